@@ -9,6 +9,8 @@ module adc_manager #(
     input  wire               trigger,
     // SPI interface
     input  wire [NUM_SDI-1:0] spi_sdi,
+    // Echo clock (SCKOUT) of the ADC, used in echo clock mode
+    input  wire               spi_echo_clk,
     output reg                spi_sdo = 0,
     output wire               spi_csn,
     output wire               spi_clk,
@@ -40,11 +42,43 @@ module adc_manager #(
     endfunction
 
     localparam integer DataWidth = 32;
+    // Number of 'NUM_SDI' bit groups sampled on each edge in DDR mode
+    localparam integer DdrGroups = DataWidth / (2 * NUM_SDI);
+
+    // Interleave the groups sampled on the rising edges ('rise') and on the
+    // falling edges ('fall') of the SPI clock in DDR mode. The first group of
+    // a conversion is sampled on the first rising edge, the second one on
+    // the following falling edge, and so on:
+    //
+    //   {rise[n-1], fall[n-1], rise[n-2], fall[n-2], ..., rise[0], fall[0]}
+    //
+    // where group 'i' is bits 'i * NUM_SDI' and up.
+    function automatic [DataWidth-1:0] interleave;
+        input reg [DataWidth/2-1:0] rise;
+        input reg [DataWidth/2-1:0] fall;
+        integer group;
+        begin
+            for (group = 0; group < DdrGroups; group = group + 1) begin
+                interleave[2*group*NUM_SDI+:NUM_SDI] = fall[group*NUM_SDI+:NUM_SDI];
+                interleave[(2*group+1)*NUM_SDI+:NUM_SDI] = rise[group*NUM_SDI+:NUM_SDI];
+            end
+        end
+    endfunction
     assign spi_resetn = aresetn;
 
-    // Internal register holding the data that came from the ADC
+    // Internal register holding the data that came from the ADC. In DDR
+    // mode, it only holds the groups sampled on the rising edges and
+    // 'cnv_data_fall' the ones sampled on the falling edges.
     reg [DataWidth-1:0] cnv_data = 0;
-    assign m_axis_tdata = cnv_data;
+    reg [DataWidth/2-1:0] cnv_data_fall = 0;
+    // Set if the ADC was configured for DDR data output or for the echo
+    // clock mode, follows the writes to the mode register
+    reg ddr = 0;
+    reg echo = 0;
+    // Conversion result captured with the echo clock, see 'adc_manager_echo'
+    wire [DataWidth-1:0] echo_data;
+    assign m_axis_tdata = echo ? echo_data :
+                          ddr ? interleave(cnv_data[DataWidth/2-1:0], cnv_data_fall) : cnv_data;
 
     // Internal register holding the register data to be written to
     // the ADC
@@ -55,6 +89,7 @@ module adc_manager #(
     localparam integer IdxDataSize = $clog2(DataWidth + 1);
     reg [IdxDataSize-1:0] data_idx = 0;
     localparam integer MaxIdxCnv = DataWidth / NUM_SDI;
+    localparam integer MaxIdxCnvDdr = DdrGroups;
     localparam integer MaxIdxReg = 24;
 
     // Device modes
@@ -68,6 +103,27 @@ module adc_manager #(
 
     localparam reg [23:0] ExitReg = {1'b0, 15'h0014, 8'd1};
     //                write mode ----^^^^  ^^^^^^^^---- address
+    localparam reg [15:0] ModeReg = {1'b0, 15'h0020};
+    // DDR_MD bit and CLK_MD field of the mode register
+    localparam integer ModeDdrBit = 3;
+    localparam reg [1:0] ClkModeEcho = 2'b01;
+
+    // Echo clock mode: the ADC returns the SPI clock on SCKOUT alongside the
+    // data, such that the data can be sampled with it regardless of the
+    // round-trip delay through the level shifters. 'adc_manager_echo'
+    // captures the data in the echo clock domain and hands it over through
+    // a small FIFO. The data is read at single data rate, DDR_MD is ignored.
+    // At the end of a conversion, the transaction is held open until the
+    // result arrived, or for 'EchoTimeout' cycles. A result that did not
+    // arrive in time is lost and flagged in 'echo_lost' until the mode
+    // register is written again.
+    localparam integer EchoTimeout = 8;
+    reg [3:0] echo_wait = 0;
+    reg echo_lost = 0;
+    wire echo_empty;
+    wire echo_start = ~transaction_active & ~cs & (device_mode == Conversion) & trigger;
+    wire echo_done = transaction_active & (data_idx == 0) & (device_mode == Conversion) & echo;
+    wire echo_pending = echo_done & echo_empty & (echo_wait != EchoTimeout[3:0]);
 
     // Used to gate the SPI clock
     reg spi_clk_enable = 0;
@@ -92,7 +148,9 @@ module adc_manager #(
     assign status[1] = reg_available;
     assign status[3:2] = device_mode;
     assign status[4] = m_axis_tvalid;
-    assign status[7:5] = 0;
+    assign status[5] = ddr;
+    assign status[6] = echo;
+    assign status[7] = echo_lost;
     assign status[31:8] = reg_data;
 
     always @(posedge spi_clk or negedge aresetn or negedge spi_csn) begin
@@ -104,7 +162,8 @@ module adc_manager #(
             if (~spi_csn && !transaction_active) begin
                 // CSn was just asserted, setup counter
                 if (device_mode == Conversion) begin
-                    data_idx <= MaxIdxCnv[IdxDataSize-1:0];
+                    data_idx <= (ddr & ~echo) ? MaxIdxCnvDdr[IdxDataSize-1:0] :
+                                MaxIdxCnv[IdxDataSize-1:0];
                     spi_sdo  <= 0;
                 end else begin
                     data_idx <= MaxIdxReg[IdxDataSize-1:0];
@@ -125,6 +184,10 @@ module adc_manager #(
                     // The 'NUM_SDI' least significant bits of 'spi_data_in'
                     // are dropped and 'spi_sdo' is added to the most
                     // significant bits on the right.
+                    //
+                    // In DDR mode, the same happens on the rising edges,
+                    // the groups in between are sampled on the falling
+                    // edges below.
                     cnv_data <= {cnv_data[DataWidth-1-NUM_SDI:0], reverse(spi_sdi)};
                 end else begin
                     // NOTE: Because the first bit is already shifted out
@@ -144,9 +207,26 @@ module adc_manager #(
         end
     end
 
+    // Second half of the DDR capture. The SPI clock only runs during
+    // transactions and a conversion has exactly 'DdrGroups' falling edges,
+    // which shift out whatever register accesses left behind. The last
+    // group is sampled half a clock cycle after the last rising edge, before
+    // 'm_axis_tvalid' is asserted.
+    always @(negedge spi_clk or negedge aresetn) begin
+        if (!aresetn) begin
+            cnv_data_fall <= 0;
+        end else begin
+            cnv_data_fall <= {cnv_data_fall[DataWidth/2-1-NUM_SDI:0], reverse(spi_sdi)};
+        end
+    end
+
     always @(posedge aclk or negedge aresetn) begin
         if (!aresetn) begin
             reg_data <= 0;
+            ddr <= 0;
+            echo <= 0;
+            echo_wait <= 0;
+            echo_lost <= 0;
             transaction_active <= 0;
             spi_clk_enable <= 0;
             m_axis_tvalid <= 0;
@@ -176,13 +256,26 @@ module adc_manager #(
                     reg_available <= 0;
                 end
             end else begin
-                if (data_idx == 0) begin
+                if (echo_pending) begin
+                    // The clock is stopped, wait for the echo clock domain
+                    echo_wait <= echo_wait + 1;
+                end else if (data_idx == 0) begin
                     transaction_active <= 0;
                     spi_clk_enable <= 0;
                     cs <= 0;
+                    echo_wait <= 0;
                     if (device_mode == Conversion) begin
-                        m_axis_tvalid <= 1;
+                        if (echo && echo_empty) begin
+                            echo_lost <= 1;
+                        end else begin
+                            m_axis_tvalid <= 1;
+                        end
                     end else begin
+                        if (device_mode == RegAccess && reg_data[23:8] == ModeReg) begin
+                            ddr <= reg_data[ModeDdrBit];
+                            echo <= reg_data[5:4] == ClkModeEcho;
+                            echo_lost <= 0;
+                        end
                         if (reg_data[23:21] == 3'b101) begin
                             device_mode <= RegAccess;
                         end else if (reg_data == ExitReg || device_mode == RegAccessOnce) begin
@@ -199,4 +292,139 @@ module adc_manager #(
             end
         end
     end
+
+    adc_manager_echo #(
+        .NUM_SDI(NUM_SDI),
+        .DATA_WIDTH(DataWidth)
+    ) echo_capture (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .echo_clk(spi_echo_clk),
+        .spi_csn(spi_csn),
+        .spi_sdi(reverse(spi_sdi)),
+        .capture(device_mode == Conversion),
+        .flush(echo_start),
+        .pop(echo_done & ~echo_empty),
+        .empty(echo_empty),
+        .data(echo_data)
+    );
+endmodule
+
+module adc_manager_echo #(
+    parameter integer NUM_SDI = 4,
+    parameter integer DATA_WIDTH = 32,
+    parameter integer LOG2_DEPTH = 2
+) (
+    input  wire                  aclk,
+    input  wire                  aresetn,
+    // Echo clock domain
+    input  wire                  echo_clk,
+    input  wire                  spi_csn,
+    input  wire [   NUM_SDI-1:0] spi_sdi,
+    // 'aclk' domain, 'capture' only changes while 'spi_csn' is high
+    input  wire                  capture,
+    input  wire                  flush,
+    input  wire                  pop,
+    output wire                  empty,
+    output reg  [DATA_WIDTH-1:0] data = 0
+);
+    // The lanes are sampled on the rising edges of the echo clock, in the
+    // same order as in 'adc_manager'. The edges of a transaction are counted
+    // from the falling edge of CSn. On the last edge of a conversion, the
+    // complete result is written into an asynchronous FIFO with gray-coded
+    // pointers: the echo clock stops right after, so the write has to
+    // happen on that very edge. Only registered gray pointers cross the clock
+    // domains. Register accesses are not captured.
+    //
+    // 'flush' drops results left over from a conversion that timed out,
+    // 'pop' reads the oldest result into 'data'.
+    localparam integer Groups = DATA_WIDTH / NUM_SDI;
+    localparam integer LastGroup = Groups - 1;
+    localparam integer Depth = 1 << LOG2_DEPTH;
+    localparam integer GroupBits = $clog2(Groups + 1);
+
+    function automatic [LOG2_DEPTH:0] to_gray(input [LOG2_DEPTH:0] value);
+        to_gray = value ^ (value >> 1);
+    endfunction
+
+    function automatic [LOG2_DEPTH:0] from_gray(input [LOG2_DEPTH:0] value);
+        integer bit_index;
+        begin
+            from_gray[LOG2_DEPTH] = value[LOG2_DEPTH];
+            for (bit_index = LOG2_DEPTH - 1; bit_index >= 0; bit_index = bit_index - 1) begin
+                from_gray[bit_index] = from_gray[bit_index+1] ^ value[bit_index];
+            end
+        end
+    endfunction
+
+    reg [DATA_WIDTH-1:0] memory[0:Depth-1];
+
+    // Echo clock domain
+    reg [ GroupBits-1:0] group = 0;
+    reg [DATA_WIDTH-1:0] shift = 0;
+    reg [LOG2_DEPTH:0] write_ptr = 0;
+    reg [LOG2_DEPTH:0] write_gray = 0;
+    reg [LOG2_DEPTH:0] read_gray_meta = 0;
+    reg [LOG2_DEPTH:0] read_gray_sync = 0;
+    wire [DATA_WIDTH-1:0] word = {shift[DATA_WIDTH-1-NUM_SDI:0], spi_sdi};
+    wire full = write_gray ==
+        {~read_gray_sync[LOG2_DEPTH:LOG2_DEPTH-1], read_gray_sync[LOG2_DEPTH-2:0]};
+    wire write = capture & (group == LastGroup[GroupBits-1:0]) & ~full;
+
+    // 'aclk' domain
+    reg [LOG2_DEPTH:0] read_ptr = 0;
+    reg [LOG2_DEPTH:0] read_gray = 0;
+    reg [LOG2_DEPTH:0] write_gray_meta = 0;
+    reg [LOG2_DEPTH:0] write_gray_sync = 0;
+    assign empty = read_gray == write_gray_sync;
+
+    always @(posedge echo_clk or posedge spi_csn) begin
+        if (spi_csn) begin
+            group <= 0;
+        end else if (group != Groups[GroupBits-1:0]) begin
+            group <= group + 1;
+        end
+    end
+
+    always @(posedge echo_clk) begin
+        shift <= word;
+        if (write) memory[write_ptr[LOG2_DEPTH-1:0]] <= word;
+    end
+
+    always @(posedge echo_clk or negedge aresetn) begin
+        if (!aresetn) begin
+            write_ptr      <= 0;
+            write_gray     <= 0;
+            read_gray_meta <= 0;
+            read_gray_sync <= 0;
+        end else begin
+            read_gray_meta <= read_gray;
+            read_gray_sync <= read_gray_meta;
+            if (write) begin
+                write_ptr  <= write_ptr + 1;
+                write_gray <= to_gray(write_ptr + 1);
+            end
+        end
+    end
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            read_ptr        <= 0;
+            read_gray       <= 0;
+            write_gray_meta <= 0;
+            write_gray_sync <= 0;
+            data            <= 0;
+        end else begin
+            write_gray_meta <= write_gray;
+            write_gray_sync <= write_gray_meta;
+            if (flush) begin
+                read_ptr  <= from_gray(write_gray_sync);
+                read_gray <= write_gray_sync;
+            end else if (pop && !empty) begin
+                data      <= memory[read_ptr[LOG2_DEPTH-1:0]];
+                read_ptr  <= read_ptr + 1;
+                read_gray <= to_gray(read_ptr + 1);
+            end
+        end
+    end
 endmodule
@@ -12,6 +12,8 @@ module adc_impl #(
 
     input wire sdi,
     output reg [3:0] sdo = 0,
+    // Echo clock, follows 'sck' if enabled in the mode register
+    output reg sckout = 0,
 
     input  reg [31:0] test_pattern,
     output reg [23:0] reg_command
@@ -23,6 +25,17 @@ module adc_impl #(
     localparam reg [1:0] LaneModeTwo = 2'b01;
     localparam reg [1:0] LaneModeFour = 2'b10;
     reg [1:0] lane_md = LaneModeOne;
+    // In DDR mode, the data is shifted out on both edges of 'sck'
+    reg ddr_md = 0;
+    wire sck_fall = ddr_md & ~sck;
+    // Clock mode, 'sckout' is only driven in echo clock mode
+    localparam reg [1:0] ClkModeEcho = 2'b01;
+    reg [1:0] clk_md = 0;
+    // Delays of 'sdo' and 'sckout' from the edges of 'sck', including the
+    // round trip through the level shifters
+    real sdo_delay = 8.1;
+    real echo_delay = 0.0;
+    bit echo_connected = 1;
     reg data_ready = 0;
     reg device_mode = Conversion;
 
@@ -48,12 +61,16 @@ module adc_impl #(
         if (!resetn) begin
             device_mode <= Conversion;
             lane_md <= LaneModeOne;
+            ddr_md <= 0;
+            clk_md <= 0;
         end else begin
             if (reg_command[23:21] == 3'b101) begin
                 device_mode <= RegAccess;
             end else if (device_mode == RegAccess) begin
                 if (reg_command[23:8] == {1'b0, ModeReg}) begin
                     lane_md <= reg_command[7:6];
+                    ddr_md <= reg_command[3];
+                    clk_md <= reg_command[5:4];
                 end else if (reg_command[23:8] == {1'b0, ExitReg}) begin
                     if (reg_command[0]) begin
                         device_mode <= Conversion;
@@ -63,7 +80,9 @@ module adc_impl #(
         end
     end
 
-    always @(posedge sck or negedge csn or posedge cnv or negedge resetn) begin
+    always @(sck) sckout <= #(echo_delay) sck & echo_connected & (clk_md == ClkModeEcho);
+
+    always @(posedge sck or posedge sck_fall or negedge csn or posedge cnv or negedge resetn) begin
         if (!resetn) begin
             data_ready <= 0;
             data_idx <= 0;
@@ -80,15 +99,15 @@ module adc_impl #(
             end else begin
                 case (lane_md)
                     LaneModeFour: begin
-                        sdo[3:0] <= #(8.1) {<<{test_pattern[data_idx-4+:4]}};
+                        sdo[3:0] <= #(sdo_delay) {<<{test_pattern[data_idx-4+:4]}};
                         data_idx <= data_idx - 4;
                     end
                     LaneModeTwo: begin
-                        sdo[1:0] <= #(8.1) {<<{test_pattern[data_idx-2+:2]}};
+                        sdo[1:0] <= #(sdo_delay) {<<{test_pattern[data_idx-2+:2]}};
                         data_idx <= data_idx - 2;
                     end
                     default: begin
-                        sdo[0]   <= #(8.1) test_pattern[data_idx-1];
+                        sdo[0]   <= #(sdo_delay) test_pattern[data_idx-1];
                         data_idx <= data_idx - 1;
                     end
                 endcase
@@ -122,6 +141,7 @@ module adc_manager_tb #(
     wire sck;
     wire mosi;
     wire [3:0] miso;
+    wire sckout;
     wire resetn;
     wire csn;
     wire ready;
@@ -143,6 +163,10 @@ module adc_manager_tb #(
 
     wire [31:0] status;
 
+    // SPI clock cycles of the last transaction
+    integer sck_cycles = 0;
+    integer last_sck_cycles = 0;
+
     adc_impl adc (
         .cnv(cnv),
         .busy(busy),
@@ -151,6 +175,7 @@ module adc_manager_tb #(
         .resetn(resetn),
         .sdi(mosi),
         .sdo(miso),
+        .sckout(sckout),
         .test_pattern(test_pattern),
         .reg_command(reg_command_received)
     );
@@ -161,6 +186,7 @@ module adc_manager_tb #(
         .aclk(clk),
         .aresetn(aresetn),
         .spi_sdi(miso),
+        .spi_echo_clk(sckout),
         .spi_sdo(mosi),
         .spi_csn(csn),
         .spi_clk(sck),
@@ -187,6 +213,21 @@ module adc_manager_tb #(
         end
     end
 
+    always @(posedge sck or negedge csn) begin
+        if (!csn && !sck) sck_cycles <= 0;
+        else sck_cycles <= sck_cycles + 1;
+    end
+
+    always @(posedge csn) last_sck_cycles <= sck_cycles;
+
+    task automatic write_reg(input [23:0] command);
+        begin
+            m_axis_tdata = {8'b0, command};
+            @(posedge clk) m_axis_tvalid = 1;
+            @(negedge m_axis_tready) m_axis_tvalid = 0;
+        end
+    endtask
+
     always @(negedge busy) begin
         trigger <= 1;
         trigger <= #(3 * Period) 0;
@@ -235,6 +276,64 @@ module adc_manager_tb #(
         if (axis_data_received == test_pattern) begin
             $display("Test pattern received from ADC");
         end else $error("Received invalid data");
+        if (last_sck_cycles != 8) $error("SDR conversion took %0d clock cycles", last_sck_cycles);
+        if (status[5]) $error("DDR mode reported");
+
+        // Switch to DDR, the same data is read out in half the clock cycles
+        @(posedge clk) cnv_clk_en = 0;
+        #(4 * CnvPeriod);
+        write_reg({3'b101, 21'b0});
+        write_reg({1'b0, 15'h0020, 2'b10, 6'b001000});
+        write_reg({1'b0, 15'h0014, 8'h01});
+        @(posedge m_axis_tready)
+        if (!status[5]) $error("DDR mode not detected");
+
+        #(4 * Period);
+        test_pattern = 32'h1E5C0DE8;
+        @(posedge clk) cnv_clk_en = 1;
+        @(negedge s_axis_tvalid);
+        @(negedge s_axis_tvalid)
+        if (axis_data_received == test_pattern) begin
+            $display("Test pattern received from ADC in DDR mode");
+        end else $error("Received invalid data in DDR mode: %x", axis_data_received);
+        if (last_sck_cycles != 4) $error("DDR conversion took %0d clock cycles", last_sck_cycles);
+
+        #(4 * Period) test_pattern = 32'hA5F0_0F5A;
+        @(negedge s_axis_tvalid);
+        @(negedge s_axis_tvalid)
+        if (axis_data_received != test_pattern)
+            $error("Received invalid data in DDR mode: %x", axis_data_received);
+
+        // Echo clock mode with a round trip longer than a clock period, the
+        // data is sampled with the echo clock
+        @(posedge clk) cnv_clk_en = 0;
+        #(4 * CnvPeriod);
+        adc.sdo_delay = 24.0;
+        adc.echo_delay = 21.0;
+        write_reg({3'b101, 21'b0});
+        write_reg({1'b0, 15'h0020, 2'b10, 6'b010000});
+        write_reg({1'b0, 15'h0014, 8'h01});
+        @(posedge m_axis_tready)
+        if (!status[6] || status[5]) $error("Echo clock mode not detected");
+
+        #(4 * Period);
+        test_pattern = 32'h5EC0_7D1A;
+        @(posedge clk) cnv_clk_en = 1;
+        @(negedge s_axis_tvalid);
+        @(negedge s_axis_tvalid)
+        if (axis_data_received == test_pattern) begin
+            $display("Test pattern received from ADC in echo clock mode");
+        end else $error("Received invalid data in echo clock mode: %x", axis_data_received);
+        if (last_sck_cycles != 8)
+            $error("Echo clock conversion took %0d clock cycles", last_sck_cycles);
+        if (status[7]) $error("Echo clock reported lost");
+
+        // Without the echo clock, the conversions are dropped and flagged
+        adc.echo_connected = 0;
+        test_pattern = 32'h0BAD_EC40;
+        #(6 * CnvPeriod);
+        if (!status[7]) $error("Missing echo clock not detected");
+        if (axis_data_received == test_pattern) $error("Conversion without echo clock forwarded");
         $finish();
     end
 
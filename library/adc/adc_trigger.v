@@ -8,6 +8,9 @@ module adc_trigger (
     input  wire        busy,
     input  wire        last,
     input  wire        ready,
+    // Current registers, copied into the block headers of 'packetizer'
+    output wire [31:0] divider,
+    output wire [31:0] cfg,
     // AXI4-Lite subordinate
     input  wire [31:0] s_axi_lite_awaddr,
     input  wire [ 2:0] s_axi_lite_awprot,
@@ -216,6 +219,9 @@ module adc_trigger (
         end
     end
 
+    assign divider = divider_reg;
+    assign cfg = config_reg;
+
     adc_trigger_impl adc_trigger_0 (
         .clk(aclk),
         .resetn(aresetn),
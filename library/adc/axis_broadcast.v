@@ -0,0 +1,49 @@
+`timescale 1ns / 1ps
+
+module axis_broadcast (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data managers, one per path
+    output wire [31:0] m_axis_0_tdata,
+    output wire        m_axis_0_tvalid,
+    input  wire        m_axis_0_tready,
+    output wire [31:0] m_axis_1_tdata,
+    output wire        m_axis_1_tvalid,
+    input  wire        m_axis_1_tready
+);
+    // Splits the conversion results into two paths in the dual-stream
+    // variant of the block design, each with its own FIFO, packetizer and
+    // DMA channel. Every sample goes to both managers. A manager that
+    // accepted the sample does not see it again while the other one still
+    // holds it back, the sample is accepted on the subordinate once both
+    // have taken it.
+    //
+    // Both paths start with an 'axis_fifo', which never holds back a
+    // sample, such that neither path stalls the other.
+    reg  taken_0 = 1'b0;
+    reg  taken_1 = 1'b0;
+
+    wire done_0 = taken_0 | m_axis_0_tready;
+    wire done_1 = taken_1 | m_axis_1_tready;
+
+    assign s_axis_data_tready = done_0 & done_1;
+    assign m_axis_0_tdata = s_axis_data_tdata;
+    assign m_axis_0_tvalid = s_axis_data_tvalid & ~taken_0;
+    assign m_axis_1_tdata = s_axis_data_tdata;
+    assign m_axis_1_tvalid = s_axis_data_tvalid & ~taken_1;
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            taken_0 <= 0;
+            taken_1 <= 0;
+        end else if (s_axis_data_tvalid) begin
+            // Start over with the next sample once both took this one
+            taken_0 <= done_0 & ~s_axis_data_tready;
+            taken_1 <= done_1 & ~s_axis_data_tready;
+        end
+    end
+endmodule
@@ -0,0 +1,107 @@
+`timescale 1ns / 1ps
+
+module axis_broadcast_tb #(
+    parameter real CLK_FREQ = 125.0
+);
+    localparam integer Period = $rtoi(1_000.0 / (2.0 * CLK_FREQ));
+
+    bit         clk = 0;
+    bit         resetn = 0;
+
+    reg  [31:0] s_axis_data_tdata = 32'b0;
+    reg         s_axis_data_tvalid = 1'b0;
+    wire        s_axis_data_tready;
+    wire [31:0] m_axis_0_tdata;
+    wire        m_axis_0_tvalid;
+    reg         m_axis_0_tready = 1'b0;
+    wire [31:0] m_axis_1_tdata;
+    wire        m_axis_1_tvalid;
+    reg         m_axis_1_tready = 1'b0;
+
+    // The source sends consecutive numbers, each sink is ready with its own
+    // probability in percent and expects every number once and in order
+    integer     ready_0 = 50;
+    integer     ready_1 = 50;
+    reg         run = 1'b0;
+    reg  [31:0] sent = 32'b0;
+    reg  [31:0] expected_0 = 32'b0;
+    reg  [31:0] expected_1 = 32'b0;
+
+    axis_broadcast dut (
+        .aclk(clk),
+        .aresetn(resetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_0_tdata(m_axis_0_tdata),
+        .m_axis_0_tvalid(m_axis_0_tvalid),
+        .m_axis_0_tready(m_axis_0_tready),
+        .m_axis_1_tdata(m_axis_1_tdata),
+        .m_axis_1_tvalid(m_axis_1_tvalid),
+        .m_axis_1_tready(m_axis_1_tready)
+    );
+
+    always #(Period) clk <= ~clk;
+
+    always @(posedge clk) begin
+        if (resetn) begin
+            if (s_axis_data_tvalid && s_axis_data_tready) s_axis_data_tvalid <= 0;
+            if (run && (!s_axis_data_tvalid || s_axis_data_tready) && 1'($urandom() % 2)) begin
+                s_axis_data_tdata  <= sent;
+                s_axis_data_tvalid <= 1;
+                sent <= sent + 1;
+            end
+        end
+        m_axis_0_tready <= ($urandom() % 100) < ready_0;
+        m_axis_1_tready <= ($urandom() % 100) < ready_1;
+        if (m_axis_0_tvalid && m_axis_0_tready) begin
+            if (m_axis_0_tdata != expected_0)
+                $error("Manager 0 got %0d, expected %0d", m_axis_0_tdata, expected_0);
+            expected_0 <= m_axis_0_tdata + 1;
+        end
+        if (m_axis_1_tvalid && m_axis_1_tready) begin
+            if (m_axis_1_tdata != expected_1)
+                $error("Manager 1 got %0d, expected %0d", m_axis_1_tdata, expected_1);
+            expected_1 <= m_axis_1_tdata + 1;
+        end
+    end
+
+    task automatic check(input integer samples);
+        integer start;
+        begin
+            start = sent;
+            @(posedge clk) run <= 1;
+            while (sent < start + samples) @(posedge clk);
+            // Stop the source and let the last sample through
+            run <= 0;
+            ready_0 = 100;
+            ready_1 = 100;
+            while (s_axis_data_tvalid) @(posedge clk);
+            #(4 * Period);
+            if (expected_0 != sent || expected_1 != sent)
+                $error("Managers got %0d and %0d samples, %0d sent", expected_0, expected_1, sent);
+        end
+    endtask
+
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn = 1;
+
+        // Both managers ready at random, independently of each other
+        check(500);
+
+        // One manager always ready, the other one holds back most samples
+        ready_0 = 100;
+        ready_1 = 10;
+        check(200);
+        ready_0 = 10;
+        ready_1 = 100;
+        check(200);
+
+        // Both always ready, a sample every cycle
+        ready_0 = 100;
+        ready_1 = 100;
+        check(200);
+        $finish();
+    end
+endmodule
@@ -0,0 +1,367 @@
+`timescale 1ns / 1ps
+
+module axis_fifo #(
+    parameter integer LOG2_DEPTH = 10,
+    // Address of the control register, see below
+    parameter integer ADDR_BASE  = 'h0400
+) (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_data_tdata,
+    output wire        m_axis_data_tvalid,
+    input  wire        m_axis_data_tready,
+    // 'ready' to 'adc_trigger', and 'last' and the config register of
+    // 'adc_trigger' to flush the samples after a single packet
+    output wire        ready,
+    input  wire        last,
+    input  wire [31:0] trigger_config,
+    // AXI4-Lite configuration subordinate
+    input  wire [31:0] s_axi_lite_awaddr,
+    input  wire [ 2:0] s_axi_lite_awprot,
+    input  wire        s_axi_lite_awvalid,
+    output wire        s_axi_lite_awready,
+
+    input  wire [31:0] s_axi_lite_wdata,
+    input  wire [ 3:0] s_axi_lite_wstrb,
+    input  wire        s_axi_lite_wvalid,
+    output wire        s_axi_lite_wready,
+
+    output wire [1:0] s_axi_lite_bresp,
+    output wire       s_axi_lite_bvalid,
+    input  wire       s_axi_lite_bready,
+
+    input  wire [31:0] s_axi_lite_araddr,
+    input  wire [ 2:0] s_axi_lite_arprot,
+    input  wire        s_axi_lite_arvalid,
+    output wire        s_axi_lite_arready,
+
+    output wire [31:0] s_axi_lite_rdata,
+    output wire [ 1:0] s_axi_lite_rresp,
+    output wire        s_axi_lite_rvalid,
+    input  wire        s_axi_lite_rready
+);
+    `include "axi4lite_helpers.vh"
+    // The FIFO sits between the ADC Manager and the decimator and absorbs
+    // stalls of the DMA. It always accepts samples, such that the trigger
+    // never skips a conversion, and drops the samples that arrive while it
+    // is full. Dropped samples are counted, see 'axis_fifo_impl'.
+    //
+    // After the last sample of a packet in single packet mode (CONTINUOUS
+    // of 'adc_trigger' cleared), the FIFO is flushed: the samples converted
+    // while the FIFO drained belong to no packet.
+    //
+    // Address configuration:
+    //  - Control register (write-only):
+    //      Base address: 0x?000_0400, 32-bit large.
+    //  - Level register (read-only):
+    //      Base address: 0x?000_0404, 32-bit large.
+    //  - High-water mark register (read-only):
+    //      Base address: 0x?000_0408, 32-bit large.
+    //  - Dropped samples register (read-only):
+    //      Base address: 0x?000_040C, 32-bit large.
+    //  - Overflows register (read-only):
+    //      Base address: 0x?000_0410, 32-bit large.
+    //  - Depth register (read-only):
+    //      Base address: 0x?000_0414, 32-bit large.
+    //
+    // Control register:
+    // +----------+-------+-------+
+    // | RESERVED | CLEAR | FLUSH |
+    // +----------+-------+-------+
+    // |     31-2 |     1 |     0 |
+    // +----------+-------+-------+
+    //
+    // - FLUSH: Writing 1 drops all samples in the FIFO.
+    // - CLEAR: Writing 1 resets the high-water mark, the dropped samples,
+    //     and the overflows.
+    // - RESERVED: Not in use, writing to this has no effect
+    //
+    // The level is the number of samples in the FIFO, the high-water mark
+    // the highest level since the counters were cleared. Dropped samples
+    // counts the samples that arrived while the FIFO was full, overflows
+    // the number of times the FIFO started to drop samples. Both saturate.
+    // The depth is the number of samples the FIFO holds.
+    // 'ADDR_BASE' moves the registers of another instance, e.g. the FIFO of
+    // the raw path in the dual-stream variant.
+    localparam reg [29:0] AddrControl = ADDR_BASE[29:0] + 30'h00;
+    localparam reg [29:0] AddrLevel = ADDR_BASE[29:0] + 30'h04;
+    localparam reg [29:0] AddrHighWater = ADDR_BASE[29:0] + 30'h08;
+    localparam reg [29:0] AddrDropped = ADDR_BASE[29:0] + 30'h0C;
+    localparam reg [29:0] AddrOverflows = ADDR_BASE[29:0] + 30'h10;
+    localparam reg [29:0] AddrDepth = ADDR_BASE[29:0] + 30'h14;
+    localparam reg [31:0] Depth = 1 << LOG2_DEPTH;
+
+    reg flush = 1'b0;
+    reg clear_counters = 1'b0;
+    wire [LOG2_DEPTH:0] level;
+    wire [LOG2_DEPTH:0] high_water;
+    wire [31:0] dropped;
+    wire [31:0] overflows;
+
+    reg [31:0] axi_lite_awaddr;
+    reg        axi_lite_awready;
+    reg        axi_lite_wready;
+    reg [ 1:0] axi_lite_bresp;
+    reg        axi_lite_bvalid;
+    reg [31:0] axi_lite_araddr;
+    reg        axi_lite_arready;
+    reg        axi_lite_rvalid;
+
+    assign s_axi_lite_awready = axi_lite_awready;
+    assign s_axi_lite_wready  = axi_lite_wready;
+    assign s_axi_lite_bresp   = axi_lite_bresp;
+    assign s_axi_lite_bvalid  = axi_lite_bvalid;
+    assign s_axi_lite_arready = axi_lite_arready;
+    assign s_axi_lite_rvalid  = axi_lite_rvalid;
+
+    localparam reg [1:0] StateIdle = 2'b00;
+    localparam reg [1:0] StateRaddr = 2'b01;
+    localparam reg [1:0] StateRdata = 2'b11;
+    localparam reg [1:0] StateWaddr = 2'b01;
+    localparam reg [1:0] StateWdata = 2'b11;
+
+    reg [1:0] state_write = StateIdle;
+    reg [1:0] state_read = StateIdle;
+
+    // AXI4-Lite state machine for write operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_awready <= 0;
+            axi_lite_wready <= 0;
+            axi_lite_bvalid <= 0;
+            axi_lite_awaddr <= 0;
+            state_write <= StateIdle;
+        end else begin
+            case (state_write)
+                StateIdle: begin
+                    axi_lite_awready <= 1;
+                    axi_lite_wready <= 1;
+                    state_write <= StateWaddr;
+                end
+                StateWaddr: begin
+                    if (s_axi_lite_awvalid && s_axi_lite_awready) begin
+                        axi_lite_awaddr <= s_axi_lite_awaddr;
+                        if (s_axi_lite_wvalid) begin
+                            // Set address and write is performed at the same
+                            // time, address is available from the
+                            // s_axi_lite_awaddr input.
+                            axi_lite_awready <= 1;
+                            state_write <= StateWaddr;
+                            axi_lite_bvalid <= 1;
+                        end else begin
+                            // Write will be performed in the upcoming cycles,
+                            // disable axi_lite_bvalid if it has been read.
+                            axi_lite_awready <= 0;
+                            state_write <= StateWdata;
+                            if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                        end
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                StateWdata: begin
+                    if (s_axi_lite_wvalid && axi_lite_wready) begin
+                        state_write <= StateWaddr;
+                        axi_lite_bvalid <= 1;
+                        axi_lite_awready <= 1;
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                default: state_write <= StateIdle;
+            endcase
+        end
+    end
+
+    // AXI4-Lite state machine for read operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_araddr <= 0;
+            axi_lite_arready <= 0;
+            axi_lite_rvalid <= 0;
+            state_read <= StateIdle;
+        end else begin
+            case (state_read)
+                StateIdle: begin
+                    axi_lite_arready <= 1;
+                    state_read <= StateRaddr;
+                end
+                StateRaddr: begin
+                    if (s_axi_lite_arvalid && s_axi_lite_arready) begin
+                        axi_lite_araddr <= s_axi_lite_araddr;
+                        axi_lite_rvalid <= 1;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRdata;
+                    end
+                end
+                StateRdata: begin
+                    if (s_axi_lite_rvalid && s_axi_lite_rready) begin
+                        axi_lite_rvalid <= 0;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRaddr;
+                    end
+                end
+                default: state_read <= StateIdle;
+            endcase
+        end
+    end
+
+    assign s_axi_lite_rdata = (axi_lite_araddr[29:2] == AddrLevel[29:2])
+                              ? {{(31 - LOG2_DEPTH) {1'b0}}, level} :
+                              (axi_lite_araddr[29:2] == AddrHighWater[29:2])
+                              ? {{(31 - LOG2_DEPTH) {1'b0}}, high_water} :
+                              (axi_lite_araddr[29:2] == AddrDropped[29:2]) ? dropped :
+                              (axi_lite_araddr[29:2] == AddrOverflows[29:2]) ? overflows :
+                              (axi_lite_araddr[29:2] == AddrDepth[29:2]) ? Depth : 0;
+    assign s_axi_lite_rresp = (axi_lite_araddr[29:2] == AddrControl[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrLevel[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrHighWater[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrDropped[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrOverflows[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrDepth[29:2]) ? 2'b00 : 2'b10;
+
+    // AXI4-Lite write logic
+    wire [29:0] write_addr = (s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:0] : axi_lite_awaddr[29:0];
+    wire [31:0] control_write = write_register(s_axi_lite_wdata, s_axi_lite_wstrb, 32'b0);
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            flush <= 0;
+            clear_counters <= 0;
+            axi_lite_bresp <= 2'b00;
+        end else begin
+            // Both are asserted for a single cycle
+            flush <= 0;
+            clear_counters <= 0;
+            if (s_axi_lite_wvalid) begin
+                if (write_addr[29:2] == AddrControl[29:2]) begin
+                    flush <= control_write[0];
+                    clear_counters <= control_write[1];
+                    axi_lite_bresp <= 2'b00;
+                end else begin
+                    // The other registers are read-only registers
+                    axi_lite_bresp <= 2'b10;
+                end
+            end
+        end
+    end
+
+    axis_fifo_impl #(
+        .LOG2_DEPTH(LOG2_DEPTH)
+    ) impl (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .flush(flush | (last & ~trigger_config[0])),
+        .clear_counters(clear_counters),
+        .level(level),
+        .high_water(high_water),
+        .dropped(dropped),
+        .overflows(overflows)
+    );
+    assign ready = s_axis_data_tready;
+endmodule
+
+module axis_fifo_impl #(
+    parameter integer LOG2_DEPTH = 10
+) (
+    input  wire                aclk,
+    input  wire                aresetn,
+    // AXI-Stream data subordinate
+    input  wire [        31:0] s_axis_data_tdata,
+    input  wire                s_axis_data_tvalid,
+    output wire                s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [        31:0] m_axis_data_tdata,
+    output wire                m_axis_data_tvalid,
+    input  wire                m_axis_data_tready,
+    // Control
+    input  wire                flush,
+    input  wire                clear_counters,
+    // Status
+    output wire [LOG2_DEPTH:0] level,
+    output reg  [LOG2_DEPTH:0] high_water = 0,
+    output reg  [        31:0] dropped = 32'b0,
+    output reg  [        31:0] overflows = 32'b0
+);
+    // First-word-fall-through FIFO of 2^LOG2_DEPTH samples in block RAM,
+    // followed by an output register. The memory is read as soon as the
+    // output register is empty or forwarded, a sample takes two cycles from
+    // the input to the output.
+    //
+    // 'tready' is always asserted, a sample that arrives while the FIFO is
+    // full is dropped and counted in 'dropped'. 'overflows' counts the
+    // transitions from storing to dropping samples. 'flush' drops all
+    // samples, including one that arrives in the same cycle.
+    reg [31:0] memory[0:(1 << LOG2_DEPTH)-1];
+    reg [LOG2_DEPTH:0] write_ptr = 0;
+    reg [LOG2_DEPTH:0] read_ptr = 0;
+    reg [31:0] out_data = 32'b0;
+    reg out_valid = 1'b0;
+    reg dropping = 1'b0;
+
+    wire [LOG2_DEPTH:0] stored = write_ptr - read_ptr;
+    wire full = stored[LOG2_DEPTH];
+    wire empty = stored == 0;
+    wire write = s_axis_data_tvalid & ~full & ~flush;
+    wire read = ~empty & ~flush & (~out_valid | m_axis_data_tready);
+
+    assign s_axis_data_tready = 1'b1;
+    assign m_axis_data_tdata = out_data;
+    assign m_axis_data_tvalid = out_valid;
+    assign level = stored + {{LOG2_DEPTH{1'b0}}, out_valid};
+
+    // Block RAM, without a reset
+    always @(posedge aclk) begin
+        if (write) memory[write_ptr[LOG2_DEPTH-1:0]] <= s_axis_data_tdata;
+        if (read) out_data <= memory[read_ptr[LOG2_DEPTH-1:0]];
+    end
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            write_ptr <= 0;
+            read_ptr <= 0;
+            out_valid <= 0;
+            dropping <= 0;
+            high_water <= 0;
+            dropped <= 0;
+            overflows <= 0;
+        end else begin
+            if (flush) begin
+                read_ptr  <= write_ptr;
+                out_valid <= 0;
+            end else begin
+                if (write) write_ptr <= write_ptr + 1;
+                if (read) begin
+                    read_ptr  <= read_ptr + 1;
+                    out_valid <= 1;
+                end else if (m_axis_data_tready) begin
+                    out_valid <= 0;
+                end
+            end
+            if (s_axis_data_tvalid && full && !flush) begin
+                if (~&dropped) dropped <= dropped + 1;
+                if (!dropping && ~&overflows) overflows <= overflows + 1;
+                dropping <= 1;
+            end else if (write) begin
+                dropping <= 0;
+            end
+            if (level > high_water) high_water <= level;
+            if (clear_counters) begin
+                high_water <= 0;
+                dropped <= 0;
+                overflows <= 0;
+                dropping <= 0;
+            end
+        end
+    end
+endmodule
@@ -0,0 +1,151 @@
+`timescale 1ns / 1ps
+
+module axis_fifo_tb #(
+    parameter real CLK_FREQ = 125.0
+);
+    localparam integer Period = $rtoi(1_000.0 / (2.0 * CLK_FREQ));
+    localparam integer Log2Depth = 4;
+    // The FIFO and the output register
+    localparam integer Capacity = (1 << Log2Depth) + 1;
+
+    bit         clk = 0;
+    bit         resetn = 0;
+
+    reg  [31:0] s_axis_data_tdata = 32'b0;
+    reg         s_axis_data_tvalid = 1'b0;
+    wire        s_axis_data_tready;
+    wire [31:0] m_axis_data_tdata;
+    wire        m_axis_data_tvalid;
+    reg         m_axis_data_tready = 1'b0;
+
+    reg         flush = 1'b0;
+    reg         clear_counters = 1'b0;
+    wire [Log2Depth:0] level;
+    wire [Log2Depth:0] high_water;
+    wire [31:0] dropped;
+    wire [31:0] overflows;
+
+    // The source sends sample 'n' every 'interval' cycles like the ADC, the
+    // sink is ready at random unless the DMA 'stall's.
+    integer     interval = 4;
+    integer     phase = 0;
+    reg         stall = 1'b0;
+    reg  [31:0] sent = 32'b0;
+    // The next sample expected by the sink, samples missing before it, and
+    // the highest level seen
+    reg  [31:0] expected = 32'b0;
+    reg  [31:0] missing = 32'b0;
+    reg         resync = 1'b0;
+    reg  [Log2Depth:0] max_level = 0;
+
+    axis_fifo_impl #(
+        .LOG2_DEPTH(Log2Depth)
+    ) dut (
+        .aclk(clk),
+        .aresetn(resetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .flush(flush),
+        .clear_counters(clear_counters),
+        .level(level),
+        .high_water(high_water),
+        .dropped(dropped),
+        .overflows(overflows)
+    );
+
+    always #(Period) clk <= ~clk;
+
+    always @(posedge clk) begin
+        if (resetn) begin
+            phase <= (phase + 1 >= interval) ? 0 : phase + 1;
+            s_axis_data_tvalid <= (phase == 0);
+            if (phase == 0) begin
+                s_axis_data_tdata <= sent;
+                sent <= sent + 1;
+            end
+        end
+        m_axis_data_tready <= ~stall & 1'($urandom() % 2);
+        if (!s_axis_data_tready) $error("Sample held back");
+        if (level > max_level) max_level <= level;
+        if (flush) resync <= 1;
+        if (clear_counters) begin
+            missing   <= 0;
+            max_level <= 0;
+        end
+        if (m_axis_data_tvalid && m_axis_data_tready) begin
+            if (!resync && m_axis_data_tdata < expected)
+                $error("Sample %0d out of order, expected %0d", m_axis_data_tdata, expected);
+            if (!resync) missing <= missing + (m_axis_data_tdata - expected);
+            resync   <= 0;
+            expected <= m_axis_data_tdata + 1;
+        end
+    end
+
+    task automatic pulse_clear;
+        begin
+            @(posedge clk) clear_counters <= 1;
+            @(posedge clk) clear_counters <= 0;
+        end
+    endtask
+
+    task automatic check_counters(input [31:0] drops, input [31:0] events);
+        begin
+            if (missing != drops) $error("%0d samples missing, expected %0d", missing, drops);
+            if (dropped != missing)
+                $error("%0d samples dropped, but %0d missing", dropped, missing);
+            if (overflows != events) $error("%0d overflows, expected %0d", overflows, events);
+            if (high_water != max_level)
+                $error("High-water mark %0d, highest level %0d", high_water, max_level);
+        end
+    endtask
+
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn = 1;
+
+        // The sink is faster than the source on average, nothing is lost
+        while (sent < 400) @(posedge clk);
+        check_counters(0, 0);
+
+        // The DMA stalls for longer than the FIFO lasts, the FIFO fills up
+        // and drops the rest. Every dropped sample is counted.
+        pulse_clear();
+        @(posedge clk) stall <= 1;
+        #(2 * 40 * 4 * Period);
+        @(posedge clk) stall <= 0;
+        if (high_water != (Log2Depth + 1)'(Capacity)) $error("FIFO not full after the stall");
+        while (level != 0) @(posedge clk);
+        #(40 * Period);
+        @(posedge clk) check_counters(dropped, 1);
+        if (dropped < 40 - Capacity - 2 || dropped > 40 - Capacity + 2)
+            $error("Dropped %0d samples in a stall of 40 samples", dropped);
+
+        // Two stalls at a higher rate, two overflows
+        pulse_clear();
+        interval = 3;
+        repeat (2) begin
+            @(posedge clk) stall <= 1;
+            #(2 * 3 * 2 * Capacity * Period);
+            @(posedge clk) stall <= 0;
+            while (level != 0) @(posedge clk);
+        end
+        @(posedge clk) check_counters(dropped, 2);
+
+        // Flushing drops the samples in the FIFO without counting them
+        pulse_clear();
+        interval = 4;
+        @(posedge clk) stall <= 1;
+        #(2 * 8 * 4 * Period);
+        @(posedge clk) flush <= 1;
+        @(posedge clk) flush <= 0;
+        #1 if (level != 0) $error("FIFO not empty after the flush");
+        stall <= 0;
+        #(2 * 40 * Period);
+        @(posedge clk) check_counters(0, 0);
+        $finish();
+    end
+endmodule
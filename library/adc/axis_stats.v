@@ -0,0 +1,384 @@
+`timescale 1ns / 1ps
+
+module axis_stats (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_data_tdata,
+    output wire        m_axis_data_tvalid,
+    input  wire        m_axis_data_tready,
+    // AXI4-Lite configuration subordinate
+    input  wire [31:0] s_axi_lite_awaddr,
+    input  wire [ 2:0] s_axi_lite_awprot,
+    input  wire        s_axi_lite_awvalid,
+    output wire        s_axi_lite_awready,
+
+    input  wire [31:0] s_axi_lite_wdata,
+    input  wire [ 3:0] s_axi_lite_wstrb,
+    input  wire        s_axi_lite_wvalid,
+    output wire        s_axi_lite_wready,
+
+    output wire [1:0] s_axi_lite_bresp,
+    output wire       s_axi_lite_bvalid,
+    input  wire       s_axi_lite_bready,
+
+    input  wire [31:0] s_axi_lite_araddr,
+    input  wire [ 2:0] s_axi_lite_arprot,
+    input  wire        s_axi_lite_arvalid,
+    output wire        s_axi_lite_arready,
+
+    output wire [31:0] s_axi_lite_rdata,
+    output wire [ 1:0] s_axi_lite_rresp,
+    output wire        s_axi_lite_rvalid,
+    input  wire        s_axi_lite_rready
+);
+    `include "axi4lite_helpers.vh"
+    // The statistics tap passes the samples of the ADC Manager through
+    // unchanged and accumulates the number of samples, their sum, the sum of
+    // their squares, and their minimum and maximum over windows of a fixed
+    // number of samples. Housekeeping values like the offset and the noise
+    // are available without moving the samples through the DMA.
+    //
+    // The samples are the signed 24-bit conversion results in bits 31:8 of
+    // the 24-bit and 32-bit output modes of the ADC, like in the decimator.
+    //
+    // At the end of every window, the results are copied to a second set of
+    // registers, the snapshot, which is read through AXI4-Lite while the next
+    // window accumulates. The snapshot is not updated while FREEZE is set,
+    // such that it can be read consistently across the registers.
+    //
+    // Address configuration:
+    //  - Control register (read/write):
+    //      Base address: 0x?000_0500, 32-bit large.
+    //  - Window register (read/write):
+    //      Base address: 0x?000_0504, 32-bit large.
+    //  - Sequence register (read-only):
+    //      Base address: 0x?000_0508, 32-bit large.
+    //  - Count register (read-only):
+    //      Base address: 0x?000_050C, 32-bit large.
+    //  - Sum registers (read-only):
+    //      Base address: 0x?000_0510, 64-bit large, low word first.
+    //  - Sum of squares registers (read-only):
+    //      Base address: 0x?000_0518, 96-bit large, low word first.
+    //  - Minimum register (read-only):
+    //      Base address: 0x?000_0524, 32-bit large.
+    //  - Maximum register (read-only):
+    //      Base address: 0x?000_0528, 32-bit large.
+    //
+    // Control register:
+    // +----------+---------+--------+
+    // | RESERVED | RESTART | FREEZE |
+    // +----------+---------+--------+
+    // |     31-2 |       1 |      0 |
+    // +----------+---------+--------+
+    //
+    // - FREEZE: Holds the snapshot. Windows that end while it is set are
+    //     counted in the sequence, but their results are discarded.
+    // - RESTART: Writing 1 discards the current window and starts a new one,
+    //     reads as 0.
+    // - RESERVED: Not in use, writing to this has no effect
+    //
+    // The window is the number of samples per window, 0 stops the
+    // accumulation. Writing it restarts the current window. The sequence
+    // counts the windows that ended, the count is the number of samples in
+    // the snapshot. The sum and the sum of squares are signed and unsigned,
+    // the minimum and the maximum are sign-extended to 32 bits.
+    localparam reg [29:0] AddrControl = 30'h0000_0500;
+    localparam reg [29:0] AddrWindow = 30'h0000_0504;
+    localparam reg [29:0] AddrSequence = 30'h0000_0508;
+    localparam reg [29:0] AddrCount = 30'h0000_050C;
+    localparam reg [29:0] AddrSumLow = 30'h0000_0510;
+    localparam reg [29:0] AddrSumHigh = 30'h0000_0514;
+    localparam reg [29:0] AddrSumSqLow = 30'h0000_0518;
+    localparam reg [29:0] AddrSumSqMid = 30'h0000_051C;
+    localparam reg [29:0] AddrSumSqHigh = 30'h0000_0520;
+    localparam reg [29:0] AddrMin = 30'h0000_0524;
+    localparam reg [29:0] AddrMax = 30'h0000_0528;
+
+    reg freeze = 1'b0;
+    reg restart = 1'b0;
+    reg [31:0] window = 32'b0;
+    wire [31:0] sequence_number;
+    wire [31:0] count;
+    wire [63:0] sum;
+    wire [95:0] sum_sq;
+    wire [31:0] minimum;
+    wire [31:0] maximum;
+
+    assign m_axis_data_tdata = s_axis_data_tdata;
+    assign m_axis_data_tvalid = s_axis_data_tvalid;
+    assign s_axis_data_tready = m_axis_data_tready;
+
+    reg [31:0] axi_lite_awaddr;
+    reg        axi_lite_awready;
+    reg        axi_lite_wready;
+    reg [ 1:0] axi_lite_bresp;
+    reg        axi_lite_bvalid;
+    reg [31:0] axi_lite_araddr;
+    reg        axi_lite_arready;
+    reg        axi_lite_rvalid;
+
+    assign s_axi_lite_awready = axi_lite_awready;
+    assign s_axi_lite_wready  = axi_lite_wready;
+    assign s_axi_lite_bresp   = axi_lite_bresp;
+    assign s_axi_lite_bvalid  = axi_lite_bvalid;
+    assign s_axi_lite_arready = axi_lite_arready;
+    assign s_axi_lite_rvalid  = axi_lite_rvalid;
+
+    localparam reg [1:0] StateIdle = 2'b00;
+    localparam reg [1:0] StateRaddr = 2'b01;
+    localparam reg [1:0] StateRdata = 2'b11;
+    localparam reg [1:0] StateWaddr = 2'b01;
+    localparam reg [1:0] StateWdata = 2'b11;
+
+    reg [1:0] state_write = StateIdle;
+    reg [1:0] state_read = StateIdle;
+
+    // AXI4-Lite state machine for write operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_awready <= 0;
+            axi_lite_wready <= 0;
+            axi_lite_bvalid <= 0;
+            axi_lite_awaddr <= 0;
+            state_write <= StateIdle;
+        end else begin
+            case (state_write)
+                StateIdle: begin
+                    axi_lite_awready <= 1;
+                    axi_lite_wready <= 1;
+                    state_write <= StateWaddr;
+                end
+                StateWaddr: begin
+                    if (s_axi_lite_awvalid && s_axi_lite_awready) begin
+                        axi_lite_awaddr <= s_axi_lite_awaddr;
+                        if (s_axi_lite_wvalid) begin
+                            // Set address and write is performed at the same
+                            // time, address is available from the
+                            // s_axi_lite_awaddr input.
+                            axi_lite_awready <= 1;
+                            state_write <= StateWaddr;
+                            axi_lite_bvalid <= 1;
+                        end else begin
+                            // Write will be performed in the upcoming cycles,
+                            // disable axi_lite_bvalid if it has been read.
+                            axi_lite_awready <= 0;
+                            state_write <= StateWdata;
+                            if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                        end
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                StateWdata: begin
+                    if (s_axi_lite_wvalid && axi_lite_wready) begin
+                        state_write <= StateWaddr;
+                        axi_lite_bvalid <= 1;
+                        axi_lite_awready <= 1;
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                default: state_write <= StateIdle;
+            endcase
+        end
+    end
+
+    // AXI4-Lite state machine for read operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_araddr <= 0;
+            axi_lite_arready <= 0;
+            axi_lite_rvalid <= 0;
+            state_read <= StateIdle;
+        end else begin
+            case (state_read)
+                StateIdle: begin
+                    axi_lite_arready <= 1;
+                    state_read <= StateRaddr;
+                end
+                StateRaddr: begin
+                    if (s_axi_lite_arvalid && s_axi_lite_arready) begin
+                        axi_lite_araddr <= s_axi_lite_araddr;
+                        axi_lite_rvalid <= 1;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRdata;
+                    end
+                end
+                StateRdata: begin
+                    if (s_axi_lite_rvalid && s_axi_lite_rready) begin
+                        axi_lite_rvalid <= 0;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRaddr;
+                    end
+                end
+                default: state_read <= StateIdle;
+            endcase
+        end
+    end
+
+    wire [29:2] read_addr = axi_lite_araddr[29:2];
+    assign s_axi_lite_rdata = (read_addr == AddrControl[29:2]) ? {31'b0, freeze} :
+                              (read_addr == AddrWindow[29:2]) ? window :
+                              (read_addr == AddrSequence[29:2]) ? sequence_number :
+                              (read_addr == AddrCount[29:2]) ? count :
+                              (read_addr == AddrSumLow[29:2]) ? sum[31:0] :
+                              (read_addr == AddrSumHigh[29:2]) ? sum[63:32] :
+                              (read_addr == AddrSumSqLow[29:2]) ? sum_sq[31:0] :
+                              (read_addr == AddrSumSqMid[29:2]) ? sum_sq[63:32] :
+                              (read_addr == AddrSumSqHigh[29:2]) ? sum_sq[95:64] :
+                              (read_addr == AddrMin[29:2]) ? minimum :
+                              (read_addr == AddrMax[29:2]) ? maximum : 0;
+    assign s_axi_lite_rresp = (read_addr >= AddrControl[29:2] && read_addr <= AddrMax[29:2])
+                              ? 2'b00 : 2'b10;
+
+    // AXI4-Lite write logic
+    wire [29:0] write_addr = (s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:0] : axi_lite_awaddr[29:0];
+    wire [31:0] control_write = write_register(s_axi_lite_wdata, s_axi_lite_wstrb, {31'b0, freeze});
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            freeze <= 0;
+            restart <= 0;
+            window <= 0;
+            axi_lite_bresp <= 2'b00;
+        end else begin
+            // Asserted for a single cycle
+            restart <= 0;
+            if (s_axi_lite_wvalid) begin
+                if (write_addr[29:2] == AddrControl[29:2]) begin
+                    freeze <= control_write[0];
+                    restart <= control_write[1];
+                    axi_lite_bresp <= 2'b00;
+                end else if (write_addr[29:2] == AddrWindow[29:2]) begin
+                    window <= write_register(s_axi_lite_wdata, s_axi_lite_wstrb, window);
+                    restart <= 1;
+                    axi_lite_bresp <= 2'b00;
+                end else begin
+                    // The other registers are read-only registers
+                    axi_lite_bresp <= 2'b10;
+                end
+            end
+        end
+    end
+
+    axis_stats_impl impl (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .valid(s_axis_data_tvalid & m_axis_data_tready),
+        .sample(s_axis_data_tdata[31:8]),
+        .window(window),
+        .restart(restart),
+        .freeze(freeze),
+        .sequence_number(sequence_number),
+        .count(count),
+        .sum(sum),
+        .sum_sq(sum_sq),
+        .minimum(minimum),
+        .maximum(maximum)
+    );
+endmodule
+
+module axis_stats_impl (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // Samples, accumulated if 'valid' is asserted
+    input  wire        valid,
+    input  wire [23:0] sample,
+    // Control
+    input  wire [31:0] window,
+    input  wire        restart,
+    input  wire        freeze,
+    // Snapshot of the last window
+    output reg  [31:0] sequence_number = 32'b0,
+    output reg  [31:0] count = 32'b0,
+    output reg  [63:0] sum = 64'b0,
+    output reg  [95:0] sum_sq = 96'b0,
+    output reg  [31:0] minimum = 32'b0,
+    output reg  [31:0] maximum = 32'b0
+);
+    // The sample and its square are registered first, which maps the
+    // multiplication onto the DSP slices, and accumulated in the next cycle.
+    // A window ends with its last sample, the accumulators start over with
+    // the following one. 'restart' discards the sample in the pipeline as
+    // well.
+    //
+    // A window holds at most 2^32 - 1 samples: the sum needs 24 + 32 bits,
+    // the sum of squares 47 + 32 bits, neither of them can overflow.
+    reg                valid_reg = 1'b0;
+    reg signed  [23:0] sample_reg = 24'b0;
+    reg         [46:0] square = 47'b0;
+    wire signed [47:0] sample_ext = {{24{sample[23]}}, sample};
+    wire signed [47:0] product = sample_ext * sample_ext;
+
+    reg         [31:0] acc_count = 32'b0;
+    reg signed  [63:0] acc_sum = 64'b0;
+    reg         [95:0] acc_sum_sq = 96'b0;
+    reg signed  [23:0] acc_min = 24'b0;
+    reg signed  [23:0] acc_max = 24'b0;
+
+    // Accumulators including the sample in the pipeline
+    wire        [31:0] next_count = acc_count + 1;
+    wire signed [63:0] next_sum = acc_sum + {{40{sample_reg[23]}}, sample_reg};
+    wire        [95:0] next_sum_sq = acc_sum_sq + {49'b0, square};
+    wire signed [23:0] next_min = (acc_count == 0 || sample_reg < acc_min) ? sample_reg : acc_min;
+    wire signed [23:0] next_max = (acc_count == 0 || sample_reg > acc_max) ? sample_reg : acc_max;
+    wire               window_end = next_count >= window;
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            valid_reg  <= 0;
+            sample_reg <= 0;
+            square     <= 0;
+        end else begin
+            valid_reg <= valid & ~restart & (window != 0);
+            if (valid) begin
+                sample_reg <= sample;
+                square     <= product[46:0];
+            end
+        end
+    end
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            acc_count  <= 0;
+            acc_sum    <= 0;
+            acc_sum_sq <= 0;
+            acc_min    <= 0;
+            acc_max    <= 0;
+            sequence_number <= 0;
+            count           <= 0;
+            sum             <= 0;
+            sum_sq          <= 0;
+            minimum         <= 0;
+            maximum         <= 0;
+        end else if (restart) begin
+            acc_count <= 0;
+            acc_sum <= 0;
+            acc_sum_sq <= 0;
+        end else if (valid_reg) begin
+            if (window_end) begin
+                acc_count <= 0;
+                acc_sum <= 0;
+                acc_sum_sq <= 0;
+                sequence_number <= sequence_number + 1;
+                if (!freeze) begin
+                    count   <= next_count;
+                    sum     <= next_sum;
+                    sum_sq  <= next_sum_sq;
+                    minimum <= {{8{next_min[23]}}, next_min};
+                    maximum <= {{8{next_max[23]}}, next_max};
+                end
+            end else begin
+                acc_count  <= next_count;
+                acc_sum    <= next_sum;
+                acc_sum_sq <= next_sum_sq;
+                acc_min    <= next_min;
+                acc_max    <= next_max;
+            end
+        end
+    end
+endmodule
@@ -0,0 +1,191 @@
+`timescale 1ns / 1ps
+
+module axis_stats_tb #(
+    parameter real CLK_FREQ = 125.0
+);
+    localparam integer Period = $rtoi(1_000.0 / (2.0 * CLK_FREQ));
+
+    bit           clk = 0;
+    bit           resetn = 0;
+
+    reg           valid = 1'b0;
+    reg    [23:0] sample = 24'b0;
+    reg    [31:0] window = 32'b0;
+    reg           restart = 1'b0;
+    reg           freeze = 1'b0;
+    wire   [31:0] sequence_number;
+    wire   [31:0] count;
+    wire   [63:0] sum;
+    wire   [95:0] sum_sq;
+    wire   [31:0] minimum;
+    wire   [31:0] maximum;
+
+    // The source sends random samples while 'run' is set, or 'level' if
+    // 'constant' is set. The source is paused whenever the window, 'restart'
+    // or 'freeze' change, such that no sample is in the pipeline.
+    reg           run = 1'b0;
+    reg           constant = 1'b0;
+    reg    [23:0] level = 24'b0;
+
+    // Reference model, a snapshot is {count, sum, sum of squares, minimum,
+    // maximum} and queued at the end of every window
+    reg   [255:0] expected[$];
+    reg    [31:0] ref_count = 32'b0;
+    reg    [63:0] ref_sum = 64'b0;
+    reg    [95:0] ref_sum_sq = 96'b0;
+    reg    [31:0] ref_min = 32'b0;
+    reg    [31:0] ref_max = 32'b0;
+    reg    [31:0] last_sequence = 32'b0;
+    reg   [255:0] frozen = 256'b0;
+    integer       checked = 0;
+
+    wire   [31:0] value = 32'($signed(sample));
+    wire signed [95:0] wide = 96'($signed(sample));
+    wire   [95:0] square = 96'(wide * wide);
+    wire  [255:0] snapshot = {count, sum, sum_sq, minimum, maximum};
+
+    axis_stats_impl dut (
+        .aclk(clk),
+        .aresetn(resetn),
+        .valid(valid),
+        .sample(sample),
+        .window(window),
+        .restart(restart),
+        .freeze(freeze),
+        .sequence_number(sequence_number),
+        .count(count),
+        .sum(sum),
+        .sum_sq(sum_sq),
+        .minimum(minimum),
+        .maximum(maximum)
+    );
+
+    always #(Period) clk <= ~clk;
+
+    always @(posedge clk) begin
+        valid  <= run & 1'($urandom() % 4 != 0);
+        sample <= constant ? level : 24'($urandom());
+        if (restart) begin
+            ref_count  <= 0;
+            ref_sum    <= 0;
+            ref_sum_sq <= 0;
+        end else if (valid && window != 0) begin
+            if (ref_count + 1 >= window) begin
+                expected.push_back({
+                    ref_count + 32'd1,
+                    ref_sum + 64'($signed(value)),
+                    ref_sum_sq + square,
+                    (ref_count == 0 || $signed(value) < $signed(ref_min)) ? value : ref_min,
+                    (ref_count == 0 || $signed(value) > $signed(ref_max)) ? value : ref_max
+                });
+                ref_count  <= 0;
+                ref_sum    <= 0;
+                ref_sum_sq <= 0;
+            end else begin
+                ref_count  <= ref_count + 1;
+                ref_sum    <= ref_sum + 64'($signed(value));
+                ref_sum_sq <= ref_sum_sq + square;
+                if (ref_count == 0 || $signed(value) < $signed(ref_min)) ref_min <= value;
+                if (ref_count == 0 || $signed(value) > $signed(ref_max)) ref_max <= value;
+            end
+        end
+
+        // Compare every new snapshot, or check that it is held with 'freeze'
+        if (sequence_number != last_sequence) begin
+            if (sequence_number != last_sequence + 1) $error("Windows skipped in the sequence");
+            if (expected.size() == 0) begin
+                $error("Unexpected window %0d", sequence_number);
+            end else if (freeze) begin
+                void'(expected.pop_front());
+                if (snapshot != frozen) $error("Snapshot changed while frozen");
+            end else begin
+                if (snapshot != expected[0])
+                    $error("Window %0d: count %0d, sum %0d, min %0d, max %0d", sequence_number,
+                           count, $signed(sum), $signed(minimum), $signed(maximum));
+                void'(expected.pop_front());
+                checked <= checked + 1;
+            end
+            last_sequence <= sequence_number;
+        end
+    end
+
+    task automatic pause;
+        begin
+            @(posedge clk) run <= 0;
+            repeat (4) @(posedge clk);
+        end
+    endtask
+
+    task automatic start(input [31:0] samples);
+        begin
+            @(posedge clk) window <= samples;
+            restart <= 1;
+            @(posedge clk) restart <= 0;
+            run <= 1;
+        end
+    endtask
+
+    task automatic wait_windows(input integer windows);
+        integer first;
+        begin
+            first = sequence_number;
+            while (sequence_number - first < windows) @(posedge clk);
+        end
+    endtask
+
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn = 1;
+
+        // Nothing is accumulated without a window
+        run <= 1;
+        #(40 * Period);
+        if (sequence_number != 0) $error("Window ended without a window length");
+        pause();
+
+        // Random samples over short windows
+        start(32'd7);
+        wait_windows(20);
+        pause();
+        start(32'd100);
+        wait_windows(5);
+        pause();
+
+        // The snapshot is held while frozen, the sequence continues
+        start(32'd10);
+        wait_windows(2);
+        pause();
+        frozen = snapshot;
+        @(posedge clk) freeze <= 1;
+        run <= 1;
+        wait_windows(3);
+        pause();
+        @(posedge clk) freeze <= 0;
+        run <= 1;
+        wait_windows(2);
+        pause();
+
+        // Restarting discards the partial window
+        start(32'd50);
+        #(40 * Period);
+        pause();
+        start(32'd50);
+        wait_windows(2);
+        pause();
+
+        // Negative full scale over a window long enough for the sum of
+        // squares to exceed 64 bits
+        constant <= 1;
+        level <= 24'h800000;
+        start(32'd300_000);
+        wait_windows(1);
+        pause();
+        if (sum_sq[95:64] == 0) $error("Sum of squares did not exceed 64 bits");
+        if ($signed(minimum) != -32'sd8388608 || minimum != maximum)
+            $error("Invalid minimum or maximum at full scale");
+
+        if (expected.size() != 0) $error("%0d windows did not end", expected.size());
+        if (checked == 0) $error("No window checked");
+        $finish();
+    end
+endmodule
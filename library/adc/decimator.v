@@ -0,0 +1,440 @@
+`timescale 1ns / 1ps
+
+module decimator (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_data_tdata,
+    output wire        m_axis_data_tvalid,
+    input  wire        m_axis_data_tready,
+    // AXI4-Lite configuration subordinate
+    input  wire [31:0] s_axi_lite_awaddr,
+    input  wire [ 2:0] s_axi_lite_awprot,
+    input  wire        s_axi_lite_awvalid,
+    output wire        s_axi_lite_awready,
+
+    input  wire [31:0] s_axi_lite_wdata,
+    input  wire [ 3:0] s_axi_lite_wstrb,
+    input  wire        s_axi_lite_wvalid,
+    output wire        s_axi_lite_wready,
+
+    output wire [1:0] s_axi_lite_bresp,
+    output wire       s_axi_lite_bvalid,
+    input  wire       s_axi_lite_bready,
+
+    input  wire [31:0] s_axi_lite_araddr,
+    input  wire [ 2:0] s_axi_lite_arprot,
+    input  wire        s_axi_lite_arvalid,
+    output wire        s_axi_lite_arready,
+
+    output wire [31:0] s_axi_lite_rdata,
+    output wire [ 1:0] s_axi_lite_rresp,
+    output wire        s_axi_lite_rvalid,
+    input  wire        s_axi_lite_rready
+);
+    `include "axi4lite_helpers.vh"
+    // The decimator sits between the ADC Manager and the packetizer and
+    // reduces the sample rate by a power of two with a CIC filter, followed
+    // by an optional FIR filter that compensates the droop of the CIC
+    // filter in the passband. See 'decimator_impl' for the data format.
+    //
+    // Address configuration:
+    //  - Config register:
+    //      Base address: 0x?000_0300, 32-bit large.
+    //  - FIR coefficients:
+    //      Base address: 0x?000_0340, 16 registers, 32-bit large each.
+    //
+    // Config register:
+    // +----------+------------+----------+------------+
+    // | RESERVED | COMPENSATE | RESERVED | LOG2_RATIO |
+    // +----------+------------+----------+------------+
+    // |     31-9 |          8 |      7-4 |        3-0 |
+    // +----------+------------+----------+------------+
+    //
+    // - LOG2_RATIO: Decimation ratio 2^LOG2_RATIO, at most 2^10. Zero
+    //     bypasses the decimator, the samples are forwarded unchanged.
+    // - COMPENSATE: Apply the FIR filter to the output of the CIC filter.
+    // - RESERVED: Not in use, writing to this has no effect
+    //
+    // Every write to the config register clears the state of the filters,
+    // such that no samples of a previous capture leak into the next one.
+    //
+    // FIR coefficients:
+    // +----------+--------+
+    // | RESERVED |  COEFF |
+    // +----------+--------+
+    // |    31-18 |   17-0 |
+    // +----------+--------+
+    // - COEFF: Signed coefficient of tap n at 0x?000_0340 + 4 * n, 65536
+    //     corresponds to 1.0. The reset values compensate the droop of the
+    //     CIC filter up to a fifth of the output rate within 0.07 dB for
+    //     ratios of 8 and up, and within 0.09 dB for a ratio of 4. At a
+    //     ratio of 2, they overshoot by 0.41 dB, leave COMPENSATE cleared.
+    localparam reg [29:0] AddrConfig = 30'h0000_0300;
+    localparam reg [29:0] AddrTaps = 30'h0000_0340;
+    localparam integer NumTaps = 16;
+    localparam integer TapWidth = 18;
+
+    reg [31:0] config_reg = 32'b0;
+    reg [NumTaps*TapWidth-1:0] taps;
+    reg clear = 1'b0;
+    wire [TapWidth-1:0] tap_read = taps[axi_lite_araddr[5:2]*TapWidth+:TapWidth];
+
+    // Reset values of the FIR coefficients, symmetric with 15 taps
+    localparam reg [NumTaps*TapWidth-1:0] DefaultTaps = {
+        18'sd0,
+        18'sd315,
+        18'sd730,
+        -18'sd3940,
+        18'sd5902,
+        -18'sd158,
+        -18'sd13707,
+        18'sd18495,
+        18'sd50262,
+        18'sd18495,
+        -18'sd13707,
+        -18'sd158,
+        18'sd5902,
+        -18'sd3940,
+        18'sd730,
+        18'sd315
+    };
+
+    reg [31:0] axi_lite_awaddr;
+    reg        axi_lite_awready;
+    reg        axi_lite_wready;
+    reg [ 1:0] axi_lite_bresp;
+    reg        axi_lite_bvalid;
+    reg [31:0] axi_lite_araddr;
+    reg        axi_lite_arready;
+    reg        axi_lite_rvalid;
+
+    assign s_axi_lite_awready = axi_lite_awready;
+    assign s_axi_lite_wready  = axi_lite_wready;
+    assign s_axi_lite_bresp   = axi_lite_bresp;
+    assign s_axi_lite_bvalid  = axi_lite_bvalid;
+    assign s_axi_lite_arready = axi_lite_arready;
+    assign s_axi_lite_rvalid  = axi_lite_rvalid;
+
+    localparam reg [1:0] StateIdle = 2'b00;
+    localparam reg [1:0] StateRaddr = 2'b01;
+    localparam reg [1:0] StateRdata = 2'b11;
+    localparam reg [1:0] StateWaddr = 2'b01;
+    localparam reg [1:0] StateWdata = 2'b11;
+
+    reg [1:0] state_write = StateIdle;
+    reg [1:0] state_read = StateIdle;
+
+    // AXI4-Lite state machine for write operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_awready <= 0;
+            axi_lite_wready <= 0;
+            axi_lite_bvalid <= 0;
+            axi_lite_awaddr <= 0;
+            state_write <= StateIdle;
+        end else begin
+            case (state_write)
+                StateIdle: begin
+                    axi_lite_awready <= 1;
+                    axi_lite_wready <= 1;
+                    state_write <= StateWaddr;
+                end
+                StateWaddr: begin
+                    if (s_axi_lite_awvalid && s_axi_lite_awready) begin
+                        axi_lite_awaddr <= s_axi_lite_awaddr;
+                        if (s_axi_lite_wvalid) begin
+                            // Set address and write is performed at the same
+                            // time, address is available from the
+                            // s_axi_lite_awaddr input.
+                            axi_lite_awready <= 1;
+                            state_write <= StateWaddr;
+                            axi_lite_bvalid <= 1;
+                        end else begin
+                            // Write will be performed in the upcoming cycles,
+                            // disable axi_lite_bvalid if it has been read.
+                            axi_lite_awready <= 0;
+                            state_write <= StateWdata;
+                            if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                        end
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                StateWdata: begin
+                    if (s_axi_lite_wvalid && axi_lite_wready) begin
+                        state_write <= StateWaddr;
+                        axi_lite_bvalid <= 1;
+                        axi_lite_awready <= 1;
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                default: state_write <= StateIdle;
+            endcase
+        end
+    end
+
+    // AXI4-Lite state machine for read operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_araddr <= 0;
+            axi_lite_arready <= 0;
+            axi_lite_rvalid <= 0;
+            state_read <= StateIdle;
+        end else begin
+            case (state_read)
+                StateIdle: begin
+                    axi_lite_arready <= 1;
+                    state_read <= StateRaddr;
+                end
+                StateRaddr: begin
+                    if (s_axi_lite_arvalid && s_axi_lite_arready) begin
+                        axi_lite_araddr <= s_axi_lite_araddr;
+                        axi_lite_rvalid <= 1;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRdata;
+                    end
+                end
+                StateRdata: begin
+                    if (s_axi_lite_rvalid && s_axi_lite_rready) begin
+                        axi_lite_rvalid <= 0;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRaddr;
+                    end
+                end
+                default: state_read <= StateIdle;
+            endcase
+        end
+    end
+
+    assign s_axi_lite_rdata = (axi_lite_araddr[29:2] == AddrConfig[29:2]) ? config_reg :
+                              (axi_lite_araddr[29:6] == AddrTaps[29:6])
+                              ? {{(32 - TapWidth) {tap_read[TapWidth-1]}}, tap_read} : 0;
+    assign s_axi_lite_rresp = (axi_lite_araddr[29:2] == AddrConfig[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:6] == AddrTaps[29:6]) ? 2'b00 : 2'b10;
+
+    // AXI4-Lite write logic
+    wire [29:0] write_addr = (s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:0] : axi_lite_awaddr[29:0];
+    wire [31:0] tap_write = write_register(
+        s_axi_lite_wdata,
+        s_axi_lite_wstrb,
+        {{(32 - TapWidth) {1'b0}}, taps[write_addr[5:2]*TapWidth+:TapWidth]}
+    );
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            config_reg <= 0;
+            taps <= DefaultTaps;
+            clear <= 0;
+            axi_lite_bresp <= 2'b00;
+        end else begin
+            // 'clear' is asserted for a single cycle
+            clear <= 0;
+            if (s_axi_lite_wvalid) begin
+                if (write_addr[29:2] == AddrConfig[29:2]) begin
+                    config_reg <= write_register(
+                        s_axi_lite_wdata, s_axi_lite_wstrb, config_reg
+                    );
+                    clear <= 1;
+                    axi_lite_bresp <= 2'b00;
+                end else if (write_addr[29:6] == AddrTaps[29:6]) begin
+                    taps[write_addr[5:2]*TapWidth+:TapWidth] <= tap_write[TapWidth-1:0];
+                    axi_lite_bresp <= 2'b00;
+                end else begin
+                    axi_lite_bresp <= 2'b10;
+                end
+            end
+        end
+    end
+
+    decimator_impl #(
+        .STAGES(3),
+        .MAX_LOG2_RATIO(10),
+        .NUM_TAPS(NumTaps),
+        .TAP_WIDTH(TapWidth)
+    ) impl (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .log2_ratio(config_reg[3:0]),
+        .compensate(config_reg[8]),
+        .taps(taps),
+        .clear(clear)
+    );
+endmodule
+
+module decimator_impl #(
+    parameter integer STAGES = 3,
+    parameter integer MAX_LOG2_RATIO = 10,
+    parameter integer NUM_TAPS = 16,
+    parameter integer TAP_WIDTH = 18
+) (
+    input  wire                          aclk,
+    input  wire                          aresetn,
+    // AXI-Stream data subordinate
+    input  wire [                  31:0] s_axis_data_tdata,
+    input  wire                          s_axis_data_tvalid,
+    output wire                          s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [                  31:0] m_axis_data_tdata,
+    output wire                          m_axis_data_tvalid,
+    input  wire                          m_axis_data_tready,
+    // Configuration
+    input  wire [                   3:0] log2_ratio,
+    input  wire                          compensate,
+    input  wire [NUM_TAPS*TAP_WIDTH-1:0] taps,
+    input  wire                          clear
+);
+    // The input samples are the signed 24-bit conversion results in bits
+    // 31:8 of the 24-bit and 32-bit output modes of the ADC, the common mode
+    // in bits 7:0 is dropped. The output samples are signed 32-bit words
+    // with the same full scale, the low byte holds the additional bits of
+    // resolution gained by the decimation:
+    //
+    //   output = round_down(2^8 * mean of the input samples)
+    //
+    // with the CIC filter of 'STAGES' stages as the weighted mean. The gain
+    // 2^(STAGES * log2_ratio) of the CIC filter is removed by a shift, the
+    // integrators wrap around without loss as they are wide enough for the
+    // largest ratio.
+    //
+    // Per output sample, the combs take 'STAGES' cycles and the FIR filter
+    // 'NUM_TAPS' cycles with a single multiplier. Inputs are not accepted
+    // meanwhile, which is shorter than two sample periods at any divider
+    // supported by the ADC.
+    localparam integer Width = 24 + STAGES * MAX_LOG2_RATIO;
+    localparam integer AccWidth = 32 + TAP_WIDTH + $clog2(NUM_TAPS);
+    localparam integer StageBits = (STAGES > 1) ? $clog2(STAGES) : 1;
+    localparam integer TapBits = (NUM_TAPS > 1) ? $clog2(NUM_TAPS) : 1;
+    localparam integer LastStage = STAGES - 1;
+    localparam integer LastTap = NUM_TAPS - 1;
+
+    localparam reg [2:0] StateIdle = 3'd0;
+    localparam reg [2:0] StateComb = 3'd1;
+    localparam reg [2:0] StateScale = 3'd2;
+    localparam reg [2:0] StateMac = 3'd3;
+    localparam reg [2:0] StateRound = 3'd4;
+    localparam reg [2:0] StateOut = 3'd5;
+    reg [2:0] state = StateIdle;
+
+    wire [3:0] ratio = (log2_ratio > MAX_LOG2_RATIO[3:0]) ? MAX_LOG2_RATIO[3:0] : log2_ratio;
+    wire bypass = (ratio == 4'd0);
+    wire [MAX_LOG2_RATIO-1:0] last_count = ~({MAX_LOG2_RATIO{1'b1}} << ratio);
+    wire [31:0] shift = {28'b0, ratio} * STAGES;
+    wire accept = s_axis_data_tvalid & s_axis_data_tready;
+
+    reg signed [Width-1:0] integrator[0:STAGES-1];
+    reg signed [Width-1:0] comb_delay[0:STAGES-1];
+    reg signed [Width-1:0] comb;
+    reg [StageBits-1:0] stage = 0;
+    reg [MAX_LOG2_RATIO-1:0] count = 0;
+
+    reg signed [31:0] fir_line[0:NUM_TAPS-1];
+    reg signed [AccWidth-1:0] acc;
+    reg [TapBits-1:0] tap_index = 0;
+    reg [31:0] result = 32'b0;
+
+    wire signed [Width-1:0] sample = {{(Width - 24) {s_axis_data_tdata[31]}}, s_axis_data_tdata[31:8]};
+    // CIC output with the gain removed, 8 additional bits of resolution
+    wire signed [Width+7:0] scaled = $signed({comb, 8'b0}) >>> shift;
+    wire signed [TAP_WIDTH-1:0] tap = taps[tap_index*TAP_WIDTH+:TAP_WIDTH];
+    wire signed [AccWidth-17:0] rounded = acc[AccWidth-1:16];
+    // Saturate the FIR output, its gain can exceed one for some signals
+    wire overflow = |rounded[AccWidth-17:31] & ~&rounded[AccWidth-17:31];
+
+    assign s_axis_data_tready = bypass ? m_axis_data_tready : (state == StateIdle);
+    assign m_axis_data_tvalid = bypass ? s_axis_data_tvalid : (state == StateOut);
+    assign m_axis_data_tdata  = bypass ? s_axis_data_tdata : result;
+
+    integer i;
+    task automatic reset_filters;
+        begin
+            state <= StateIdle;
+            stage <= 0;
+            count <= 0;
+            comb <= 0;
+            acc <= 0;
+            tap_index <= 0;
+            result <= 0;
+            for (i = 0; i < STAGES; i = i + 1) begin
+                integrator[i] <= 0;
+                comb_delay[i] <= 0;
+            end
+            for (i = 0; i < NUM_TAPS; i = i + 1) begin
+                fir_line[i] <= 0;
+            end
+        end
+    endtask
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            reset_filters();
+        end else if (clear) begin
+            reset_filters();
+        end else if (!bypass) begin
+            case (state)
+                StateIdle: begin
+                    if (accept) begin
+                        // The integrators are pipelined, which only delays
+                        // the output.
+                        integrator[0] <= integrator[0] + sample;
+                        for (i = 1; i < STAGES; i = i + 1) begin
+                            integrator[i] <= integrator[i] + integrator[i-1];
+                        end
+                        if (count == last_count) begin
+                            count <= 0;
+                            comb  <= integrator[STAGES-1];
+                            stage <= 0;
+                            state <= StateComb;
+                        end else begin
+                            count <= count + 1;
+                        end
+                    end
+                end
+                StateComb: begin
+                    comb <= comb - comb_delay[stage];
+                    comb_delay[stage] <= comb;
+                    stage <= stage + 1;
+                    if (stage == LastStage[StageBits-1:0]) state <= StateScale;
+                end
+                StateScale: begin
+                    if (compensate) begin
+                        fir_line[0] <= scaled[31:0];
+                        for (i = 1; i < NUM_TAPS; i = i + 1) begin
+                            fir_line[i] <= fir_line[i-1];
+                        end
+                        acc <= 0;
+                        tap_index <= 0;
+                        state <= StateMac;
+                    end else begin
+                        result <= scaled[31:0];
+                        state  <= StateOut;
+                    end
+                end
+                StateMac: begin
+                    acc <= acc + fir_line[tap_index] * tap;
+                    tap_index <= tap_index + 1;
+                    if (tap_index == LastTap[TapBits-1:0]) state <= StateRound;
+                end
+                StateRound: begin
+                    result <= overflow ? {rounded[AccWidth-17], {31{~rounded[AccWidth-17]}}}
+                                       : rounded[31:0];
+                    state <= StateOut;
+                end
+                StateOut: begin
+                    if (m_axis_data_tready) state <= StateIdle;
+                end
+                default: state <= StateIdle;
+            endcase
+        end
+    end
+endmodule
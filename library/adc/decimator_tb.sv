@@ -0,0 +1,159 @@
+`timescale 1ns / 1ps
+
+module decimator_tb #(
+    parameter real CLK_FREQ = 125.0
+);
+    localparam integer Period = $rtoi(1_000.0 / (2.0 * CLK_FREQ));
+    localparam reg [16*18-1:0] Taps = {
+        18'sd0,
+        18'sd315,
+        18'sd730,
+        -18'sd3940,
+        18'sd5902,
+        -18'sd158,
+        -18'sd13707,
+        18'sd18495,
+        18'sd50262,
+        18'sd18495,
+        -18'sd13707,
+        -18'sd158,
+        18'sd5902,
+        -18'sd3940,
+        18'sd730,
+        18'sd315
+    };
+
+    bit         clk = 0;
+    bit         resetn = 0;
+
+    wire [31:0] s_axis_data_tdata;
+    reg         s_axis_data_tvalid = 1'b0;
+    wire        s_axis_data_tready;
+    wire [31:0] m_axis_data_tdata;
+    wire        m_axis_data_tvalid;
+    reg         m_axis_data_tready = 1'b0;
+
+    reg  [ 3:0] log2_ratio = 4'd0;
+    reg         compensate = 1'b0;
+    reg         clear = 1'b0;
+
+    // Input samples: a constant or a full-scale signal at half the sample
+    // rate, which is a zero of the CIC filter at a ratio of two. The common
+    // mode byte has to be dropped.
+    reg  [23:0] level = 24'b0;
+    reg         alternate = 1'b0;
+    reg         sign = 1'b0;
+    wire [23:0] sample = (alternate & sign) ? -level : level;
+    assign s_axis_data_tdata = {sample, 8'hA5};
+
+    // Every output after the first 'settle' ones has to equal 'expected'
+    reg  [31:0] expected = 32'b0;
+    integer     settle = 0;
+    integer     inputs = 0;
+    integer     outputs = 0;
+
+    decimator_impl #(
+        .STAGES(3),
+        .MAX_LOG2_RATIO(10),
+        .NUM_TAPS(16),
+        .TAP_WIDTH(18)
+    ) dut (
+        .aclk(clk),
+        .aresetn(resetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .log2_ratio(log2_ratio),
+        .compensate(compensate),
+        .taps(Taps),
+        .clear(clear)
+    );
+
+    always #(Period) clk <= ~clk;
+
+    // Source and sink with random 'tvalid' and 'tready'. The counters start
+    // over with every 'clear', handshakes during 'clear' are ignored by the
+    // decimator as well.
+    always @(posedge clk) begin
+        s_axis_data_tvalid <= resetn & 1'($urandom() % 4 != 0);
+        m_axis_data_tready <= 1'($urandom() % 4 != 0);
+        if (clear) begin
+            inputs  <= 0;
+            outputs <= 0;
+        end else if (s_axis_data_tvalid && s_axis_data_tready) begin
+            sign   <= ~sign;
+            inputs <= inputs + 1;
+        end
+        if (!clear && m_axis_data_tvalid && m_axis_data_tready) begin
+            if (log2_ratio == 0) begin
+                if (m_axis_data_tdata != s_axis_data_tdata)
+                    $error("Bypassed sample modified");
+            end else if (outputs >= settle && m_axis_data_tdata != expected) begin
+                $error("Output %0d is 0x%08X, expected 0x%08X", outputs,
+                       m_axis_data_tdata, expected);
+            end
+            outputs <= outputs + 1;
+        end
+    end
+
+    task automatic configure(input [3:0] ratio, input fir, input [23:0] value,
+                             input alt, input [31:0] result, input integer skip);
+        begin
+            @(posedge clk);
+            log2_ratio <= ratio;
+            compensate <= fir;
+            level <= value;
+            alternate <= alt;
+            expected <= result;
+            settle <= skip;
+            clear <= 1;
+            @(posedge clk);
+            clear <= 0;
+        end
+    endtask
+
+    task automatic run(input integer count);
+        begin
+            while (outputs < count) @(posedge clk);
+        end
+    endtask
+
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn = 1;
+
+        // Bypass, the samples are forwarded unchanged
+        configure(4'd0, 1'b0, 24'h123456, 1'b1, 32'b0, 0);
+        run(32);
+        if (inputs < 31 || inputs > 33) $error("Bypass dropped samples");
+
+        // The DC gain is exactly one, 8 more bits of resolution
+        configure(4'd3, 1'b0, 24'hEDCBAA, 1'b0, 32'hEDCBAA00, 4);
+        run(16);
+        if (inputs < 16 * 8 || inputs > 17 * 8) $error("Invalid decimation ratio");
+
+        // Half the sample rate is suppressed completely
+        configure(4'd1, 1'b0, 24'h7FFFFF, 1'b1, 32'b0, 3);
+        run(16);
+
+        // The FIR filter keeps both
+        configure(4'd1, 1'b1, 24'h7FFFFF, 1'b1, 32'b0, 17);
+        run(32);
+        configure(4'd4, 1'b1, 24'h012345, 1'b0, 32'h01234500, 20);
+        run(32);
+
+        // Largest ratio at negative full scale, the output must not wrap
+        configure(4'd10, 1'b1, 24'h800000, 1'b0, 32'h80000000, 20);
+        run(24);
+        if (inputs < 24 * 1024) $error("Invalid decimation ratio");
+
+        // Ratios above the largest one are limited to it
+        configure(4'd15, 1'b0, 24'h000100, 1'b0, 32'h00010000, 4);
+        run(8);
+        if (inputs < 8 * 1024) $error("Ratio not limited");
+        $finish();
+    end
+endmodule
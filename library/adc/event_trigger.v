@@ -0,0 +1,434 @@
+`timescale 1ns / 1ps
+
+module event_trigger #(
+    parameter integer LOG2_DEPTH = 12
+) (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_data_tdata,
+    output wire        m_axis_data_tvalid,
+    input  wire        m_axis_data_tready,
+    // AXI4-Lite configuration subordinate
+    input  wire [31:0] s_axi_lite_awaddr,
+    input  wire [ 2:0] s_axi_lite_awprot,
+    input  wire        s_axi_lite_awvalid,
+    output wire        s_axi_lite_awready,
+
+    input  wire [31:0] s_axi_lite_wdata,
+    input  wire [ 3:0] s_axi_lite_wstrb,
+    input  wire        s_axi_lite_wvalid,
+    output wire        s_axi_lite_wready,
+
+    output wire [1:0] s_axi_lite_bresp,
+    output wire       s_axi_lite_bvalid,
+    input  wire       s_axi_lite_bready,
+
+    input  wire [31:0] s_axi_lite_araddr,
+    input  wire [ 2:0] s_axi_lite_arprot,
+    input  wire        s_axi_lite_arvalid,
+    output wire        s_axi_lite_arready,
+
+    output wire [31:0] s_axi_lite_rdata,
+    output wire [ 1:0] s_axi_lite_rresp,
+    output wire        s_axi_lite_rvalid,
+    input  wire        s_axi_lite_rready
+);
+    `include "axi4lite_helpers.vh"
+    // The event trigger sits between the FIFO and the decimator and only
+    // forwards windows of samples around events, such that the bandwidth to
+    // the DMA depends on the window and not on the sample rate. The
+    // packetizer is set to packets of PRE + POST samples, every window
+    // becomes one packet.
+    //
+    // While ARM is cleared, the samples pass through unchanged. Writing the
+    // config register with ARM set (re-)arms the trigger: the last PRE
+    // samples are kept in block RAM, all older ones are dropped. Once PRE
+    // samples are kept, every new sample is compared against the threshold.
+    // On a hit, the PRE samples before it, the sample itself and the
+    // following POST - 1 samples are forwarded. Afterwards, the trigger
+    // arms again with CONTINUOUS, or drops all samples until it is armed
+    // again otherwise.
+    //
+    // Address configuration:
+    //  - Config register (read/write):
+    //      Base address: 0x?000_0600, 32-bit large.
+    //  - Threshold register (read/write):
+    //      Base address: 0x?000_0604, 32-bit large.
+    //  - Pre register (read/write):
+    //      Base address: 0x?000_0608, 32-bit large.
+    //  - Post register (read/write):
+    //      Base address: 0x?000_060C, 32-bit large.
+    //  - Status register (read-only):
+    //      Base address: 0x?000_0610, 32-bit large.
+    //  - Events register (read-only):
+    //      Base address: 0x?000_0614, 32-bit large.
+    //  - Depth register (read-only):
+    //      Base address: 0x?000_0618, 32-bit large.
+    //
+    // Config register:
+    // +----------+-------+---------+--------+------------+-----+
+    // | RESERVED | SLOPE | FALLING | RISING | CONTINUOUS | ARM |
+    // +----------+-------+---------+--------+------------+-----+
+    // |     31-5 |     4 |       3 |      2 |          1 |   0 |
+    // +----------+-------+---------+--------+------------+-----+
+    //
+    // - ARM: Keep the pre-trigger history and wait for an event, see above.
+    // - CONTINUOUS: Arm again after every window.
+    // - RISING: Trigger if the sample crosses the threshold upwards, or with
+    //     SLOPE if it exceeds the previous sample by at least the threshold.
+    // - FALLING: Trigger if the sample crosses the threshold downwards, or
+    //     with SLOPE if it is below the previous sample by at least the
+    //     threshold.
+    // - SLOPE: Compare the difference of consecutive samples.
+    // - RESERVED: Not in use, writing to this has no effect
+    //
+    // The threshold is a signed 24-bit conversion result, sign-extended to
+    // 32 bits, like the samples in bits 31:8 of the 24-bit and 32-bit output
+    // modes of the ADC. PRE is limited to the depth minus one, POST has to be
+    // at least one. Both must only change while ARM is cleared.
+    //
+    // Status register:
+    // +----------+---------+-------+
+    // | RESERVED | TRIGGER | STATE |
+    // +----------+---------+-------+
+    // |     31-3 |       2 |   1-0 |
+    // +----------+---------+-------+
+    //
+    // - STATE: 0: passing samples through, 1: armed, 2: forwarding a window,
+    //     3: done, dropping samples.
+    // - TRIGGER: The pre-trigger history is complete, the samples are
+    //     compared against the threshold.
+    //
+    // The events are the windows forwarded since the trigger was armed. The
+    // depth is the number of samples the block RAM holds.
+    localparam reg [29:0] AddrConfig = 30'h0000_0600;
+    localparam reg [29:0] AddrThreshold = 30'h0000_0604;
+    localparam reg [29:0] AddrPre = 30'h0000_0608;
+    localparam reg [29:0] AddrPost = 30'h0000_060C;
+    localparam reg [29:0] AddrStatus = 30'h0000_0610;
+    localparam reg [29:0] AddrEvents = 30'h0000_0614;
+    localparam reg [29:0] AddrDepth = 30'h0000_0618;
+    localparam reg [31:0] Depth = 1 << LOG2_DEPTH;
+
+    reg  [ 4:0] config_reg = 5'b0;
+    reg  [31:0] threshold = 32'b0;
+    reg  [31:0] pre = 32'b0;
+    reg  [31:0] post = 32'b1;
+    reg         arm = 1'b0;
+    wire [ 2:0] status;
+    wire [31:0] events;
+
+    reg [31:0] axi_lite_awaddr;
+    reg        axi_lite_awready;
+    reg        axi_lite_wready;
+    reg [ 1:0] axi_lite_bresp;
+    reg        axi_lite_bvalid;
+    reg [31:0] axi_lite_araddr;
+    reg        axi_lite_arready;
+    reg        axi_lite_rvalid;
+
+    assign s_axi_lite_awready = axi_lite_awready;
+    assign s_axi_lite_wready  = axi_lite_wready;
+    assign s_axi_lite_bresp   = axi_lite_bresp;
+    assign s_axi_lite_bvalid  = axi_lite_bvalid;
+    assign s_axi_lite_arready = axi_lite_arready;
+    assign s_axi_lite_rvalid  = axi_lite_rvalid;
+
+    localparam reg [1:0] StateIdle = 2'b00;
+    localparam reg [1:0] StateRaddr = 2'b01;
+    localparam reg [1:0] StateRdata = 2'b11;
+    localparam reg [1:0] StateWaddr = 2'b01;
+    localparam reg [1:0] StateWdata = 2'b11;
+
+    reg [1:0] state_write = StateIdle;
+    reg [1:0] state_read = StateIdle;
+
+    // AXI4-Lite state machine for write operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_awready <= 0;
+            axi_lite_wready <= 0;
+            axi_lite_bvalid <= 0;
+            axi_lite_awaddr <= 0;
+            state_write <= StateIdle;
+        end else begin
+            case (state_write)
+                StateIdle: begin
+                    axi_lite_awready <= 1;
+                    axi_lite_wready <= 1;
+                    state_write <= StateWaddr;
+                end
+                StateWaddr: begin
+                    if (s_axi_lite_awvalid && s_axi_lite_awready) begin
+                        axi_lite_awaddr <= s_axi_lite_awaddr;
+                        if (s_axi_lite_wvalid) begin
+                            // Set address and write is performed at the same
+                            // time, address is available from the
+                            // s_axi_lite_awaddr input.
+                            axi_lite_awready <= 1;
+                            state_write <= StateWaddr;
+                            axi_lite_bvalid <= 1;
+                        end else begin
+                            // Write will be performed in the upcoming cycles,
+                            // disable axi_lite_bvalid if it has been read.
+                            axi_lite_awready <= 0;
+                            state_write <= StateWdata;
+                            if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                        end
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                StateWdata: begin
+                    if (s_axi_lite_wvalid && axi_lite_wready) begin
+                        state_write <= StateWaddr;
+                        axi_lite_bvalid <= 1;
+                        axi_lite_awready <= 1;
+                    end else begin
+                        if (s_axi_lite_bready && axi_lite_bvalid) axi_lite_bvalid <= 0;
+                    end
+                end
+                default: state_write <= StateIdle;
+            endcase
+        end
+    end
+
+    // AXI4-Lite state machine for read operations
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            axi_lite_araddr <= 0;
+            axi_lite_arready <= 0;
+            axi_lite_rvalid <= 0;
+            state_read <= StateIdle;
+        end else begin
+            case (state_read)
+                StateIdle: begin
+                    axi_lite_arready <= 1;
+                    state_read <= StateRaddr;
+                end
+                StateRaddr: begin
+                    if (s_axi_lite_arvalid && s_axi_lite_arready) begin
+                        axi_lite_araddr <= s_axi_lite_araddr;
+                        axi_lite_rvalid <= 1;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRdata;
+                    end
+                end
+                StateRdata: begin
+                    if (s_axi_lite_rvalid && s_axi_lite_rready) begin
+                        axi_lite_rvalid <= 0;
+                        axi_lite_arready <= 1;
+                        state_read <= StateRaddr;
+                    end
+                end
+                default: state_read <= StateIdle;
+            endcase
+        end
+    end
+
+    wire [29:2] read_addr = axi_lite_araddr[29:2];
+    assign s_axi_lite_rdata = (read_addr == AddrConfig[29:2]) ? {27'b0, config_reg} :
+                              (read_addr == AddrThreshold[29:2]) ? threshold :
+                              (read_addr == AddrPre[29:2]) ? pre :
+                              (read_addr == AddrPost[29:2]) ? post :
+                              (read_addr == AddrStatus[29:2]) ? {29'b0, status} :
+                              (read_addr == AddrEvents[29:2]) ? events :
+                              (read_addr == AddrDepth[29:2]) ? Depth : 0;
+    assign s_axi_lite_rresp = (read_addr >= AddrConfig[29:2] && read_addr <= AddrDepth[29:2])
+                              ? 2'b00 : 2'b10;
+
+    // AXI4-Lite write logic
+    wire [29:0] write_addr = (s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:0] : axi_lite_awaddr[29:0];
+    wire [31:0] config_write = write_register(s_axi_lite_wdata, s_axi_lite_wstrb, {27'b0, config_reg});
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            config_reg <= 0;
+            threshold <= 0;
+            pre <= 0;
+            post <= 1;
+            arm <= 0;
+            axi_lite_bresp <= 2'b00;
+        end else begin
+            // Asserted for a single cycle
+            arm <= 0;
+            if (s_axi_lite_wvalid) begin
+                axi_lite_bresp <= 2'b00;
+                if (write_addr[29:2] == AddrConfig[29:2]) begin
+                    config_reg <= config_write[4:0];
+                    arm <= config_write[0];
+                end else if (write_addr[29:2] == AddrThreshold[29:2]) begin
+                    threshold <= write_register(s_axi_lite_wdata, s_axi_lite_wstrb, threshold);
+                end else if (write_addr[29:2] == AddrPre[29:2]) begin
+                    pre <= write_register(s_axi_lite_wdata, s_axi_lite_wstrb, pre);
+                end else if (write_addr[29:2] == AddrPost[29:2]) begin
+                    post <= write_register(s_axi_lite_wdata, s_axi_lite_wstrb, post);
+                end else begin
+                    // The other registers are read-only registers
+                    axi_lite_bresp <= 2'b10;
+                end
+            end
+        end
+    end
+
+    event_trigger_impl #(
+        .LOG2_DEPTH(LOG2_DEPTH)
+    ) impl (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .enable(config_reg[0]),
+        .arm(arm),
+        .continuous(config_reg[1]),
+        .rising(config_reg[2]),
+        .falling(config_reg[3]),
+        .slope(config_reg[4]),
+        .threshold(threshold[23:0]),
+        .pre(pre),
+        .post(post),
+        .status(status),
+        .events(events)
+    );
+endmodule
+
+module event_trigger_impl #(
+    parameter integer LOG2_DEPTH = 12
+) (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream data subordinate
+    input  wire [31:0] s_axis_data_tdata,
+    input  wire        s_axis_data_tvalid,
+    output wire        s_axis_data_tready,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_data_tdata,
+    output wire        m_axis_data_tvalid,
+    input  wire        m_axis_data_tready,
+    // Control, 'arm' is a single-cycle pulse
+    input  wire        enable,
+    input  wire        arm,
+    input  wire        continuous,
+    input  wire        rising,
+    input  wire        falling,
+    input  wire        slope,
+    input  wire [23:0] threshold,
+    input  wire [31:0] pre,
+    input  wire [31:0] post,
+    // Status
+    output wire [ 2:0] status,
+    output reg  [31:0] events = 32'b0
+);
+    // The block RAM is a ring buffer with a write and a read pointer like in
+    // 'axis_fifo_impl', followed by an output register. While armed, the
+    // read pointer follows the write pointer at a distance of 'pre', which
+    // drops the older samples. In a window, the samples are read out like
+    // from a FIFO; new samples are held back while the buffer is full. They
+    // are the history of the next window with 'continuous'.
+    localparam reg [1:0] StatePass = 2'd0;
+    localparam reg [1:0] StateArmed = 2'd1;
+    localparam reg [1:0] StateWindow = 2'd2;
+    localparam reg [1:0] StateDone = 2'd3;
+    localparam integer MaxPre = (1 << LOG2_DEPTH) - 1;
+
+    reg [31:0] memory[0:(1 << LOG2_DEPTH)-1];
+    reg [LOG2_DEPTH:0] write_ptr = 0;
+    reg [LOG2_DEPTH:0] read_ptr = 0;
+    reg [31:0] out_data = 32'b0;
+    reg out_valid = 1'b0;
+    reg [1:0] state = StatePass;
+    // Samples of the window still to be read from the buffer
+    reg [32:0] remaining = 33'b0;
+    reg signed [23:0] last_sample = 24'b0;
+    reg has_last = 1'b0;
+
+    wire [LOG2_DEPTH:0] stored = write_ptr - read_ptr;
+    wire full = stored[LOG2_DEPTH];
+    wire empty = stored == 0;
+    wire [LOG2_DEPTH:0] history = (pre > MaxPre) ? MaxPre[LOG2_DEPTH:0] : pre[LOG2_DEPTH:0];
+    wire ready = (state == StateWindow) ? ~full : 1'b1;
+
+    // Comparison of the sample, or its difference to the last one with
+    // 'slope', against the threshold
+    wire signed [23:0] sample = s_axis_data_tdata[31:8];
+    wire signed [24:0] level = {threshold[23], threshold};
+    wire signed [24:0] delta = {sample[23], sample} - {last_sample[23], last_sample};
+    wire hit_rising = slope ? (delta >= level) : (last_sample < $signed(threshold) && sample >= $signed(threshold));
+    wire hit_falling = slope ? (delta <= -level) : (last_sample > $signed(threshold) && sample <= $signed(threshold));
+    wire triggered = has_last & (stored >= history) & ((rising & hit_rising) | (falling & hit_falling));
+
+    wire accept = s_axis_data_tvalid & ready & (state != StatePass);
+    wire fire = accept & (state == StateArmed) & triggered;
+    wire write = accept & (state != StateDone);
+    // Drop the oldest samples beyond the history, there may be more than
+    // one left from the previous window
+    wire drop = (state == StateArmed) & ~fire & ((stored > history) | (write & (stored == history)));
+    wire read = (state == StateWindow) & (remaining != 0) & ~empty & (~out_valid | m_axis_data_tready);
+
+    assign s_axis_data_tready = (state == StatePass) ? m_axis_data_tready : ready;
+    assign m_axis_data_tdata = (state == StatePass) ? s_axis_data_tdata : out_data;
+    assign m_axis_data_tvalid = (state == StatePass) ? s_axis_data_tvalid : out_valid;
+    assign status = {state == StateArmed && has_last && stored >= history, state};
+
+    // Block RAM, without a reset
+    always @(posedge aclk) begin
+        if (write) memory[write_ptr[LOG2_DEPTH-1:0]] <= s_axis_data_tdata;
+        if (read) out_data <= memory[read_ptr[LOG2_DEPTH-1:0]];
+    end
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            write_ptr <= 0;
+            read_ptr <= 0;
+            out_valid <= 0;
+            state <= StatePass;
+            remaining <= 0;
+            last_sample <= 0;
+            has_last <= 0;
+            events <= 0;
+        end else if (!enable) begin
+            state <= StatePass;
+            out_valid <= 0;
+        end else if (arm) begin
+            // Start over with an empty history
+            read_ptr <= write_ptr;
+            out_valid <= 0;
+            state <= StateArmed;
+            remaining <= 0;
+            has_last <= 0;
+            events <= 0;
+        end else begin
+            if (write) write_ptr <= write_ptr + 1;
+            if (drop || read) read_ptr <= read_ptr + 1;
+            if (read) begin
+                out_valid <= 1;
+                remaining <= remaining - 1;
+            end else if (m_axis_data_tready) begin
+                out_valid <= 0;
+            end
+            if (accept) begin
+                last_sample <= sample;
+                has_last <= 1;
+            end
+            if (fire) begin
+                // The history, the sample and the rest of the window. Samples
+                // left from the previous window that are older than the
+                // history are skipped.
+                read_ptr <= write_ptr - history;
+                state <= StateWindow;
+                remaining <= {{(32 - LOG2_DEPTH) {1'b0}}, history} + {1'b0, post};
+                if (~&events) events <= events + 1;
+            end else if (state == StateWindow && remaining == {32'b0, read}) begin
+                state <= continuous ? StateArmed : StateDone;
+            end
+        end
+    end
+endmodule
@@ -0,0 +1,199 @@
+`timescale 1ns / 1ps
+
+module event_trigger_tb #(
+    parameter real CLK_FREQ = 125.0
+);
+    localparam integer Period = $rtoi(1_000.0 / (2.0 * CLK_FREQ));
+    localparam integer Log2Depth = 6;
+    localparam reg [23:0] Amplitude = 24'd100000;
+    localparam reg [23:0] Threshold = 24'd50000;
+
+    bit         clk = 0;
+    bit         resetn = 0;
+
+    reg  [31:0] s_axis_data_tdata = 32'b0;
+    reg         s_axis_data_tvalid = 1'b0;
+    wire        s_axis_data_tready;
+    wire [31:0] m_axis_data_tdata;
+    wire        m_axis_data_tvalid;
+    reg         m_axis_data_tready = 1'b0;
+
+    reg         enable = 1'b0;
+    reg         arm = 1'b0;
+    reg         continuous = 1'b0;
+    reg         rising = 1'b0;
+    reg         falling = 1'b0;
+    reg         slope = 1'b0;
+    reg  [31:0] pre = 32'b0;
+    reg  [31:0] post = 32'b1;
+    wire [ 2:0] status;
+    wire [31:0] events;
+
+    // Source: sample 'n' is a pulse of 'Amplitude' for four samples after
+    // each index in 'pulses', zero otherwise. The low byte holds 'n'.
+    reg         run = 1'b0;
+    integer     n = 0;
+    integer     pulses[$];
+    reg  [31:0] sent[$];
+
+    // Sink: passed through samples have to arrive in order from 'pass_n',
+    // windows have to match the samples around the indices in 'expected'
+    reg         passing = 1'b1;
+    integer     pass_n = 0;
+    integer     expected[$];
+    integer     position = 0;
+    integer     windows = 0;
+
+    event_trigger_impl #(
+        .LOG2_DEPTH(Log2Depth)
+    ) dut (
+        .aclk(clk),
+        .aresetn(resetn),
+        .s_axis_data_tdata(s_axis_data_tdata),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_data_tdata(m_axis_data_tdata),
+        .m_axis_data_tvalid(m_axis_data_tvalid),
+        .m_axis_data_tready(m_axis_data_tready),
+        .enable(enable),
+        .arm(arm),
+        .continuous(continuous),
+        .rising(rising),
+        .falling(falling),
+        .slope(slope),
+        .threshold(Threshold),
+        .pre(pre),
+        .post(post),
+        .status(status),
+        .events(events)
+    );
+
+    always #(Period) clk <= ~clk;
+
+    function automatic [31:0] source_sample(input integer index);
+        reg high;
+        begin
+            high = 0;
+            foreach (pulses[i]) if (index >= pulses[i] && index < pulses[i] + 4) high = 1;
+            source_sample = {high ? Amplitude : 24'd0, 8'(index)};
+        end
+    endfunction
+
+    always @(posedge clk) begin
+        if (s_axis_data_tvalid && s_axis_data_tready) s_axis_data_tvalid <= 0;
+        if (run && (!s_axis_data_tvalid || s_axis_data_tready) && 1'($urandom() % 4 != 0)) begin
+            s_axis_data_tdata  <= source_sample(n);
+            s_axis_data_tvalid <= 1;
+            sent.push_back(source_sample(n));
+            n <= n + 1;
+        end
+        m_axis_data_tready <= 1'($urandom() % 2);
+        if (m_axis_data_tvalid && m_axis_data_tready) begin
+            if (passing) begin
+                if (m_axis_data_tdata != sent[pass_n])
+                    $error("Passed sample 0x%08X, expected 0x%08X", m_axis_data_tdata, sent[pass_n]);
+                pass_n <= pass_n + 1;
+            end else if (expected.size() == 0) begin
+                $error("Unexpected window");
+            end else begin
+                if (m_axis_data_tdata != sent[expected[0]-pre+position])
+                    $error("Sample %0d of the window at %0d is 0x%08X, expected 0x%08X", position,
+                           expected[0], m_axis_data_tdata, sent[expected[0]-pre+position]);
+                if (position + 1 == pre + post) begin
+                    void'(expected.pop_front());
+                    position <= 0;
+                    windows  <= windows + 1;
+                end else begin
+                    position <= position + 1;
+                end
+            end
+        end
+    end
+
+    // Stop the source and let the window in progress drain
+    task automatic pause;
+        begin
+            @(posedge clk) run <= 0;
+            while (s_axis_data_tvalid || status[1:0] == 2'd2 || m_axis_data_tvalid) @(posedge clk);
+            repeat (8) @(posedge clk);
+        end
+    endtask
+
+    // Arm the trigger and send 'samples' samples with pulses at the given
+    // offsets from the arming
+    task automatic capture(input integer samples, input integer offset_0, input integer offset_1,
+                           input integer offset_2);
+        integer start;
+        begin
+            start = n;
+            pulses.push_back(start + offset_0);
+            pulses.push_back(start + offset_1);
+            pulses.push_back(start + offset_2);
+            passing = 0;
+            @(posedge clk) enable <= 1;
+            arm <= 1;
+            @(posedge clk) arm <= 0;
+            run <= 1;
+            while (n < start + samples) @(posedge clk);
+            pause();
+        end
+    endtask
+
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn = 1;
+
+        // Disabled, all samples pass through
+        run <= 1;
+        while (n < 100) @(posedge clk);
+        pause();
+        if (pass_n != n) $error("%0d samples passed through, expected %0d", pass_n, n);
+
+        // Once, rising level: the first pulse arrives before the history is
+        // complete, only the second one is captured
+        pre = 16;
+        post = 32;
+        rising = 1;
+        expected.push_back(n + 100);
+        capture(400, 5, 100, 300);
+        if (status[1:0] != 2'd3) $error("Trigger not done after a single window");
+        if (events != 1) $error("%0d events, expected 1", events);
+
+        // Continuous, falling level, every pulse ends a window
+        pre = 8;
+        post = 8;
+        rising = 0;
+        falling = 1;
+        continuous = 1;
+        expected.push_back(n + 54);
+        expected.push_back(n + 154);
+        expected.push_back(n + 254);
+        capture(350, 50, 150, 250);
+        if (events != 3) $error("%0d events, expected 3", events);
+
+        // Slope in both directions, the falling edge of each pulse is within
+        // the window of its rising edge. A window longer than the buffer
+        // holds back the source.
+        pre = 4;
+        post = 100;
+        rising = 1;
+        slope = 1;
+        expected.push_back(n + 40);
+        expected.push_back(n + 200);
+        expected.push_back(n + 360);
+        capture(500, 40, 200, 360);
+
+        if (expected.size() != 0) $error("%0d windows missing", expected.size());
+        if (windows != 7) $error("%0d windows received, expected 7", windows);
+
+        // Disabled again, back to passing through
+        @(posedge clk) enable <= 0;
+        passing = 1;
+        pass_n  = n;
+        run <= 1;
+        while (n < pass_n + 50) @(posedge clk);
+        pause();
+        if (pass_n != n) $error("%0d samples passed through, expected %0d", pass_n, n);
+        $finish();
+    end
+endmodule
@@ -1,6 +1,9 @@
 `timescale 1ns / 1ps
 
-module packetizer (
+module packetizer #(
+    // Address of the config register, see below
+    parameter integer ADDR_BASE = 'h0200
+) (
     input  wire        aclk,
     input  wire        aresetn,
     // AXI-Stream data subordinate
@@ -15,6 +18,9 @@ module packetizer (
     // Additional 'tlast' and 'ready' output to trigger other modules
     output wire        last,
     output wire        ready,
+    // Configuration of 'adc_trigger', copied into the block headers
+    input  wire [31:0] trigger_divider,
+    input  wire [31:0] trigger_config,
     // AXI4-Lite configuration subordinate
     input  wire [31:0] s_axi_lite_awaddr,
     input  wire [ 2:0] s_axi_lite_awprot,
@@ -52,15 +58,76 @@ module packetizer (
     // unsinged integer equal to the number of samples. Writing zero
     // to the register disables the packetizer completly, not forwarding
     // any packages.
-    localparam reg [29:0] AddrConfig = 30'h0000_0200;
-    localparam reg [29:0] AddrPacketCounter = 30'h0000_0204;
-    localparam reg [29:0] AddrIterCounter = 30'h0000_0208;
+    // Setting bit 0 of the packing register packs the 24-bit samples
+    // (bits 31:8 of the input) of the 24-bit output modes of the ADC,
+    // four samples into three words, see 'packetizer_s2mm'. Setting bit 1
+    // starts every packet with a block header.
+    // The iteration counter counts completed packets, it is the sequence
+    // number of the block headers. The timestamp counts 'aclk' cycles since
+    // the reset, reading its lower half latches the upper half.
+    //
+    // Performance counters, see 'packetizer_perf':
+    //  - Performance control register (write-only):
+    //      Base address: 0x?000_0218, 32-bit large.
+    //  - Cycles, input beats, input stalls, output beats, output stalls, and
+    //    disabled cycles (read-only):
+    //      Base addresses: 0x?000_021C to 0x?000_0248, 64-bit large each,
+    //      lower half first (cycles at 0x?000_021C and 0x?000_0220, input
+    //      beats at 0x?000_0224 and 0x?000_0228, and so on).
+    //
+    // Performance control register:
+    // +----------+-------+----------+
+    // | RESERVED | CLEAR | SNAPSHOT |
+    // +----------+-------+----------+
+    // |     31-2 |     1 |        0 |
+    // +----------+-------+----------+
+    //
+    // - SNAPSHOT: Writing 1 copies the running counters into the read-only
+    //     registers, such that they are read consistently.
+    // - CLEAR: Writing 1 restarts the running counters from zero, after the
+    //     snapshot if both are set.
+    // Unlike the other registers, the performance control register can be
+    // written in the middle of a packet.
+    //
+    // The addresses are those of the packetizer of the conversion results,
+    // 'ADDR_BASE' moves the registers of another instance, e.g. the one of
+    // the raw path in the dual-stream variant.
+    localparam reg [29:0] AddrConfig = ADDR_BASE[29:0] + 30'h00;
+    localparam reg [29:0] AddrPacketCounter = ADDR_BASE[29:0] + 30'h04;
+    localparam reg [29:0] AddrIterCounter = ADDR_BASE[29:0] + 30'h08;
+    localparam reg [29:0] AddrPack = ADDR_BASE[29:0] + 30'h0C;
+    localparam reg [29:0] AddrTimestampLow = ADDR_BASE[29:0] + 30'h10;
+    localparam reg [29:0] AddrTimestampHigh = ADDR_BASE[29:0] + 30'h14;
+    localparam reg [29:0] AddrPerfControl = ADDR_BASE[29:0] + 30'h18;
+    localparam reg [29:0] AddrPerfCyclesLow = ADDR_BASE[29:0] + 30'h1C;
+    localparam reg [29:0] AddrPerfCyclesHigh = ADDR_BASE[29:0] + 30'h20;
+    localparam reg [29:0] AddrPerfInBeatsLow = ADDR_BASE[29:0] + 30'h24;
+    localparam reg [29:0] AddrPerfInBeatsHigh = ADDR_BASE[29:0] + 30'h28;
+    localparam reg [29:0] AddrPerfInStallsLow = ADDR_BASE[29:0] + 30'h2C;
+    localparam reg [29:0] AddrPerfInStallsHigh = ADDR_BASE[29:0] + 30'h30;
+    localparam reg [29:0] AddrPerfOutBeatsLow = ADDR_BASE[29:0] + 30'h34;
+    localparam reg [29:0] AddrPerfOutBeatsHigh = ADDR_BASE[29:0] + 30'h38;
+    localparam reg [29:0] AddrPerfOutStallsLow = ADDR_BASE[29:0] + 30'h3C;
+    localparam reg [29:0] AddrPerfOutStallsHigh = ADDR_BASE[29:0] + 30'h40;
+    localparam reg [29:0] AddrPerfDisabledLow = ADDR_BASE[29:0] + 30'h44;
+    localparam reg [29:0] AddrPerfDisabledHigh = ADDR_BASE[29:0] + 30'h48;
 
     // Internal register for storing data recieved on the AXI
     // subordinates.
     reg  [31:0] config_reg;
+    reg  [31:0] pack_reg;
     wire [31:0] packet_counter;
-    wire [15:0] iter_counter;
+    wire [31:0] iter_counter;
+    wire [63:0] timestamp;
+    reg  [63:0] timestamp_reg = 64'b0;
+    reg         perf_snapshot = 1'b0;
+    reg         perf_clear = 1'b0;
+    wire [63:0] perf_cycles;
+    wire [63:0] perf_in_beats;
+    wire [63:0] perf_in_stalls;
+    wire [63:0] perf_out_beats;
+    wire [63:0] perf_out_stalls;
+    wire [63:0] perf_disabled;
 
     // AXI4-Lite state machine and registers
     localparam reg [1:0] StateIdle = 2'b00;
@@ -83,11 +150,12 @@ module packetizer (
     reg        axis_tready = 1'b0;
 
     // Only accept writes if the counter is zero or equal to
-    // config_reg
-    assign s_axi_lite_awready = axi_lite_awready &
-        ((packet_counter == 32'b0) | (packet_counter == config_reg));
-    assign s_axi_lite_wready  = axi_lite_wready &
-        ((packet_counter == 32'b0) | (packet_counter == config_reg));
+    // config_reg, or if they go to the performance control register
+    wire [29:0] write_addr = (s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:0] : axi_lite_awaddr[29:0];
+    wire write_idle = (packet_counter == 32'b0) | (packet_counter == config_reg) |
+        (write_addr[29:2] == AddrPerfControl[29:2]);
+    assign s_axi_lite_awready = axi_lite_awready & write_idle;
+    assign s_axi_lite_wready  = axi_lite_wready & write_idle;
     assign s_axi_lite_bresp = axi_lite_bresp;
     assign s_axi_lite_bvalid = axi_lite_bvalid;
     assign s_axi_lite_arready = axi_lite_arready;
@@ -159,6 +227,8 @@ module packetizer (
                 StateRaddr: begin
                     if (s_axi_lite_arvalid && s_axi_lite_arready) begin
                         axi_lite_araddr <= s_axi_lite_araddr;
+                        if (s_axi_lite_araddr[29:2] == AddrTimestampLow[29:2])
+                            timestamp_reg <= timestamp;
                         axi_lite_rvalid <= 1;
                         axi_lite_arready <= 1;
                         state_read <= StateRdata;
@@ -178,29 +248,108 @@ module packetizer (
 
     assign s_axi_lite_rdata = (axi_lite_araddr[29:2] == AddrConfig[29:2]) ? config_reg :
                               (axi_lite_araddr[29:2] == AddrPacketCounter[29:2]) ? packet_counter :
-                              (axi_lite_araddr[29:2] == AddrIterCounter[29:2])
-                              ? {16'b0, iter_counter} : 0;
+                              (axi_lite_araddr[29:2] == AddrIterCounter[29:2]) ? iter_counter :
+                              (axi_lite_araddr[29:2] == AddrPack[29:2]) ? pack_reg :
+                              (axi_lite_araddr[29:2] == AddrTimestampLow[29:2])
+                              ? timestamp_reg[31:0] :
+                              (axi_lite_araddr[29:2] == AddrTimestampHigh[29:2])
+                              ? timestamp_reg[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfCyclesLow[29:2])
+                              ? perf_cycles[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfCyclesHigh[29:2])
+                              ? perf_cycles[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfInBeatsLow[29:2])
+                              ? perf_in_beats[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfInBeatsHigh[29:2])
+                              ? perf_in_beats[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfInStallsLow[29:2])
+                              ? perf_in_stalls[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfInStallsHigh[29:2])
+                              ? perf_in_stalls[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfOutBeatsLow[29:2])
+                              ? perf_out_beats[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfOutBeatsHigh[29:2])
+                              ? perf_out_beats[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfOutStallsLow[29:2])
+                              ? perf_out_stalls[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfOutStallsHigh[29:2])
+                              ? perf_out_stalls[63:32] :
+                              (axi_lite_araddr[29:2] == AddrPerfDisabledLow[29:2])
+                              ? perf_disabled[31:0] :
+                              (axi_lite_araddr[29:2] == AddrPerfDisabledHigh[29:2])
+                              ? perf_disabled[63:32] :
+                              0;
     assign s_axi_lite_rresp = (axi_lite_araddr[29:2] == AddrConfig[29:2]) ? 2'b00 :
                               (axi_lite_araddr[29:2] == AddrPacketCounter[29:2]) ? 2'b00 :
-                              (axi_lite_araddr[29:2] == AddrIterCounter[29:2]) ? 2'b00 : 2'b10;
+                              (axi_lite_araddr[29:2] == AddrIterCounter[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPack[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrTimestampLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrTimestampHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfCyclesLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfCyclesHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfInBeatsLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfInBeatsHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfInStallsLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfInStallsHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfOutBeatsLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfOutBeatsHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfOutStallsLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfOutStallsHigh[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfDisabledLow[29:2]) ? 2'b00 :
+                              (axi_lite_araddr[29:2] == AddrPerfDisabledHigh[29:2]) ? 2'b00 :
+                              2'b10;
 
     // AXI4-Lite write logic
+    wire [31:0] perf_write = write_register(s_axi_lite_wdata, s_axi_lite_wstrb, 32'b0);
     always @(posedge aclk or negedge aresetn) begin
         if (!aresetn) begin
             config_reg <= 0;
+            pack_reg <= 0;
+            perf_snapshot <= 0;
+            perf_clear <= 0;
             axi_lite_bresp <= 2'b00;
         end else begin
+            // Both are asserted for a single cycle
+            perf_snapshot <= 0;
+            perf_clear <= 0;
             if (s_axi_lite_wvalid) begin
-                case ((s_axi_lite_awvalid) ? s_axi_lite_awaddr[29:2] : axi_lite_awaddr[29:2])
+                case (write_addr[29:2])
                     AddrConfig[29:2]: begin
                         config_reg <= write_register(
                             s_axi_lite_wdata, s_axi_lite_wstrb, config_reg
                         );
                         axi_lite_bresp <= 2'b00;
                     end
+                    AddrPack[29:2]: begin
+                        pack_reg <= write_register(
+                            s_axi_lite_wdata, s_axi_lite_wstrb, pack_reg
+                        );
+                        axi_lite_bresp <= 2'b00;
+                    end
+                    AddrPerfControl[29:2]: begin
+                        if (s_axi_lite_wready) begin
+                            perf_snapshot <= perf_write[0];
+                            perf_clear <= perf_write[1];
+                        end
+                        axi_lite_bresp <= 2'b00;
+                    end
                     // The counter registers are read-only registers
                     AddrPacketCounter[29:2]: axi_lite_bresp <= 2'b10;
                     AddrIterCounter[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrTimestampLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrTimestampHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfCyclesLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfCyclesHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfInBeatsLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfInBeatsHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfInStallsLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfInStallsHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfOutBeatsLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfOutBeatsHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfOutStallsLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfOutStallsHigh[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfDisabledLow[29:2]: axi_lite_bresp <= 2'b10;
+                    AddrPerfDisabledHigh[29:2]: axi_lite_bresp <= 2'b10;
                     default: axi_lite_bresp <= 2'b10;
                 endcase
             end
@@ -220,13 +369,125 @@ module packetizer (
         .m_axis_s2mm_tlast(m_axis_s2mm_tlast),
         // Other
         .config_reg(config_reg),
+        .pack(pack_reg[0]),
+        .header(pack_reg[1]),
+        .trigger_divider(trigger_divider),
+        .trigger_config(trigger_config),
         .packet_counter(packet_counter),
-        .iter_counter(iter_counter)
+        .iter_counter(iter_counter),
+        .timestamp(timestamp)
+    );
+
+    packetizer_perf perf (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_s2mm_tvalid(m_axis_s2mm_tvalid),
+        .m_axis_s2mm_tready(m_axis_s2mm_tready),
+        .enabled(|config_reg),
+        .snapshot(perf_snapshot),
+        .clear(perf_clear),
+        .cycles(perf_cycles),
+        .in_beats(perf_in_beats),
+        .in_stalls(perf_in_stalls),
+        .out_beats(perf_out_beats),
+        .out_stalls(perf_out_stalls),
+        .disabled(perf_disabled)
     );
     assign last  = m_axis_s2mm_tlast;
     assign ready = s_axis_data_tready;
 endmodule
 
+module packetizer_perf (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // Handshakes of the input and the S2MM interface of the packetizer
+    input  wire        s_axis_data_tvalid,
+    input  wire        s_axis_data_tready,
+    input  wire        m_axis_s2mm_tvalid,
+    input  wire        m_axis_s2mm_tready,
+    // The packetizer is enabled (configured with a nonzero length)
+    input  wire        enabled,
+    input  wire        snapshot,
+    input  wire        clear,
+    // Running counters as of the last 'snapshot'
+    output reg  [63:0] cycles = 64'b0,
+    output reg  [63:0] in_beats = 64'b0,
+    output reg  [63:0] in_stalls = 64'b0,
+    output reg  [63:0] out_beats = 64'b0,
+    output reg  [63:0] out_stalls = 64'b0,
+    output reg  [63:0] disabled = 64'b0
+);
+    // Every counter counts the cycles in which its condition holds, 64 bits
+    // do not wrap around in any realistic capture:
+    //
+    //   cycles:     every cycle
+    //   in_beats:   samples accepted on the input
+    //   in_stalls:  input 'tvalid' without 'tready', the packetizer holds
+    //               back a sample (this includes disabled cycles)
+    //   out_beats:  words accepted by the DMA, including block headers
+    //   out_stalls: S2MM 'tvalid' without 'tready', the DMA holds back a
+    //               word
+    //   disabled:   input 'tvalid' while the packetizer is disabled, e.g.
+    //               between two captures
+    //
+    // 'out_beats / cycles' is the utilization of the link to the DMA.
+    reg [63:0] run_cycles = 64'b0;
+    reg [63:0] run_in_beats = 64'b0;
+    reg [63:0] run_in_stalls = 64'b0;
+    reg [63:0] run_out_beats = 64'b0;
+    reg [63:0] run_out_stalls = 64'b0;
+    reg [63:0] run_disabled = 64'b0;
+
+    function automatic [63:0] count(input [63:0] value, input condition);
+        count = condition ? value + 1 : value;
+    endfunction
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            run_cycles     <= 0;
+            run_in_beats   <= 0;
+            run_in_stalls  <= 0;
+            run_out_beats  <= 0;
+            run_out_stalls <= 0;
+            run_disabled   <= 0;
+            cycles         <= 0;
+            in_beats       <= 0;
+            in_stalls      <= 0;
+            out_beats      <= 0;
+            out_stalls     <= 0;
+            disabled       <= 0;
+        end else begin
+            if (snapshot) begin
+                cycles     <= run_cycles;
+                in_beats   <= run_in_beats;
+                in_stalls  <= run_in_stalls;
+                out_beats  <= run_out_beats;
+                out_stalls <= run_out_stalls;
+                disabled   <= run_disabled;
+            end
+            if (clear) begin
+                run_cycles     <= 0;
+                run_in_beats   <= 0;
+                run_in_stalls  <= 0;
+                run_out_beats  <= 0;
+                run_out_stalls <= 0;
+                run_disabled   <= 0;
+            end else begin
+                run_cycles <= count(run_cycles, 1'b1);
+                run_in_beats <= count(run_in_beats, s_axis_data_tvalid & s_axis_data_tready);
+                run_in_stalls <= count(run_in_stalls, s_axis_data_tvalid & ~s_axis_data_tready);
+                run_out_beats <= count(run_out_beats, m_axis_s2mm_tvalid & m_axis_s2mm_tready);
+                run_out_stalls <= count(
+                    run_out_stalls, m_axis_s2mm_tvalid & ~m_axis_s2mm_tready
+                );
+                run_disabled <= count(run_disabled, s_axis_data_tvalid & ~enabled);
+            end
+        end
+    end
+endmodule
+
 module packetizer_s2mm (
     input  wire        aclk,
     input  wire        aresetn,
@@ -241,19 +502,90 @@ module packetizer_s2mm (
     output wire        m_axis_s2mm_tlast,
     // Other
     input  wire [31:0] config_reg,
+    input  wire        pack,
+    input  wire        header,
+    input  wire [31:0] trigger_divider,
+    input  wire [31:0] trigger_config,
     output reg  [31:0] packet_counter = 32'b0,
-    output reg  [15:0] iter_counter = 16'b0
+    output reg  [31:0] iter_counter = 32'b0,
+    output reg  [63:0] timestamp = 64'b0
 );
+    // Packing mode: bits 31:8 of four samples are forwarded as three
+    // words, as a little endian stream of 24-bit samples:
+    //
+    //   word 0: {s1[ 7:0], s0[23:0]}
+    //   word 1: {s2[15:0], s1[23:8]}
+    //   word 2: {s3[23:0], s2[23:16]}
+    //
+    // The first sample of a group is only stored, the bits that do not fit
+    // into the current word are kept in 'rest'. Packets are rounded down to
+    // a multiple of four samples, such that every packet ends with a full
+    // group. 'packet_counter' counts samples in both modes.
+    //
+    // Header mode: every packet starts with eight words,
+    //
+    //   word 0: magic 0x48434441 ("ADCH")
+    //   word 1: sequence number ('iter_counter')
+    //   word 2: timestamp[31:0]
+    //   word 3: timestamp[63:32]
+    //   word 4: number of samples of the packet
+    //   word 5: divider of 'adc_trigger'
+    //   word 6: config register of 'adc_trigger'
+    //   word 7: flags, bit 0 is set if the samples are packed
+    //
+    // The timestamp is the 'aclk' cycle in which the first sample of the
+    // packet arrived, which follows the conversion by a constant delay. The
+    // first sample is accepted (stored in 'held') without waiting for the
+    // header, such that 'ready' to 'adc_trigger' only drops if the header
+    // takes longer than a sample period. In packing mode, the first sample
+    // of a group is stored in 'rest' anyway and nothing is held.
+    localparam reg [31:0] HeaderMagic = 32'h4843_4441;
+    localparam reg [1:0] HeaderWait = 2'd0;
+    localparam reg [1:0] HeaderWords = 2'd1;
+    localparam reg [1:0] HeaderHeld = 2'd2;
+    localparam reg [1:0] HeaderDone = 2'd3;
+    reg [1:0] header_state = HeaderWait;
+    reg [2:0] header_index = 3'b0;
+    reg [63:0] stamp = 64'b0;
+    reg [31:0] held = 32'b0;
+    wire emit = header & (header_state == HeaderWords || header_state == HeaderHeld);
+    wire wait_first = header & (header_state == HeaderWait);
+
     reg last = 1'b0;
+    reg [1:0] phase = 2'b0;
+    reg [23:0] rest = 24'b0;
+    wire [31:0] length = pack ? {config_reg[31:2], 2'b00} : config_reg;
+    wire [23:0] sample = s_axis_data_tdata[31:8];
+    // The first sample of a packet with a header is only stored, like the
+    // first sample of a group in packing mode
+    wire store = (pack & (phase == 2'd0)) | wait_first;
+    wire accept = s_axis_data_tvalid & s_axis_data_tready;
+    wire emit_accept = emit & m_axis_s2mm_tvalid & m_axis_s2mm_tready;
+    reg [31:0] header_word;
+    always @(*) begin
+        case (header_index)
+            3'd0: header_word = HeaderMagic;
+            3'd1: header_word = iter_counter;
+            3'd2: header_word = stamp[31:0];
+            3'd3: header_word = stamp[63:32];
+            3'd4: header_word = length;
+            3'd5: header_word = trigger_divider;
+            3'd6: header_word = trigger_config;
+            default: header_word = {31'b0, pack};
+        endcase
+    end
     // AXI-Stream to AXI S2MM
-    // Ready to receive data if downstream DMA is ready and config_reg is not 0
-    assign s_axis_data_tready = |config_reg & m_axis_s2mm_tready;
-    // Last if config_reg not 0, tvalid is asserted high,
-    // and config_reg is equal to counter.
-    assign m_axis_s2mm_tlast  = |config_reg & m_axis_s2mm_tvalid & last;
-    // Data is valid if config_reg not zero,
-    // and upstream data input is also valid.
-    assign m_axis_s2mm_tvalid = |config_reg & s_axis_data_tvalid;
+    // Ready to receive data if downstream DMA is ready and the length is not
+    // 0. The first sample of a group in packing mode is accepted regardless.
+    // Nothing is accepted while the header is sent.
+    assign s_axis_data_tready = |length & ~emit & (m_axis_s2mm_tready | store);
+    // Last if the length is not 0, tvalid is asserted high,
+    // and the length is equal to counter.
+    assign m_axis_s2mm_tlast  = |length & m_axis_s2mm_tvalid & last & ~emit;
+    // Data is valid if the length is not zero, upstream data input is also
+    // valid, and the sample completes a word. The header and the held sample
+    // are always valid.
+    assign m_axis_s2mm_tvalid = |length & (emit | (s_axis_data_tvalid & ~store));
     // Funnel the data through the module.
     //
     // Note: If the upstream manager provides data (s_axis_data_tvalid
@@ -264,26 +596,67 @@ module packetizer_s2mm (
     //
     // There is no situation where the subordinate has tvalid and tready
     // asserted to high while the data is not valid.
-    assign m_axis_s2mm_tdata  = s_axis_data_tdata;
+    assign m_axis_s2mm_tdata  = (emit & (header_state == HeaderWords)) ? header_word :
+                                emit ? held :
+                                ~pack ? s_axis_data_tdata :
+                                (phase == 2'd1) ? {sample[7:0], rest[23:0]} :
+                                (phase == 2'd2) ? {sample[15:0], rest[15:0]} :
+                                {sample[23:0], rest[7:0]};
 
     always @(posedge aclk or negedge aresetn) begin
         if (!aresetn) begin
             packet_counter <= 0;
             iter_counter   <= 0;
+            timestamp      <= 0;
             last           <= 0;
+            phase          <= 0;
+            rest           <= 0;
+            header_state   <= HeaderWait;
+            header_index   <= 0;
+            stamp          <= 0;
+            held           <= 0;
         end else begin
-            if (config_reg == 32'b0) begin
+            timestamp <= timestamp + 1;
+            if (length == 32'b0 || !header) begin
+                header_state <= HeaderWait;
+                header_index <= 0;
+            end else if (wait_first && accept) begin
+                stamp <= timestamp;
+                held <= s_axis_data_tdata;
+                header_state <= HeaderWords;
+                header_index <= 0;
+            end else if (emit_accept) begin
+                header_index <= header_index + 1;
+                if (header_state == HeaderHeld) begin
+                    header_state <= HeaderDone;
+                end else if (header_index == 3'd7) begin
+                    // In packing mode, the first sample is kept in 'rest'
+                    header_state <= pack ? HeaderDone : HeaderHeld;
+                end
+            end
+            if (length == 32'b0) begin
                 packet_counter <= 0;
                 last <= 0;
+                phase <= 0;
             end
-            if (m_axis_s2mm_tvalid && m_axis_s2mm_tready) begin
+            if (accept) begin
+                if (pack) begin
+                    phase <= phase + 1;
+                    case (phase)
+                        2'd0: rest <= sample;
+                        2'd1: rest <= {8'b0, sample[23:8]};
+                        2'd2: rest <= {16'b0, sample[23:16]};
+                        default: rest <= 0;
+                    endcase
+                end
                 if (last) begin
                     last <= 0;
                     packet_counter <= 0;
                     iter_counter <= iter_counter + 1;
+                    header_state <= HeaderWait;
                 end else begin
                     packet_counter <= packet_counter + 1;
-                    if (packet_counter + 1 == config_reg - 1) begin
+                    if (packet_counter + 1 == length - 1) begin
                         // Next cycle will be the last cycle
                         last <= 1;
                     end
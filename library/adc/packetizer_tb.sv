@@ -38,6 +38,147 @@ module axis_loopback_checker (
     end
 endmodule
 
+module axis_pack_checker #(
+    parameter integer PACKET = 8
+) (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream subordinate
+    input  wire [31:0] s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    output wire        s_axis_tready,
+    input  wire        s_axis_tlast,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_tdata,
+    output wire        m_axis_tvalid,
+    input  wire        m_axis_tready
+);
+    // Sample 'n' carries 'n' in bits 31:8, the lower bits have to be dropped
+    // by the packing. The received words have to be the little endian
+    // stream of the 24-bit samples 0, 1, 2, ... with 'tlast' on the last
+    // word of every packet. 'tready' is random to exercise backpressure.
+    localparam integer PacketWords = PACKET * 3 / 4;
+    reg [23:0] sample = 24'b0;
+    reg [31:0] received = 32'b0;
+    reg tready = 1'b0;
+    assign s_axis_tready = tready;
+    assign m_axis_tvalid = aresetn;
+    assign m_axis_tdata  = {sample, sample[7:0] ^ 8'hA5};
+
+    function automatic [31:0] expected_word(input [31:0] index);
+        reg [31:0] byte_index;
+        reg [31:0] value;
+        begin
+            expected_word = 32'b0;
+            for (integer j = 0; j < 4; j = j + 1) begin
+                byte_index = 4 * index + j;
+                value = (byte_index / 3) >> (8 * (byte_index % 3));
+                expected_word = expected_word | ((value & 32'hFF) << (8 * j));
+            end
+        end
+    endfunction
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            sample   <= 0;
+            received <= 0;
+            tready   <= 0;
+        end else begin
+            tready <= 1'($urandom() % 2);
+            if (m_axis_tvalid && m_axis_tready) begin
+                sample <= sample + 1;
+            end
+            if (s_axis_tvalid && s_axis_tready) begin
+                if (s_axis_tdata != expected_word(received))
+                    $error("Invalid packed word %0d", received);
+                if (s_axis_tlast != (received % PacketWords == PacketWords - 1))
+                    $error("'tlast' not asserted on the last packed word");
+                received <= received + 1;
+            end
+        end
+    end
+endmodule
+
+module axis_header_checker #(
+    parameter integer PACKET = 6,
+    parameter integer DIVIDER = 17,
+    parameter integer TRIGGER_CONFIG = 1
+) (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // AXI-Stream subordinate
+    input  wire [31:0] s_axis_tdata,
+    input  wire        s_axis_tvalid,
+    output wire        s_axis_tready,
+    input  wire        s_axis_tlast,
+    // AXI-Stream data manager
+    output wire [31:0] m_axis_tdata,
+    output wire        m_axis_tvalid,
+    input  wire        m_axis_tready,
+    // Timestamp counter of the packetizer
+    input  wire [63:0] timestamp
+);
+    // Sample 'n' is the word {n, n[7:0] ^ 0xA5} and is sent at random. Every
+    // packet has to be the eight header words followed by its samples, with
+    // 'tlast' on the last sample. The header timestamp has to be the cycle
+    // in which the first sample of the packet was sent.
+    localparam integer PacketWords = PACKET + 8;
+    reg [31:0] sample = 32'b0;
+    reg [31:0] received = 32'b0;
+    reg [63:0] sent_at [4];
+    reg tready = 1'b0;
+    reg tvalid = 1'b0;
+    assign s_axis_tready = tready;
+    assign m_axis_tvalid = tvalid;
+    assign m_axis_tdata  = {sample[23:0], sample[7:0] ^ 8'hA5};
+
+    function automatic [31:0] expected_word(input [31:0] index);
+        reg [31:0] packet;
+        reg [31:0] word;
+        reg [23:0] n;
+        begin
+            packet = index / PacketWords;
+            word = index % PacketWords;
+            n = 24'(packet * PACKET + word - 8);
+            case (word)
+                0: expected_word = 32'h4843_4441;
+                1: expected_word = packet;
+                2: expected_word = sent_at[2'(packet%4)][31:0];
+                3: expected_word = sent_at[2'(packet%4)][63:32];
+                4: expected_word = PACKET;
+                5: expected_word = DIVIDER;
+                6: expected_word = TRIGGER_CONFIG;
+                7: expected_word = 32'b0;
+                default: expected_word = {n, n[7:0] ^ 8'hA5};
+            endcase
+        end
+    endfunction
+
+    always @(posedge aclk or negedge aresetn) begin
+        if (!aresetn) begin
+            sample   <= 0;
+            received <= 0;
+            tready   <= 0;
+            tvalid   <= 0;
+        end else begin
+            tready <= 1'($urandom() % 2);
+            if (!tvalid || m_axis_tready) tvalid <= 1'($urandom() % 2);
+            if (m_axis_tvalid && m_axis_tready) begin
+                if (sample % PACKET == 0) sent_at[2'((sample/PACKET)%4)] <= timestamp;
+                sample <= sample + 1;
+            end
+            if (s_axis_tvalid && s_axis_tready) begin
+                if (s_axis_tdata != expected_word(received))
+                    $error("Invalid word %0d of packet %0d: 0x%08X", received % PacketWords,
+                           received / PacketWords, s_axis_tdata);
+                if (s_axis_tlast != (received % PacketWords == PacketWords - 1))
+                    $error("'tlast' not asserted on the last sample");
+                received <= received + 1;
+            end
+        end
+    end
+endmodule
+
 module packetizer_tb #(
     parameter real CLK_FREQ = 125.0
 );
@@ -58,7 +199,49 @@ module packetizer_tb #(
 
     reg  [31:0] config_reg = 32'b0;
     wire [31:0] counter;
-    wire [15:0] iter_counter;
+    wire [31:0] iter_counter;
+    wire [63:0] timestamp;
+
+    wire [31:0] pack_s_axis_tdata;
+    wire        pack_s_axis_tvalid;
+    wire        pack_s_axis_tready;
+    wire [31:0] pack_m_axis_tdata;
+    wire        pack_m_axis_tvalid;
+    wire        pack_m_axis_tready;
+    wire        pack_last;
+    bit         resetn_pack = 0;
+    // Not a multiple of four, rounded down to 8 samples (6 words)
+    reg  [31:0] pack_config = 32'd10;
+    wire [31:0] pack_counter;
+    wire [31:0] pack_iter_counter;
+    wire [63:0] pack_timestamp;
+
+    wire [31:0] header_s_axis_tdata;
+    wire        header_s_axis_tvalid;
+    wire        header_s_axis_tready;
+    wire [31:0] header_m_axis_tdata;
+    wire        header_m_axis_tvalid;
+    wire        header_m_axis_tready;
+    wire        header_last;
+    bit         resetn_header = 0;
+    wire [31:0] header_counter;
+    wire [31:0] header_iter_counter;
+    wire [63:0] header_timestamp;
+
+    reg         perf_snapshot = 1'b0;
+    reg         perf_clear = 1'b0;
+    wire [63:0] cycles;
+    wire [63:0] in_beats;
+    wire [63:0] in_stalls;
+    wire [63:0] out_beats;
+    wire [63:0] out_stalls;
+    wire [63:0] disabled;
+    wire [63:0] header_cycles;
+    wire [63:0] header_in_beats;
+    wire [63:0] header_in_stalls;
+    wire [63:0] header_out_beats;
+    wire [63:0] header_out_stalls;
+    wire [63:0] header_disabled;
 
     axis_loopback_checker loopback (
         .aclk(clk),
@@ -84,12 +267,192 @@ module packetizer_tb #(
         .m_axis_s2mm_tlast (last),
 
         .config_reg(config_reg),
+        .pack(1'b0),
+        .header(1'b0),
+        .trigger_divider(32'b0),
+        .trigger_config(32'b0),
         .packet_counter(counter),
-        .iter_counter(iter_counter)
+        .iter_counter(iter_counter),
+        .timestamp(timestamp)
+    );
+
+    axis_pack_checker #(
+        .PACKET(8)
+    ) pack_checker (
+        .aclk(clk),
+        .aresetn(resetn_pack),
+        .s_axis_tdata(pack_m_axis_tdata),
+        .s_axis_tvalid(pack_m_axis_tvalid),
+        .s_axis_tready(pack_m_axis_tready),
+        .s_axis_tlast(pack_last),
+        .m_axis_tdata(pack_s_axis_tdata),
+        .m_axis_tvalid(pack_s_axis_tvalid),
+        .m_axis_tready(pack_s_axis_tready)
+    );
+
+    packetizer_s2mm s2mm_pack (
+        .aclk(clk),
+        .aresetn(resetn_pack),
+        .s_axis_data_tdata(pack_s_axis_tdata),
+        .s_axis_data_tvalid(pack_s_axis_tvalid),
+        .s_axis_data_tready(pack_s_axis_tready),
+
+        .m_axis_s2mm_tdata (pack_m_axis_tdata),
+        .m_axis_s2mm_tvalid(pack_m_axis_tvalid),
+        .m_axis_s2mm_tready(pack_m_axis_tready),
+        .m_axis_s2mm_tlast (pack_last),
+
+        .config_reg(pack_config),
+        .pack(1'b1),
+        .header(1'b0),
+        .trigger_divider(32'b0),
+        .trigger_config(32'b0),
+        .packet_counter(pack_counter),
+        .iter_counter(pack_iter_counter),
+        .timestamp(pack_timestamp)
+    );
+
+    axis_header_checker #(
+        .PACKET(6),
+        .DIVIDER(17),
+        .TRIGGER_CONFIG(1)
+    ) header_checker (
+        .aclk(clk),
+        .aresetn(resetn_header),
+        .s_axis_tdata(header_m_axis_tdata),
+        .s_axis_tvalid(header_m_axis_tvalid),
+        .s_axis_tready(header_m_axis_tready),
+        .s_axis_tlast(header_last),
+        .m_axis_tdata(header_s_axis_tdata),
+        .m_axis_tvalid(header_s_axis_tvalid),
+        .m_axis_tready(header_s_axis_tready),
+        .timestamp(header_timestamp)
+    );
+
+    packetizer_s2mm s2mm_header (
+        .aclk(clk),
+        .aresetn(resetn_header),
+        .s_axis_data_tdata(header_s_axis_tdata),
+        .s_axis_data_tvalid(header_s_axis_tvalid),
+        .s_axis_data_tready(header_s_axis_tready),
+
+        .m_axis_s2mm_tdata (header_m_axis_tdata),
+        .m_axis_s2mm_tvalid(header_m_axis_tvalid),
+        .m_axis_s2mm_tready(header_m_axis_tready),
+        .m_axis_s2mm_tlast (header_last),
+
+        .config_reg(32'd6),
+        .pack(1'b0),
+        .header(1'b1),
+        .trigger_divider(32'd17),
+        .trigger_config(32'd1),
+        .packet_counter(header_counter),
+        .iter_counter(header_iter_counter),
+        .timestamp(header_timestamp)
+    );
+
+    packetizer_perf perf (
+        .aclk(clk),
+        .aresetn(resetn_s2mm),
+        .s_axis_data_tvalid(s_axis_data_tvalid),
+        .s_axis_data_tready(s_axis_data_tready),
+        .m_axis_s2mm_tvalid(m_axis_s2mm_tvalid),
+        .m_axis_s2mm_tready(m_axis_s2mm_tready),
+        .enabled(|config_reg),
+        .snapshot(perf_snapshot),
+        .clear(perf_clear),
+        .cycles(cycles),
+        .in_beats(in_beats),
+        .in_stalls(in_stalls),
+        .out_beats(out_beats),
+        .out_stalls(out_stalls),
+        .disabled(disabled)
+    );
+
+    packetizer_perf perf_header (
+        .aclk(clk),
+        .aresetn(resetn_header),
+        .s_axis_data_tvalid(header_s_axis_tvalid),
+        .s_axis_data_tready(header_s_axis_tready),
+        .m_axis_s2mm_tvalid(header_m_axis_tvalid),
+        .m_axis_s2mm_tready(header_m_axis_tready),
+        .enabled(1'b1),
+        .snapshot(perf_snapshot),
+        .clear(perf_clear),
+        .cycles(header_cycles),
+        .in_beats(header_in_beats),
+        .in_stalls(header_in_stalls),
+        .out_beats(header_out_beats),
+        .out_stalls(header_out_stalls),
+        .disabled(header_disabled)
     );
 
     always #(Period) clk <= ~clk;
 
+    // Without packing and headers, the packetizer passes the handshakes
+    // through: every input beat is an output beat, and the input stalls
+    // either because the packetizer is disabled or because the DMA stalls
+    task automatic check_plain_perf;
+        if (in_beats != out_beats)
+            $error("%0d input beats but %0d output beats counted", in_beats, out_beats);
+        if (in_stalls != out_stalls + disabled)
+            $error(
+                "%0d input stalls counted, %0d output stalls and %0d disabled cycles",
+                in_stalls,
+                out_stalls,
+                disabled
+            );
+    endtask
+
+    // Performance counters of the plain and the header packetizer, snapshots
+    // are taken with and without clearing the counters
+    initial begin
+        #(5 * Period);
+        #(30 * Period);
+        @(posedge clk) perf_snapshot <= 1;
+        @(posedge clk) perf_snapshot <= 0;
+        @(posedge clk) if (disabled == 0) $error("Disabled cycles not counted");
+        if (in_beats == 0) $error("Input beats not counted");
+        check_plain_perf();
+        #(50 * Period);
+        @(posedge clk) perf_snapshot <= 1;
+        perf_clear <= 1;
+        // The counters restart from zero at this edge, neither this cycle nor
+        // the one of the next snapshot is counted
+        @(posedge clk) perf_snapshot <= 0;
+        perf_clear <= 0;
+        @(posedge clk) if (header_in_stalls == 0 || header_out_stalls == 0)
+            $error("Stalls not counted");
+        if (header_disabled != 0) $error("Disabled cycles counted while enabled");
+        check_plain_perf();
+        repeat (48) @(posedge clk);
+        perf_snapshot <= 1;
+        @(posedge clk) perf_snapshot <= 0;
+        @(posedge clk) if (header_cycles != 49) $error("%0d cycles counted", header_cycles);
+        // Every sample is sent, after the header words of its packet. Only
+        // the first sample of a packet is held back while the header is sent.
+        if (header_in_beats > header_out_beats + 1)
+            $error("%0d samples counted, but only %0d words", header_in_beats, header_out_beats);
+        check_plain_perf();
+    end
+
+    // Headers run alongside the other tests as well
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn_header = 1;
+        #(200 * Period);
+        @(posedge clk) if (header_iter_counter < 4) $error("Packets with headers not counted");
+    end
+
+    // Packing runs alongside the other tests, the checker verifies every word
+    initial begin
+        #(5 * Period);
+        @(posedge clk) resetn_pack = 1;
+        #(110 * Period);
+        @(posedge clk) if (pack_iter_counter < 2) $error("Packed packets not counted");
+        if (pack_counter > 7) $error("Packet counter does not count samples");
+    end
+
     initial begin
         #(5 * Period);
         @(posedge clk) resetn_loopback = 1;
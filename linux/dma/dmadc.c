@@ -25,6 +25,7 @@
 #include <linux/module.h>
 #include <linux/of_dma.h>
 #include <linux/platform_device.h>
+#include <linux/timekeeping.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
 #include <linux/workqueue.h>
@@ -39,9 +40,10 @@
 #include "linux/printk.h"
 #include "linux/property.h"
 
-#define DRIVER_NAME      "dmadc"
-#define ERROR            -1
-#define DMADC_TIMEOUT_MS 10000
+#define DRIVER_NAME        "dmadc"
+#define ERROR              -1
+#define DMADC_TIMEOUT_MS   10000
+#define DMADC_MAX_CHANNELS 4
 
 /**
  * struct dmadc_channel - DMA channel context
@@ -56,14 +58,15 @@
  * @dma_dev:                Device for DMA operations (device of this kernel
  *                          driver).
  * @cdev:                   Char device structure.
- * @dmadc_dev:              Actual device under /dev/dmadc.
+ * @dmadc_dev:              Actual device under /dev/dmadc, /dev/dmadc1, ...
  * @dev_node:               Char device node.
- * @class_p:                Device class.
  * @dma_channel:            DMA engine channel.
  * @transfer_completion:    Completion for transfer synchronization.
  * @cookie:                 DMA cookie for current transfer.
  * @timeout_ms:             Transfer timeout in milliseconds. Can be set using
  *                          the SET_TIMEOUT_MS ioctl call.
+ * @completion_ns:          Monotonic time of the completion of the current
+ *                          transfer in nanoseconds, zero while in progress.
  */
 struct dmadc_channel {
     uint32_t *buffer;
@@ -78,13 +81,28 @@ struct dmadc_channel {
     struct cdev cdev;
     struct device *dmadc_dev;
     dev_t dev_node;
-    struct class *class_p;
 
     struct dma_chan *dma_channel;
     struct completion transfer_completion;
     dma_cookie_t cookie;
 
     unsigned int timeout_ms;
+    u64 completion_ns;
+};
+
+/**
+ * struct dmadc_device - Driver context, one channel per entry of 'dma-names'
+ * @channels:       The DMA channels, channel 0 is /dev/dmadc and channel n
+ *                  /dev/dmadc<n>.
+ * @channel_count:  Number of channels.
+ * @dev_node:       First char device number, one per channel.
+ * @class_p:        Device class.
+ */
+struct dmadc_device {
+    struct dmadc_channel *channels;
+    int channel_count;
+    dev_t dev_node;
+    struct class *class_p;
 };
 
 /**
@@ -95,6 +113,9 @@ struct dmadc_channel {
 static void sync_callback(void *data) {
     struct dmadc_channel *channel = (struct dmadc_channel *)data;
 
+    /* Timestamp first, used to measure the wake-up latency of user space */
+    channel->completion_ns = ktime_get_ns();
+
     /* Sync buffer for CPU access after DMA completion */
     dma_sync_single_for_cpu(
         channel->dma_dev,
@@ -185,6 +206,7 @@ static long start_transfer(struct dmadc_channel *channel, unsigned int size) {
 
     // Reset completion to uncompleted state
     init_completion(&channel->transfer_completion);
+    channel->completion_ns = 0;
 
     channel->cookie = dmaengine_submit(chan_desc);
     if (dma_submit_error(channel->cookie)) {
@@ -308,6 +330,7 @@ static long ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
     enum dmadc_status status;
     int rc;
     unsigned int start_result;
+    u64 completion_ns;
 
     switch (cmd) {
         case START_TRANSFER:
@@ -347,6 +370,14 @@ static long ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
                 return -EINVAL;
             channel->timeout_ms = timeout_ms;
             break;
+        case COMPLETION_TIME:
+            completion_ns = READ_ONCE(channel->completion_ns);
+            rc = copy_to_user(
+                (uint64_t __user *)arg, &completion_ns, sizeof(completion_ns)
+            );
+            if (rc)
+                return -EINVAL;
+            break;
         default:
             return -EINVAL;
     }
@@ -361,69 +392,124 @@ static struct file_operations dm_fops = {
     .mmap = mmap
 };
 
-static int cdevice_init(struct dmadc_channel *channel) {
+static int cdevice_init(
+    struct dmadc_device *device, struct dmadc_channel *channel, int index
+) {
     int rc;
 
-    rc = alloc_chrdev_region(&channel->dev_node, 0, 1, DRIVER_NAME);
-    if (rc) {
-        dev_err(channel->dma_dev, "unable to get a char device number\n");
-        return rc;
-    }
-
+    channel->dev_node = MKDEV(MAJOR(device->dev_node), index);
     cdev_init(&channel->cdev, &dm_fops);
     channel->cdev.owner = THIS_MODULE;
 
     rc = cdev_add(&channel->cdev, channel->dev_node, 1);
     if (rc) {
         dev_err(channel->dma_dev, "unable to add char device\n");
-        goto init_error1;
+        return rc;
     }
 
-    channel->class_p = class_create(DRIVER_NAME);
-    if (IS_ERR(channel->class_p)) {
-        dev_err(channel->dma_dev, "unable to create class\n");
-        rc = PTR_ERR_OR_ZERO(channel->class_p);
-        channel->class_p = NULL;
-        goto init_error2;
+    // The first channel keeps the name of the single channel driver
+    if (index == 0) {
+        channel->dmadc_dev = device_create(
+            device->class_p, NULL, channel->dev_node, NULL, DRIVER_NAME
+        );
+    } else {
+        channel->dmadc_dev = device_create(
+            device->class_p,
+            NULL,
+            channel->dev_node,
+            NULL,
+            DRIVER_NAME "%d",
+            index
+        );
     }
-
-    channel->dmadc_dev = device_create(
-        channel->class_p, NULL, channel->dev_node, NULL, DRIVER_NAME
-    );
     if (IS_ERR(channel->dmadc_dev)) {
         dev_err(channel->dma_dev, "unable to create the device\n");
         rc = PTR_ERR_OR_ZERO(channel->dmadc_dev);
-        goto init_error3;
+        channel->dmadc_dev = NULL;
+        cdev_del(&channel->cdev);
+        return rc;
     }
 
     return 0;
+}
 
-init_error3:
-    class_destroy(channel->class_p);
-
-init_error2:
+static void cdevice_exit(
+    struct dmadc_device *device, struct dmadc_channel *channel
+) {
+    device_destroy(device->class_p, channel->dev_node);
     cdev_del(&channel->cdev);
-
-init_error1:
-    unregister_chrdev_region(channel->dev_node, 1);
-    return rc;
 }
 
-static void cdevice_exit(struct dmadc_channel *channel) {
-    if (channel->dmadc_dev) {
-        device_destroy(channel->class_p, channel->dev_node);
+/**
+ * channel_init - Request the DMA channel @name and allocate its buffer.
+ * @device: Pointer to the dmadc_device instance.
+ * @dev:    Device of this kernel driver.
+ * @index:  Index of the channel in 'dma-names'.
+ * @name:   Name of the channel in 'dma-names'.
+ */
+static int channel_init(
+    struct dmadc_device *device, struct device *dev, int index, const char *name
+) {
+    int rc;
+    struct dmadc_channel *channel = &device->channels[index];
+
+    channel->dma_channel = dma_request_chan(dev, name);
+    if (IS_ERR(channel->dma_channel)) {
+        dev_err(dev, "Unable to request DMA channel '%s'\n", name);
+        rc = PTR_ERR(channel->dma_channel);
+        channel->dma_channel = NULL;
+        return rc;
     }
-    if (channel->class_p) {
-        class_destroy(channel->class_p);
+
+    channel->dma_dev = dev;
+
+    // Allocate single DMA buffer that will be shared/mapped by user space
+    channel->buffer = (uint32_t *)dmam_alloc_coherent(
+        dev, DMADC_BUFFER_SIZE, &channel->dma_handle, GFP_KERNEL
+    );
+    if (!channel->buffer) {
+        dev_err(dev, "DMA allocation error for channel '%s'\n", name);
+        return ERROR;
     }
-    cdev_del(&channel->cdev);
-    unregister_chrdev_region(channel->dev_node, 1);
+
+    printk(
+        KERN_INFO "Allocated buffer of %u bytes for channel '%s'\n",
+        DMADC_BUFFER_SIZE,
+        name
+    );
+
+    // Initialize channel state
+    channel->transfer_size = 0;
+    channel->dma_addr_mapped = false;
+    channel->timeout_ms = DMADC_TIMEOUT_MS;
+    channel->completion_ns = 0;
+    channel->cookie = 0;
+    init_completion(&channel->transfer_completion);
+    complete(&channel->transfer_completion);
+
+    return cdevice_init(device, channel, index);
+}
+
+static void dmadc_cleanup(struct dmadc_device *device) {
+    int i;
+
+    for (i = 0; i < device->channel_count; i++) {
+        struct dmadc_channel *channel = &device->channels[i];
+        // Only set once the char device was added
+        if (channel->dmadc_dev)
+            cdevice_exit(device, channel);
+        if (channel->dma_channel)
+            dma_release_channel(channel->dma_channel);
+    }
+    if (device->class_p)
+        class_destroy(device->class_p);
+    unregister_chrdev_region(device->dev_node, device->channel_count);
 }
 
 static int dmadc_probe(struct platform_device *pdev) {
-    int rc, channel_count;
-    const char *name;
-    struct dmadc_channel *channel;
+    int rc, i, channel_count;
+    const char *names[DMADC_MAX_CHANNELS];
+    struct dmadc_device *device;
     struct device *dev = &pdev->dev;
 
     printk(KERN_INFO "dmadc module initialized\n");
@@ -437,67 +523,68 @@ static int dmadc_probe(struct platform_device *pdev) {
         );
         return channel_count;
     }
-    if (channel_count != 1) {
+    if (channel_count < 1 || channel_count > DMADC_MAX_CHANNELS) {
         dev_err(
             dev,
-            "Invalid number of DMA names. Only one DMA channel is supported.\n"
+            "Invalid number of DMA names. Between 1 and %d DMA channels are "
+            "supported.\n",
+            DMADC_MAX_CHANNELS
         );
         return ERROR;
     }
 
-    rc = device_property_read_string(dev, "dma-names", &name);
+    rc = device_property_read_string_array(
+        dev, "dma-names", names, channel_count
+    );
     if (rc < 0)
         return rc;
 
-    channel = devm_kmalloc(dev, sizeof(struct dmadc_channel), GFP_KERNEL);
-    if (!channel) {
-        dev_err(dev, "Could not allocate DMA channel\n");
+    device = devm_kzalloc(dev, sizeof(struct dmadc_device), GFP_KERNEL);
+    if (!device) {
+        dev_err(dev, "Could not allocate DMA device\n");
         return -ENOMEM;
     }
-
-    channel->dma_channel = dma_request_chan(dev, name);
-    if (IS_ERR(channel->dma_channel)) {
-        dev_err(dev, "Unable to request DMA channel '%s'\n", name);
-        return PTR_ERR(channel->dma_channel);
-    }
-
-    channel->dma_dev = dev;
-
-    // Allocate single DMA buffer that will be shared/mapped by user space
-    channel->buffer = (uint32_t *)dmam_alloc_coherent(
-        dev, DMADC_BUFFER_SIZE, &channel->dma_handle, GFP_KERNEL
+    device->channels = devm_kcalloc(
+        dev, channel_count, sizeof(struct dmadc_channel), GFP_KERNEL
     );
-    if (!channel->buffer) {
-        dev_err(dev, "DMA allocation error\n");
-        return ERROR;
+    if (!device->channels) {
+        dev_err(dev, "Could not allocate DMA channels\n");
+        return -ENOMEM;
     }
 
-    printk(
-        KERN_INFO "Allocated single buffer of %u bytes\n", DMADC_BUFFER_SIZE
-    );
-
-    // Initialize channel state
-    channel->transfer_size = 0;
-    channel->dma_addr_mapped = false;
-    channel->timeout_ms = DMADC_TIMEOUT_MS;
-    channel->cookie = 0;
-    init_completion(&channel->transfer_completion);
-    complete(&channel->transfer_completion);
-
-    rc = cdevice_init(channel);
-    if (rc)
+    rc = alloc_chrdev_region(&device->dev_node, 0, channel_count, DRIVER_NAME);
+    if (rc) {
+        dev_err(dev, "unable to get a char device number\n");
         return rc;
+    }
+    device->channel_count = channel_count;
+
+    device->class_p = class_create(DRIVER_NAME);
+    if (IS_ERR(device->class_p)) {
+        dev_err(dev, "unable to create class\n");
+        rc = PTR_ERR_OR_ZERO(device->class_p);
+        device->class_p = NULL;
+        dmadc_cleanup(device);
+        return rc;
+    }
+
+    for (i = 0; i < channel_count; i++) {
+        rc = channel_init(device, dev, i, names[i]);
+        if (rc) {
+            dmadc_cleanup(device);
+            return rc;
+        }
+    }
 
-    dev_set_drvdata(dev, channel);
+    dev_set_drvdata(dev, device);
     return 0;
 }
 
 static void dmadc_remove(struct platform_device *pdev) {
     struct device *dev = &pdev->dev;
-    struct dmadc_channel *channel = dev_get_drvdata(dev);
+    struct dmadc_device *device = dev_get_drvdata(dev);
 
-    cdevice_exit(channel);
-    dma_release_channel(channel->dma_channel);
+    dmadc_cleanup(device);
     printk(KERN_INFO "dmadc module exited\n");
 }
 
@@ -534,4 +621,4 @@ MODULE_AUTHOR("Xilinx, Inc.");
 MODULE_AUTHOR("Jonas Drotleff");
 MODULE_DESCRIPTION("DMA ADC");
 MODULE_LICENSE("GPL v2");
-MODULE_VERSION("0.3");
+MODULE_VERSION("0.5");
@@ -42,3 +42,6 @@ static const char *dmadc_status_strings[] = {
 #define WAIT_FOR_TRANSFER _IOR('a', 'b', enum dmadc_status *)
 #define STATUS            _IOR('a', 'c', enum dmadc_status *)
 #define SET_TIMEOUT_MS    _IOW('a', 'd', unsigned int *)
+// CLOCK_MONOTONIC time in ns at which the last transfer completed, zero if it
+// has not completed yet.
+#define COMPLETION_TIME _IOR('a', 'e', uint64_t *)
@@ -5,6 +5,21 @@ set ref_clk_freq 125.0
 set adc_clk_freq 33.33333
 set sampling_rate 1.0
 set num_sdi 4
+# Dual-stream variant, set in 'system.tcl': the conversion results are split
+# after the statistics tap. The first path is the usual one through the FIFO,
+# event trigger, decimator and packetizer into 'axi_dma', the second one
+# carries the raw conversion results through 'axis_fifo_raw' and
+# 'packetizer_raw' into 'axi_dma_raw' on the HP1 port.
+if {![info exists dual_stream]} {
+    set dual_stream 0
+}
+# Echo clock variant, set in 'system.tcl': SCKOUT of the ADC comes in on the
+# debug pin as 'exp_adc_sckout' and clocks the echo capture of 'adc_manager',
+# see 'constraints/echo_clk.xdc'. Otherwise, the echo clock input is tied low
+# and echo clock mode flags every conversion result as lost.
+if {![info exists echo_clk]} {
+    set echo_clk 0
+}
 
 # Ports
 # ADC SPI
@@ -15,14 +30,20 @@ create_bd_port -dir O exp_adc_sdo
 create_bd_port -dir I -from [expr $num_sdi-1] -to 0 exp_adc_sdi
 create_bd_port -dir I exp_adc_busy
 create_bd_port -dir O exp_adc_cnv
+if {$echo_clk} {
+    # Echo clock (SCKOUT)
+    create_bd_port -dir I exp_adc_sckout
+}
 # Enable pins
 create_bd_port -dir O exp_adc_ref_en
 create_bd_port -dir O exp_adc_io_en
 create_bd_port -dir O exp_adc_pwr_en
 create_bd_port -dir O exp_adc_diffamp_en
 create_bd_port -dir O exp_adc_opamp_en
-# Debug pin
-create_bd_port -dir O exp_adc_debug
+if {!$echo_clk} {
+    # Debug pin
+    create_bd_port -dir O exp_adc_debug
+}
 # External clock (on Red Pitaya)
 create_bd_port -dir I adc_clk_p_i
 create_bd_port -dir I adc_clk_n_i
@@ -73,6 +94,7 @@ create_bd_cell -type ip -vlnv xilinx.com:ip:processing_system7:5.5 ps
 set_property -dict [list \
     CONFIG.PCW_IMPORT_BOARD_PRESET "library/red-pitaya-notes/cfg/red_pitaya.xml" \
     CONFIG.PCW_USE_S_AXI_HP0 {1} \
+    CONFIG.PCW_USE_S_AXI_HP1 $dual_stream \
     CONFIG.PCW_USE_DEFAULT_ACP_USER_VAL {1} \
     CONFIG.PCW_IRQ_F2P_INTR {1} \
     CONFIG.PCW_USE_FABRIC_INTERRUPT {1} \
@@ -83,10 +105,15 @@ make_external {FIXED_IO, DDR}
     Slave "Disable"
 } [get_bd_cells ps]
 
-# ADC manager, config, trigger and packetizer
+# ADC manager, config, trigger, statistics tap, FIFO, event trigger,
+# decimator and packetizer
 create_bd_cell -type module -reference adc_manager adc_manager
 create_bd_cell -type module -reference adc_config adc_config
 create_bd_cell -type module -reference adc_trigger adc_trigger
+create_bd_cell -type module -reference axis_stats axis_stats
+create_bd_cell -type module -reference axis_fifo axis_fifo
+create_bd_cell -type module -reference event_trigger event_trigger
+create_bd_cell -type module -reference decimator decimator
 create_bd_cell -type module -reference packetizer packetizer
 create_bd_cell -type module -reference delay trigger_delay
 set_property CONFIG.DELAY_CYCLES {1} [get_bd_cells trigger_delay]
@@ -106,6 +133,27 @@ set_property -dict [list \
   CONFIG.c_sg_length_width {26} \
 ] [get_bd_cells axi_dma]
 
+# Raw path of the dual-stream variant
+if {$dual_stream} {
+    create_bd_cell -type module -reference axis_broadcast axis_broadcast
+    create_bd_cell -type module -reference axis_fifo axis_fifo_raw
+    set_property CONFIG.ADDR_BASE [expr 0x0700] [get_bd_cells axis_fifo_raw]
+    create_bd_cell -type module -reference packetizer packetizer_raw
+    set_property CONFIG.ADDR_BASE [expr 0x0800] [get_bd_cells packetizer_raw]
+    create_bd_cell -type ip -vlnv xilinx.com:ip:axi_dma:7.1 axi_dma_raw
+    set_property -dict [list \
+      CONFIG.c_include_mm2s {0} \
+      CONFIG.c_include_s2mm_dre {1} \
+      CONFIG.c_micro_dma {0} \
+      CONFIG.c_include_sg {1} \
+      CONFIG.c_sg_include_stscntrl_strm {0} \
+      CONFIG.c_s2mm_burst_size {128} \
+      CONFIG.c_sg_length_width {26} \
+    ] [get_bd_cells axi_dma_raw]
+    create_bd_cell -type inline_hdl -vlnv xilinx.com:inline_hdl:ilconcat:1.0 irq_concat
+    set_property CONFIG.NUM_PORTS {2} [get_bd_cells irq_concat]
+}
+
 # LED driver
 create_bd_cell -type inline_hdl -vlnv xilinx.com:inline_hdl:ilconcat:1.0 led_concat
 set_property CONFIG.NUM_PORTS {8} [get_bd_cells led_concat]
@@ -130,6 +178,9 @@ connect_bd_net [get_bd_pins clk_wiz_0/locked] [get_bd_pins reset_adc/dcm_locked]
 # Processing System
 connect_bd_net $ref_clk [get_bd_pins ps/M_AXI_GP0_ACLK]
 connect_bd_net $ref_clk [get_bd_pins ps/S_AXI_HP0_ACLK]
+if {$dual_stream} {
+    connect_bd_net $ref_clk [get_bd_pins ps/S_AXI_HP1_ACLK]
+}
 # ADC Config
 connect_bd_net $adc_clk [get_bd_pins adc_config/aclk]
 connect_bd_net $aresetn_adc [get_bd_pins adc_config/aresetn]
@@ -142,16 +193,62 @@ connect_bd_net [get_bd_ports exp_adc_sdo] [get_bd_pins adc_manager/spi_sdo]
 connect_bd_net [get_bd_ports exp_adc_csn] [get_bd_pins adc_manager/spi_csn]
 connect_bd_net [get_bd_ports exp_adc_sck] [get_bd_pins adc_manager/spi_clk]
 connect_bd_net [get_bd_ports exp_adc_resetn] [get_bd_pins adc_manager/spi_resetn]
+if {$echo_clk} {
+    connect_bd_net [get_bd_ports exp_adc_sckout] [get_bd_pins adc_manager/spi_echo_clk]
+} else {
+    connect_bd_net [get_bd_pins GND_0/dout] [get_bd_pins adc_manager/spi_echo_clk]
+}
 connect_bd_net [get_bd_pins adc_manager/status] [get_bd_pins adc_config/status]
 # Packetizer
+connect_bd_net $adc_clk [get_bd_pins axis_stats/aclk]
+connect_bd_net $aresetn_adc [get_bd_pins axis_stats/aresetn]
+connect_bd_intf_net [get_bd_intf_pins adc_manager/m_axis] [get_bd_intf_pins axis_stats/s_axis_data]
+
+connect_bd_net $adc_clk [get_bd_pins axis_fifo/aclk]
+connect_bd_net $aresetn_adc [get_bd_pins axis_fifo/aresetn]
+if {$dual_stream} {
+    connect_bd_net $adc_clk [get_bd_pins axis_broadcast/aclk]
+    connect_bd_net $aresetn_adc [get_bd_pins axis_broadcast/aresetn]
+    connect_bd_intf_net [get_bd_intf_pins axis_stats/m_axis_data] [get_bd_intf_pins axis_broadcast/s_axis_data]
+    connect_bd_intf_net [get_bd_intf_pins axis_broadcast/m_axis_0] [get_bd_intf_pins axis_fifo/s_axis_data]
+
+    connect_bd_net $adc_clk [get_bd_pins axis_fifo_raw/aclk]
+    connect_bd_net $aresetn_adc [get_bd_pins axis_fifo_raw/aresetn]
+    connect_bd_intf_net [get_bd_intf_pins axis_broadcast/m_axis_1] [get_bd_intf_pins axis_fifo_raw/s_axis_data]
+
+    connect_bd_net $adc_clk [get_bd_pins packetizer_raw/aclk]
+    connect_bd_net $aresetn_adc [get_bd_pins packetizer_raw/aresetn]
+    connect_bd_intf_net [get_bd_intf_pins axis_fifo_raw/m_axis_data] [get_bd_intf_pins packetizer_raw/s_axis_data]
+} else {
+    connect_bd_intf_net [get_bd_intf_pins axis_stats/m_axis_data] [get_bd_intf_pins axis_fifo/s_axis_data]
+}
+
+connect_bd_net $adc_clk [get_bd_pins event_trigger/aclk]
+connect_bd_net $aresetn_adc [get_bd_pins event_trigger/aresetn]
+connect_bd_intf_net [get_bd_intf_pins axis_fifo/m_axis_data] [get_bd_intf_pins event_trigger/s_axis_data]
+
+connect_bd_net $adc_clk [get_bd_pins decimator/aclk]
+connect_bd_net $aresetn_adc [get_bd_pins decimator/aresetn]
+connect_bd_intf_net [get_bd_intf_pins event_trigger/m_axis_data] [get_bd_intf_pins decimator/s_axis_data]
+
 connect_bd_net $adc_clk [get_bd_pins packetizer/aclk]
 connect_bd_net $aresetn_adc [get_bd_pins packetizer/aresetn]
-connect_bd_intf_net [get_bd_intf_pins adc_manager/m_axis] [get_bd_intf_pins packetizer/s_axis_data]
+connect_bd_intf_net [get_bd_intf_pins decimator/m_axis_data] [get_bd_intf_pins packetizer/s_axis_data]
 # ADC Trigger
 connect_bd_net $adc_clk [get_bd_pins adc_trigger/aclk]
 connect_bd_net $aresetn_adc [get_bd_pins adc_trigger/aresetn]
 connect_bd_net [get_bd_pins packetizer/last] [get_bd_pins adc_trigger/last]
-connect_bd_net [get_bd_pins packetizer/ready] [get_bd_pins ready_and/Op1]
+connect_bd_net [get_bd_pins adc_trigger/divider] [get_bd_pins packetizer/trigger_divider]
+connect_bd_net [get_bd_pins adc_trigger/cfg] [get_bd_pins packetizer/trigger_config]
+connect_bd_net [get_bd_pins packetizer/last] [get_bd_pins axis_fifo/last]
+connect_bd_net [get_bd_pins adc_trigger/cfg] [get_bd_pins axis_fifo/trigger_config]
+if {$dual_stream} {
+    connect_bd_net [get_bd_pins adc_trigger/divider] [get_bd_pins packetizer_raw/trigger_divider]
+    connect_bd_net [get_bd_pins adc_trigger/cfg] [get_bd_pins packetizer_raw/trigger_config]
+    connect_bd_net [get_bd_pins packetizer_raw/last] [get_bd_pins axis_fifo_raw/last]
+    connect_bd_net [get_bd_pins adc_trigger/cfg] [get_bd_pins axis_fifo_raw/trigger_config]
+}
+connect_bd_net [get_bd_pins axis_fifo/ready] [get_bd_pins ready_and/Op1]
 connect_bd_net [get_bd_pins adc_manager/ready] [get_bd_pins ready_and/Op2]
 connect_bd_net [get_bd_pins ready_and/Res] [get_bd_pins adc_trigger/ready]
 connect_bd_net [get_bd_pins adc_trigger/trigger] [get_bd_pins trigger_delay/signal_in]
@@ -167,14 +264,37 @@ connect_bd_net $aresetn_adc [get_bd_pins axi_dma/axi_resetn]
 connect_bd_net $adc_clk [get_bd_pins axi_dma/m_axi_s2mm_aclk]
 connect_bd_net $adc_clk [get_bd_pins axi_dma/m_axi_sg_aclk]
 connect_bd_net $adc_clk [get_bd_pins axi_dma/s_axi_lite_aclk]
-connect_bd_net [get_bd_pins axi_dma/s2mm_introut] [get_bd_pins ps/IRQ_F2P]
+if {$dual_stream} {
+    connect_bd_intf_net [get_bd_intf_pins packetizer_raw/m_axis_s2mm] [get_bd_intf_pins axi_dma_raw/S_AXIS_S2MM]
+    connect_bd_net $aresetn_adc [get_bd_pins axi_dma_raw/axi_resetn]
+    connect_bd_net $adc_clk [get_bd_pins axi_dma_raw/m_axi_s2mm_aclk]
+    connect_bd_net $adc_clk [get_bd_pins axi_dma_raw/m_axi_sg_aclk]
+    connect_bd_net $adc_clk [get_bd_pins axi_dma_raw/s_axi_lite_aclk]
+    # IRQ_F2P[0] and IRQ_F2P[1]
+    connect_bd_net [get_bd_pins axi_dma/s2mm_introut] [get_bd_pins irq_concat/In0]
+    connect_bd_net [get_bd_pins axi_dma_raw/s2mm_introut] [get_bd_pins irq_concat/In1]
+    connect_bd_net [get_bd_pins irq_concat/dout] [get_bd_pins ps/IRQ_F2P]
+} else {
+    connect_bd_net [get_bd_pins axi_dma/s2mm_introut] [get_bd_pins ps/IRQ_F2P]
+}
 # Automation
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/adc_config/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins adc_config/s_axi_lite]
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/adc_trigger/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins adc_trigger/s_axi_lite]
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/axi_dma/S_AXI_LITE} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axi_dma/S_AXI_LITE]
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/packetizer/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins packetizer/s_axi_lite]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/decimator/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins decimator/s_axi_lite]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/axis_fifo/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axis_fifo/s_axi_lite]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/axis_stats/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axis_stats/s_axi_lite]
+apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/event_trigger/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins event_trigger/s_axi_lite]
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$adc_clk} Clk_slave {$ref_clk} Clk_xbar {$ref_clk} Master {/axi_dma/M_AXI_S2MM} Slave {/ps/S_AXI_HP0} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins ps/S_AXI_HP0]
 apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$adc_clk} Clk_slave {$ref_clk} Clk_xbar {$ref_clk} Master {/axi_dma/M_AXI_SG} Slave {/ps/S_AXI_HP0} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axi_dma/M_AXI_SG]
+if {$dual_stream} {
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/axis_fifo_raw/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axis_fifo_raw/s_axi_lite]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/packetizer_raw/s_axi_lite} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins packetizer_raw/s_axi_lite]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$ref_clk} Clk_slave {$adc_clk} Clk_xbar {Auto} Master {/ps/M_AXI_GP0} Slave {/axi_dma_raw/S_AXI_LITE} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axi_dma_raw/S_AXI_LITE]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$adc_clk} Clk_slave {$ref_clk} Clk_xbar {$ref_clk} Master {/axi_dma_raw/M_AXI_S2MM} Slave {/ps/S_AXI_HP1} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins ps/S_AXI_HP1]
+    apply_bd_automation -rule xilinx.com:bd_rule:axi4 -config { Clk_master {$adc_clk} Clk_slave {$ref_clk} Clk_xbar {$ref_clk} Master {/axi_dma_raw/M_AXI_SG} Slave {/ps/S_AXI_HP1} ddr_seg {Auto} intc_ip {New AXI SmartConnect} master_apm {0}}  [get_bd_intf_pins axi_dma_raw/M_AXI_SG]
+}
 # IO
 connect_bd_net [get_bd_ports exp_adc_pwr_en] [get_bd_pins adc_config/pwr_en]
 connect_bd_net [get_bd_ports exp_adc_ref_en] [get_bd_pins adc_config/ref_en]
@@ -0,0 +1,667 @@
+#include <adc-analyze.h>
+#include <argp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adcctl.h"
+#include "decode.h"
+#include "fft.h"
+
+// Bins on either side of a tone that contain its power. The main lobe of the
+// 7-term Blackman-Harris window is 7 bins wide on either side, its side lobes
+// are below -180 dB.
+#define WINDOW_BINS 8
+
+static const double blackman_harris_7[] = {
+    0.27105140069342,
+    0.43329793923448,
+    0.21812299954311,
+    0.06592544638803,
+    0.01081174209837,
+    0.00077658482522,
+    0.00001388721735,
+};
+
+static const char *format_names[] = {
+    [ADC_REG_MODE_24BIT] = "24bit",
+    [ADC_REG_MODE_24BIT_COM] = "24bit_com",
+    [ADC_REG_MODE_32BIT_COM] = "32bit_com",
+    [ADC_REG_MODE_32BIT_AVG] = "32bit_avg",
+    [ADC_FORMAT_DECIMATED] = "decimated",
+};
+
+// Shared, read-only state of an analysis run
+struct analysis {
+    const uint32_t *raw;
+    size_t segments;
+    // Words of the file per segment, a segment of a packed capture has to be
+    // unpacked first
+    size_t segment_words;
+    bool packed;
+    struct adc_word_layout layout;
+    struct fft_plan plan;
+    double *window;
+    double window_sum;
+    // Mean and sum of squared differences from the mean of every segment
+    double *seg_mean;
+    double *seg_m2;
+    // Mean weighted by the window, which suppresses the contribution of
+    // signals that do not complete an integer number of periods
+    double *seg_dc;
+};
+
+// Segments [first, last) are processed by one thread
+struct analysis_part {
+    const struct analysis *analysis;
+    pthread_t thread;
+    size_t first;
+    size_t last;
+    // Sum of the power spectra of all segments
+    double *spectrum;
+    int rc;
+};
+
+// Metrics derived from the averaged power spectrum
+struct analysis_result {
+    double fundamental_hz;
+    double signal;
+    double noise;
+    double distortion;
+    double noise_bin;
+    unsigned int harmonics;
+};
+
+static error_t parse_args(int key, char *arg, struct argp_state *state) {
+    struct analyze_arguments *args = state->input;
+    size_t n;
+    switch (key) {
+        case 'f':
+            args->mode = 0xFF;
+            for (uint8_t i = 0; i <= ADC_FORMAT_DECIMATED; i++) {
+                if (format_names[i] != NULL &&
+                    strcmp(arg, format_names[i]) == 0)
+                    args->mode = i;
+            }
+            if (args->mode == 0xFF)
+                argp_error(
+                    state,
+                    "Invalid format: '%s'. Valid formats: 24bit, 24bit_com, "
+                    "32bit_com, 32bit_avg, decimated",
+                    arg
+                );
+            break;
+        case 'P':
+            args->packed = true;
+            break;
+        case 'd':
+            args->div = (size_t)atoi(arg);
+            if (args->div == 0)
+                argp_error(state, "Invalid divider: '%s'", arg);
+            break;
+        case 'r':
+            args->rate = atof(arg);
+            break;
+        case 'n':
+            n = (size_t)atol(arg);
+            if (n < MIN_FFT_SIZE || n > MAX_FFT_SIZE || (n & (n - 1)) != 0)
+                argp_error(
+                    state,
+                    "Invalid FFT length '%s'. Power of two from %d to %d",
+                    arg,
+                    MIN_FFT_SIZE,
+                    MAX_FFT_SIZE
+                );
+            args->fft_size = n;
+            break;
+        case 'H':
+            args->harmonics = (unsigned int)atoi(arg);
+            break;
+        case 'j':
+            args->threads = (unsigned int)atoi(arg);
+            if (args->threads == 0 || args->threads > MAX_NUM_THREADS)
+                argp_error(
+                    state,
+                    "Invalid number of threads '%s'. Max: %d",
+                    arg,
+                    MAX_NUM_THREADS
+                );
+            break;
+        case 's':
+            args->spectrum = arg;
+            break;
+        case 'D':
+            args->drift = arg;
+            break;
+        case 'b':
+            args->bench = true;
+            break;
+        case ARGP_KEY_ARG:
+            if (args->input != NULL)
+                argp_error(state, "Only a single file can be analyzed");
+            args->input = arg;
+            break;
+        case ARGP_KEY_END:
+            if (args->input == NULL)
+                argp_error(state, "No capture file given");
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = {options, parse_args, analyze_args_doc, analyze_docs};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double to_db(double ratio) {
+    return 10.0 * log10(ratio);
+}
+
+static void *analyze_segments(void *arg) {
+    struct analysis_part *part = arg;
+    const struct analysis *a = part->analysis;
+    const size_t n = a->plan.n;
+    const uint32_t *raw;
+    uint32_t *unpacked = NULL;
+    double *x, *power, *work;
+    double mean, m2, dc, d;
+
+    x = malloc(n * sizeof(double));
+    power = malloc((n / 2 + 1) * sizeof(double));
+    work = malloc(fft_work_size(&a->plan) * sizeof(double));
+    part->spectrum = calloc(n / 2 + 1, sizeof(double));
+    if (a->packed)
+        unpacked = malloc(n * sizeof(uint32_t));
+    if (x == NULL || power == NULL || work == NULL || part->spectrum == NULL ||
+        (a->packed && unpacked == NULL)) {
+        part->rc = -ENOMEM;
+        goto out;
+    }
+    for (size_t seg = part->first; seg < part->last; seg++) {
+        raw = &a->raw[seg * a->segment_words];
+        if (a->packed) {
+            adc_unpack24(raw, unpacked, n);
+            raw = unpacked;
+        }
+        adc_decode_f64(raw, x, n, &a->layout, ADC_VREF);
+        mean = 0.0;
+        for (size_t i = 0; i < n; i++)
+            mean += x[i];
+        mean /= (double)n;
+        m2 = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            d = x[i] - mean;
+            m2 += d * d;
+        }
+        dc = 0.0;
+        for (size_t i = 0; i < n; i++)
+            dc += x[i] * a->window[i];
+        dc /= a->window_sum;
+        a->seg_mean[seg] = mean;
+        a->seg_m2[seg] = m2;
+        a->seg_dc[seg] = dc;
+
+        // DC is removed before windowing, such that it does not leak into
+        // the lowest bins.
+        for (size_t i = 0; i < n; i++)
+            x[i] = (x[i] - dc) * a->window[i];
+        fft_power(&a->plan, x, power, work);
+        for (size_t k = 0; k <= n / 2; k++)
+            part->spectrum[k] += power[k];
+    }
+    part->rc = 0;
+out:
+    free(unpacked);
+    free(x);
+    free(power);
+    free(work);
+    return NULL;
+}
+
+// Process all segments with 'num_threads' threads and write the power
+// spectrum, averaged over the segments and scaled to V^2 per bin, to
+// 'spectrum'.
+static int analyze(
+    struct analysis *a, unsigned int num_threads, double *spectrum
+) {
+    struct analysis_part parts[MAX_NUM_THREADS];
+    const size_t n = a->plan.n;
+    double sum_w2 = 0.0, scale;
+    unsigned int started = 0;
+    int rc = 0;
+
+    memset(parts, 0, sizeof(parts));
+    if (num_threads > a->segments)
+        num_threads = (unsigned int)a->segments;
+    for (unsigned int i = 0; i < num_threads; i++) {
+        parts[i].analysis = a;
+        parts[i].first = a->segments * i / num_threads;
+        parts[i].last = a->segments * (i + 1) / num_threads;
+        if (pthread_create(&parts[i].thread, NULL, analyze_segments, &parts[i]))
+            break;
+        started++;
+    }
+    if (started < num_threads)
+        rc = -EAGAIN;
+
+    memset(spectrum, 0, (n / 2 + 1) * sizeof(double));
+    for (unsigned int i = 0; i < started; i++) {
+        pthread_join(parts[i].thread, NULL);
+        if (parts[i].rc < 0)
+            rc = parts[i].rc;
+        if (parts[i].spectrum != NULL) {
+            for (size_t k = 0; k <= n / 2; k++)
+                spectrum[k] += parts[i].spectrum[k];
+        }
+        free(parts[i].spectrum);
+    }
+
+    // One-sided spectrum normalized to the power of the window: a sine of
+    // amplitude A sums up to A^2 / 2 over its bins, white noise of variance
+    // s^2 to s^2 over all bins.
+    for (size_t i = 0; i < n; i++)
+        sum_w2 += a->window[i] * a->window[i];
+    scale = 2.0 / ((double)n * sum_w2 * (double)a->segments);
+    for (size_t k = 0; k <= n / 2; k++)
+        spectrum[k] *= scale;
+    spectrum[0] /= 2.0;
+    spectrum[n / 2] /= 2.0;
+    return rc;
+}
+
+// Mark the bins of a tone at bin 'center', returns the power contained in
+// the bins that were not already marked.
+static double mark_tone(
+    const double *spectrum,
+    char *mask,
+    size_t bins,
+    size_t center,
+    char tag
+) {
+    size_t first = (center > WINDOW_BINS) ? center - WINDOW_BINS : 0;
+    size_t last = center + WINDOW_BINS;
+    double power = 0.0;
+    if (last >= bins)
+        last = bins - 1;
+    for (size_t k = first; k <= last; k++) {
+        if (mask[k] == 0) {
+            mask[k] = tag;
+            power += spectrum[k];
+        }
+    }
+    return power;
+}
+
+// The fundamental is the largest bin outside of DC. The noise is the mean of
+// all bins that are neither DC, the fundamental, nor one of its harmonics,
+// extrapolated to the full band.
+static int evaluate(
+    const double *spectrum,
+    size_t n,
+    double rate,
+    unsigned int harmonics,
+    struct analysis_result *result
+) {
+    const size_t bins = n / 2 + 1;
+    size_t peak = WINDOW_BINS + 1, h_bin, noise_bins = 0;
+    double weighted = 0.0, noise = 0.0;
+    char *mask = calloc(bins, 1);
+    if (mask == NULL)
+        return -ENOMEM;
+
+    for (size_t k = WINDOW_BINS + 1; k < bins - 1; k++) {
+        if (spectrum[k] > spectrum[peak])
+            peak = k;
+    }
+    mark_tone(spectrum, mask, bins, 0, 'd');
+    mask[bins - 1] = 'd';
+    result->signal = mark_tone(spectrum, mask, bins, peak, 'f');
+    for (size_t k = 0; k < bins; k++) {
+        if (mask[k] == 'f')
+            weighted += (double)k * spectrum[k];
+    }
+    result->fundamental_hz = weighted / result->signal * rate / (double)n;
+
+    // Harmonics above Nyquist are folded back into the first zone
+    result->distortion = 0.0;
+    result->harmonics = 0;
+    for (unsigned int h = 2; h <= harmonics; h++) {
+        h_bin = (size_t)(((uint64_t)peak * h) % n);
+        if (h_bin > n / 2)
+            h_bin = n - h_bin;
+        if (mask[h_bin] != 0)
+            continue;
+        result->distortion += mark_tone(spectrum, mask, bins, h_bin, 'h');
+        result->harmonics++;
+    }
+
+    for (size_t k = 0; k < bins; k++) {
+        if (mask[k] == 0) {
+            noise += spectrum[k];
+            noise_bins++;
+        }
+    }
+    free(mask);
+    if (noise_bins == 0)
+        return -EINVAL;
+    result->noise_bin = noise / (double)noise_bins;
+    result->noise = result->noise_bin * (double)(n / 2);
+    return 0;
+}
+
+// Least-squares slope of the segment means over time in V/s
+static double drift_slope(const double *mean, size_t count, double dt) {
+    double t_mean = dt * (double)(count - 1) / 2.0, y_mean = 0.0;
+    double num = 0.0, den = 0.0, t;
+    for (size_t i = 0; i < count; i++)
+        y_mean += mean[i];
+    y_mean /= (double)count;
+    for (size_t i = 0; i < count; i++) {
+        t = dt * (double)i - t_mean;
+        num += t * (mean[i] - y_mean);
+        den += t * t;
+    }
+    return (den > 0.0) ? num / den : 0.0;
+}
+
+static void print_report(
+    struct analysis *a,
+    struct analyze_arguments *args,
+    size_t samples,
+    double rate,
+    struct analysis_result *r,
+    double seconds
+) {
+    const size_t n = a->plan.n, total = a->segments * n;
+    const double full_scale = ADC_VREF * ADC_VREF / 2.0;
+    const double sinad = to_db(r->signal / (r->noise + r->distortion));
+    double mean = 0.0, m2 = 0.0, delta, min, max;
+
+    // Combine the segments (Chan et al.), all of them have 'n' samples
+    for (size_t i = 0; i < a->segments; i++) {
+        delta = a->seg_mean[i] - mean;
+        mean += delta / (double)(i + 1);
+        m2 += a->seg_m2[i] + delta * delta * (double)n * (double)i / (i + 1);
+    }
+    min = max = a->seg_dc[0];
+    for (size_t i = 1; i < a->segments; i++) {
+        if (a->seg_dc[i] < min)
+            min = a->seg_dc[i];
+        if (a->seg_dc[i] > max)
+            max = a->seg_dc[i];
+    }
+
+    printf("file:                           %s\n", args->input);
+    printf(
+        "samples:                        %zu (%.3f s at %.1f Hz)\n",
+        samples,
+        (double)samples / rate,
+        rate
+    );
+    printf(
+        "format:                         %s (%u bit, LSB %.3f nV)\n",
+        format_names[args->mode],
+        a->layout.bits,
+        adc_lsb_volts(&a->layout, ADC_VREF) * 1e9
+    );
+    printf(
+        "fft:                            %zu points, %zu segments (%zu "
+        "samples unused)\n",
+        n,
+        a->segments,
+        samples - total
+    );
+    printf(
+        "mean:                           %.9f V (std %.9f V)\n",
+        mean,
+        sqrt(m2 / (double)total)
+    );
+    printf(
+        "fundamental:                    %.3f Hz, %.2f dBFS (%.6f V rms)\n",
+        r->fundamental_hz,
+        to_db(r->signal / full_scale),
+        sqrt(r->signal)
+    );
+    printf(
+        "snr:                            %.2f dB\n",
+        to_db(r->signal / r->noise)
+    );
+    printf("sinad:                          %.2f dB\n", sinad);
+    printf(
+        "enob:                           %.2f bit\n", (sinad - 1.76) / 6.02
+    );
+    if (r->harmonics > 0) {
+        printf(
+            "thd:                            %.2f dB (%u harmonics)\n",
+            to_db(r->distortion / r->signal),
+            r->harmonics
+        );
+    }
+    printf(
+        "noise density:                  %.3f nV/sqrt(Hz)\n",
+        sqrt(r->noise_bin / (rate / (double)n)) * 1e9
+    );
+    printf(
+        "drift:                          %.3f uV/s (p-p %.3f uV)\n",
+        drift_slope(a->seg_dc, a->segments, (double)n / rate) * 1e6,
+        (max - min) * 1e6
+    );
+    printf(
+        "analysis:                       %.3f s, %u threads (%.1f MS/s)\n",
+        seconds,
+        args->threads,
+        (double)total / seconds / 1e6
+    );
+}
+
+static int write_spectrum(
+    const char *path, const double *spectrum, size_t n, double rate
+) {
+    const double full_scale = ADC_VREF * ADC_VREF / 2.0;
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", path);
+        return -errno;
+    }
+    fprintf(file, "frequency_hz,dbfs\n");
+    for (size_t k = 0; k <= n / 2; k++) {
+        fprintf(
+            file,
+            "%.6f,%.3f\n",
+            (double)k * rate / (double)n,
+            to_db(spectrum[k] / full_scale)
+        );
+    }
+    return (fclose(file) == 0) ? 0 : -EIO;
+}
+
+static int write_drift(const char *path, struct analysis *a, double rate) {
+    const double dt = (double)a->plan.n / rate;
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", path);
+        return -errno;
+    }
+    fprintf(file, "time_s,volts\n");
+    for (size_t i = 0; i < a->segments; i++)
+        fprintf(file, "%.6f,%.9f\n", dt * ((double)i + 0.5), a->seg_dc[i]);
+    return (fclose(file) == 0) ? 0 : -EIO;
+}
+
+// Analysis time for 1, 2, 4, ... threads. The first run also brings the file
+// into the page cache, such that all runs read from memory.
+static int run_bench(
+    struct analysis *a, unsigned int max_threads, double *spectrum
+) {
+    const size_t total = a->segments * a->plan.n;
+    double base = 0.0, seconds;
+    uint64_t t0;
+    int rc;
+
+    rc = analyze(a, 1, spectrum);
+    if (rc < 0)
+        return rc;
+    printf("threads   time_s     MS/s  speedup\n");
+    for (unsigned int t = 1; t <= max_threads; t *= 2) {
+        t0 = now_ns();
+        rc = analyze(a, t, spectrum);
+        seconds = (double)(now_ns() - t0) / 1e9;
+        if (rc < 0)
+            return rc;
+        if (t == 1)
+            base = seconds;
+        printf(
+            "%7u %8.3f %8.1f %8.2f\n",
+            t,
+            seconds,
+            (double)total / seconds / 1e6,
+            base / seconds
+        );
+        if (t < max_threads && t * 2 > max_threads)
+            t = max_threads / 2;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct analyze_arguments args;
+    struct analysis a;
+    struct analysis_result result = {0};
+    struct stat st;
+    double *spectrum = NULL, rate, seconds;
+    size_t samples, n;
+    uint64_t t0;
+    void *map;
+    long cpus;
+    int fd, rc;
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    args.input = NULL;
+    args.mode = ADC_REG_MODE_32BIT_COM;
+    args.packed = false;
+    args.div = DEFAULT_DIVIDER;
+    args.rate = 0.0;
+    args.fft_size = DEFAULT_FFT_SIZE;
+    args.harmonics = DEFAULT_HARMONICS;
+    args.threads = (cpus > 0 && cpus <= MAX_NUM_THREADS) ? (unsigned int)cpus
+                                                         : 1;
+    args.spectrum = NULL;
+    args.drift = NULL;
+    args.bench = false;
+    argp_parse(&argp, argc, argv, 0, 0, &args);
+    rate = (args.rate > 0.0) ? args.rate : adc_sample_rate(args.div);
+    n = args.fft_size;
+
+    memset(&a, 0, sizeof(a));
+    if (args.packed)
+        args.mode = ADC_REG_MODE_24BIT;
+    adc_word_layout(args.mode, &a.layout);
+    a.packed = args.packed;
+    a.segment_words = args.packed ? n / 4 * 3 : n;
+
+    fd = open(args.input, O_RDONLY);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "Unable to open file %s\n", args.input);
+        exit(errno);
+    }
+    samples = (size_t)st.st_size / sizeof(uint32_t);
+    if (args.packed)
+        samples = samples / 3 * 4;
+    a.segments = samples / n;
+    if (a.segments == 0) {
+        fprintf(
+            stderr,
+            "Error: %s contains %zu samples, at least %zu are required\n",
+            args.input,
+            samples,
+            n
+        );
+        exit(EINVAL);
+    }
+    // Only whole segments are mapped, the threads read them once in order
+    map = mmap(
+        NULL,
+        a.segments * a.segment_words * sizeof(uint32_t),
+        PROT_READ,
+        MAP_PRIVATE,
+        fd,
+        0
+    );
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Unable to map file %s\n", args.input);
+        exit(errno);
+    }
+    madvise(
+        map, a.segments * a.segment_words * sizeof(uint32_t), MADV_SEQUENTIAL
+    );
+    a.raw = map;
+
+    rc = fft_plan_init(&a.plan, n);
+    a.window = malloc(n * sizeof(double));
+    a.seg_mean = malloc(a.segments * sizeof(double));
+    a.seg_m2 = malloc(a.segments * sizeof(double));
+    a.seg_dc = malloc(a.segments * sizeof(double));
+    spectrum = malloc((n / 2 + 1) * sizeof(double));
+    if (rc < 0 || a.window == NULL || a.seg_mean == NULL ||
+        a.seg_m2 == NULL || a.seg_dc == NULL || spectrum == NULL) {
+        fprintf(stderr, "Unable to allocate buffers\n");
+        exit(ENOMEM);
+    }
+    for (size_t i = 0; i < n; i++) {
+        a.window[i] = 0.0;
+        for (size_t j = 0; j < 7; j++) {
+            a.window[i] += ((j % 2) ? -1.0 : 1.0) * blackman_harris_7[j] *
+                           cos(2.0 * M_PI * (double)(j * i) / (double)n);
+        }
+        a.window_sum += a.window[i];
+    }
+
+    if (args.bench) {
+        rc = run_bench(&a, args.threads, spectrum);
+        if (rc < 0)
+            fprintf(stderr, "Error: Analysis failed: %d\n", rc);
+        goto out;
+    }
+
+    t0 = now_ns();
+    rc = analyze(&a, args.threads, spectrum);
+    if (rc == 0)
+        rc = evaluate(spectrum, n, rate, args.harmonics, &result);
+    seconds = (double)(now_ns() - t0) / 1e9;
+    if (rc < 0) {
+        fprintf(stderr, "Error: Analysis failed: %d\n", rc);
+        goto out;
+    }
+    print_report(&a, &args, samples, rate, &result, seconds);
+    if (args.spectrum != NULL)
+        rc = write_spectrum(args.spectrum, spectrum, n, rate);
+    if (rc == 0 && args.drift != NULL)
+        rc = write_drift(args.drift, &a, rate);
+
+out:
+    free(spectrum);
+    free(a.seg_dc);
+    free(a.seg_m2);
+    free(a.seg_mean);
+    free(a.window);
+    fft_plan_free(&a.plan);
+    munmap(map, a.segments * a.segment_words * sizeof(uint32_t));
+    return (rc < 0) ? -rc : 0;
+}
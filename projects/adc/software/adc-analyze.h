@@ -0,0 +1,87 @@
+#pragma once
+#include <argp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEFAULT_DIVIDER   20
+#define DEFAULT_FFT_SIZE  65536
+#define DEFAULT_HARMONICS 5
+#define MIN_FFT_SIZE      1024
+#define MAX_FFT_SIZE      (1 << 24)
+#define MAX_NUM_THREADS   64
+
+const char *argp_program_version = "adc-analyze 0.1.0";
+const char analyze_docs[] =
+    "Analyze a capture file written by 'adc': SNR, SINAD, ENOB, THD, noise "
+    "density, and drift of the DC level. The file is split into segments "
+    "that are processed in parallel";
+const char analyze_args_doc[] = "FILE";
+const struct argp_option options[] = {
+    {"format",
+     'f',
+     "format",
+     0,
+     "Output data format of the capture: 24bit, 24bit_com, 32bit_com, "
+     "32bit_avg, or decimated, defaults to 32bit_com (32bit_avg if captured "
+     "with --avg, decimated if captured with --decimate)"},
+    {"packed",
+     'P',
+     0,
+     0,
+     "The capture was taken with 'adc --pack', implies --format 24bit"},
+    {"div", 'd', "divider", 0, "Divider of the capture, defaults to 20"},
+    {"rate",
+     'r',
+     "samples_per_s",
+     0,
+     "Sample rate, defaults to the rate set by --div"},
+    {"fft",
+     'n',
+     "points",
+     0,
+     "Length of the FFT segments (power of two), defaults to 65536"},
+    {"harmonics",
+     'H',
+     "count",
+     0,
+     "Highest harmonic included in THD, defaults to 5"},
+    {"threads",
+     'j',
+     "count",
+     0,
+     "Number of threads, defaults to the number of CPUs"},
+    {"spectrum",
+     's',
+     "file",
+     0,
+     "Write the averaged spectrum as 'frequency_hz,dbfs' lines"},
+    {"drift",
+     'D',
+     "file",
+     0,
+     "Write the mean of every segment as 'time_s,volts' lines"},
+    {"bench",
+     'b',
+     0,
+     0,
+     "Repeat the analysis with 1, 2, 4, ... threads up to --threads and "
+     "report the scaling"},
+    {0}
+};
+
+struct analyze_arguments {
+    char *input;
+    uint8_t mode;
+    bool packed;
+    size_t div;
+    double rate;
+    size_t fft_size;
+    unsigned int harmonics;
+    unsigned int threads;
+    char *spectrum;
+    char *drift;
+    bool bench;
+};
+
+static error_t parse_args(int key, char *arg, struct argp_state *state);
@@ -0,0 +1,405 @@
+#include <adc-bench.h>
+#include <argp.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adcctl.h"
+#include "dmaclient.h"
+#include "dmadc.h"
+
+// Minimum, maximum, and sum of a series of durations in nanoseconds
+struct bench_stat {
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    size_t count;
+};
+
+struct bench_result {
+    size_t samples;
+    size_t errors;
+    struct bench_stat start;
+    struct bench_stat transfer;
+    struct bench_stat mmap;
+    struct bench_stat munmap;
+    struct bench_stat copy;
+    struct bench_stat write;
+    // Performance counters of the packetizer, summed over the transfers
+    uint64_t cycles;
+    uint64_t out_beats;
+    uint64_t in_stalls;
+    uint64_t out_stalls;
+};
+
+static error_t parse_args(int key, char *arg, struct argp_state *state) {
+    struct bench_arguments *args = state->input;
+    switch (key) {
+        case 's':
+            args->sim = true;
+            break;
+        case 'r':
+            args->rate = atof(arg);
+            break;
+        case 'd':
+            args->div = (size_t)atoi(arg);
+            break;
+        case 'z':
+            args->zone = (unsigned int)atoi(arg);
+            if (args->zone != 1 && args->zone != 2) {
+                argp_error(state, "Invalid zone: '%s'. Valid zones: 1, 2", arg);
+            }
+            break;
+        case 'D':
+            args->ddr = true;
+            break;
+        case 'm':
+        case 'M':
+            if ((size_t)atoi(arg) == 0 || (size_t)atoi(arg) > MAX_NUM_SAMPLES)
+                argp_error(
+                    state,
+                    "Invalid number of samples '%s'. Max: %zu",
+                    arg,
+                    (size_t)MAX_NUM_SAMPLES
+                );
+            if (key == 'm')
+                args->min = (size_t)atoi(arg);
+            else
+                args->max = (size_t)atoi(arg);
+            break;
+        case 'n':
+            args->reps = (size_t)atoi(arg);
+            if (args->reps == 0)
+                argp_error(state, "At least one repetition is required");
+            break;
+        case 'w':
+            args->timeout_ms = (unsigned int)atoi(arg);
+            break;
+        case 'k':
+            args->sink = arg;
+            break;
+        case 'o':
+            args->output = arg;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = {options, parse_args, 0, bench_docs};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void stat_add(struct bench_stat *stat, uint64_t value) {
+    if (stat->count == 0 || value < stat->min)
+        stat->min = value;
+    if (stat->count == 0 || value > stat->max)
+        stat->max = value;
+    stat->sum += value;
+    stat->count++;
+}
+
+static double stat_mean(const struct bench_stat *stat) {
+    if (stat->count == 0)
+        return 0.0;
+    return (double)stat->sum / (double)stat->count;
+}
+
+// Bandwidth in MB/s (10^6 bytes per second) based on the mean duration
+static double stat_bandwidth(const struct bench_stat *stat, size_t bytes) {
+    double mean = stat_mean(stat);
+    if (mean == 0.0)
+        return 0.0;
+    return (double)bytes / mean * 1e3;
+}
+
+static void print_stat(FILE *out, const char *name, struct bench_stat *stat) {
+    fprintf(
+        out,
+        "\"%s\": {\"min\": %llu, \"mean\": %.1f, \"max\": %llu}",
+        name,
+        (unsigned long long)stat->min,
+        stat_mean(stat),
+        (unsigned long long)stat->max
+    );
+}
+
+static void bench_ioctl(
+    struct dmadc_channel *channel, struct bench_stat *stat
+) {
+    uint64_t t0;
+    for (size_t i = 0; i < DEFAULT_IOCTL_ROUNDS; i++) {
+        t0 = now_ns();
+        get_status(channel);
+        stat_add(stat, now_ns() - t0);
+    }
+}
+
+static void bench_transfer(
+    struct adc *adc,
+    struct dmadc_channel *channel,
+    struct bench_arguments *args,
+    FILE *sink,
+    uint32_t *copy,
+    struct bench_result *result
+) {
+    size_t bytes = result->samples * sizeof(uint32_t);
+    struct packetizer_perf perf;
+    enum dmadc_status status;
+    uint64_t t0, t1, t2;
+    long rc;
+
+    for (size_t rep = 0; rep < args->reps; rep++) {
+        // START_TRANSFER -> WAIT_FOR_TRANSFER
+        set_packatizer_save(&adc->pack, result->samples);
+        clear_packetizer_perf(&adc->pack);
+        t0 = now_ns();
+        rc = start_transfer(channel, bytes);
+        t1 = now_ns();
+        if (rc != 0) {
+            fprintf(stderr, "Error: Unable to start transfer: %ld\n", rc);
+            result->errors++;
+            continue;
+        }
+        restart_adc_trigger(&adc->trigger);
+        *adc->trigger.divider = args->div;
+        status = wait_for_transfer(channel);
+        t2 = now_ns();
+        get_packetizer_perf(&adc->pack, &perf);
+        if (status != DMADC_COMPLETE) {
+            fprintf(
+                stderr,
+                "Error: DMA transfer exited with status %s\n",
+                dmadc_status_strings[status]
+            );
+            result->errors++;
+            continue;
+        }
+        stat_add(&result->start, t1 - t0);
+        stat_add(&result->transfer, t2 - t0);
+        result->cycles += perf.cycles;
+        result->out_beats += perf.out_beats;
+        result->in_stalls += perf.in_stalls;
+        result->out_stalls += perf.out_stalls;
+
+        // mmap setup, page faults are accounted to the copy-out
+        t0 = now_ns();
+        rc = dmadc_mmap_buffer(channel, bytes);
+        t1 = now_ns();
+        if (rc != 0) {
+            fprintf(stderr, "Error: Unable to map buffer: Error %ld\n", rc);
+            result->errors++;
+            continue;
+        }
+        stat_add(&result->mmap, t1 - t0);
+
+        // Copy-out from the DMA mapping
+        t0 = now_ns();
+        memcpy(copy, channel->buffer, bytes);
+        t1 = now_ns();
+        stat_add(&result->copy, t1 - t0);
+
+        // Write to the output sink
+        t0 = now_ns();
+        fwrite(copy, sizeof(uint32_t), result->samples, sink);
+        fflush(sink);
+        t1 = now_ns();
+        stat_add(&result->write, t1 - t0);
+
+        t0 = now_ns();
+        dmadc_munmap(channel);
+        t1 = now_ns();
+        stat_add(&result->munmap, t1 - t0);
+    }
+    // Every transfer size overwrites the sink from the start, such that the
+    // file does not grow beyond the largest transfer.
+    rewind(sink);
+    *adc->trigger.divider = 0;
+    set_packatizer_save(&adc->pack, 0);
+}
+
+// Fraction of the cycles counted by the packetizer, zero without counts (as
+// with the stand-in backend)
+static double cycle_ratio(const struct bench_result *result, uint64_t count) {
+    return (result->cycles > 0) ? (double)count / result->cycles : 0.0;
+}
+
+static void print_result(FILE *out, struct bench_result *result, double rate) {
+    size_t bytes = result->samples * sizeof(uint32_t);
+    double expected_ns = (rate > 0.0) ? result->samples / rate * 1e9 : 0.0;
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"samples\": %zu,\n", result->samples);
+    fprintf(out, "      \"bytes\": %zu,\n", bytes);
+    fprintf(out, "      \"errors\": %zu,\n", result->errors);
+    fprintf(out, "      \"expected_acquisition_ns\": %.1f,\n", expected_ns);
+    fprintf(out, "      ");
+    print_stat(out, "start_transfer_ns", &result->start);
+    fprintf(out, ",\n      ");
+    print_stat(out, "transfer_latency_ns", &result->transfer);
+    fprintf(out, ",\n      ");
+    print_stat(out, "mmap_ns", &result->mmap);
+    fprintf(out, ",\n      ");
+    print_stat(out, "munmap_ns", &result->munmap);
+    fprintf(out, ",\n      ");
+    print_stat(out, "copy_ns", &result->copy);
+    fprintf(out, ",\n      ");
+    print_stat(out, "write_ns", &result->write);
+    fprintf(out, ",\n");
+    fprintf(
+        out,
+        "      \"copy_mb_per_s\": %.1f,\n",
+        stat_bandwidth(&result->copy, bytes)
+    );
+    fprintf(
+        out,
+        "      \"write_mb_per_s\": %.1f,\n",
+        stat_bandwidth(&result->write, bytes)
+    );
+    fprintf(
+        out,
+        "      \"datapath_cycles\": %llu,\n",
+        (unsigned long long)result->cycles
+    );
+    fprintf(
+        out,
+        "      \"link_utilization\": %.4f,\n",
+        cycle_ratio(result, result->out_beats)
+    );
+    fprintf(
+        out,
+        "      \"input_stall_ratio\": %.4f,\n",
+        cycle_ratio(result, result->in_stalls)
+    );
+    fprintf(
+        out,
+        "      \"dma_stall_ratio\": %.4f\n",
+        cycle_ratio(result, result->out_stalls)
+    );
+    fprintf(out, "    }");
+}
+
+int main(int argc, char *argv[]) {
+    struct adc adc;
+    struct dmadc_channel channel;
+    struct bench_arguments args;
+    struct bench_stat ioctl_stat = {0};
+    struct bench_result result;
+    FILE *sink, *out;
+    uint32_t *copy;
+    double rate;
+    int rc;
+    args.sim = false;
+    args.rate = 0.0;
+    args.div = DEFAULT_DIVIDER;
+    args.zone = 2;
+    args.ddr = false;
+    args.min = DEFAULT_MIN_SAMPLES;
+    args.max = MAX_NUM_SAMPLES;
+    args.reps = DEFAULT_REPETITIONS;
+    args.timeout_ms = DEFAULT_TIMEOUT_MS;
+    args.sink = DEFAULT_SINK;
+    args.output = NULL;
+    argp_parse(&argp, argc, argv, 0, 0, &args);
+    if (args.min > args.max) {
+        fprintf(stderr, "Error: --min is larger than --max\n");
+        exit(EINVAL);
+    }
+
+    rate = adc_sample_rate(args.div);
+    if (args.sim && args.rate > 0.0) {
+        rate = args.rate;
+    }
+
+    if (args.sim) {
+        rc = open_adc_sim(&adc);
+    } else {
+        rc = open_adc(&adc);
+    }
+    if (rc < 0) {
+        exit(-rc);
+    }
+    if (args.sim) {
+        rc = open_dma_channel_sim(&channel, rate);
+    } else {
+        rc = open_dma_channel(&channel);
+    }
+    if (rc < 0) {
+        close_adc(&adc);
+        exit(-rc);
+    }
+
+    sink = fopen(args.sink, "w");
+    if (sink == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", args.sink);
+        close_dma_channel(&channel);
+        close_adc(&adc);
+        exit(errno);
+    }
+    out = stdout;
+    if (args.output != NULL) {
+        out = fopen(args.output, "w");
+        if (out == NULL) {
+            fprintf(stderr, "Unable to open file %s\n", args.output);
+            exit(errno);
+        }
+    }
+    copy = malloc(args.max * sizeof(uint32_t));
+    if (copy == NULL) {
+        fprintf(stderr, "Unable to allocate copy buffer\n");
+        exit(ENOMEM);
+    }
+
+    if (!args.sim) {
+        // The hardware is configured once, just like 'adc' does for a capture.
+        // The stand-in does not need the power-up delays.
+        uint8_t mode = adc_default_mode(false, 0);
+        if (args.ddr)
+            mode |= ADC_REG_MODE_DDR;
+        configure_adc(&adc, mode, 0);
+    }
+    configure_adc_trigger(&adc.trigger, args.zone);
+    reset_adc_datapath(&adc);
+    set_timeout_ms(&channel, args.timeout_ms);
+
+    bench_ioctl(&channel, &ioctl_stat);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%s\",\n", argp_program_version);
+    fprintf(out, "  \"backend\": \"%s\",\n", args.sim ? "sim" : "hardware");
+    fprintf(out, "  \"divider\": %zu,\n", args.div);
+    fprintf(out, "  \"zone\": %u,\n", args.zone);
+    fprintf(out, "  \"ddr\": %s,\n", args.ddr ? "true" : "false");
+    fprintf(out, "  \"sample_rate\": %.1f,\n", rate);
+    fprintf(out, "  \"repetitions\": %zu,\n", args.reps);
+    fprintf(out, "  \"sink\": \"%s\",\n", args.sink);
+    fprintf(out, "  ");
+    print_stat(out, "ioctl_status_ns", &ioctl_stat);
+    fprintf(out, ",\n  \"results\": [\n");
+    for (size_t samples = args.min; samples <= args.max; samples *= 2) {
+        memset(&result, 0, sizeof(result));
+        result.samples = samples;
+        bench_transfer(&adc, &channel, &args, sink, copy, &result);
+        print_result(out, &result, rate);
+        fprintf(out, (samples * 2 <= args.max) ? ",\n" : "\n");
+        fflush(out);
+    }
+    fprintf(out, "  ]\n}\n");
+
+    free(copy);
+    if (out != stdout)
+        fclose(out);
+    fclose(sink);
+    close_dma_channel(&channel);
+    close_adc(&adc);
+}
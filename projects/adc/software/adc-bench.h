@@ -0,0 +1,56 @@
+#pragma once
+#include <argp.h>
+#include <dmadc.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DEFAULT_SINK         "/dev/null"
+#define DEFAULT_DIVIDER      20
+#define DEFAULT_TIMEOUT_MS   10000
+#define DEFAULT_MIN_SAMPLES  1024
+#define DEFAULT_REPETITIONS  10
+#define DEFAULT_IOCTL_ROUNDS 1000
+#define MAX_NUM_SAMPLES      DMADC_BUFFER_SIZE / sizeof(uint32_t)
+
+const char *argp_program_version = "adc-bench 0.1.0";
+const char bench_docs[] =
+    "Benchmark the acquisition path (DMA transfers, ioctl calls, mmap, "
+    "copy-out and output writes) and report the results as JSON";
+const struct argp_option options[] = {
+    {"sim", 's', 0, 0, "Use the simulated stand-in instead of the hardware"},
+    {"rate",
+     'r',
+     "samples_per_s",
+     0,
+     "Sample rate of the stand-in, defaults to the rate set by --div"},
+    {"div", 'd', "divider", 0, "Divider, defaults to 20"},
+    {"zone", 'z', "zone", 0, "Zone, can be either 1 or 2, default to 2"},
+    {"ddr", 'D', 0, 0, "Read the conversion results at double data rate"},
+    {"min", 'm', "count", 0, "Smallest transfer in samples, defaults to 1024"},
+    {"max", 'M', "count", 0, "Largest transfer in samples, defaults to max"},
+    {"reps", 'n', "count", 0, "Repetitions per transfer size, defaults to 10"},
+    {"timeout", 'w', "timeout_ms", 0, "Timeout, defaults to 10000"},
+    {"sink",
+     'k',
+     "file",
+     0,
+     "File the captured data is written to, defaults to " DEFAULT_SINK},
+    {"output", 'o', "file", 0, "Output file for the JSON report, or stdout"},
+    {0}
+};
+
+struct bench_arguments {
+    bool sim;
+    double rate;
+    size_t div;
+    unsigned int zone;
+    bool ddr;
+    size_t min;
+    size_t max;
+    size_t reps;
+    unsigned int timeout_ms;
+    char *sink;
+    char *output;
+};
+
+static error_t parse_args(int key, char *arg, struct argp_state *state);
@@ -0,0 +1,126 @@
+#include <adc-view.h>
+#include <argp.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static error_t parse_args(int key, char *arg, struct argp_state *state) {
+    struct view_arguments *args = state->input;
+    switch (key) {
+        case 'N':
+            args->name = arg;
+            break;
+        case 'i':
+            args->interval_ms = (unsigned int)atoi(arg);
+            break;
+        case 'c':
+            args->count = (size_t)atoi(arg);
+            break;
+        case 'd':
+            args->dump = true;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = {options, parse_args, 0, view_docs};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void on_interrupt(int signum) {
+    (void)signum;
+    interrupted = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void print_window(
+    const float *window, const struct adc_snapshot_info *info
+) {
+    double sum = 0.0, sum2 = 0.0, mean;
+    float min = INFINITY, max = -INFINITY;
+    for (uint32_t i = 0; i < info->samples; i++) {
+        sum += window[i];
+        sum2 += (double)window[i] * window[i];
+        min = (window[i] < min) ? window[i] : min;
+        max = (window[i] > max) ? window[i] : max;
+    }
+    mean = sum / info->samples;
+    printf(
+        "Block %llu: %u samples, age %.1f ms, mean %.6f V, std %.6f V, min "
+        "%.6f V, max %.6f V\n",
+        (unsigned long long)info->block,
+        info->samples,
+        (double)(now_ns() - info->timestamp_ns) / 1e6,
+        mean,
+        sqrt(fmax(sum2 / info->samples - mean * mean, 0.0)),
+        min,
+        max
+    );
+}
+
+int main(int argc, char *argv[]) {
+    struct view_arguments args;
+    struct adc_snapshot snapshot;
+    struct adc_snapshot_info info;
+    uint64_t last_block = UINT64_MAX;
+    float *window;
+    int rc;
+    args.name = ADC_SNAPSHOT_DEFAULT_NAME;
+    args.interval_ms = DEFAULT_INTERVAL_MS;
+    args.count = 0;
+    args.dump = false;
+    argp_parse(&argp, argc, argv, 0, 0, &args);
+
+    rc = adc_snapshot_open(&snapshot, args.name);
+    if (rc < 0)
+        exit(-rc);
+    window = malloc(snapshot.capacity * sizeof(float));
+    if (window == NULL) {
+        fprintf(stderr, "Unable to allocate %u samples\n", snapshot.capacity);
+        exit(ENOMEM);
+    }
+
+    signal(SIGINT, on_interrupt);
+    for (size_t i = 0; args.count == 0 || i < args.count; i++) {
+        if (interrupted)
+            break;
+        if (i > 0)
+            usleep(args.interval_ms * 1000);
+        rc = adc_snapshot_read(&snapshot, window, &info);
+        if (rc < 0) {
+            fprintf(stderr, "Error: Unable to read snapshot: %d\n", rc);
+            break;
+        }
+        // The valid samples are at the end of the window
+        if (info.samples == 0 || info.block == last_block)
+            continue;
+        last_block = info.block;
+        if (args.dump) {
+            for (uint32_t j = snapshot.capacity - info.samples;
+                 j < snapshot.capacity;
+                 j++)
+                printf("%.9f\n", window[j]);
+            break;
+        }
+        print_window(&window[snapshot.capacity - info.samples], &info);
+        fflush(stdout);
+    }
+
+    free(window);
+    adc_snapshot_close(&snapshot);
+    return (rc < 0) ? -rc : 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "snapshot.h"
+#include <argp.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DEFAULT_INTERVAL_MS 100
+
+const char *argp_program_version = "adc-view 0.1.0";
+const char view_docs[] =
+    "Print the most recent samples published by 'adc --fanout --snapshot'. "
+    "Any number of viewers can read the window without slowing down the "
+    "acquisition";
+const struct argp_option options[] = {
+    {"name",
+     'N',
+     "name",
+     0,
+     "Name of the shared memory, defaults to " ADC_SNAPSHOT_DEFAULT_NAME},
+    {"interval",
+     'i',
+     "interval_ms",
+     0,
+     "Interval between two reads, defaults to 100"},
+    {"count",
+     'c',
+     "count",
+     0,
+     "Number of reads, defaults to 0 (until interrupted)"},
+    {"dump",
+     'd',
+     0,
+     0,
+     "Print all samples of the window, one per line, and exit"},
+    {0}
+};
+
+struct view_arguments {
+    char *name;
+    unsigned int interval_ms;
+    size_t count;
+    bool dump;
+};
+
+static error_t parse_args(int key, char *arg, struct argp_state *state);
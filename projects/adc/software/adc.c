@@ -1,20 +1,80 @@
 #include <adc.h>
 #include <argp.h>
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "adcctl.h"
+#include "blockheader.h"
+#include "capture.h"
+#include "clockmodel.h"
+#include "decode.h"
+#include "detect.h"
 #include "dmaclient.h"
 #include "dmadc.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "rt.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
 
 #define yesno(b) (b) ? "yes" : "no"
 
+// Flags of the event trigger for the modes of --hw-trigger
+static int parse_hw_trigger(const char *name, uint32_t *flags) {
+    if (strcmp(name, "level") == 0)
+        *flags = EVENT_TRIGGER_RISING | EVENT_TRIGGER_FALLING;
+    else if (strcmp(name, "rising") == 0)
+        *flags = EVENT_TRIGGER_RISING;
+    else if (strcmp(name, "falling") == 0)
+        *flags = EVENT_TRIGGER_FALLING;
+    else if (strcmp(name, "slope") == 0)
+        *flags = EVENT_TRIGGER_SLOPE | EVENT_TRIGGER_RISING |
+                 EVENT_TRIGGER_FALLING;
+    else
+        return -EINVAL;
+    return 0;
+}
+
+static const char *event_trigger_state_str(uint32_t state) {
+    switch (state) {
+    case EVENT_TRIGGER_STATE_PASS:
+        return "pass";
+    case EVENT_TRIGGER_STATE_ARMED:
+        return "armed";
+    case EVENT_TRIGGER_STATE_WINDOW:
+        return "window";
+    default:
+        return "done";
+    }
+}
+
+// --threshold in codes of the 24-bit conversion results the event trigger
+// compares, limited to their range
+static int32_t hw_trigger_threshold(double volts) {
+    double code = round(volts / (2.0 * ADC_VREF / (double)(1u << 24)));
+    if (code > 8388607.0)
+        return 8388607;
+    if (code < -8388608.0)
+        return -8388608;
+    return (int32_t)code;
+}
+
 static error_t parse_args(int key, char *arg, struct argp_state *state) {
     struct adc_arguments *args = state->input;
+    unsigned int ratio;
     switch (key) {
         case 'i':
             args->info = true;
@@ -30,14 +90,26 @@ static error_t parse_args(int key, char *arg, struct argp_state *state) {
             break;
         case 'n':
             args->num = (size_t)atoi(arg);
-            if (args->num > MAX_NUM_SAMPLES)
+            if (args->num > MAX_PACKED_SAMPLES)
                 argp_error(
                     state,
                     "Invalid number of samples '%s'. Max: %u",
                     arg,
-                    MAX_NUM_SAMPLES
+                    MAX_PACKED_SAMPLES
                 );
             break;
+        case 'P':
+            args->pack = true;
+            break;
+        case OPT_HEADER:
+            args->header = true;
+            break;
+        case OPT_DDR:
+            args->ddr = true;
+            break;
+        case OPT_ECHO:
+            args->echo = true;
+            break;
         case 'd':
             args->div = (size_t)atoi(arg);
             break;
@@ -50,6 +122,166 @@ static error_t parse_args(int key, char *arg, struct argp_state *state) {
                 argp_error(state, "Invalid zone: '%s'. Valid zones: 1, 2", arg);
             }
             break;
+        case 'S':
+            args->stats = true;
+            break;
+        case 'b':
+            args->blocks = (size_t)atoi(arg);
+            break;
+        case OPT_HW_TRIGGER:
+            if (parse_hw_trigger(arg, &args->hw_trigger) < 0)
+                argp_error(state, "Invalid trigger mode '%s'", arg);
+            break;
+        case OPT_HW_STATS:
+            args->hw_stats = (uint32_t)strtoul(arg, NULL, 10);
+            if (args->hw_stats == 0)
+                argp_error(state, "At least one sample per window is required");
+            break;
+        case 'j':
+            args->threads = (unsigned int)atoi(arg);
+            if (args->threads == 0 || args->threads > MAX_NUM_THREADS) {
+                argp_error(
+                    state,
+                    "Invalid number of threads '%s'. Max: %u",
+                    arg,
+                    MAX_NUM_THREADS
+                );
+            }
+            break;
+        case 'r':
+            args->rt = true;
+            break;
+        case OPT_RT_CPU:
+            args->rt_cpu = atoi(arg);
+            break;
+        case OPT_RT_WRITER_CPU:
+            args->rt_writer_cpu = atoi(arg);
+            break;
+        case OPT_RT_PRIO:
+            args->rt_prio = atoi(arg);
+            break;
+        case OPT_RT_WRITER_PRIO:
+            args->rt_writer_prio = atoi(arg);
+            break;
+        case OPT_RT_BUFFERS:
+            args->rt_buffers = (size_t)atoi(arg);
+            if (args->rt_buffers == 0)
+                argp_error(state, "At least one buffer is required");
+            break;
+        case OPT_LATENCY:
+            args->latency = arg;
+            break;
+        case OPT_TIMESTAMPS:
+            args->timestamps = arg;
+            break;
+        case OPT_TRACE:
+            args->trace = arg;
+            break;
+        case 'F':
+            args->fanout = true;
+            break;
+        case OPT_SEND:
+            args->send = arg;
+            break;
+        case OPT_PREVIEW:
+            args->preview_ms = (unsigned int)atoi(arg);
+            break;
+        case OPT_POOL:
+            args->pool = (size_t)atoi(arg);
+            if (args->pool == 0)
+                argp_error(state, "At least one block is required");
+            break;
+        case OPT_HISTOGRAM:
+            args->histogram = arg;
+            break;
+        case OPT_SNAPSHOT:
+            args->snapshot = arg;
+            break;
+        case 'C':
+            args->calibrate = true;
+            break;
+        case OPT_PROFILE:
+            args->profile = arg;
+            break;
+        case OPT_CAL_MIN_DIV:
+        case OPT_CAL_MAX_DIV:
+            if (atoi(arg) <= 0)
+                argp_error(state, "Invalid divider: '%s'", arg);
+            if (key == OPT_CAL_MIN_DIV)
+                args->cal_min_div = (size_t)atoi(arg);
+            else
+                args->cal_max_div = (size_t)atoi(arg);
+            break;
+        case OPT_SNAPSHOT_SAMPLES:
+            args->snapshot_samples = (size_t)atoi(arg);
+            if (args->snapshot_samples == 0 ||
+                args->snapshot_samples > ADC_SNAPSHOT_MAX_SAMPLES)
+                argp_error(
+                    state,
+                    "Invalid number of samples '%s'. Max: %d",
+                    arg,
+                    ADC_SNAPSHOT_MAX_SAMPLES
+                );
+            break;
+        case OPT_DETECT:
+            if (adc_detect_mode_parse(arg, &args->detect_mode) < 0)
+                argp_error(state, "Invalid detection mode '%s'", arg);
+            args->detect = true;
+            break;
+        case OPT_THRESHOLD:
+            args->threshold = atof(arg);
+            break;
+        case OPT_PRE:
+            args->pre = (size_t)atoi(arg);
+            if (args->pre > MAX_DETECT_WINDOW)
+                argp_error(
+                    state,
+                    "Invalid number of samples '%s'. Max: %d",
+                    arg,
+                    MAX_DETECT_WINDOW
+                );
+            break;
+        case OPT_POST:
+            args->post = (size_t)atoi(arg);
+            if (args->post == 0 || args->post > MAX_DETECT_WINDOW)
+                argp_error(
+                    state,
+                    "Invalid number of samples '%s'. Max: %d",
+                    arg,
+                    MAX_DETECT_WINDOW
+                );
+            break;
+        case OPT_DECIMATE:
+            ratio = (unsigned int)atoi(arg);
+            args->decimate = 0;
+            while (args->decimate < DECIMATOR_MAX_LOG2_RATIO &&
+                   (1u << args->decimate) < ratio)
+                args->decimate++;
+            if ((1u << args->decimate) != ratio)
+                argp_error(
+                    state,
+                    "Invalid decimation ratio '%s'. Valid ratios: 1, 2, 4, "
+                    "..., %u",
+                    arg,
+                    1u << DECIMATOR_MAX_LOG2_RATIO
+                );
+            break;
+        case OPT_NO_COMPENSATE:
+            args->compensate = false;
+            break;
+        case OPT_RAW:
+            args->raw = (size_t)strtoul(arg, NULL, 10);
+            if (args->raw == 0 || args->raw > MAX_NUM_SAMPLES)
+                argp_error(
+                    state,
+                    "Invalid number of raw samples '%s'. Max: %zu",
+                    arg,
+                    (size_t)MAX_NUM_SAMPLES
+                );
+            break;
+        case OPT_RAW_OUTPUT:
+            args->raw_output = arg;
+            break;
         case 'a':
             args->avg = (size_t)atoi(arg);
             if (args->avg > MAX_NUM_AVG) {
@@ -69,27 +301,1505 @@ static error_t parse_args(int key, char *arg, struct argp_state *state) {
 
 static struct argp argp = {options, parse_args, 0, adc_docs};
 
+static volatile sig_atomic_t interrupted = 0;
+
+static void write_trace(void) {
+    trace_close();
+}
+
+static void on_interrupt(int signum) {
+    (void)signum;
+    interrupted = 1;
+}
+
+static void print_stats(struct adc_stats *stats, size_t blocks) {
+    double lsb = adc_lsb_volts(&stats->layout, ADC_VREF);
+    double std = sqrt(adc_stats_variance(stats));
+    puts("Statistics:");
+    printf("blocks:                         %zu\n", blocks);
+    printf(
+        "samples:                        %llu\n",
+        (unsigned long long)stats->count
+    );
+    printf(
+        "mean:                           %.3f (%.9f V)\n",
+        stats->mean,
+        stats->mean * lsb
+    );
+    printf("std:                            %.3f (%.9f V)\n", std, std * lsb);
+    printf(
+        "min:                            %ld (%.9f V)\n",
+        (long)stats->min,
+        stats->min * lsb
+    );
+    printf(
+        "max:                            %ld (%.9f V)\n",
+        (long)stats->max,
+        stats->max * lsb
+    );
+    printf(
+        "histogram bins:                 %llu (%u bit)\n",
+        (unsigned long long)adc_stats_bins(stats),
+        stats->hist_bits
+    );
+}
+
+// Read out the conversion results at double data rate with --ddr, or with
+// the echo clock with --echo, which is single data rate only
+static uint8_t data_rate_mode(const struct adc_arguments *args, uint8_t mode) {
+    if (args->echo)
+        return (mode & ~(ADC_REG_MODE_DDR | ADC_REG_MODE_HOST_CLK |
+                         ADC_REG_MODE_ECHO_CLK)) |
+               ADC_REG_MODE_ECHO_CLK;
+    return args->ddr ? (mode | ADC_REG_MODE_DDR) : mode;
+}
+
+// Mode of the ADC for a capture. Packing needs the plain 24-bit samples.
+static uint8_t capture_mode(const struct adc_arguments *args) {
+    if (args->pack)
+        return data_rate_mode(
+            args,
+            (adc_default_mode(false, 0) & ~(uint8_t)0x7) | ADC_REG_MODE_24BIT
+        );
+    return data_rate_mode(
+        args, adc_default_mode(args->test, (uint8_t)args->avg)
+    );
+}
+
+// Format of the words in the DMA buffer, which is not the output data format
+// of the ADC with --decimate
+static uint8_t data_format(const struct adc_arguments *args) {
+    if (args->decimate > 0)
+        return ADC_FORMAT_DECIMATED;
+    return capture_mode(args);
+}
+
+// Words of a block in the DMA buffer, including the block header
+static size_t capture_words(const struct adc_arguments *args) {
+    size_t words = args->pack ? args->num / 4 * 3 : args->num;
+    return words + (args->header ? ADC_BLOCK_HEADER_WORDS : 0);
+}
+
+// Rate of the samples in the DMA buffer
+static double output_rate(const struct adc_arguments *args) {
+    return adc_sample_rate(args->div) / (double)(1u << args->decimate);
+}
+
+// Date the block that just completed with the clock model. The probes are
+// only used if the packetizer completed exactly one packet since 'iter' was
+// read, otherwise they might belong to a different packet.
+static void date_block(
+    struct adc *adc,
+    struct adc_clock_model *clock,
+    const struct adc_clock_probe *probes,
+    size_t num_probes,
+    uint32_t iter,
+    size_t samples,
+    uint64_t completion_ns,
+    struct adc_block_time *time
+) {
+    if (*adc->pack.iter_counter - iter != 1)
+        num_probes = 0;
+    adc_clock_update(clock, probes, num_probes, samples, completion_ns, time);
+}
+
+// One line per block: sequence number, number of samples, CLOCK_REALTIME of
+// the first sample in ns, and the sample period in ns. With block headers,
+// the 'adc_clk' timestamp of the header follows.
+static int write_timestamp(
+    FILE *file,
+    uint64_t sequence,
+    size_t samples,
+    uint64_t realtime_ns,
+    double period_ns,
+    const uint64_t *ticks
+) {
+    int rc = fprintf(
+        file,
+        "%llu %zu %llu %.6f",
+        (unsigned long long)sequence,
+        samples,
+        (unsigned long long)realtime_ns,
+        period_ns
+    );
+    if (rc >= 0 && ticks != NULL)
+        rc = fprintf(file, " %llu", (unsigned long long)*ticks);
+    if (rc >= 0)
+        rc = fputs("\n", file);
+    return (rc < 0) ? -EIO : 0;
+}
+
+static void print_clock(const struct adc_clock_model *clock) {
+    puts("Sample clock:");
+    printf(
+        "blocks probed:                  %llu of %llu (%llu rejected)\n",
+        (unsigned long long)clock->fitted,
+        (unsigned long long)clock->blocks,
+        (unsigned long long)clock->rejected
+    );
+    printf(
+        "sample rate:                    %.3f Hz (%+.3f ppm)\n",
+        adc_clock_sample_rate(clock),
+        adc_clock_ppm(clock)
+    );
+    printf(
+        "completion latency:             %.1f us (std %.1f us)\n",
+        clock->latency_ns / 1e3,
+        sqrt(clock->latency_var) / 1e3
+    );
+}
+
+// Blocks copied out of the DMA buffer by the acquisition thread and written to
+// the output file by the writer thread.
+struct rt_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t **buffers;
+    // Time base of every buffer, and the timestamp of its header with
+    // --header
+    struct adc_block_time *times;
+    uint64_t *ticks;
+    size_t num_buffers;
+    // Index of the next buffer to write and number of filled buffers
+    size_t head;
+    size_t filled;
+    // Samples per buffer, and words with --pack
+    size_t samples;
+    size_t words;
+    // Number of buffers written
+    uint64_t written;
+    bool done;
+    FILE *outfile;
+    FILE *timestamps;
+    int rc;
+};
+
+static void *rt_writer(void *arg) {
+    struct rt_queue *queue = arg;
+    uint32_t *buffer;
+    struct adc_block_time *time;
+    size_t written;
+    uint64_t t;
+    int rc = 0;
+
+    trace_thread_name("writer");
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        while (queue->filled == 0 && !queue->done)
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        if (queue->filled == 0)
+            break;
+        buffer = queue->buffers[queue->head];
+        time = &queue->times[queue->head];
+        pthread_mutex_unlock(&queue->lock);
+
+        t = trace_begin();
+        written =
+            fwrite(buffer, sizeof(uint32_t), queue->words, queue->outfile);
+        trace_end("fwrite", t);
+        if (queue->timestamps != NULL) {
+            rc = write_timestamp(
+                queue->timestamps,
+                queue->written,
+                queue->samples,
+                time->first_realtime_ns,
+                time->period_ns,
+                (queue->ticks != NULL) ? &queue->ticks[queue->head] : NULL
+            );
+        }
+
+        pthread_mutex_lock(&queue->lock);
+        if (written != queue->words || rc < 0)
+            queue->rc = -EIO;
+        queue->written++;
+        queue->head = (queue->head + 1) % queue->num_buffers;
+        queue->filled--;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+static void print_rt(
+    struct rt_latency *latency, size_t blocks, size_t samples, size_t stalls
+) {
+    double mean_ns =
+        (latency->count > 0) ? (double)latency->sum_ns / latency->count : 0.0;
+    puts("Real-time capture:");
+    printf("blocks:                         %zu\n", blocks);
+    printf("samples:                        %zu\n", blocks * samples);
+    printf("writer stalls:                  %zu\n", stalls);
+    if (latency->count == 0)
+        return;
+    printf(
+        "wake-up latency min:            %.1f us\n", latency->min_ns / 1e3
+    );
+    printf("wake-up latency mean:           %.1f us\n", mean_ns / 1e3);
+    printf(
+        "wake-up latency p99:            %.1f us\n",
+        rt_latency_percentile(latency, 99.0) / 1e3
+    );
+    printf(
+        "wake-up latency p99.9:          %.1f us\n",
+        rt_latency_percentile(latency, 99.9) / 1e3
+    );
+    printf(
+        "wake-up latency max:            %.1f us\n", latency->max_ns / 1e3
+    );
+}
+
+static void print_headers(const struct adc_block_check *check) {
+    puts("Block headers:");
+    printf(
+        "blocks checked:                 %llu\n",
+        (unsigned long long)check->blocks
+    );
+    printf(
+        "blocks lost:                    %llu\n",
+        (unsigned long long)check->lost
+    );
+    printf(
+        "blocks repeated:                %llu\n",
+        (unsigned long long)check->repeated
+    );
+    printf(
+        "invalid headers:                %llu\n",
+        (unsigned long long)check->invalid
+    );
+}
+
+// Samples the FIFO dropped while the DMA stalled, since 'run_rt()' or
+// 'run_fanout()' cleared the counters
+static void print_fifo(struct adc_fifo *fifo) {
+    puts("FIFO:");
+    printf("depth:                          %u\n", *fifo->depth);
+    printf("high-water mark:                %u\n", *fifo->high_water);
+    printf("samples dropped:                %u\n", *fifo->dropped);
+    printf("overflows:                      %u\n", *fifo->overflows);
+}
+
+// Link utilization and stalls of the packetizer since 'run_rt()' or
+// 'run_fanout()' cleared the counters, as fractions of all 'adc_clk' cycles
+static void print_perf(struct packetizer *pack) {
+    struct packetizer_perf perf;
+    get_packetizer_perf(pack, &perf);
+    puts("Datapath:");
+    printf(
+        "cycles:                         %llu\n",
+        (unsigned long long)perf.cycles
+    );
+    printf(
+        "link utilization:               %.2f %%\n",
+        100.0 * packetizer_perf_ratio(perf.out_beats, &perf)
+    );
+    printf(
+        "input stalls:                   %.2f %%\n",
+        100.0 * packetizer_perf_ratio(perf.in_stalls, &perf)
+    );
+    printf(
+        "DMA stalls:                     %.2f %%\n",
+        100.0 * packetizer_perf_ratio(perf.out_stalls, &perf)
+    );
+    printf(
+        "disabled with data pending:     %.2f %%\n",
+        100.0 * packetizer_perf_ratio(perf.disabled, &perf)
+    );
+}
+
+// Capture '--blocks' blocks into the output file. The acquisition runs in the
+// calling thread, writing to the file in a separate thread, both pinned and
+// with SCHED_FIFO priorities. For every block, the time from the completion
+// of the DMA transfer (timestamped by the driver) until the acquisition thread
+// returns from 'WAIT_FOR_TRANSFER' is recorded. If all buffers are still
+// waiting for the writer, the acquisition stalls until one is free. Every
+// block is dated with the clock model, see 'date_block()'. With --header, the
+// header of every block is verified as well.
+static int run_rt(struct adc *adc, struct adc_arguments *args) {
+    struct rt_queue queue;
+    struct rt_latency latency;
+    struct adc_block_check check;
+    struct adc_clock_model clock;
+    struct adc_clock_probe probes[ADC_CLOCK_PROBES];
+    struct adc_block_time time;
+    struct dmadc_channel channel;
+    enum dmadc_status status;
+    pthread_t writer;
+    size_t bytes = capture_bytes(adc, args->num);
+    size_t block = 0, stalls = 0, index, num_probes = 0;
+    uint64_t wake_ns = 0, completion_ns, t, ticks = 0;
+    uint32_t iter;
+    FILE *latency_file = NULL;
+    int rc;
+
+    memset(&queue, 0, sizeof(queue));
+    rt_latency_init(&latency);
+    adc_block_check_init(&check);
+    adc_clock_init(&clock, output_rate(args));
+    queue.num_buffers = args->rt_buffers;
+    queue.samples = args->num;
+    queue.words = bytes / sizeof(uint32_t);
+    queue.outfile = fopen(args->output, "w");
+    if (queue.outfile == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", args->output);
+        return -errno;
+    }
+    if (args->latency != NULL) {
+        latency_file = fopen(args->latency, "w");
+        if (latency_file == NULL) {
+            fprintf(stderr, "Unable to open file %s\n", args->latency);
+            fclose(queue.outfile);
+            return -errno;
+        }
+    }
+    if (args->timestamps != NULL) {
+        queue.timestamps = fopen(args->timestamps, "w");
+        if (queue.timestamps == NULL) {
+            fprintf(stderr, "Unable to open file %s\n", args->timestamps);
+            rc = -errno;
+            goto exit_files;
+        }
+    }
+
+    // Lock memory before the buffers are allocated, such that they are
+    // locked as well, then fault in all of their pages.
+    rc = rt_lock_memory();
+    if (rc < 0)
+        goto exit_files;
+    queue.buffers = calloc(queue.num_buffers, sizeof(uint32_t *));
+    queue.times = calloc(queue.num_buffers, sizeof(struct adc_block_time));
+    if (args->header)
+        queue.ticks = calloc(queue.num_buffers, sizeof(uint64_t));
+    if (queue.buffers == NULL || queue.times == NULL ||
+        (args->header && queue.ticks == NULL)) {
+        free(queue.buffers);
+        rc = -ENOMEM;
+        goto exit_files;
+    }
+    for (size_t i = 0; i < queue.num_buffers; i++) {
+        queue.buffers[i] = malloc(bytes);
+        if (queue.buffers[i] == NULL) {
+            fprintf(stderr, "Unable to allocate %zu buffers\n", i + 1);
+            rc = -ENOMEM;
+            goto exit_buffers;
+        }
+        rt_prefault(queue.buffers[i], bytes);
+    }
+
+    rc = open_dma_channel(&channel);
+    if (rc < 0)
+        goto exit_buffers;
+    // 'dma_mmap_coherent()' maps all pages at once, there are no page faults
+    rc = dmadc_mmap_buffer(&channel, bytes);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to map buffer: Error %d\n", rc);
+        goto exit_channel;
+    }
+    uint8_t mode = capture_mode(args);
+    configure_adc(adc, mode, (uint8_t)args->avg);
+    configure_adc_trigger(&adc->trigger, args->zone);
+    clear_adc_fifo_counters(&adc->fifo);
+    clear_packetizer_perf(&adc->pack);
+    set_timeout_ms(&channel, args->timeout_ms);
+
+    rc = rt_setup_thread(pthread_self(), args->rt_cpu, args->rt_prio);
+    if (rc < 0)
+        goto exit_channel;
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.cond, NULL);
+    rc = -pthread_create(&writer, NULL, rt_writer, &queue);
+    if (rc < 0)
+        goto exit_queue;
+    rc = rt_setup_thread(writer, args->rt_writer_cpu, args->rt_writer_prio);
+
+    signal(SIGINT, on_interrupt);
+    for (; rc == 0 && (args->blocks == 0 || block < args->blocks); block++) {
+        if (interrupted)
+            break;
+        iter = *adc->pack.iter_counter;
+        status = capture_start(adc, &channel, args->num, args->div);
+        if (status == DMADC_IN_PROGRESS) {
+            num_probes = capture_probe(
+                adc, rt_now_ns(), args->num, clock.period_ns, probes
+            );
+            status = wait_for_transfer(&channel);
+            wake_ns = rt_now_ns();
+            capture_finish(adc, status);
+        }
+        if (status != DMADC_COMPLETE) {
+            fprintf(
+                stderr,
+                "Error: DMA transfer exited with status %s\n",
+                dmadc_status_strings[status]
+            );
+            rc = -EIO;
+            break;
+        }
+        completion_ns = get_completion_ns(&channel);
+        if (completion_ns != 0 && wake_ns >= completion_ns)
+            rt_latency_add(&latency, wake_ns - completion_ns);
+        date_block(
+            adc,
+            &clock,
+            probes,
+            num_probes,
+            iter,
+            args->num,
+            completion_ns,
+            &time
+        );
+        if (args->header)
+            adc_block_check(&check, channel.buffer, args->num, &ticks);
+
+        t = trace_begin();
+        pthread_mutex_lock(&queue.lock);
+        if (queue.filled == queue.num_buffers)
+            stalls++;
+        while (queue.filled == queue.num_buffers)
+            pthread_cond_wait(&queue.cond, &queue.lock);
+        index = (queue.head + queue.filled) % queue.num_buffers;
+        pthread_mutex_unlock(&queue.lock);
+        trace_end("wait_for_buffer", t);
+
+        t = trace_begin();
+        memcpy(queue.buffers[index], channel.buffer, bytes);
+        queue.times[index] = time;
+        if (queue.ticks != NULL)
+            queue.ticks[index] = ticks;
+        trace_end("memcpy", t);
+
+        pthread_mutex_lock(&queue.lock);
+        queue.filled++;
+        pthread_cond_broadcast(&queue.cond);
+        pthread_mutex_unlock(&queue.lock);
+    }
+    signal(SIGINT, SIG_DFL);
+
+    pthread_mutex_lock(&queue.lock);
+    queue.done = true;
+    pthread_cond_broadcast(&queue.cond);
+    pthread_mutex_unlock(&queue.lock);
+    pthread_join(writer, NULL);
+    if (queue.rc < 0) {
+        fprintf(stderr, "Error: Unable to write to %s\n", args->output);
+        rc = queue.rc;
+    }
+
+    print_rt(&latency, block, args->num, stalls);
+    print_clock(&clock);
+    print_fifo(&adc->fifo);
+    print_perf(&adc->pack);
+    if (args->header)
+        print_headers(&check);
+    if (latency_file != NULL && rt_latency_write(&latency, latency_file) < 0)
+        rc = -EIO;
+
+exit_queue:
+    pthread_cond_destroy(&queue.cond);
+    pthread_mutex_destroy(&queue.lock);
+exit_channel:
+    close_dma_channel(&channel);
+exit_buffers:
+    for (size_t i = 0; i < queue.num_buffers; i++) {
+        free(queue.buffers[i]);
+    }
+    free(queue.buffers);
+exit_files:
+    free(queue.times);
+    free(queue.ticks);
+    if (queue.timestamps != NULL)
+        fclose(queue.timestamps);
+    if (latency_file != NULL)
+        fclose(latency_file);
+    fclose(queue.outfile);
+    return rc;
+}
+
+// Capture blocks of 'args->num' samples and only keep their statistics. The
+// histogram is written to 'args->output'. Blocks are not contiguous, the ADC
+// is idle while a block is processed.
+static void print_hw_stats(const struct adc_hw_stats_window *window) {
+    // The statistics tap sees the 24-bit conversion results
+    const double lsb = 2.0 * ADC_VREF / (double)(1u << 24);
+    double mean = adc_hw_stats_mean(window);
+    double std = adc_hw_stats_stddev(window);
+
+    printf("Window %u:\n", window->sequence);
+    printf("samples:                        %u\n", window->count);
+    printf("mean:                           %.3f (%.9f V)\n", mean, mean * lsb);
+    printf("std:                            %.3f (%.9f V)\n", std, std * lsb);
+    printf(
+        "min:                            %ld (%.9f V)\n",
+        (long)window->min,
+        window->min * lsb
+    );
+    printf(
+        "max:                            %ld (%.9f V)\n",
+        (long)window->max,
+        window->max * lsb
+    );
+}
+
+// Let the statistics tap in the FPGA accumulate '--blocks' windows of
+// '--hw-stats' samples and print the results of every window. No samples
+// are captured, the DMA stays idle.
+static int run_hw_stats(struct adc *adc, struct adc_arguments *args) {
+    struct adc_hw_stats_window window;
+    uint32_t last = 0;
+    size_t windows = 0;
+    unsigned int waited_ms = 0;
+    int rc = 0;
+
+    configure_adc(adc, data_rate_mode(args, adc_default_mode(false, 0)), 0);
+    configure_adc_trigger(&adc->trigger, args->zone);
+    // Only the windows that end from now on are printed
+    get_adc_hw_stats(&adc->hw_stats, &window);
+    last = window.sequence;
+    set_adc_hw_stats_window(&adc->hw_stats, args->hw_stats);
+    restart_adc_trigger(&adc->trigger);
+    *adc->trigger.divider = (uint32_t)args->div;
+
+    signal(SIGINT, on_interrupt);
+    while (args->blocks == 0 || windows < args->blocks) {
+        if (interrupted)
+            break;
+        if (get_adc_hw_stats(&adc->hw_stats, &window) < 0 ||
+            window.sequence == last) {
+            if (waited_ms >= args->timeout_ms) {
+                fprintf(stderr, "Error: No window ended in time\n");
+                rc = -ETIMEDOUT;
+                break;
+            }
+            usleep(1000);
+            waited_ms++;
+            continue;
+        }
+        if (window.sequence != last + 1)
+            fprintf(
+                stderr,
+                "Warning: %u windows ended unread\n",
+                window.sequence - last - 1
+            );
+        last = window.sequence;
+        waited_ms = 0;
+        windows++;
+        print_hw_stats(&window);
+    }
+    signal(SIGINT, SIG_DFL);
+
+    *adc->trigger.divider = 0;
+    set_adc_hw_stats_window(&adc->hw_stats, 0);
+    return rc;
+}
+
+static int run_stats(struct adc *adc, struct adc_arguments *args) {
+    struct adc_stats parts[MAX_NUM_THREADS];
+    struct adc_stats total;
+    struct dmadc_channel channel;
+    enum dmadc_status status;
+    FILE *outfile;
+    size_t block;
+    int rc;
+
+    uint8_t mode = data_rate_mode(
+        args, adc_default_mode(args->test, (uint8_t)args->avg)
+    );
+    if (adc_stats_init(&total, data_format(args)) < 0) {
+        fprintf(stderr, "Error: No statistics in test pattern mode\n");
+        return -EINVAL;
+    }
+    for (unsigned int i = 0; i < args->threads; i++) {
+        adc_stats_init(&parts[i], data_format(args));
+    }
+    outfile = fopen(args->output, "w");
+    if (outfile == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", args->output);
+        return -errno;
+    }
+    rc = open_dma_channel(&channel);
+    if (rc < 0) {
+        fclose(outfile);
+        return rc;
+    }
+    rc = dmadc_mmap_buffer(&channel, args->num * sizeof(uint32_t));
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to map buffer: Error %d\n", rc);
+        close_dma_channel(&channel);
+        fclose(outfile);
+        return rc;
+    }
+
+    configure_adc(adc, mode, (uint8_t)args->avg);
+    configure_adc_trigger(&adc->trigger, args->zone);
+    set_timeout_ms(&channel, args->timeout_ms);
+
+    signal(SIGINT, on_interrupt);
+    for (block = 0; args->blocks == 0 || block < args->blocks; block++) {
+        if (interrupted)
+            break;
+        status = capture_block(adc, &channel, args->num, args->div);
+        if (status != DMADC_COMPLETE) {
+            fprintf(
+                stderr,
+                "Error: DMA transfer exited with status %s\n",
+                dmadc_status_strings[status]
+            );
+            rc = -EIO;
+            break;
+        }
+        uint64_t t = trace_begin();
+        rc = adc_stats_update_parallel(
+            parts, args->threads, channel.buffer, args->num
+        );
+        trace_end("adc_stats_update", t);
+        if (rc < 0) {
+            fprintf(stderr, "Error: Unable to update statistics\n");
+            break;
+        }
+        printf("Block %zu done\n", block + 1);
+    }
+    signal(SIGINT, SIG_DFL);
+    close_dma_channel(&channel);
+
+    for (unsigned int i = 0; i < args->threads; i++) {
+        if (adc_stats_merge(&total, &parts[i]) < 0)
+            rc = -ENOMEM;
+        adc_stats_free(&parts[i]);
+    }
+    print_stats(&total, block);
+    if (adc_stats_write_histogram(&total, outfile) < 0) {
+        fprintf(stderr, "Error: Unable to write histogram\n");
+        rc = -EIO;
+    }
+    fclose(outfile);
+    adc_stats_free(&total);
+    return rc;
+}
+
+// Frame sent ahead of every block by the network consumer of --fanout
+struct fanout_header {
+    uint32_t magic;
+    uint32_t samples;
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+    double period_ns;
+};
+
+#define FANOUT_MAGIC 0x42434441
+
+struct fanout_stats {
+    struct adc_stats parts[MAX_NUM_THREADS];
+    unsigned int threads;
+};
+
+struct fanout_preview {
+    struct adc_word_layout layout;
+    uint64_t interval_ns;
+    uint64_t last_ns;
+};
+
+struct fanout_snapshot {
+    struct adc_snapshot snapshot;
+    struct adc_word_layout layout;
+};
+
+static int consume_disk(const struct pipeline_block *block, void *user) {
+    FILE *outfile = user;
+    size_t written =
+        fwrite(block->data, sizeof(uint32_t), block->samples, outfile);
+    return (written == block->samples) ? 0 : -EIO;
+}
+
+static int consume_events(const struct pipeline_block *block, void *user) {
+    return adc_detector_process(
+        user,
+        block->data,
+        block->samples,
+        block->sequence,
+        block->timestamp_ns,
+        block->period_ns
+    );
+}
+
+static int consume_stats(const struct pipeline_block *block, void *user) {
+    struct fanout_stats *stats = user;
+    return adc_stats_update_parallel(
+        stats->parts, stats->threads, block->data, block->samples
+    );
+}
+
+static int consume_timestamps(const struct pipeline_block *block, void *user) {
+    return write_timestamp(
+        user,
+        block->sequence,
+        block->samples,
+        block->timestamp_ns,
+        block->period_ns,
+        NULL
+    );
+}
+
+static int send_all(int fd, const void *data, size_t len) {
+    const uint8_t *p = data;
+    ssize_t sent;
+    while (len > 0) {
+        sent = send(fd, p, len, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+static int consume_send(const struct pipeline_block *block, void *user) {
+    int *fd = user;
+    struct fanout_header header = {
+        FANOUT_MAGIC,
+        (uint32_t)block->samples,
+        block->sequence,
+        block->timestamp_ns,
+        block->period_ns
+    };
+    int rc;
+    if (*fd < 0)
+        return -ENOTCONN;
+    rc = send_all(*fd, &header, sizeof(header));
+    if (rc == 0)
+        rc = send_all(*fd, block->data, block->samples * sizeof(uint32_t));
+    if (rc < 0) {
+        // The connection is not re-established, all further blocks fail
+        fprintf(stderr, "Error: Unable to send block: %s\n", strerror(-rc));
+        close(*fd);
+        *fd = -1;
+    }
+    return rc;
+}
+
+static int consume_preview(const struct pipeline_block *block, void *user) {
+    struct fanout_preview *preview = user;
+    const double lsb = adc_lsb_volts(&preview->layout, ADC_VREF);
+    uint64_t now = rt_now_ns();
+    int32_t code, min = INT32_MAX, max = INT32_MIN;
+    int64_t sum = 0;
+
+    if (now - preview->last_ns < preview->interval_ns)
+        return 0;
+    preview->last_ns = now;
+    for (size_t i = 0; i < block->samples; i++) {
+        code = (int32_t)block->data[i] >> preview->layout.shift;
+        sum += code;
+        min = (code < min) ? code : min;
+        max = (code > max) ? code : max;
+    }
+    printf(
+        "Block %llu: mean %.6f V, min %.6f V, max %.6f V\n",
+        (unsigned long long)block->sequence,
+        (double)sum / (double)block->samples * lsb,
+        min * lsb,
+        max * lsb
+    );
+    fflush(stdout);
+    return 0;
+}
+
+static int consume_snapshot(const struct pipeline_block *block, void *user) {
+    struct fanout_snapshot *snapshot = user;
+    adc_snapshot_publish(
+        &snapshot->snapshot,
+        block->data,
+        block->samples,
+        &snapshot->layout,
+        block->sequence
+    );
+    return 0;
+}
+
+static int connect_to(const char *address) {
+    struct addrinfo hints, *result, *ai;
+    char host[256];
+    const char *port = strrchr(address, ':');
+    int fd = -1, rc;
+
+    if (port == NULL || (size_t)(port - address) >= sizeof(host)) {
+        fprintf(stderr, "Invalid address '%s', expected host:port\n", address);
+        return -EINVAL;
+    }
+    memcpy(host, address, (size_t)(port - address));
+    host[port - address] = '\0';
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    rc = getaddrinfo(host, port + 1, &hints, &result);
+    if (rc != 0) {
+        fprintf(stderr, "Unable to resolve %s: %s\n", host, gai_strerror(rc));
+        return -EHOSTUNREACH;
+    }
+    for (ai = result; ai != NULL; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to connect to %s\n", address);
+        return -ECONNREFUSED;
+    }
+    return fd;
+}
+
+static void print_fanout(struct pipeline *pipeline, size_t blocks) {
+    struct pipeline_consumer *c;
+    char label[64];
+    puts("Fan-out capture:");
+    printf("blocks:                         %zu\n", blocks);
+    printf(
+        "pool waits:                     %llu\n",
+        (unsigned long long)pipeline->pool_waits
+    );
+    for (size_t i = 0; i < pipeline->num_consumers; i++) {
+        c = &pipeline->consumers[i];
+        snprintf(label, sizeof(label), "consumer %s:", c->name);
+        printf(
+            "%-32s%llu delivered, %llu dropped, %llu waits, max depth %zu, "
+            "%llu errors\n",
+            label,
+            (unsigned long long)c->delivered,
+            (unsigned long long)c->dropped,
+            (unsigned long long)c->waits,
+            c->max_depth,
+            (unsigned long long)c->errors
+        );
+    }
+}
+
+static void print_detect(const struct adc_detector *detector) {
+    double ratio = (detector->samples_in > 0)
+                       ? (double)detector->samples_out /
+                             (double)detector->samples_in
+                       : 0.0;
+    puts("Event detection:");
+    printf(
+        "events:                         %llu\n",
+        (unsigned long long)detector->events
+    );
+    printf(
+        "samples written:                %llu of %llu (%.4f %%)\n",
+        (unsigned long long)detector->samples_out,
+        (unsigned long long)detector->samples_in,
+        ratio * 100.0
+    );
+}
+
+// Capture '--blocks' blocks and hand them to several consumers at once, each
+// running in its own thread. Every block is copied out of the DMA buffer
+// once, into a block of the pool that is shared by reference. Lossless
+// consumers (output file, statistics) that fall behind make the acquisition
+// wait, lossy ones (network, preview) miss blocks instead. Both are counted
+// and reported at the end. Every block is dated with the clock model, see
+// 'date_block()'. With --detect, only the windows around events are written
+// to the output file.
+static int run_fanout(struct adc *adc, struct adc_arguments *args) {
+    struct pipeline pipeline;
+    struct pipeline_block *block;
+    struct adc_clock_model clock;
+    struct adc_clock_probe probes[ADC_CLOCK_PROBES];
+    struct adc_block_time time;
+    struct dmadc_channel channel;
+    struct fanout_stats stats = {0};
+    struct fanout_preview preview;
+    struct fanout_snapshot snapshot = {0};
+    struct adc_detector detector;
+    struct adc_stats total;
+    enum dmadc_status status;
+    FILE *outfile, *histfile = NULL, *timestamps = NULL;
+    size_t block_count = 0, num_probes = 0;
+    int send_fd = -1, rc;
+    uint64_t t;
+    uint32_t iter;
+
+    uint8_t mode = capture_mode(args), format = data_format(args);
+    if ((args->stats || args->preview_ms > 0 || args->snapshot != NULL ||
+         args->detect) &&
+        adc_word_layout(format, &preview.layout) < 0) {
+        fprintf(stderr, "Error: No conversion results in test pattern mode\n");
+        return -EINVAL;
+    }
+    snapshot.layout = preview.layout;
+    outfile = fopen(args->output, "w");
+    if (outfile == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", args->output);
+        return -errno;
+    }
+    if (args->histogram != NULL) {
+        histfile = fopen(args->histogram, "w");
+        if (histfile == NULL) {
+            fprintf(stderr, "Unable to open file %s\n", args->histogram);
+            rc = -errno;
+            goto exit_files;
+        }
+    }
+    if (args->timestamps != NULL) {
+        timestamps = fopen(args->timestamps, "w");
+        if (timestamps == NULL) {
+            fprintf(stderr, "Unable to open file %s\n", args->timestamps);
+            rc = -errno;
+            goto exit_files;
+        }
+    }
+    if (args->send != NULL) {
+        send_fd = connect_to(args->send);
+        if (send_fd < 0) {
+            rc = send_fd;
+            goto exit_files;
+        }
+    }
+    if (args->snapshot != NULL) {
+        rc = adc_snapshot_create(
+            &snapshot.snapshot,
+            args->snapshot,
+            (uint32_t)args->snapshot_samples,
+            output_rate(args)
+        );
+        if (rc < 0)
+            goto exit_files;
+    }
+
+    rc = pipeline_init(&pipeline, args->pool, args->num);
+    if (rc < 0) {
+        fprintf(stderr, "Unable to allocate %zu blocks\n", args->pool);
+        goto exit_files;
+    }
+    // The output file is always the first consumer
+    if (args->detect) {
+        rc = adc_detector_init(
+            &detector,
+            args->detect_mode,
+            &preview.layout,
+            args->threshold,
+            args->pre,
+            args->post,
+            outfile
+        );
+        if (rc < 0)
+            goto exit_pipeline;
+        pipeline_add_consumer(
+            &pipeline,
+            "events",
+            PIPELINE_WAIT,
+            args->pool,
+            consume_events,
+            &detector
+        );
+    } else {
+        pipeline_add_consumer(
+            &pipeline, "disk", PIPELINE_WAIT, args->pool, consume_disk, outfile
+        );
+    }
+    if (args->stats) {
+        stats.threads = args->threads;
+        for (unsigned int i = 0; i < stats.threads; i++)
+            adc_stats_init(&stats.parts[i], format);
+        pipeline_add_consumer(
+            &pipeline, "stats", PIPELINE_WAIT, args->pool, consume_stats, &stats
+        );
+    }
+    if (timestamps != NULL) {
+        pipeline_add_consumer(
+            &pipeline,
+            "timestamps",
+            PIPELINE_WAIT,
+            args->pool,
+            consume_timestamps,
+            timestamps
+        );
+    }
+    if (send_fd >= 0) {
+        pipeline_add_consumer(
+            &pipeline, "send", PIPELINE_DROP, SEND_DEPTH, consume_send, &send_fd
+        );
+    }
+    if (args->preview_ms > 0) {
+        preview.interval_ns = (uint64_t)args->preview_ms * 1000000ull;
+        preview.last_ns = 0;
+        pipeline_add_consumer(
+            &pipeline,
+            "preview",
+            PIPELINE_DROP,
+            PREVIEW_DEPTH,
+            consume_preview,
+            &preview
+        );
+    }
+    if (args->snapshot != NULL) {
+        pipeline_add_consumer(
+            &pipeline,
+            "snapshot",
+            PIPELINE_DROP,
+            SNAPSHOT_DEPTH,
+            consume_snapshot,
+            &snapshot
+        );
+    }
+
+    rc = open_dma_channel(&channel);
+    if (rc < 0)
+        goto exit_pipeline;
+    rc = dmadc_mmap_buffer(&channel, capture_bytes(adc, args->num));
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to map buffer: Error %d\n", rc);
+        goto exit_channel;
+    }
+    configure_adc(adc, mode, (uint8_t)args->avg);
+    configure_adc_trigger(&adc->trigger, args->zone);
+    clear_adc_fifo_counters(&adc->fifo);
+    clear_packetizer_perf(&adc->pack);
+    set_timeout_ms(&channel, args->timeout_ms);
+    adc_clock_init(&clock, output_rate(args));
+
+    rc = pipeline_start(&pipeline);
+    if (rc < 0)
+        goto exit_channel;
+    signal(SIGINT, on_interrupt);
+    for (; args->blocks == 0 || block_count < args->blocks; block_count++) {
+        if (interrupted)
+            break;
+        // A block is taken from the pool before the transfer is started,
+        // such that the data is never lost when the pool is exhausted.
+        t = trace_begin();
+        block = pipeline_acquire(&pipeline);
+        trace_end("pipeline_acquire", t);
+        iter = *adc->pack.iter_counter;
+        status = capture_start(adc, &channel, args->num, args->div);
+        if (status == DMADC_IN_PROGRESS) {
+            num_probes = capture_probe(
+                adc, rt_now_ns(), args->num, clock.period_ns, probes
+            );
+            status = capture_finish(adc, wait_for_transfer(&channel));
+        }
+        if (status != DMADC_COMPLETE) {
+            fprintf(
+                stderr,
+                "Error: DMA transfer exited with status %s\n",
+                dmadc_status_strings[status]
+            );
+            pipeline_release(&pipeline, block);
+            rc = -EIO;
+            break;
+        }
+        date_block(
+            adc,
+            &clock,
+            probes,
+            num_probes,
+            iter,
+            args->num,
+            get_completion_ns(&channel),
+            &time
+        );
+        t = trace_begin();
+        if (args->pack)
+            adc_unpack24(channel.buffer, block->data, args->num);
+        else
+            memcpy(block->data, channel.buffer, args->num * sizeof(uint32_t));
+        trace_end("memcpy", t);
+        block->samples = args->num;
+        block->timestamp_ns = time.first_realtime_ns;
+        block->period_ns = time.period_ns;
+        pipeline_publish(&pipeline, block);
+    }
+    signal(SIGINT, SIG_DFL);
+    if (pipeline_stop(&pipeline) < 0 && rc == 0)
+        rc = -EIO;
+
+    print_fanout(&pipeline, block_count);
+    print_clock(&clock);
+    print_fifo(&adc->fifo);
+    print_perf(&adc->pack);
+    if (args->detect) {
+        if (adc_detector_flush(&detector) < 0)
+            rc = -EIO;
+        print_detect(&detector);
+    }
+    if (args->stats) {
+        adc_stats_init(&total, format);
+        for (unsigned int i = 0; i < stats.threads; i++) {
+            if (adc_stats_merge(&total, &stats.parts[i]) < 0)
+                rc = -ENOMEM;
+        }
+        // The statistics consumer is always added after the output file
+        print_stats(&total, pipeline.consumers[1].delivered);
+        if (histfile != NULL && adc_stats_write_histogram(&total, histfile) < 0)
+            rc = -EIO;
+        adc_stats_free(&total);
+    }
+
+exit_channel:
+    close_dma_channel(&channel);
+exit_pipeline:
+    if (args->detect)
+        adc_detector_free(&detector);
+    if (args->stats) {
+        for (unsigned int i = 0; i < stats.threads; i++)
+            adc_stats_free(&stats.parts[i]);
+    }
+    pipeline_free(&pipeline);
+exit_files:
+    if (args->snapshot != NULL && snapshot.snapshot.shm != NULL)
+        adc_snapshot_close(&snapshot.snapshot);
+    if (send_fd >= 0)
+        close(send_fd);
+    if (timestamps != NULL)
+        fclose(timestamps);
+    if (histfile != NULL)
+        fclose(histfile);
+    fclose(outfile);
+    return rc;
+}
+
+// Capture the test pattern of the ADC with every divider from
+// '--cal-max-div' down to '--cal-min-div' in both zones and check every word.
+// The result of a zone is the lowest divider down to which all dividers were
+// free of errors, the faster zone is saved to the profile.
+static int run_calibrate(struct adc *adc, struct adc_arguments *args) {
+    struct dmadc_channel channel;
+    struct adc_pattern_errors errors;
+    struct adc_profile profile;
+    enum dmadc_status status;
+    const uint32_t pattern = ADC_TEST_PAT_DEFAULT;
+    size_t samples = args->num, best[3] = {0, 0, 0}, div;
+    bool failed[3] = {false, false, false};
+    unsigned int zone;
+    int rc;
+
+    if (args->cal_min_div > args->cal_max_div) {
+        fprintf(stderr, "Error: --cal-min-div is larger than --cal-max-div\n");
+        return -EINVAL;
+    }
+    if (samples == 0 || samples > MAX_CAL_SAMPLES)
+        samples = MAX_CAL_SAMPLES;
+    rc = open_dma_channel(&channel);
+    if (rc < 0)
+        return rc;
+    rc = dmadc_mmap_buffer(&channel, samples * sizeof(uint32_t));
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to map buffer: Error %d\n", rc);
+        close_dma_channel(&channel);
+        return rc;
+    }
+    configure_adc(adc, data_rate_mode(args, adc_default_mode(true, 0)), 0);
+    configure_adc_test_pattern(adc, pattern);
+    set_timeout_ms(&channel, args->timeout_ms);
+
+    printf("Test pattern 0x%08X, %zu samples per setting\n", pattern, samples);
+    puts("divider  zone  sample_rate_hz   word_errors    bit_errors");
+    signal(SIGINT, on_interrupt);
+    for (div = args->cal_max_div; div >= args->cal_min_div && !interrupted;
+         div--) {
+        for (zone = 1; zone <= 2; zone++) {
+            configure_adc_trigger(&adc->trigger, zone);
+            status = capture_block(adc, &channel, samples, div);
+            if (status != DMADC_COMPLETE) {
+                fprintf(
+                    stderr,
+                    "Error: DMA transfer exited with status %s\n",
+                    dmadc_status_strings[status]
+                );
+                rc = -EIO;
+                goto out;
+            }
+            memset(&errors, 0, sizeof(errors));
+            adc_check_pattern(channel.buffer, samples, pattern, &errors);
+            printf(
+                "%7zu %5u %15.1f %13llu %13llu\n",
+                div,
+                zone,
+                adc_sample_rate(div),
+                (unsigned long long)errors.words,
+                (unsigned long long)errors.bits
+            );
+            if (errors.words == 0 && !failed[zone])
+                best[zone] = div;
+            else
+                failed[zone] = true;
+        }
+    }
+
+    // Zone 2 is the default, it is preferred if both reach the same divider
+    zone = (best[1] != 0 && (best[2] == 0 || best[1] < best[2])) ? 1 : 2;
+    if (best[zone] == 0) {
+        fprintf(stderr, "Error: No divider without errors\n");
+        rc = -EIO;
+        goto out;
+    }
+    profile.divider = (uint32_t)best[zone];
+    profile.zone = zone;
+    profile.sample_rate = adc_sample_rate(profile.divider);
+    profile.pattern = pattern;
+    profile.calibrated = (int64_t)time(NULL);
+    printf(
+        "Highest sample rate without errors: %.1f Hz (divider %u, zone %u)\n",
+        profile.sample_rate,
+        profile.divider,
+        profile.zone
+    );
+    rc = adc_profile_save(args->profile, &profile);
+    if (rc == 0)
+        printf("Saved profile to %s\n", args->profile);
+
+out:
+    signal(SIGINT, SIG_DFL);
+    close_dma_channel(&channel);
+    return rc;
+}
+
+// Open the raw path of the dual-stream variant and start the burst of --raw
+// before the trigger starts, such that it begins with the first conversion
+static int start_raw(
+    struct adc_raw *raw,
+    struct dmadc_channel *channel,
+    struct adc_arguments *args
+) {
+    int rc;
+
+    // Only the dual-stream variant has the second DMA channel, and only then
+    // are the registers of the raw path there
+    if (access(DMADC_RAW_DEVICE, F_OK) != 0) {
+        fprintf(
+            stderr,
+            "Error: --raw needs the dual-stream variant, '%s' is missing\n",
+            DMADC_RAW_DEVICE
+        );
+        return -ENODEV;
+    }
+    rc = open_dma_channel_path(channel, DMADC_RAW_DEVICE);
+    if (rc < 0)
+        return rc;
+    rc = open_adc_raw(raw);
+    if (rc < 0) {
+        close_dma_channel(channel);
+        return rc;
+    }
+    set_timeout_ms(channel, args->timeout_ms);
+    if (set_packetizer_packing(&raw->pack, false) < 0 ||
+        set_packetizer_header(&raw->pack, false) < 0 ||
+        capture_raw_start(raw, channel, args->raw) != DMADC_IN_PROGRESS) {
+        fprintf(stderr, "Error: Unable to start the raw burst\n");
+        close_adc_raw(raw);
+        close_dma_channel(channel);
+        return -EBUSY;
+    }
+    return 0;
+}
+
+// Wait for the burst started with 'start_raw()' and write it to --raw-output
+static void finish_raw(
+    struct adc_raw *raw,
+    struct dmadc_channel *channel,
+    struct adc_arguments *args
+) {
+    size_t bytes = capture_raw_bytes(raw, args->raw);
+    enum dmadc_status status;
+    FILE *file;
+
+    status = capture_raw_finish(raw, wait_for_transfer(channel));
+    if (status != DMADC_COMPLETE) {
+        fprintf(
+            stderr,
+            "Error: Raw DMA transfer exited with status %s\n",
+            dmadc_status_strings[get_status(channel)]
+        );
+    } else if (dmadc_mmap_buffer(channel, bytes) != 0) {
+        fprintf(stderr, "Error: Unable to map the raw buffer\n");
+    } else if ((file = fopen(args->raw_output, "w")) == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", args->raw_output);
+    } else {
+        fwrite(channel->buffer, 1, bytes, file);
+        fclose(file);
+        printf("Wrote %zu raw samples to %s\n", args->raw, args->raw_output);
+    }
+    close_dma_channel(channel);
+    close_adc_raw(raw);
+}
+
 int main(int argc, char *argv[]) {
     struct adc adc;
+    struct adc_raw raw;
+    struct dmadc_channel raw_channel;
     int rc;
     enum dmadc_status status;
     struct adc_arguments args;
+    struct adc_profile profile;
+    bool has_profile;
     FILE *outfile;
     args.info = false;
     args.shutdown = false;
     args.test = false;
-    args.div = DEFAULT_DIVIDER;
+    // Divider and zone are taken from the profile if not given
+    args.div = 0;
     args.avg = 0;
-    args.zone = 2;
+    args.zone = 0;
     args.output = DEFAULT_OUTPUT_FILE;
     args.timeout_ms = DEFAULT_TIMEOUT_MS;
     args.num = DEFAULT_NUM_SAMPLES;
+    args.pack = false;
+    args.header = false;
+    args.ddr = false;
+    args.echo = false;
+    args.stats = false;
+    args.hw_stats = 0;
+    args.hw_trigger = 0;
+    args.blocks = 1;
+    args.threads = 1;
+    args.rt = false;
+    args.rt_cpu = DEFAULT_RT_CPU;
+    args.rt_writer_cpu = DEFAULT_RT_WRITER_CPU;
+    args.rt_prio = DEFAULT_RT_PRIO;
+    args.rt_writer_prio = DEFAULT_RT_WRITER_PRIO;
+    args.rt_buffers = DEFAULT_RT_BUFFERS;
+    args.latency = NULL;
+    args.timestamps = NULL;
+    args.trace = NULL;
+    args.fanout = false;
+    args.send = NULL;
+    args.preview_ms = 0;
+    args.pool = DEFAULT_POOL_BLOCKS;
+    args.histogram = NULL;
+    args.snapshot = NULL;
+    args.snapshot_samples = ADC_SNAPSHOT_DEFAULT_SAMPLES;
+    args.detect = false;
+    args.detect_mode = ADC_DETECT_LEVEL;
+    args.threshold = DEFAULT_DETECT_THRESHOLD;
+    args.pre = DEFAULT_DETECT_PRE;
+    args.post = DEFAULT_DETECT_POST;
+    args.decimate = 0;
+    args.compensate = true;
+    args.raw = 0;
+    args.raw_output = DEFAULT_RAW_FILE;
+    args.calibrate = false;
+    args.profile = ADC_PROFILE_PATH;
+    args.cal_min_div = DEFAULT_CAL_MIN_DIVIDER;
+    args.cal_max_div = DEFAULT_CAL_MAX_DIVIDER;
     argp_parse(&argp, argc, argv, 0, 0, &args);
 
+    has_profile = adc_profile_load(args.profile, &profile) == 0;
+    if (args.div == 0)
+        args.div = has_profile ? profile.divider : DEFAULT_DIVIDER;
+    if (args.zone == 0)
+        args.zone = has_profile ? profile.zone : 2;
+    if (args.hw_trigger != 0) {
+        if (args.detect || args.hw_stats > 0 || args.decimate > 0 ||
+            args.test || args.calibrate) {
+            fprintf(
+                stderr,
+                "Error: --hw-trigger cannot be combined with --detect, "
+                "--hw-stats, --decimate, --test, or --calibrate\n"
+            );
+            exit(EINVAL);
+        }
+        // Every capture is a single window
+        args.num = args.pre + args.post;
+    }
+    if (args.pack) {
+        if (args.num % 4 != 0) {
+            fprintf(stderr, "Error: --pack needs a multiple of 4 samples\n");
+            exit(EINVAL);
+        }
+        if (args.test || args.avg > 0 || args.calibrate ||
+            (args.stats && !args.rt && !args.fanout)) {
+            fprintf(
+                stderr,
+                "Error: --pack cannot be combined with --test, --avg, "
+                "--calibrate, or --stats without --fanout\n"
+            );
+            exit(EINVAL);
+        }
+    } else if (args.num > MAX_NUM_SAMPLES) {
+        fprintf(
+            stderr,
+            "Error: Invalid number of samples %zu. Max: %zu\n",
+            args.num,
+            (size_t)MAX_NUM_SAMPLES
+        );
+        exit(EINVAL);
+    }
+    if (args.header &&
+        (!args.rt || capture_words(&args) > MAX_NUM_SAMPLES)) {
+        fprintf(
+            stderr,
+            "Error: --header needs --rt and room for the header in the DMA "
+            "buffer\n"
+        );
+        exit(EINVAL);
+    }
+    if (args.decimate > 0 &&
+        (args.test || args.avg > 0 || args.pack || args.calibrate)) {
+        fprintf(
+            stderr,
+            "Error: --decimate cannot be combined with --test, --avg, --pack, "
+            "or --calibrate\n"
+        );
+        exit(EINVAL);
+    }
+
+    if (args.raw > 0 && (args.info || args.shutdown || args.rt ||
+                         args.fanout || args.hw_stats > 0 || args.stats ||
+                         args.calibrate)) {
+        fprintf(
+            stderr,
+            "Error: --raw cannot be combined with --info, --shutdown, --rt, "
+            "--fanout, --hw-stats, --stats, or --calibrate\n"
+        );
+        exit(EINVAL);
+    }
+
+    if (args.trace != NULL) {
+        rc = trace_open(args.trace);
+        if (rc < 0) {
+            exit(-rc);
+        }
+        // The trace is also written if the program exits early
+        atexit(write_trace);
+        trace_thread_name("main");
+    }
+
     rc = open_adc(&adc);
     if (rc < 0) {
         exit(-rc);
     }
+    if (!args.shutdown && !args.info) {
+        if (set_packetizer_packing(&adc.pack, args.pack) < 0 ||
+            set_packetizer_header(&adc.pack, args.header) < 0) {
+            fprintf(stderr, "Error: Packetizer is busy\n");
+            close_adc(&adc);
+            exit(EBUSY);
+        }
+        set_decimator(&adc.decimator, args.decimate, args.compensate);
+        if (args.hw_trigger == 0) {
+            disable_event_trigger(&adc.event);
+        } else if (set_event_trigger(
+                       &adc.event,
+                       args.hw_trigger,
+                       hw_trigger_threshold(args.threshold),
+                       (uint32_t)args.pre,
+                       (uint32_t)args.post
+                   ) < 0) {
+            fprintf(
+                stderr,
+                "Error: --hw-trigger needs --post of at least 1 and --pre "
+                "below %u\n",
+                *adc.event.depth
+            );
+            close_adc(&adc);
+            exit(EINVAL);
+        }
+    }
 
     if (args.shutdown) {
         puts("Shutdown device, all other options are ignored.");
@@ -113,10 +1823,23 @@ int main(int argc, char *argv[]) {
         bool is_zone_1 = (bool)((*adc.trigger.config >> 2) & 1);
 
         uint32_t last_reg = get_adc_last_reg(&adc.config);
+        struct packetizer_perf perf;
         puts("ADC Status:");
         printf("adc_config transaction_active:  %s\n", yesno(trans_active));
         printf("adc_config reg_available:       %s\n", yesno(reg_available));
         printf("adc_config tvalid:              %s\n", yesno(tvalid));
+        printf(
+            "adc_config ddr:                 %s\n",
+            yesno(get_adc_ddr(&adc.config))
+        );
+        printf(
+            "adc_config echo:                %s\n",
+            yesno(get_adc_echo(&adc.config))
+        );
+        printf(
+            "adc_config echo_lost:           %s\n",
+            yesno(get_adc_echo_lost(&adc.config))
+        );
         printf("adc_config device_mode:         %s\n", dev_mode_str);
         printf("adc_config last_reg:            0x%X\n", last_reg);
         printf("adc_config config:              0x%X\n", *adc.config.config);
@@ -126,9 +1849,116 @@ int main(int argc, char *argv[]) {
             "packetizer packet counter:      %u\n", *adc.pack.packet_counter
         );
         printf("packetizer iter counter:        %u\n", *adc.pack.iter_counter);
+        printf(
+            "packetizer packing:             %s\n",
+            yesno(get_packetizer_packing(&adc.pack))
+        );
+        printf(
+            "packetizer header:              %s\n",
+            yesno(get_packetizer_header(&adc.pack))
+        );
+        printf(
+            "packetizer timestamp:           %llu\n",
+            (unsigned long long)get_packetizer_timestamp(&adc.pack)
+        );
+        get_packetizer_perf(&adc.pack, &perf);
+        printf(
+            "packetizer cycles:              %llu\n",
+            (unsigned long long)perf.cycles
+        );
+        printf(
+            "packetizer input beats:         %llu (%.2f %%)\n",
+            (unsigned long long)perf.in_beats,
+            100.0 * packetizer_perf_ratio(perf.in_beats, &perf)
+        );
+        printf(
+            "packetizer input stalls:        %llu (%.2f %%)\n",
+            (unsigned long long)perf.in_stalls,
+            100.0 * packetizer_perf_ratio(perf.in_stalls, &perf)
+        );
+        printf(
+            "packetizer output beats:        %llu (%.2f %%)\n",
+            (unsigned long long)perf.out_beats,
+            100.0 * packetizer_perf_ratio(perf.out_beats, &perf)
+        );
+        printf(
+            "packetizer output stalls:       %llu (%.2f %%)\n",
+            (unsigned long long)perf.out_stalls,
+            100.0 * packetizer_perf_ratio(perf.out_stalls, &perf)
+        );
+        printf(
+            "packetizer disabled pending:    %llu (%.2f %%)\n",
+            (unsigned long long)perf.disabled,
+            100.0 * packetizer_perf_ratio(perf.disabled, &perf)
+        );
+        printf(
+            "decimator ratio:                %u\n",
+            get_decimator_ratio(&adc.decimator)
+        );
+        printf(
+            "decimator compensate:           %s\n",
+            yesno(*adc.decimator.config & DECIMATOR_COMPENSATE)
+        );
+        printf("fifo level:                     %u\n", *adc.fifo.level);
+        printf("fifo depth:                     %u\n", *adc.fifo.depth);
+        printf("fifo high-water mark:           %u\n", *adc.fifo.high_water);
+        printf("fifo samples dropped:           %u\n", *adc.fifo.dropped);
+        printf("fifo overflows:                 %u\n", *adc.fifo.overflows);
+        printf("hw_stats window:                %u\n", *adc.hw_stats.window);
+        printf("hw_stats windows:               %u\n", *adc.hw_stats.snapshot);
+        printf(
+            "event_trigger state:            %s\n",
+            event_trigger_state_str(get_event_trigger_state(&adc.event))
+        );
+        printf("event_trigger events:           %u\n", *adc.event.events);
+        printf(
+            "event_trigger window:           %u + %u\n",
+            *adc.event.pre,
+            *adc.event.post
+        );
+        printf("event_trigger depth:            %u\n", *adc.event.depth);
         printf("adc_trigger config:             %s\n", trigger_config_str);
         printf("adc_trigger zone_1:             %s\n", yesno(is_zone_1));
         printf("adc_trigger divider:            %u\n", *adc.trigger.divider);
+        if (has_profile) {
+            printf(
+                "profile:                        divider %u, zone %u (%.1f "
+                "Hz)\n",
+                profile.divider,
+                profile.zone,
+                profile.sample_rate
+            );
+        }
+    } else if (args.rt) {
+        rc = run_rt(&adc, &args);
+        if (rc < 0) {
+            close_adc(&adc);
+            exit(-rc);
+        }
+    } else if (args.calibrate) {
+        rc = run_calibrate(&adc, &args);
+        if (rc < 0) {
+            close_adc(&adc);
+            exit(-rc);
+        }
+    } else if (args.fanout) {
+        rc = run_fanout(&adc, &args);
+        if (rc < 0) {
+            close_adc(&adc);
+            exit(-rc);
+        }
+    } else if (args.hw_stats > 0) {
+        rc = run_hw_stats(&adc, &args);
+        if (rc < 0) {
+            close_adc(&adc);
+            exit(-rc);
+        }
+    } else if (args.stats) {
+        rc = run_stats(&adc, &args);
+        if (rc < 0) {
+            close_adc(&adc);
+            exit(-rc);
+        }
     } else {
         outfile = fopen(args.output, "w");
         if (outfile == NULL) {
@@ -142,55 +1972,28 @@ int main(int argc, char *argv[]) {
             exit(-rc);
         }
 
-        // Enable power
-        *adc.config.config =
-            ADC_PWR_EN | ADC_IO_EN | ADC_REF_EN | ADC_DIFFAMP_EN | ADC_OPAMP_EN;
-        // Wait for power to stabilize
-        sleep(1);
-
-        // Configure ADC
-        write_adc_reg(&adc.config, ADC_REG_ENTER);
-        usleep(250 * 1000);
-        // Configure averages
-        write_adc_reg(
-            &adc.config, ADC_REG(0, ADC_REG_AVG, (uint8_t)(0x1F & args.avg))
-        );
-        usleep(250 * 1000);
-
-        uint8_t mode =
-            ADC_REG_MODE_4_LANE | ADC_REG_MODE_SPI_CLK | ADC_REG_MODE_SDR;
-        if (args.test) {
-            mode |= ADC_REG_MODE_TEST;
-        } else if (args.avg >= 1) {
-            mode |= ADC_REG_MODE_32BIT_AVG;
-        } else {
-            mode |= ADC_REG_MODE_32BIT_COM;
-        }
-        write_adc_reg(&adc.config, ADC_REG(0, ADC_REG_MODE_ADDR, mode));
-        write_adc_reg(&adc.config, ADC_REG(0, ADC_REG_OUT, ADC_REG_OUT_DOUBLE));
-        usleep(250 * 1000);
-        write_adc_reg(&adc.config, ADC_REG_EXIT);
-        usleep(250 * 1000);
-
-        // Configure trigger
-        // Restart trigger if in non-continous mode
-        *adc.trigger.config |= ADC_TRIGGER_CLEAR;
-        // Set trigger to non-continous
-        *adc.trigger.config &= ~ADC_TRIGGER_CONTINUOUS;
-
-        if (args.zone == 1) {
-            *adc.trigger.config |= ADC_TRIGGER_ZONE_1;
-        } else {
-            *adc.trigger.config &= ~ADC_TRIGGER_ZONE_1;
-        }
+        uint8_t mode = capture_mode(&args);
+        configure_adc(&adc, mode, (uint8_t)args.avg);
+        configure_adc_trigger(&adc.trigger, args.zone);
 
         set_timeout_ms(&channel, args.timeout_ms);
 
         // Configure packetizer and set up DMA
         set_packatizer_save(&adc.pack, args.num);
-        start_transfer(&channel, args.num * sizeof(uint32_t));
+        start_transfer(&channel, capture_bytes(&adc, args.num));
+        if (args.raw > 0) {
+            rc = start_raw(&raw, &raw_channel, &args);
+            if (rc < 0) {
+                close_dma_channel(&channel);
+                set_packatizer_save(&adc.pack, 0);
+                close_adc(&adc);
+                exit(-rc);
+            }
+        }
         // Start the trigger after a short wait
+        uint64_t t = trace_begin();
         usleep(250 * 1000);
+        trace_end("trigger_delay", t);
         puts("Start transfer");
         *adc.trigger.divider = args.div;
 
@@ -210,17 +2013,26 @@ int main(int argc, char *argv[]) {
                 );
                 break;
         }
-        rc = dmadc_mmap_buffer(&channel, args.num * sizeof(uint32_t));
+        rc = dmadc_mmap_buffer(&channel, capture_bytes(&adc, args.num));
         if (rc != 0) {
             fprintf(stderr, "Error: Unable to map buffer: Error %d\n", rc);
         } else {
             if (channel.buffer != NULL) {
-                fwrite(channel.buffer, sizeof(uint32_t), args.num, outfile);
+                t = trace_begin();
+                fwrite(
+                    channel.buffer, 1, capture_bytes(&adc, args.num), outfile
+                );
+                trace_end("fwrite", t);
             }
         }
+        t = trace_begin();
         fclose(outfile);
+        trace_end("fclose", t);
         puts("Close DMA channel");
         close_dma_channel(&channel);
+        if (args.raw > 0) {
+            finish_raw(&raw, &raw_channel, &args);
+        }
         *adc.trigger.divider = 0;
         set_packatizer_save(&adc.pack, 0);
     }
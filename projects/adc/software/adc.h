@@ -1,15 +1,77 @@
 #pragma once
 #include <argp.h>
+#include <detect.h>
 #include <dmadc.h>
+#include <profile.h>
 #include <stdbool.h>
 #include <stddef.h>
 
 #define DEFAULT_OUTPUT_FILE "out.dat"
+#define DEFAULT_RAW_FILE    "raw.dat"
 #define DEFAULT_DIVIDER     20
 #define DEFAULT_TIMEOUT_MS  10000
 #define DEFAULT_NUM_SAMPLES DMADC_BUFFER_SIZE / sizeof(uint32_t)
 #define MAX_NUM_SAMPLES     DMADC_BUFFER_SIZE / sizeof(uint32_t)
+// With --pack, four samples take three words of the DMA buffer
+#define MAX_PACKED_SAMPLES  (DMADC_BUFFER_SIZE / 12 * 4)
 #define MAX_NUM_AVG         0x10
+#define MAX_NUM_THREADS     16
+
+#define DEFAULT_RT_CPU         1
+#define DEFAULT_RT_WRITER_CPU  0
+#define DEFAULT_RT_PRIO        80
+#define DEFAULT_RT_WRITER_PRIO 70
+#define DEFAULT_RT_BUFFERS     4
+
+#define DEFAULT_POOL_BLOCKS 8
+
+#define DEFAULT_DETECT_THRESHOLD 1.0
+#define DEFAULT_DETECT_PRE       1024
+#define DEFAULT_DETECT_POST      4096
+#define MAX_DETECT_WINDOW        (1 << 24)
+
+#define DEFAULT_CAL_MIN_DIVIDER 16
+#define DEFAULT_CAL_MAX_DIVIDER 40
+#define MAX_CAL_SAMPLES         (1 << 20)
+// Blocks the lossy consumers of --fanout can fall behind before blocks are
+// dropped for them
+#define SEND_DEPTH     2
+#define PREVIEW_DEPTH  1
+#define SNAPSHOT_DEPTH 1
+
+// Keys of options without a short option
+enum adc_option_key {
+    OPT_RT_CPU = 0x100,
+    OPT_RT_WRITER_CPU,
+    OPT_RT_PRIO,
+    OPT_RT_WRITER_PRIO,
+    OPT_RT_BUFFERS,
+    OPT_LATENCY,
+    OPT_TRACE,
+    OPT_SEND,
+    OPT_PREVIEW,
+    OPT_POOL,
+    OPT_HISTOGRAM,
+    OPT_SNAPSHOT,
+    OPT_SNAPSHOT_SAMPLES,
+    OPT_PROFILE,
+    OPT_CAL_MIN_DIV,
+    OPT_CAL_MAX_DIV,
+    OPT_TIMESTAMPS,
+    OPT_DETECT,
+    OPT_THRESHOLD,
+    OPT_PRE,
+    OPT_POST,
+    OPT_DECIMATE,
+    OPT_NO_COMPENSATE,
+    OPT_HEADER,
+    OPT_DDR,
+    OPT_ECHO,
+    OPT_HW_STATS,
+    OPT_HW_TRIGGER,
+    OPT_RAW,
+    OPT_RAW_OUTPUT,
+};
 
 const char *argp_program_version = "adc 0.1.0";
 const char adc_docs[] =
@@ -17,17 +79,241 @@ const char adc_docs[] =
 const struct argp_option options[] = {
     {"info", 'i', 0, 0, "Read the current status registers"},
     {"shutdown", 's', 0, 0, "Shutdown ADC and disable power"},
-    {"div", 'd', "divider", 0, "Divider, defaults to 20"},
+    {"div",
+     'd',
+     "divider",
+     0,
+     "Divider, defaults to the profile of the board or 20"},
     {"avg", 'a', "averages", 0, "Averages, defaults to 0, max: 16"},
     {"timeout", 'w', "timeout_ms", 0, "Timeout, defaults to 10000"},
     {"test", 't', 0, 0, "Test pattern mode"},
-    {"zone", 'z', "zone", 0, "Zone, can be either 1 or 2, default to 2"},
+    {"zone",
+     'z',
+     "zone",
+     0,
+     "Zone, can be either 1 or 2, defaults to the profile of the board or 2"},
+    {"ddr",
+     OPT_DDR,
+     0,
+     0,
+     "Read the conversion results on both edges of the SPI clock (double "
+     "data rate), which takes half as long as the default single data rate"},
+    {"echo",
+     OPT_ECHO,
+     0,
+     0,
+     "Sample the conversion results with the echo clock of the ADC (SCKOUT) "
+     "at single data rate, independent of the round-trip delay"},
     {"output",
      'o',
      "file",
      0,
      "Output file for the data, defaults to " DEFAULT_OUTPUT_FILE},
     {"num", 'n', "count", 0, "Number of samples, defaults to 2048"},
+    {"pack",
+     'P',
+     0,
+     0,
+     "Capture 24-bit samples packed into three bytes each. The output file "
+     "holds four samples in every three words, '--num' has to be a multiple "
+     "of four"},
+    {"stats",
+     'S',
+     0,
+     0,
+     "Compute statistics and a code histogram instead of saving the data. "
+     "The histogram is written to the output file"},
+    {"hw-stats",
+     OPT_HW_STATS,
+     "samples",
+     0,
+     "Accumulate statistics over windows of 'samples' conversion results in "
+     "the FPGA instead of capturing them, for '--blocks' windows"},
+    {"blocks",
+     'b',
+     "count",
+     0,
+     "Number of blocks of '--num' samples for --stats, defaults to 1. "
+     "Zero runs until interrupted"},
+    {"threads",
+     'j',
+     "count",
+     0,
+     "Number of threads for --stats, defaults to 1"},
+    {"rt",
+     'r',
+     0,
+     0,
+     "Real-time mode: capture '--blocks' blocks with pinned SCHED_FIFO "
+     "acquisition and writer threads and locked memory"},
+    {"rt-cpu",
+     OPT_RT_CPU,
+     "cpu",
+     0,
+     "CPU of the acquisition thread in --rt mode, defaults to 1, -1 to not "
+     "pin the thread"},
+    {"rt-writer-cpu",
+     OPT_RT_WRITER_CPU,
+     "cpu",
+     0,
+     "CPU of the writer thread in --rt mode, defaults to 0"},
+    {"rt-prio",
+     OPT_RT_PRIO,
+     "priority",
+     0,
+     "SCHED_FIFO priority of the acquisition thread, defaults to 80, 0 to "
+     "keep the default policy"},
+    {"rt-writer-prio",
+     OPT_RT_WRITER_PRIO,
+     "priority",
+     0,
+     "SCHED_FIFO priority of the writer thread, defaults to 70"},
+    {"rt-buffers",
+     OPT_RT_BUFFERS,
+     "count",
+     0,
+     "Number of blocks buffered for the writer thread, defaults to 4"},
+    {"latency",
+     OPT_LATENCY,
+     "file",
+     0,
+     "Write the wake-up latency histogram of --rt mode to file"},
+    {"header",
+     OPT_HEADER,
+     0,
+     0,
+     "Have the packetizer start every block of --rt mode with a header "
+     "(sequence number and adc_clk timestamp). The headers are verified and "
+     "kept in the output file"},
+    {"timestamps",
+     OPT_TIMESTAMPS,
+     "file",
+     0,
+     "Write the CLOCK_REALTIME time of the first sample and the sample period "
+     "of every block of --rt or --fanout mode to file"},
+    {"fanout",
+     'F',
+     0,
+     0,
+     "Fan-out mode: capture '--blocks' blocks and hand every block to the "
+     "enabled consumers: the output file, --send, --stats, --preview, and "
+     "--snapshot"},
+    {"send",
+     OPT_SEND,
+     "host:port",
+     0,
+     "Send the blocks of --fanout mode over TCP, blocks are dropped if the "
+     "connection cannot keep up"},
+    {"preview",
+     OPT_PREVIEW,
+     "interval_ms",
+     0,
+     "Print the mean, minimum, and maximum of a block every interval in "
+     "--fanout mode"},
+    {"pool",
+     OPT_POOL,
+     "count",
+     0,
+     "Number of blocks buffered in --fanout mode, defaults to 8"},
+    {"histogram",
+     OPT_HISTOGRAM,
+     "file",
+     0,
+     "Write the histogram of --stats in --fanout mode to file"},
+    {"snapshot",
+     OPT_SNAPSHOT,
+     "name",
+     0,
+     "Publish the most recent samples of --fanout mode (in volts) to the "
+     "POSIX shared memory 'name' for 'adc-view', e.g. /adc-snapshot"},
+    {"snapshot-samples",
+     OPT_SNAPSHOT_SAMPLES,
+     "count",
+     0,
+     "Number of samples in the --snapshot window, defaults to 4096"},
+    {"detect",
+     OPT_DETECT,
+     "mode",
+     0,
+     "Only write windows around events to the output file in --fanout mode. "
+     "Modes: 'level' (crossing of --threshold), 'slope' (difference of "
+     "consecutive samples of at least --threshold), 'deviation' (distance "
+     "from the running mean of at least --threshold)"},
+    {"threshold",
+     OPT_THRESHOLD,
+     "volts",
+     0,
+     "Threshold of --detect, defaults to 1.0"},
+    {"pre",
+     OPT_PRE,
+     "samples",
+     0,
+     "Samples before the trigger in a --detect window, defaults to 1024"},
+    {"post",
+     OPT_POST,
+     "samples",
+     0,
+     "Samples from the trigger on in a --detect window, defaults to 4096"},
+    {"hw-trigger",
+     OPT_HW_TRIGGER,
+     "mode",
+     0,
+     "Capture a window of --pre and --post samples around an event found by "
+     "the FPGA instead of --num samples. Modes: 'level' (crossing of "
+     "--threshold), 'rising', 'falling' (crossing in one direction), 'slope' "
+     "(difference of consecutive samples of at least --threshold)"},
+    {"decimate",
+     OPT_DECIMATE,
+     "ratio",
+     0,
+     "Decimate in the FPGA by a power of two up to 1024 (CIC filter with "
+     "droop compensation). '--num' counts decimated samples, which are "
+     "signed 32-bit words with 8 more bits of resolution"},
+    {"no-compensate",
+     OPT_NO_COMPENSATE,
+     0,
+     0,
+     "Skip the droop compensation of --decimate"},
+    {"raw",
+     OPT_RAW,
+     "count",
+     0,
+     "Dual-stream variant only: capture a burst of this many raw conversion "
+     "results on the second DMA channel along with the capture"},
+    {"raw-output",
+     OPT_RAW_OUTPUT,
+     "file",
+     0,
+     "Output file of --raw, defaults to " DEFAULT_RAW_FILE},
+    {"calibrate",
+     'C',
+     0,
+     0,
+     "Capture the test pattern for every divider from --cal-max-div down to "
+     "--cal-min-div in both zones and save the highest sample rate without "
+     "errors to the profile. At most 1M samples of --num are captured per "
+     "setting"},
+    {"profile",
+     OPT_PROFILE,
+     "file",
+     0,
+     "Profile of the board, defaults to " ADC_PROFILE_PATH},
+    {"cal-min-div",
+     OPT_CAL_MIN_DIV,
+     "divider",
+     0,
+     "Lowest divider of --calibrate, defaults to 16"},
+    {"cal-max-div",
+     OPT_CAL_MAX_DIV,
+     "divider",
+     0,
+     "Highest divider of --calibrate, defaults to 40"},
+    {"trace",
+     OPT_TRACE,
+     "file",
+     0,
+     "Record spans of the acquisition and write them to file as Chrome trace "
+     "JSON (chrome://tracing, ui.perfetto.dev)"},
     {0}
 };
 
@@ -39,8 +325,49 @@ struct adc_arguments {
     bool test;
     char *output;
     size_t num;
+    bool pack;
+    bool header;
     unsigned int timeout_ms;
     unsigned int zone;
+    bool ddr;
+    bool echo;
+    bool stats;
+    uint32_t hw_stats;
+    // 'EVENT_TRIGGER_*' flags of --hw-trigger, zero without it
+    uint32_t hw_trigger;
+    size_t blocks;
+    unsigned int threads;
+    bool rt;
+    int rt_cpu;
+    int rt_writer_cpu;
+    int rt_prio;
+    int rt_writer_prio;
+    size_t rt_buffers;
+    char *latency;
+    char *timestamps;
+    char *trace;
+    bool fanout;
+    char *send;
+    unsigned int preview_ms;
+    size_t pool;
+    char *histogram;
+    char *snapshot;
+    size_t snapshot_samples;
+    bool detect;
+    enum adc_detect_mode detect_mode;
+    double threshold;
+    size_t pre;
+    size_t post;
+    // log2 of the decimation ratio, 0 without decimation
+    unsigned int decimate;
+    bool compensate;
+    // Raw samples of --raw, 0 without it
+    size_t raw;
+    char *raw_output;
+    bool calibrate;
+    char *profile;
+    size_t cal_min_div;
+    size_t cal_max_div;
 };
 
 static error_t parse_args(int key, char *arg, struct argp_state *state);
@@ -1,20 +1,37 @@
 #include "adcctl.h"
+#include "trace.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
+// Map the AXI4-Lite register space. If 'fd' is negative, anonymous memory is
+// mapped instead, which serves as a stand-in register file when running
+// without hardware.
+static uint32_t *map_registers(int fd, size_t size) {
+    void *regs;
+    if (fd < 0) {
+        regs = mmap(
+            NULL,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        );
+    } else {
+        regs = mmap(
+            NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, ADC_CONFIG_ADDR
+        );
+    }
+    return (uint32_t *)regs;
+}
+
 int open_adc_config(int fd, struct adc_config *config) {
-    config->_mmap = mmap(
-        NULL,
-        ADC_CONFIG_ADDR_RANGE,
-        PROT_READ | PROT_WRITE,
-        MAP_SHARED,
-        fd,
-        ADC_CONFIG_ADDR
-    );
+    config->_mmap = map_registers(fd, ADC_CONFIG_ADDR_RANGE);
     if (config->_mmap == MAP_FAILED) {
         fprintf(stderr, "Unable to map memory for ADC config register\n");
         return -errno;
@@ -25,38 +42,34 @@ int open_adc_config(int fd, struct adc_config *config) {
     return 0;
 }
 
-int open_packetizer(int fd, struct packetizer *pack) {
-    unsigned int offset = PACKETIZER_ADDR - ADC_CONFIG_ADDR;
-    pack->_mmap = mmap(
-        NULL,
-        offset + PACKETIZER_ADDR_RANGE,
-        PROT_READ | PROT_WRITE,
-        MAP_SHARED,
-        fd,
-        ADC_CONFIG_ADDR
-    );
+// Map the registers of the packetizer at 'addr', the one of the conversion
+// results or the one of the raw path in the dual-stream variant
+static int open_packetizer_at(int fd, struct packetizer *pack, uint32_t addr) {
+    unsigned int offset = addr - ADC_CONFIG_ADDR;
+    pack->_mmap = map_registers(fd, offset + PACKETIZER_ADDR_RANGE);
     if (pack->_mmap == MAP_FAILED) {
         fprintf(stderr, "Unable to map memory for packetizer register\n");
         return -errno;
     }
     pack->config = &pack->_mmap[(offset / sizeof(uint32_t)) + 0];
     pack->packet_counter = &pack->_mmap[(offset / sizeof(uint32_t)) + 1];
-    pack->iter_counter =
-        (uint16_t *)(&pack->_mmap[(offset / sizeof(uint32_t)) + 2]);
+    pack->iter_counter = &pack->_mmap[(offset / sizeof(uint32_t)) + 2];
+    pack->packing = &pack->_mmap[(offset / sizeof(uint32_t)) + 3];
+    pack->timestamp_low = &pack->_mmap[(offset / sizeof(uint32_t)) + 4];
+    pack->timestamp_high = &pack->_mmap[(offset / sizeof(uint32_t)) + 5];
+    pack->perf_control = &pack->_mmap[(offset / sizeof(uint32_t)) + 6];
+    pack->perf = &pack->_mmap[(offset / sizeof(uint32_t)) + 7];
     return 0;
 }
 
+int open_packetizer(int fd, struct packetizer *pack) {
+    return open_packetizer_at(fd, pack, PACKETIZER_ADDR);
+}
+
 int open_adc_trigger(int fd, struct adc_trigger *trigger) {
     unsigned int offset = ADC_TRIGGER_ADDR - ADC_CONFIG_ADDR;
-    trigger->_mmap = mmap(
-        NULL,
-        offset + ADC_TRIGGER_ADDR_RANGE,
-        PROT_READ | PROT_WRITE,
-        MAP_SHARED,
-        fd,
-        ADC_CONFIG_ADDR
-    );
-    if (trigger->config == MAP_FAILED) {
+    trigger->_mmap = map_registers(fd, offset + ADC_TRIGGER_ADDR_RANGE);
+    if (trigger->_mmap == MAP_FAILED) {
         fprintf(stderr, "Unable to map memory for ADC trigger register\n");
         return -errno;
     }
@@ -65,24 +78,179 @@ int open_adc_trigger(int fd, struct adc_trigger *trigger) {
     return 0;
 }
 
-int open_adc(struct adc *adc) {
-    int rc, fd;
-    fd = open("/dev/mem", O_RDWR);
+int open_decimator(int fd, struct decimator *decimator) {
+    unsigned int offset = DECIMATOR_ADDR - ADC_CONFIG_ADDR;
+    decimator->_mmap = map_registers(fd, offset + DECIMATOR_ADDR_RANGE);
+    if (decimator->_mmap == MAP_FAILED) {
+        fprintf(stderr, "Unable to map memory for decimator register\n");
+        return -errno;
+    }
+    decimator->config = &decimator->_mmap[(offset / sizeof(uint32_t)) + 0];
+    decimator->taps =
+        (int32_t *)(&decimator->_mmap[(offset / sizeof(uint32_t)) + 16]);
+    return 0;
+}
+
+static int open_adc_fifo_at(int fd, struct adc_fifo *fifo, uint32_t addr) {
+    unsigned int offset = addr - ADC_CONFIG_ADDR;
+    fifo->_mmap = map_registers(fd, offset + ADC_FIFO_ADDR_RANGE);
+    if (fifo->_mmap == MAP_FAILED) {
+        fprintf(stderr, "Unable to map memory for ADC FIFO register\n");
+        return -errno;
+    }
+    fifo->control = &fifo->_mmap[(offset / sizeof(uint32_t)) + 0];
+    fifo->level = &fifo->_mmap[(offset / sizeof(uint32_t)) + 1];
+    fifo->high_water = &fifo->_mmap[(offset / sizeof(uint32_t)) + 2];
+    fifo->dropped = &fifo->_mmap[(offset / sizeof(uint32_t)) + 3];
+    fifo->overflows = &fifo->_mmap[(offset / sizeof(uint32_t)) + 4];
+    fifo->depth = &fifo->_mmap[(offset / sizeof(uint32_t)) + 5];
+    return 0;
+}
+
+int open_adc_fifo(int fd, struct adc_fifo *fifo) {
+    return open_adc_fifo_at(fd, fifo, ADC_FIFO_ADDR);
+}
+
+int open_adc_hw_stats(int fd, struct adc_hw_stats *stats) {
+    unsigned int offset = ADC_HW_STATS_ADDR - ADC_CONFIG_ADDR;
+    stats->_mmap = map_registers(fd, offset + ADC_HW_STATS_ADDR_RANGE);
+    if (stats->_mmap == MAP_FAILED) {
+        fprintf(stderr, "Unable to map memory for ADC statistics register\n");
+        return -errno;
+    }
+    stats->control = &stats->_mmap[(offset / sizeof(uint32_t)) + 0];
+    stats->window = &stats->_mmap[(offset / sizeof(uint32_t)) + 1];
+    stats->snapshot = &stats->_mmap[(offset / sizeof(uint32_t)) + 2];
+    return 0;
+}
+
+int open_event_trigger(int fd, struct event_trigger *event) {
+    unsigned int offset = EVENT_TRIGGER_ADDR - ADC_CONFIG_ADDR;
+    event->_mmap = map_registers(fd, offset + EVENT_TRIGGER_ADDR_RANGE);
+    if (event->_mmap == MAP_FAILED) {
+        fprintf(stderr, "Unable to map memory for event trigger register\n");
+        return -errno;
+    }
+    event->config = &event->_mmap[(offset / sizeof(uint32_t)) + 0];
+    event->threshold =
+        (int32_t *)(&event->_mmap[(offset / sizeof(uint32_t)) + 1]);
+    event->pre = &event->_mmap[(offset / sizeof(uint32_t)) + 2];
+    event->post = &event->_mmap[(offset / sizeof(uint32_t)) + 3];
+    event->status = &event->_mmap[(offset / sizeof(uint32_t)) + 4];
+    event->events = &event->_mmap[(offset / sizeof(uint32_t)) + 5];
+    event->depth = &event->_mmap[(offset / sizeof(uint32_t)) + 6];
+    return 0;
+}
+
+// Maps all register blocks. On error, the blocks mapped so far are unmapped
+// again, 'close_adc()' must not be called.
+static int open_adc_fd(int fd, struct adc *adc) {
+    int rc;
     rc = open_adc_config(fd, &adc->config);
     if (rc < 0) {
-        close(fd);
         return rc;
     }
     rc = open_packetizer(fd, &adc->pack);
     if (rc < 0) {
-        close(fd);
-        return rc;
+        goto exit_config;
     }
     rc = open_adc_trigger(fd, &adc->trigger);
+    if (rc < 0) {
+        goto exit_packetizer;
+    }
+    rc = open_decimator(fd, &adc->decimator);
+    if (rc < 0) {
+        goto exit_trigger;
+    }
+    rc = open_adc_fifo(fd, &adc->fifo);
+    if (rc < 0) {
+        goto exit_decimator;
+    }
+    rc = open_adc_hw_stats(fd, &adc->hw_stats);
+    if (rc < 0) {
+        goto exit_fifo;
+    }
+    rc = open_event_trigger(fd, &adc->event);
+    if (rc < 0) {
+        goto exit_hw_stats;
+    }
+    return 0;
+
+exit_hw_stats:
+    close_adc_hw_stats(&adc->hw_stats);
+exit_fifo:
+    close_adc_fifo(&adc->fifo);
+exit_decimator:
+    close_decimator(&adc->decimator);
+exit_trigger:
+    close_adc_trigger(&adc->trigger);
+exit_packetizer:
+    close_packetizer(&adc->pack);
+exit_config:
+    close_adc_config(&adc->config);
+    return rc;
+}
+
+int open_adc(struct adc *adc) {
+    int rc, fd;
+    uint64_t t = trace_begin();
+    fd = open("/dev/mem", O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to open '/dev/mem'\n");
+        return -errno;
+    }
+    rc = open_adc_fd(fd, adc);
     close(fd);
+    trace_end("open_adc", t);
+    return rc;
+}
+
+int open_adc_sim(struct adc *adc) {
+    // Each register block gets its own anonymous mapping. Unlike '/dev/mem',
+    // the blocks do not alias each other, which is fine as every block only
+    // accesses its own offsets.
+    return open_adc_fd(-1, adc);
+}
+
+static int open_adc_raw_fd(int fd, struct adc_raw *raw) {
+    int rc;
+    unsigned int offset = ADC_RAW_FIFO_ADDR - ADC_CONFIG_ADDR;
+    rc = open_adc_fifo_at(fd, &raw->fifo, ADC_RAW_FIFO_ADDR);
     if (rc < 0) {
         return rc;
     }
+    rc = open_packetizer_at(fd, &raw->pack, ADC_RAW_PACKETIZER_ADDR);
+    if (rc < 0) {
+        // Like 'open_adc_fd()', 'close_adc_raw()' must not be called
+        munmap(raw->fifo._mmap, offset + ADC_FIFO_ADDR_RANGE);
+    }
+    return rc;
+}
+
+// Map the raw path of the dual-stream variant. Its registers only exist in
+// that variant, accessing them otherwise is a bus error. Check for
+// 'DMADC_RAW_DEVICE' first.
+int open_adc_raw(struct adc_raw *raw) {
+    int rc, fd;
+    fd = open("/dev/mem", O_RDWR);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to open '/dev/mem'\n");
+        return -errno;
+    }
+    rc = open_adc_raw_fd(fd, raw);
+    close(fd);
+    return rc;
+}
+
+int open_adc_raw_sim(struct adc_raw *raw) {
+    return open_adc_raw_fd(-1, raw);
+}
+
+int close_adc_raw(struct adc_raw *raw) {
+    unsigned int offset = ADC_RAW_FIFO_ADDR - ADC_CONFIG_ADDR;
+    munmap(raw->fifo._mmap, offset + ADC_FIFO_ADDR_RANGE);
+    offset = ADC_RAW_PACKETIZER_ADDR - ADC_CONFIG_ADDR;
+    munmap(raw->pack._mmap, offset + PACKETIZER_ADDR_RANGE);
     return 0;
 }
 
@@ -90,6 +258,10 @@ int close_adc(struct adc *adc) {
     close_adc_config(&adc->config);
     close_packetizer(&adc->pack);
     close_adc_trigger(&adc->trigger);
+    close_decimator(&adc->decimator);
+    close_adc_fifo(&adc->fifo);
+    close_adc_hw_stats(&adc->hw_stats);
+    close_event_trigger(&adc->event);
     return 0;
 }
 
@@ -110,6 +282,30 @@ int close_adc_trigger(struct adc_trigger *trigger) {
     return 0;
 }
 
+int close_decimator(struct decimator *decimator) {
+    unsigned int offset = DECIMATOR_ADDR - ADC_CONFIG_ADDR;
+    munmap(decimator->_mmap, offset + DECIMATOR_ADDR_RANGE);
+    return 0;
+}
+
+int close_adc_fifo(struct adc_fifo *fifo) {
+    unsigned int offset = ADC_FIFO_ADDR - ADC_CONFIG_ADDR;
+    munmap(fifo->_mmap, offset + ADC_FIFO_ADDR_RANGE);
+    return 0;
+}
+
+int close_adc_hw_stats(struct adc_hw_stats *stats) {
+    unsigned int offset = ADC_HW_STATS_ADDR - ADC_CONFIG_ADDR;
+    munmap(stats->_mmap, offset + ADC_HW_STATS_ADDR_RANGE);
+    return 0;
+}
+
+int close_event_trigger(struct event_trigger *event) {
+    unsigned int offset = EVENT_TRIGGER_ADDR - ADC_CONFIG_ADDR;
+    munmap(event->_mmap, offset + EVENT_TRIGGER_ADDR_RANGE);
+    return 0;
+}
+
 void write_adc_reg(struct adc_config *config, uint32_t data) {
     *(config->adc_reg) = data;
 }
@@ -129,6 +325,23 @@ bool get_adc_tvalid(struct adc_config *config) {
     return (bool)(*(config->status) & (1 << 4));
 }
 
+// Set if 'adc_manager' reads out the conversion results at double data rate,
+// as configured with the mode register of the ADC
+bool get_adc_ddr(struct adc_config *config) {
+    return (bool)(*(config->status) & (1 << 5));
+}
+
+// Set if 'adc_manager' samples the conversion results with the echo clock
+bool get_adc_echo(struct adc_config *config) {
+    return (bool)(*(config->status) & (1 << 6));
+}
+
+// Set if a conversion result was lost in echo clock mode because the echo
+// clock did not arrive in time, cleared by writing the mode register
+bool get_adc_echo_lost(struct adc_config *config) {
+    return (bool)(*(config->status) & (1 << 7));
+}
+
 uint8_t get_adc_device_mode(struct adc_config *config) {
     // Shift by two bits to the right and apply a mask of 0b11
     return (uint8_t)((*(config->status) >> 2) & 3);
@@ -152,3 +365,310 @@ int set_packatizer_save(struct packetizer *pack, uint32_t value) {
     *pack->config = value;
     return 0;
 }
+
+// Set or clear 'flag' of the packing register. Like the config register, it
+// can only be changed between packets.
+static int set_packetizer_flag(
+    struct packetizer *pack, uint32_t flag, bool enable
+) {
+    uint32_t value =
+        enable ? (*pack->packing | flag) : (*pack->packing & ~flag);
+    if (*pack->packing == value)
+        return 0;
+    if (*pack->packet_counter != 0)
+        return -1;
+    *pack->packing = value;
+    return 0;
+}
+
+// Enable or disable packing of the 24-bit output modes
+int set_packetizer_packing(struct packetizer *pack, bool enable) {
+    return set_packetizer_flag(pack, PACKETIZER_PACK, enable);
+}
+
+bool get_packetizer_packing(struct packetizer *pack) {
+    return (*pack->packing & PACKETIZER_PACK) != 0;
+}
+
+// Enable or disable the block header at the start of every packet
+int set_packetizer_header(struct packetizer *pack, bool enable) {
+    return set_packetizer_flag(pack, PACKETIZER_HEADER, enable);
+}
+
+bool get_packetizer_header(struct packetizer *pack) {
+    return (*pack->packing & PACKETIZER_HEADER) != 0;
+}
+
+uint64_t get_packetizer_timestamp(struct packetizer *pack) {
+    // The lower half has to be read first
+    uint64_t low = *(volatile uint32_t *)pack->timestamp_low;
+    uint64_t high = *(volatile uint32_t *)pack->timestamp_high;
+    return (high << 32) | low;
+}
+
+// Restart the performance counters from zero. Unlike the other registers of
+// the packetizer, this works in the middle of a packet.
+void clear_packetizer_perf(struct packetizer *pack) {
+    *(volatile uint32_t *)pack->perf_control = PACKETIZER_PERF_CLEAR;
+}
+
+static uint64_t read_perf_counter(volatile uint32_t *counters, int index) {
+    uint64_t low = counters[2 * index];
+    uint64_t high = counters[2 * index + 1];
+    return (high << 32) | low;
+}
+
+// Read the performance counters, all at the same cycle
+void get_packetizer_perf(
+    struct packetizer *pack, struct packetizer_perf *perf
+) {
+    volatile uint32_t *counters = pack->perf;
+    *(volatile uint32_t *)pack->perf_control = PACKETIZER_PERF_SNAPSHOT;
+    perf->cycles = read_perf_counter(counters, 0);
+    perf->in_beats = read_perf_counter(counters, 1);
+    perf->in_stalls = read_perf_counter(counters, 2);
+    perf->out_beats = read_perf_counter(counters, 3);
+    perf->out_stalls = read_perf_counter(counters, 4);
+    perf->disabled = read_perf_counter(counters, 5);
+}
+
+// Fraction of the counted cycles, zero if none were counted
+double packetizer_perf_ratio(
+    uint64_t count, const struct packetizer_perf *perf
+) {
+    if (perf->cycles == 0)
+        return 0.0;
+    return (double)count / perf->cycles;
+}
+
+// Decimate by 2^log2_ratio, zero bypasses the decimator. Setting the ratio
+// also clears the filters.
+void set_decimator(
+    struct decimator *decimator, unsigned int log2_ratio, bool compensate
+) {
+    if (log2_ratio > DECIMATOR_MAX_LOG2_RATIO)
+        log2_ratio = DECIMATOR_MAX_LOG2_RATIO;
+    *decimator->config =
+        (uint32_t)log2_ratio | (compensate ? DECIMATOR_COMPENSATE : 0);
+}
+
+// Start the filters over, such that the samples of a previous capture do
+// not leak into the next one
+void clear_decimator(struct decimator *decimator) {
+    uint32_t value = *decimator->config;
+    // Any write clears, the compiler must not drop it
+    *(volatile uint32_t *)decimator->config = value;
+}
+
+unsigned int get_decimator_ratio(struct decimator *decimator) {
+    unsigned int log2_ratio = *decimator->config & DECIMATOR_LOG2_RATIO;
+    if (log2_ratio > DECIMATOR_MAX_LOG2_RATIO)
+        log2_ratio = DECIMATOR_MAX_LOG2_RATIO;
+    return 1u << log2_ratio;
+}
+
+// Drop the samples left in the FIFO, such that a capture starts with the
+// conversions triggered after it started
+void flush_adc_fifo(struct adc_fifo *fifo) {
+    *(volatile uint32_t *)fifo->control = ADC_FIFO_FLUSH;
+}
+
+// Reset the high-water mark and the dropped samples and overflows
+void clear_adc_fifo_counters(struct adc_fifo *fifo) {
+    *(volatile uint32_t *)fifo->control = ADC_FIFO_CLEAR;
+}
+
+// Accumulate windows of 'samples' conversion results, zero stops the
+// accumulation. The current window is discarded.
+void set_adc_hw_stats_window(struct adc_hw_stats *stats, uint32_t samples) {
+    *(volatile uint32_t *)stats->window = samples;
+}
+
+// Read the results of the last window that ended. The snapshot is frozen
+// while it is read, such that all registers belong to the same window.
+// Returns -EAGAIN if no window ended yet.
+int get_adc_hw_stats(
+    struct adc_hw_stats *stats, struct adc_hw_stats_window *window
+) {
+    volatile uint32_t *snapshot = stats->snapshot;
+    *(volatile uint32_t *)stats->control = ADC_HW_STATS_FREEZE;
+    window->sequence = snapshot[0];
+    window->count = snapshot[1];
+    window->sum = (int64_t)(((uint64_t)snapshot[3] << 32) | snapshot[2]);
+    window->sum_sq_low = ((uint64_t)snapshot[5] << 32) | snapshot[4];
+    window->sum_sq_high = snapshot[6];
+    window->min = (int32_t)snapshot[7];
+    window->max = (int32_t)snapshot[8];
+    *(volatile uint32_t *)stats->control = 0;
+    if (window->sequence == 0 || window->count == 0)
+        return -EAGAIN;
+    return 0;
+}
+
+double adc_hw_stats_mean(const struct adc_hw_stats_window *window) {
+    if (window->count == 0)
+        return 0.0;
+    return (double)window->sum / window->count;
+}
+
+// Standard deviation of the samples of the window. The variance is computed
+// from the sums, which loses precision for a large offset, but not at the
+// 24 bits of the conversion results.
+double adc_hw_stats_stddev(const struct adc_hw_stats_window *window) {
+    double mean = adc_hw_stats_mean(window);
+    double sum_sq;
+    double variance;
+
+    if (window->count == 0)
+        return 0.0;
+    sum_sq = ldexp((double)window->sum_sq_high, 64) +
+             (double)window->sum_sq_low;
+    variance = sum_sq / window->count - mean * mean;
+    return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+// Only forward windows of 'pre' + 'post' samples around the samples that hit
+// 'threshold' as selected by 'flags' (EVENT_TRIGGER_RISING, ...). The
+// trigger is armed, the packetizer has to be set to packets of 'pre' +
+// 'post' samples. Returns -EINVAL if the window does not fit the buffer of
+// the trigger.
+int set_event_trigger(
+    struct event_trigger *event,
+    uint32_t flags,
+    int32_t threshold,
+    uint32_t pre,
+    uint32_t post
+) {
+    if (pre >= *event->depth || post == 0)
+        return -EINVAL;
+    *event->config = 0;
+    *event->threshold = threshold;
+    *event->pre = pre;
+    *event->post = post;
+    *(volatile uint32_t *)event->config = flags | EVENT_TRIGGER_ARM;
+    return 0;
+}
+
+// Pass all samples through
+void disable_event_trigger(struct event_trigger *event) {
+    *event->config = 0;
+}
+
+// Arm the trigger again for the next window if it is enabled, dropping the
+// history collected so far
+void rearm_event_trigger(struct event_trigger *event) {
+    uint32_t config = *event->config;
+    if (config & EVENT_TRIGGER_ARM)
+        *(volatile uint32_t *)event->config = config;
+}
+
+uint32_t get_event_trigger_state(struct event_trigger *event) {
+    return *event->status & 3;
+}
+
+// Forward the conversion results unchanged, one per word and without block
+// headers, which is what everything but 'adc --pack', 'adc --decimate', and
+// 'adc --header' expects. Returns -1 if the packetizer is in the middle of a
+// packet.
+int reset_adc_datapath(struct adc *adc) {
+    set_decimator(&adc->decimator, 0, false);
+    disable_event_trigger(&adc->event);
+    if (set_packetizer_header(&adc->pack, false) < 0)
+        return -1;
+    return set_packetizer_packing(&adc->pack, false);
+}
+
+uint8_t adc_default_mode(bool test, uint8_t avg) {
+    // Single data rate, 'ADC_REG_MODE_DDR' halves the read-out time of a
+    // conversion where the board allows it
+    uint8_t mode =
+        ADC_REG_MODE_4_LANE | ADC_REG_MODE_SPI_CLK | ADC_REG_MODE_SDR;
+    if (test) {
+        mode |= ADC_REG_MODE_TEST;
+    } else if (avg >= 1) {
+        mode |= ADC_REG_MODE_32BIT_AVG;
+    } else {
+        mode |= ADC_REG_MODE_32BIT_COM;
+    }
+    return mode;
+}
+
+// Wait for the ADC to process a register access
+static void adc_reg_wait(void) {
+    uint64_t t = trace_begin();
+    usleep(250 * 1000);
+    trace_end("adc_reg_wait", t);
+}
+
+int configure_adc(struct adc *adc, uint8_t mode, uint8_t avg) {
+    uint64_t t = trace_begin(), t_power;
+    // Enable power
+    *adc->config.config =
+        ADC_PWR_EN | ADC_IO_EN | ADC_REF_EN | ADC_DIFFAMP_EN | ADC_OPAMP_EN;
+    // Wait for power to stabilize
+    t_power = trace_begin();
+    sleep(1);
+    trace_end("power_up_wait", t_power);
+
+    // Configure ADC
+    write_adc_reg(&adc->config, ADC_REG_ENTER);
+    adc_reg_wait();
+    // Configure averages
+    write_adc_reg(&adc->config, ADC_REG(0, ADC_REG_AVG, (uint8_t)(0x1F & avg)));
+    adc_reg_wait();
+    write_adc_reg(&adc->config, ADC_REG(0, ADC_REG_MODE_ADDR, mode));
+    write_adc_reg(&adc->config, ADC_REG(0, ADC_REG_OUT, ADC_REG_OUT_DOUBLE));
+    adc_reg_wait();
+    write_adc_reg(&adc->config, ADC_REG_EXIT);
+    adc_reg_wait();
+    trace_end("configure_adc", t);
+    return 0;
+}
+
+// Set the pattern that is output in 'ADC_REG_MODE_TEST'. The ADC has to be
+// powered up by 'configure_adc()' first.
+void configure_adc_test_pattern(struct adc *adc, uint32_t pattern) {
+    uint64_t t = trace_begin();
+    write_adc_reg(&adc->config, ADC_REG_ENTER);
+    adc_reg_wait();
+    for (uint32_t i = 0; i < 4; i++) {
+        // 'ADC_REG()' does not parenthesize its arguments
+        uint32_t addr = ADC_REG_TEST_PAT + i;
+        write_adc_reg(
+            &adc->config, ADC_REG(0, addr, (uint8_t)(pattern >> (8 * i)))
+        );
+        adc_reg_wait();
+    }
+    write_adc_reg(&adc->config, ADC_REG_EXIT);
+    adc_reg_wait();
+    trace_end("configure_adc_test_pattern", t);
+}
+
+void configure_adc_trigger(struct adc_trigger *trigger, unsigned int zone) {
+    uint64_t t = trace_begin();
+    // Restart trigger if in non-continous mode
+    *trigger->config |= ADC_TRIGGER_CLEAR;
+    // Set trigger to non-continous
+    *trigger->config &= ~ADC_TRIGGER_CONTINUOUS;
+
+    if (zone == 1) {
+        *trigger->config |= ADC_TRIGGER_ZONE_1;
+    } else {
+        *trigger->config &= ~ADC_TRIGGER_ZONE_1;
+    }
+    trace_end("configure_adc_trigger", t);
+}
+
+void restart_adc_trigger(struct adc_trigger *trigger) {
+    // Re-arm the trigger after the packetizer asserted 'last' in
+    // non-continuous mode.
+    *trigger->config |= ADC_TRIGGER_CLEAR;
+}
+
+double adc_sample_rate(uint32_t divider) {
+    // 'adc_trigger' counts from 0 to 'divider' inclusive, a conversion is
+    // started every 'divider + 1' clock cycles.
+    if (divider == 0)
+        return 0.0;
+    return ADC_CLK_FREQ_HZ / (double)(divider + 1);
+}
@@ -33,11 +33,18 @@
 #define ADC_REG_MODE_32BIT_COM (uint8_t)2
 #define ADC_REG_MODE_32BIT_AVG (uint8_t)3
 #define ADC_REG_MODE_TEST      (uint8_t)4
+// Test pattern output with 'ADC_REG_MODE_TEST', TEST_PAT_BYTE0 (LSB) to
+// TEST_PAT_BYTE3 at consecutive addresses
+#define ADC_REG_TEST_PAT     0x23
+#define ADC_TEST_PAT_DEFAULT (uint32_t)0x5A5A0F0F
 
 #define ADC_STATUS_MODE_CONV            (uint8_t)0
 #define ADC_STATUS_MODE_REG_ACCESS_ONCE (uint8_t)2
 #define ADC_STATUS_MODE_REG_ACCESS      (uint8_t)3
 
+// Frequency of 'adc_clk' as configured in 'projects/adc/bd_adc.tcl'
+#define ADC_CLK_FREQ_HZ 33333330.0
+
 #define ADC_CONFIG_ADDR_RANGE 256
 #define ADC_CONFIG_ADDR       0x40000000
 struct adc_config {
@@ -49,11 +56,140 @@ struct adc_config {
 
 #define PACKETIZER_ADDR_RANGE 256
 #define PACKETIZER_ADDR       0x40000200
+// Pack four 24-bit samples into three words, see 'adc_unpack24()'
+#define PACKETIZER_PACK (uint32_t)1
+// Start every packet with a block header, see 'struct adc_block_header'
+#define PACKETIZER_HEADER (uint32_t)2
+// Performance control register, see 'struct packetizer_perf'
+#define PACKETIZER_PERF_SNAPSHOT (uint32_t)1
+#define PACKETIZER_PERF_CLEAR    (uint32_t)2
 struct packetizer {
     uint32_t *_mmap;
     uint32_t *config;
     uint32_t *packet_counter;
-    uint16_t *iter_counter;
+    uint32_t *iter_counter;
+    uint32_t *packing;
+    // 'adc_clk' cycles since the reset, reading the lower half latches the
+    // upper half
+    uint32_t *timestamp_low;
+    uint32_t *timestamp_high;
+    uint32_t *perf_control;
+    // Snapshot of the 64-bit performance counters, in the order of
+    // 'struct packetizer_perf', lower half first
+    uint32_t *perf;
+};
+
+// Cycles of 'adc_clk' in which the datapath into the DMA was busy or stalled,
+// counted since the counters were cleared
+struct packetizer_perf {
+    uint64_t cycles;
+    // Samples accepted by the packetizer, and cycles in which it held back a
+    // sample (including 'disabled')
+    uint64_t in_beats;
+    uint64_t in_stalls;
+    // Words accepted by the DMA, and cycles in which the DMA held back a word
+    uint64_t out_beats;
+    uint64_t out_stalls;
+    // Cycles with a sample pending while the packetizer was disabled
+    uint64_t disabled;
+};
+
+#define DECIMATOR_ADDR_RANGE 256
+#define DECIMATOR_ADDR       0x40000300
+// Largest decimation ratio is 2^DECIMATOR_MAX_LOG2_RATIO
+#define DECIMATOR_MAX_LOG2_RATIO 10
+#define DECIMATOR_LOG2_RATIO     (uint32_t)0xF
+#define DECIMATOR_COMPENSATE     (uint32_t)(1 << 8)
+#define DECIMATOR_NUM_TAPS       16
+struct decimator {
+    uint32_t *_mmap;
+    uint32_t *config;
+    // FIR coefficients, 65536 corresponds to 1.0
+    int32_t *taps;
+};
+
+#define ADC_FIFO_ADDR_RANGE 256
+#define ADC_FIFO_ADDR       0x40000400
+#define ADC_FIFO_FLUSH      (uint32_t)1
+#define ADC_FIFO_CLEAR      (uint32_t)(1 << 1)
+// Elastic buffer between the ADC manager and the decimator
+struct adc_fifo {
+    uint32_t *_mmap;
+    uint32_t *control;
+    // Samples in the FIFO and the most since the counters were cleared
+    uint32_t *level;
+    uint32_t *high_water;
+    // Samples dropped while the FIFO was full, and how often it filled up
+    uint32_t *dropped;
+    uint32_t *overflows;
+    uint32_t *depth;
+};
+
+#define ADC_HW_STATS_ADDR_RANGE 256
+#define ADC_HW_STATS_ADDR       0x40000500
+#define ADC_HW_STATS_FREEZE     (uint32_t)1
+#define ADC_HW_STATS_RESTART    (uint32_t)(1 << 1)
+// Statistics tap between the ADC manager and the FIFO, accumulates the
+// conversion results over windows of a fixed number of samples
+struct adc_hw_stats {
+    uint32_t *_mmap;
+    uint32_t *control;
+    uint32_t *window;
+    // Snapshot of the last window, in the order of the registers: sequence,
+    // count, sum (2 words), sum of squares (3 words), minimum and maximum
+    uint32_t *snapshot;
+};
+
+// Results of a window in LSBs of the 24-bit conversion results
+struct adc_hw_stats_window {
+    // Number of windows that ended since the reset, wraps around
+    uint32_t sequence;
+    uint32_t count;
+    int64_t sum;
+    // Sum of squares, up to 79 bits
+    uint32_t sum_sq_high;
+    uint64_t sum_sq_low;
+    int32_t min;
+    int32_t max;
+};
+
+#define EVENT_TRIGGER_ADDR_RANGE 256
+#define EVENT_TRIGGER_ADDR       0x40000600
+#define EVENT_TRIGGER_ARM        (uint32_t)1
+#define EVENT_TRIGGER_CONTINUOUS (uint32_t)(1 << 1)
+#define EVENT_TRIGGER_RISING     (uint32_t)(1 << 2)
+#define EVENT_TRIGGER_FALLING    (uint32_t)(1 << 3)
+#define EVENT_TRIGGER_SLOPE      (uint32_t)(1 << 4)
+// States in the status register
+#define EVENT_TRIGGER_STATE_PASS   (uint32_t)0
+#define EVENT_TRIGGER_STATE_ARMED  (uint32_t)1
+#define EVENT_TRIGGER_STATE_WINDOW (uint32_t)2
+#define EVENT_TRIGGER_STATE_DONE   (uint32_t)3
+// Trigger between the FIFO and the decimator that only forwards windows of
+// 'pre' + 'post' samples around events, one packet each
+struct event_trigger {
+    uint32_t *_mmap;
+    uint32_t *config;
+    // Signed 24-bit conversion result
+    int32_t *threshold;
+    // Samples before the trigger sample, and from it on
+    uint32_t *pre;
+    uint32_t *post;
+    uint32_t *status;
+    uint32_t *events;
+    // Largest 'pre' plus one
+    uint32_t *depth;
+};
+
+// Raw path of the dual-stream variant: the conversion results are split after
+// the statistics tap, the raw path has its own FIFO and packetizer (with the
+// registers of 'struct adc_fifo' and 'struct packetizer') in front of the
+// second DMA channel, 'DMADC_RAW_DEVICE'
+#define ADC_RAW_FIFO_ADDR       0x40000700
+#define ADC_RAW_PACKETIZER_ADDR 0x40000800
+struct adc_raw {
+    struct adc_fifo fifo;
+    struct packetizer pack;
 };
 
 #define ADC_TRIGGER_ONCE       (uint32_t)0
@@ -72,21 +208,79 @@ struct adc {
     struct adc_config config;
     struct packetizer pack;
     struct adc_trigger trigger;
+    struct decimator decimator;
+    struct adc_fifo fifo;
+    struct adc_hw_stats hw_stats;
+    struct event_trigger event;
 };
 
 int open_adc(struct adc *adc);
+int open_adc_sim(struct adc *adc);
 int close_adc(struct adc *adc);
+int open_adc_raw(struct adc_raw *raw);
+int open_adc_raw_sim(struct adc_raw *raw);
+int close_adc_raw(struct adc_raw *raw);
 int open_adc_config(int fd, struct adc_config *config);
 int close_adc_config(struct adc_config *config);
 int open_packetizer(int fd, struct packetizer *pack);
 int close_packetizer(struct packetizer *pack);
 int open_adc_trigger(int fd, struct adc_trigger *trigger);
 int close_adc_trigger(struct adc_trigger *trigger);
-void write_adc_reg(struct adc_config *config, uint32_t data);
+int open_decimator(int fd, struct decimator *decimator);
+int close_decimator(struct decimator *decimator);
+int open_adc_fifo(int fd, struct adc_fifo *fifo);
+int close_adc_fifo(struct adc_fifo *fifo);
+int open_adc_hw_stats(int fd, struct adc_hw_stats *stats);
+int close_adc_hw_stats(struct adc_hw_stats *stats);
+int open_event_trigger(int fd, struct event_trigger *event);
+int close_event_trigger(struct event_trigger *event);
 void write_adc_reg(struct adc_config *config, uint32_t data);
 bool get_adc_transaction_active(struct adc_config *config);
 bool get_adc_reg_available(struct adc_config *config);
 bool get_adc_tvalid(struct adc_config *config);
+bool get_adc_ddr(struct adc_config *config);
+bool get_adc_echo(struct adc_config *config);
+bool get_adc_echo_lost(struct adc_config *config);
 uint8_t get_adc_device_mode(struct adc_config *config);
 uint32_t get_adc_last_reg(struct adc_config *config);
 int set_packatizer_save(struct packetizer *pack, uint32_t value);
+int set_packetizer_packing(struct packetizer *pack, bool enable);
+bool get_packetizer_packing(struct packetizer *pack);
+int set_packetizer_header(struct packetizer *pack, bool enable);
+bool get_packetizer_header(struct packetizer *pack);
+uint64_t get_packetizer_timestamp(struct packetizer *pack);
+void clear_packetizer_perf(struct packetizer *pack);
+void get_packetizer_perf(struct packetizer *pack, struct packetizer_perf *perf);
+double packetizer_perf_ratio(
+    uint64_t count, const struct packetizer_perf *perf
+);
+void set_decimator(
+    struct decimator *decimator, unsigned int log2_ratio, bool compensate
+);
+void clear_decimator(struct decimator *decimator);
+unsigned int get_decimator_ratio(struct decimator *decimator);
+void flush_adc_fifo(struct adc_fifo *fifo);
+void clear_adc_fifo_counters(struct adc_fifo *fifo);
+void set_adc_hw_stats_window(struct adc_hw_stats *stats, uint32_t samples);
+int get_adc_hw_stats(
+    struct adc_hw_stats *stats, struct adc_hw_stats_window *window
+);
+double adc_hw_stats_mean(const struct adc_hw_stats_window *window);
+double adc_hw_stats_stddev(const struct adc_hw_stats_window *window);
+int set_event_trigger(
+    struct event_trigger *event,
+    uint32_t flags,
+    int32_t threshold,
+    uint32_t pre,
+    uint32_t post
+);
+void disable_event_trigger(struct event_trigger *event);
+void rearm_event_trigger(struct event_trigger *event);
+uint32_t get_event_trigger_state(struct event_trigger *event);
+int reset_adc_datapath(struct adc *adc);
+uint8_t adc_default_mode(bool test, uint8_t avg);
+int configure_adc(struct adc *adc, uint8_t mode, uint8_t avg);
+void configure_adc_test_pattern(struct adc *adc, uint32_t pattern);
+void configure_adc_trigger(struct adc_trigger *trigger, unsigned int zone);
+void restart_adc_trigger(struct adc_trigger *trigger);
+double adc_sample_rate(uint32_t divider);
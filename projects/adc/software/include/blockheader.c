@@ -0,0 +1,54 @@
+#include "blockheader.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+void adc_block_check_init(struct adc_block_check *check) {
+    memset(check, 0, sizeof(struct adc_block_check));
+}
+
+uint64_t adc_block_ticks(const struct adc_block_header *header) {
+    return ((uint64_t)header->timestamp_high << 32) | header->timestamp_low;
+}
+
+// Verify the header at the start of 'words', a block of 'samples' samples,
+// against the previous blocks and return its timestamp in 'ticks'. The
+// sequence number wraps around after 2^32 blocks. Returns -EBADMSG if the
+// header is invalid or the block repeats an earlier one, the sequence
+// continues with the next valid block.
+int adc_block_check(
+    struct adc_block_check *check,
+    const uint32_t *words,
+    size_t samples,
+    uint64_t *ticks
+) {
+    struct adc_block_header header;
+    int32_t delta = 0;
+
+    memcpy(&header, words, sizeof(header));
+    check->blocks++;
+    *ticks = adc_block_ticks(&header);
+    if (header.magic != ADC_BLOCK_MAGIC || header.samples != samples) {
+        check->invalid++;
+        return -EBADMSG;
+    }
+    if (check->started) {
+        delta = (int32_t)(header.sequence - check->next_sequence);
+        if (delta < 0) {
+            check->repeated++;
+            return -EBADMSG;
+        }
+        if (*ticks <= check->last_ticks) {
+            check->invalid++;
+            return -EBADMSG;
+        }
+        check->lost += (uint64_t)delta;
+    }
+    check->started = true;
+    check->next_sequence = header.sequence + 1;
+    check->last_ticks = *ticks;
+    return 0;
+}
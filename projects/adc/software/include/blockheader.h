@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADC_BLOCK_MAGIC        0x48434441
+#define ADC_BLOCK_HEADER_WORDS 8
+// Set in 'flags' if the samples of the block are packed
+#define ADC_BLOCK_FLAG_PACKED (uint32_t)1
+
+// Written by the packetizer ahead of the samples of every packet if
+// 'PACKETIZER_HEADER' is set
+struct adc_block_header {
+    uint32_t magic;
+    // Number of packets the packetizer completed before this one
+    uint32_t sequence;
+    // 'adc_clk' cycle in which the first sample reached the packetizer
+    uint32_t timestamp_low;
+    uint32_t timestamp_high;
+    uint32_t samples;
+    // Divider and config register of 'adc_trigger'
+    uint32_t divider;
+    uint32_t trigger;
+    uint32_t flags;
+};
+
+// Running verification of the headers of consecutive blocks
+struct adc_block_check {
+    bool started;
+    uint32_t next_sequence;
+    uint64_t last_ticks;
+    uint64_t blocks;
+    // Blocks missing from the sequence, and blocks that repeat or precede an
+    // earlier one
+    uint64_t lost;
+    uint64_t repeated;
+    // Wrong magic, number of samples, or a timestamp that does not advance
+    uint64_t invalid;
+};
+
+void adc_block_check_init(struct adc_block_check *check);
+int adc_block_check(
+    struct adc_block_check *check,
+    const uint32_t *words,
+    size_t samples,
+    uint64_t *ticks
+);
+uint64_t adc_block_ticks(const struct adc_block_header *header);
@@ -0,0 +1,178 @@
+#include "capture.h"
+#include "adcctl.h"
+#include "blockheader.h"
+#include "clockmodel.h"
+#include "dmaclient.h"
+#include "dmadc.h"
+#include "rt.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Blocks shorter than this are not probed, the probes would be too close to
+// each other to tell anything about the sample clock.
+#define CAPTURE_PROBE_MIN_NS 1000000
+
+// Start the acquisition of 'samples' samples into the DMA buffer without
+// waiting for it. Returns 'DMADC_IN_PROGRESS' if the transfer was started, in
+// which case 'capture_finish()' has to be called once it is done.
+enum dmadc_status capture_start(
+    struct adc *adc,
+    struct dmadc_channel *channel,
+    size_t samples,
+    uint32_t divider
+) {
+    long rc;
+
+    if (set_packatizer_save(&adc->pack, samples) != 0) {
+        fprintf(stderr, "Error: Packetizer is busy\n");
+        return DMADC_ERROR;
+    }
+    // Samples converted before the capture must not end up in it, the DMA
+    // does not accept any before the transfer starts
+    flush_adc_fifo(&adc->fifo);
+    // In once mode, the event trigger is done after the previous window
+    rearm_event_trigger(&adc->event);
+    rc = start_transfer(channel, (unsigned int)capture_bytes(adc, samples));
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to start transfer: %ld\n", rc);
+        set_packatizer_save(&adc->pack, 0);
+        return DMADC_SUBMIT_ERROR;
+    }
+    clear_decimator(&adc->decimator);
+    restart_adc_trigger(&adc->trigger);
+    *adc->trigger.divider = divider;
+    return DMADC_IN_PROGRESS;
+}
+
+// Stop the trigger after the transfer started with 'capture_start()' exited
+// with 'status'.
+enum dmadc_status capture_finish(struct adc *adc, enum dmadc_status status) {
+    *adc->trigger.divider = 0;
+    if (status != DMADC_TIMEOUT) {
+        // After a timeout, the packetizer is still in the middle of a packet
+        // and does not accept writes to its config register.
+        set_packatizer_save(&adc->pack, 0);
+    }
+    return status;
+}
+
+// Size of a block of 'samples' samples in the DMA buffer. With packing, four
+// samples take three words and 'samples' has to be a multiple of four. The
+// block header takes 'ADC_BLOCK_HEADER_WORDS' more words.
+static size_t packet_bytes(struct packetizer *pack, size_t samples) {
+    size_t words = get_packetizer_packing(pack) ? samples / 4 * 3 : samples;
+    if (get_packetizer_header(pack))
+        words += ADC_BLOCK_HEADER_WORDS;
+    return words * sizeof(uint32_t);
+}
+
+size_t capture_bytes(struct adc *adc, size_t samples) {
+    return packet_bytes(&adc->pack, samples);
+}
+
+// Start a burst of 'samples' raw conversion results on the raw path of the
+// dual-stream variant. Unlike 'capture_start()', the trigger is left alone:
+// the burst starts with the next conversion, and in once mode it has to end
+// before the packet of 'capture_start()' does. Returns 'DMADC_IN_PROGRESS' if
+// the transfer was started, in which case 'capture_raw_finish()' has to be
+// called once it is done.
+enum dmadc_status capture_raw_start(
+    struct adc_raw *raw, struct dmadc_channel *channel, size_t samples
+) {
+    long rc;
+
+    if (set_packatizer_save(&raw->pack, samples) != 0) {
+        fprintf(stderr, "Error: Raw packetizer is busy\n");
+        return DMADC_ERROR;
+    }
+    flush_adc_fifo(&raw->fifo);
+    rc = start_transfer(channel, (unsigned int)capture_raw_bytes(raw, samples));
+    if (rc != 0) {
+        fprintf(stderr, "Error: Unable to start raw transfer: %ld\n", rc);
+        set_packatizer_save(&raw->pack, 0);
+        return DMADC_SUBMIT_ERROR;
+    }
+    return DMADC_IN_PROGRESS;
+}
+
+enum dmadc_status capture_raw_finish(
+    struct adc_raw *raw, enum dmadc_status status
+) {
+    // See 'capture_finish()'
+    if (status != DMADC_TIMEOUT)
+        set_packatizer_save(&raw->pack, 0);
+    return status;
+}
+
+size_t capture_raw_bytes(struct adc_raw *raw, size_t samples) {
+    return packet_bytes(&raw->pack, samples);
+}
+
+// Number of samples of the current packet that have been forwarded to the
+// DMA. This is zero if no capture is running.
+size_t capture_progress(struct adc *adc) {
+    return *adc->pack.packet_counter;
+}
+
+// Read the packetizer counter at 1/8 and 7/8 of the expected duration of the
+// block started with 'capture_start()' at 'start_ns', sleeping in between.
+// Every read is bracketed by two reads of CLOCK_MONOTONIC. Returns the number
+// of usable probes, reads outside of the block are dropped.
+size_t capture_probe(
+    struct adc *adc,
+    uint64_t start_ns,
+    size_t samples,
+    double period_ns,
+    struct adc_clock_probe probes[ADC_CLOCK_PROBES]
+) {
+    const double duration_ns = (double)samples * period_ns;
+    struct adc_clock_probe *probe;
+    struct timespec ts;
+    uint64_t at_ns, before, after;
+    size_t count = 0;
+
+    if (duration_ns < CAPTURE_PROBE_MIN_NS)
+        return 0;
+    for (unsigned int i = 0; i < ADC_CLOCK_PROBES; i++) {
+        at_ns = start_ns + (uint64_t)(duration_ns *
+                                      (1.0 + 6.0 * i / (ADC_CLOCK_PROBES - 1)) /
+                                      8.0);
+        ts.tv_sec = (time_t)(at_ns / 1000000000ull);
+        ts.tv_nsec = (long)(at_ns % 1000000000ull);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+               EINTR)
+            ;
+        probe = &probes[count];
+        before = rt_now_ns();
+        probe->samples = *adc->pack.packet_counter;
+        after = rt_now_ns();
+        probe->ns = before + (after - before) / 2;
+        probe->error_ns = (after - before) / 2 + 1;
+        if (probe->samples > 0 && probe->samples < samples)
+            count++;
+    }
+    return count;
+}
+
+// Acquire a single block of 'samples' samples into the DMA buffer. The ADC and
+// the trigger have to be configured beforehand, see 'configure_adc()' and
+// 'configure_adc_trigger()'. Data is available in the mapped DMA buffer if
+// the returned status is 'DMADC_COMPLETE'.
+enum dmadc_status capture_block(
+    struct adc *adc,
+    struct dmadc_channel *channel,
+    size_t samples,
+    uint32_t divider
+) {
+    enum dmadc_status status;
+
+    status = capture_start(adc, channel, samples, divider);
+    if (status != DMADC_IN_PROGRESS)
+        return status;
+    status = wait_for_transfer(channel);
+    return capture_finish(adc, status);
+}
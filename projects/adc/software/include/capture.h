@@ -0,0 +1,38 @@
+#pragma once
+
+#include "adcctl.h"
+#include "clockmodel.h"
+#include "dmaclient.h"
+#include "dmadc.h"
+#include <stddef.h>
+#include <stdint.h>
+
+enum dmadc_status capture_start(
+    struct adc *adc,
+    struct dmadc_channel *channel,
+    size_t samples,
+    uint32_t divider
+);
+enum dmadc_status capture_finish(struct adc *adc, enum dmadc_status status);
+size_t capture_bytes(struct adc *adc, size_t samples);
+enum dmadc_status capture_raw_start(
+    struct adc_raw *raw, struct dmadc_channel *channel, size_t samples
+);
+enum dmadc_status capture_raw_finish(
+    struct adc_raw *raw, enum dmadc_status status
+);
+size_t capture_raw_bytes(struct adc_raw *raw, size_t samples);
+size_t capture_progress(struct adc *adc);
+size_t capture_probe(
+    struct adc *adc,
+    uint64_t start_ns,
+    size_t samples,
+    double period_ns,
+    struct adc_clock_probe probes[ADC_CLOCK_PROBES]
+);
+enum dmadc_status capture_block(
+    struct adc *adc,
+    struct dmadc_channel *channel,
+    size_t samples,
+    uint32_t divider
+);
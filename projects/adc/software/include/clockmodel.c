@@ -0,0 +1,142 @@
+#include "clockmodel.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Time of the first sample as dated by 'probe', and the inverse variance
+static double probe_first_ns(
+    const struct adc_clock_probe *probe, double period_ns, double *weight
+) {
+    // A probe that read 'n' dates sample 'n - 1' to half a period before it
+    double error = (double)probe->error_ns;
+    *weight = 1.0 / (error * error / 3.0 + period_ns * period_ns / 12.0);
+    return (double)probe->ns - ((double)probe->samples - 0.5) * period_ns;
+}
+
+static int64_t timespec_ns(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * 1000000000ll + (int64_t)ts->tv_nsec;
+}
+
+// CLOCK_REALTIME - CLOCK_MONOTONIC, the realtime clock is read in between two
+// reads of the monotonic clock.
+static int64_t realtime_offset_ns(void) {
+    struct timespec before, realtime, after;
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &after);
+    return timespec_ns(&realtime) -
+           (timespec_ns(&before) + timespec_ns(&after)) / 2;
+}
+
+void adc_clock_init(struct adc_clock_model *model, double sample_rate) {
+    model->nominal_period_ns = (sample_rate > 0.0) ? 1e9 / sample_rate : 0.0;
+    model->period_ns = model->nominal_period_ns;
+    model->sum_w = 0.0;
+    model->sum_wp = 0.0;
+    model->latency_ns = 0.0;
+    model->latency_var = 0.0;
+    model->realtime_offset_ns = realtime_offset_ns();
+    model->blocks = 0;
+    model->fitted = 0;
+    model->rejected = 0;
+}
+
+// Fit the period to the first and last of 'probes', returns false if they
+// are unusable or an outlier.
+static bool adc_clock_fit(
+    struct adc_clock_model *model,
+    const struct adc_clock_probe *a,
+    const struct adc_clock_probe *b
+) {
+    double span, period, var, w;
+    if (b->samples <= a->samples || b->ns <= a->ns)
+        return false;
+    span = (double)(b->samples - a->samples);
+    period = (double)(b->ns - a->ns) / span;
+    // The reads are uniformly distributed within their brackets, and the
+    // counter only tells that a sample was forwarded within the last period.
+    var = ((double)a->error_ns * (double)a->error_ns +
+           (double)b->error_ns * (double)b->error_ns) /
+          3.0;
+    var = (var + period * period / 6.0) / (span * span);
+    if (model->fitted >= ADC_CLOCK_MIN_BLOCKS &&
+        fabs(period - model->period_ns) >
+            ADC_CLOCK_REJECT_SIGMA * sqrt(var + 1.0 / model->sum_w)) {
+        model->rejected++;
+        return false;
+    }
+    w = 1.0 / var;
+    model->sum_w = ADC_CLOCK_FORGET * model->sum_w + w;
+    model->sum_wp = ADC_CLOCK_FORGET * model->sum_wp + w * period;
+    model->period_ns = model->sum_wp / model->sum_w;
+    model->fitted++;
+    return true;
+}
+
+// Update the model with a block of 'samples' samples that completed at
+// 'completion_ns' (zero if unknown) and was probed 'num_probes' times, and
+// return the time base of the block. Blocks without usable probes only
+// contribute their completion time, the period and completion latency of the
+// model are used to date them.
+void adc_clock_update(
+    struct adc_clock_model *model,
+    const struct adc_clock_probe *probes,
+    size_t num_probes,
+    size_t samples,
+    uint64_t completion_ns,
+    struct adc_block_time *time
+) {
+    const struct adc_clock_probe *a = &probes[0];
+    const struct adc_clock_probe *b = &probes[num_probes - 1];
+    double first_ns, first_a, first_b, wa, wb, latency, delta;
+    struct timespec ts;
+    bool probed;
+
+    model->blocks++;
+    model->realtime_offset_ns = realtime_offset_ns();
+    if (completion_ns == 0) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        completion_ns = (uint64_t)timespec_ns(&ts);
+    }
+    probed = num_probes >= 2 && adc_clock_fit(model, a, b);
+    time->period_ns = model->period_ns;
+    if (probed) {
+        first_a = probe_first_ns(a, model->period_ns, &wa);
+        first_b = probe_first_ns(b, model->period_ns, &wb);
+        first_ns = (wa * first_a + wb * first_b) / (wa + wb);
+        latency = (double)completion_ns -
+                  (first_ns + (double)(samples - 1) * model->period_ns);
+        if (model->fitted == 1) {
+            model->latency_ns = latency;
+        } else {
+            delta = latency - model->latency_ns;
+            model->latency_ns += (1.0 - ADC_CLOCK_FORGET) * delta;
+            model->latency_var =
+                ADC_CLOCK_FORGET *
+                (model->latency_var + (1.0 - ADC_CLOCK_FORGET) * delta * delta);
+        }
+        time->latency_ns = latency;
+    } else {
+        first_ns = (double)completion_ns - model->latency_ns -
+                   (double)(samples - 1) * model->period_ns;
+        time->latency_ns = 0.0;
+    }
+    time->first_ns = (uint64_t)llround(first_ns);
+    time->first_realtime_ns =
+        (uint64_t)((int64_t)time->first_ns + model->realtime_offset_ns);
+}
+
+// Deviation of the sample clock from its nominal frequency in parts per
+// million, positive if it is fast
+double adc_clock_ppm(const struct adc_clock_model *model) {
+    if (model->period_ns <= 0.0)
+        return 0.0;
+    return (model->nominal_period_ns / model->period_ns - 1.0) * 1e6;
+}
+
+double adc_clock_sample_rate(const struct adc_clock_model *model) {
+    return (model->period_ns > 0.0) ? 1e9 / model->period_ns : 0.0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of times the packetizer counter is read during a block
+#define ADC_CLOCK_PROBES 2
+// Weight of the previous blocks in the fit, the model follows changes of the
+// clock within roughly 1 / (1 - ADC_CLOCK_FORGET) blocks.
+#define ADC_CLOCK_FORGET 0.99
+// Period estimates further than this many standard deviations from the model
+// are rejected, once the model is based on a few blocks
+#define ADC_CLOCK_REJECT_SIGMA 5.0
+#define ADC_CLOCK_MIN_BLOCKS   4
+
+// 'samples' samples of the current block had been forwarded to the DMA at
+// CLOCK_MONOTONIC time 'ns', within +-'error_ns'
+struct adc_clock_probe {
+    uint64_t samples;
+    uint64_t ns;
+    uint64_t error_ns;
+};
+
+// Continuously updated model of the sample clock against CLOCK_MONOTONIC.
+// The period is fitted from the packetizer counter read during the blocks,
+// the offset of every block from the completion time of its DMA transfer.
+struct adc_clock_model {
+    double nominal_period_ns;
+    double period_ns;
+    // Exponentially weighted sums of the period estimates of the blocks
+    double sum_w;
+    double sum_wp;
+    // Time from the last sample of a block until its transfer completed
+    double latency_ns;
+    double latency_var;
+    // CLOCK_REALTIME - CLOCK_MONOTONIC at the last update
+    int64_t realtime_offset_ns;
+    uint64_t blocks;
+    // Blocks whose probes were used in the fit, or rejected as outliers
+    uint64_t fitted;
+    uint64_t rejected;
+};
+
+// Time base of a block. Sample 'i' was taken at 'first_ns + i * period_ns'
+// (CLOCK_MONOTONIC), respectively 'first_realtime_ns + i * period_ns'.
+struct adc_block_time {
+    uint64_t first_ns;
+    uint64_t first_realtime_ns;
+    double period_ns;
+    // Completion latency of this block, zero if it was not probed
+    double latency_ns;
+};
+
+void adc_clock_init(struct adc_clock_model *model, double sample_rate);
+void adc_clock_update(
+    struct adc_clock_model *model,
+    const struct adc_clock_probe *probes,
+    size_t num_probes,
+    size_t samples,
+    uint64_t completion_ns,
+    struct adc_block_time *time
+);
+double adc_clock_ppm(const struct adc_clock_model *model);
+double adc_clock_sample_rate(const struct adc_clock_model *model);
@@ -0,0 +1,113 @@
+#include "decode.h"
+#include "adcctl.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Get the layout of the data words for the output data format in 'mode' (the
+// value of 'ADC_REG_MODE_ADDR'). Test patterns are not conversion results and
+// return -EINVAL.
+int adc_word_layout(uint8_t mode, struct adc_word_layout *layout) {
+    switch (mode & 0x7) {
+        case ADC_REG_MODE_24BIT:
+            layout->shift = 8;
+            layout->bits = 24;
+            layout->common_mode = 0;
+            return 0;
+        case ADC_REG_MODE_24BIT_COM:
+            layout->shift = 16;
+            layout->bits = 16;
+            layout->common_mode = 1;
+            return 0;
+        case ADC_REG_MODE_32BIT_COM:
+            layout->shift = 8;
+            layout->bits = 24;
+            layout->common_mode = 1;
+            return 0;
+        case ADC_REG_MODE_32BIT_AVG:
+            layout->shift = 2;
+            layout->bits = 30;
+            layout->common_mode = 0;
+            return 0;
+        case ADC_FORMAT_DECIMATED:
+            layout->shift = 0;
+            layout->bits = 32;
+            layout->common_mode = 0;
+            return 0;
+        default:
+            return -EINVAL;
+    }
+}
+
+// Voltage of a single code of the conversion result
+double adc_lsb_volts(const struct adc_word_layout *layout, double vref) {
+    return 2.0 * vref / (double)(1ull << layout->bits);
+}
+
+// The loops below are kept free of branches, such that the compiler can
+// vectorize them (NEON on the Zynq).
+void adc_decode_f32(
+    const uint32_t *raw,
+    float *out,
+    size_t count,
+    const struct adc_word_layout *layout,
+    double vref
+) {
+    const unsigned int shift = layout->shift;
+    const float lsb = (float)adc_lsb_volts(layout, vref);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (float)((int32_t)raw[i] >> shift) * lsb;
+    }
+}
+
+// Unpack 'count' samples (a multiple of four) packed by the packetizer, four
+// 24-bit samples in three words, see 'packetizer_s2mm'. The samples are
+// restored to the 'ADC_REG_MODE_24BIT' layout. Each group of three words is
+// loaded and four words are stored without branches, NEON has interleaving
+// loads and stores for exactly this ('vld3', 'vst4').
+void adc_unpack24(const uint32_t *packed, uint32_t *out, size_t count) {
+    uint32_t w0, w1, w2;
+    for (size_t g = 0; g < count / 4; g++) {
+        w0 = packed[3 * g];
+        w1 = packed[3 * g + 1];
+        w2 = packed[3 * g + 2];
+        out[4 * g] = w0 << 8;
+        out[4 * g + 1] = ((w0 >> 24) << 8) | (w1 << 16);
+        out[4 * g + 2] = ((w1 >> 16) << 8) | (w2 << 24);
+        out[4 * g + 3] = w2 & 0xFFFFFF00u;
+    }
+}
+
+void adc_decode_f64(
+    const uint32_t *raw,
+    double *out,
+    size_t count,
+    const struct adc_word_layout *layout,
+    double vref
+) {
+    const unsigned int shift = layout->shift;
+    const double lsb = adc_lsb_volts(layout, vref);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (double)((int32_t)raw[i] >> shift) * lsb;
+    }
+}
+
+// Count the words and bits that differ from 'pattern' and add them to
+// 'errors'. Like the conversions above, the loop has no branches, such that
+// it is vectorized (NEON 'vcnt' for the bit count).
+void adc_check_pattern(
+    const uint32_t *raw,
+    size_t count,
+    uint32_t pattern,
+    struct adc_pattern_errors *errors
+) {
+    uint32_t words = 0, bits = 0, diff;
+    for (size_t i = 0; i < count; i++) {
+        diff = raw[i] ^ pattern;
+        words += (diff != 0);
+        bits += (uint32_t)__builtin_popcount(diff);
+    }
+    errors->words += words;
+    errors->bits += bits;
+}
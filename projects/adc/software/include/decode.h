@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Default reference voltage of the ADC. The differential input range is
+// +/- VREF.
+#define ADC_VREF 4.096
+
+// Output of the decimator: signed 32-bit words with the full scale of the
+// 24-bit conversion results, the low byte holds the additional resolution.
+// Not an output data format of the ADC, the value is unused by it.
+#define ADC_FORMAT_DECIMATED (uint8_t)7
+
+// Position of the signed conversion result within a 32-bit word as written to
+// the DMA buffer, depending on the output data format of the ADC
+// ('ADC_REG_MODE_24BIT' ... 'ADC_REG_MODE_TEST', 'ADC_FORMAT_DECIMATED').
+struct adc_word_layout {
+    // Right shift of the (signed) word to get the conversion result
+    unsigned int shift;
+    // Number of bits of the conversion result
+    unsigned int bits;
+    // Common mode is contained in the lower 8 bits
+    int common_mode;
+};
+
+int adc_word_layout(uint8_t mode, struct adc_word_layout *layout);
+double adc_lsb_volts(const struct adc_word_layout *layout, double vref);
+void adc_decode_f32(
+    const uint32_t *raw,
+    float *out,
+    size_t count,
+    const struct adc_word_layout *layout,
+    double vref
+);
+void adc_unpack24(const uint32_t *packed, uint32_t *out, size_t count);
+void adc_decode_f64(
+    const uint32_t *raw,
+    double *out,
+    size_t count,
+    const struct adc_word_layout *layout,
+    double vref
+);
+
+// Mismatches of the data words against the expected test pattern
+struct adc_pattern_errors {
+    uint64_t words;
+    uint64_t bits;
+};
+
+void adc_check_pattern(
+    const uint32_t *raw,
+    size_t count,
+    uint32_t pattern,
+    struct adc_pattern_errors *errors
+);
@@ -0,0 +1,334 @@
+#include "detect.h"
+#include "decode.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int adc_detect_mode_parse(const char *name, enum adc_detect_mode *mode) {
+    if (strcmp(name, "level") == 0)
+        *mode = ADC_DETECT_LEVEL;
+    else if (strcmp(name, "slope") == 0)
+        *mode = ADC_DETECT_SLOPE;
+    else if (strcmp(name, "deviation") == 0)
+        *mode = ADC_DETECT_DEVIATION;
+    else
+        return -EINVAL;
+    return 0;
+}
+
+// Detect events in blocks of conversion results and write a window of 'pre'
+// samples before and 'post' samples from the trigger sample on to 'out'.
+// Events within the window of a previous event are part of that window.
+int adc_detector_init(
+    struct adc_detector *detector,
+    enum adc_detect_mode mode,
+    const struct adc_word_layout *layout,
+    double threshold_volts,
+    size_t pre,
+    size_t post,
+    FILE *out
+) {
+    long threshold = lrint(threshold_volts / adc_lsb_volts(layout, ADC_VREF));
+    memset(detector, 0, sizeof(struct adc_detector));
+    if (post == 0)
+        return -EINVAL;
+    if (mode != ADC_DETECT_LEVEL) {
+        threshold = labs(threshold);
+        threshold = (threshold > 0) ? threshold : 1;
+    }
+    detector->mode = mode;
+    detector->layout = *layout;
+    detector->threshold = (int32_t)threshold;
+    detector->pre = pre;
+    detector->post = post;
+    detector->out = out;
+    if (pre > 0) {
+        detector->history = malloc(pre * sizeof(uint32_t));
+        if (detector->history == NULL)
+            return -ENOMEM;
+    }
+    detector->window = malloc((pre + post) * sizeof(uint32_t));
+    if (detector->window == NULL) {
+        adc_detector_free(detector);
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+void adc_detector_free(struct adc_detector *detector) {
+    free(detector->history);
+    free(detector->window);
+    detector->history = NULL;
+    detector->window = NULL;
+}
+
+static inline int32_t code(uint32_t word, unsigned int shift) {
+    return (int32_t)word >> shift;
+}
+
+static inline int level_hit(int32_t x, int32_t prev, int32_t threshold) {
+    return (x >= threshold) ^ (prev >= threshold);
+}
+
+static inline int distance_hit(int32_t x, int32_t ref, int32_t threshold) {
+    int32_t d = x - ref;
+    return (d >= threshold) | (d <= -threshold);
+}
+
+// Check whether any of the 'count' samples triggers, 'prev' is the sample
+// before the first one. The loops have no branches (and do not stop at the
+// first trigger), such that the compiler can vectorize them.
+static bool chunk_hit(
+    const struct adc_detector *detector,
+    const uint32_t *raw,
+    size_t count,
+    int32_t prev,
+    int32_t baseline
+) {
+    const unsigned int shift = detector->layout.shift;
+    const int32_t threshold = detector->threshold;
+    int hit = 0;
+    switch (detector->mode) {
+        case ADC_DETECT_LEVEL:
+            hit = level_hit(code(raw[0], shift), prev, threshold);
+            for (size_t i = 1; i < count; i++) {
+                hit |= level_hit(
+                    code(raw[i], shift), code(raw[i - 1], shift), threshold
+                );
+            }
+            break;
+        case ADC_DETECT_SLOPE:
+            hit = distance_hit(code(raw[0], shift), prev, threshold);
+            for (size_t i = 1; i < count; i++) {
+                hit |= distance_hit(
+                    code(raw[i], shift), code(raw[i - 1], shift), threshold
+                );
+            }
+            break;
+        case ADC_DETECT_DEVIATION:
+            for (size_t i = 0; i < count; i++) {
+                hit |= distance_hit(code(raw[i], shift), baseline, threshold);
+            }
+            break;
+    }
+    return hit != 0;
+}
+
+static bool sample_hit(
+    const struct adc_detector *detector,
+    int32_t x,
+    int32_t prev,
+    int32_t baseline
+) {
+    switch (detector->mode) {
+        case ADC_DETECT_LEVEL:
+            return level_hit(x, prev, detector->threshold);
+        case ADC_DETECT_SLOPE:
+            return distance_hit(x, prev, detector->threshold);
+        default:
+            return distance_hit(x, baseline, detector->threshold);
+    }
+}
+
+// Index of the first trigger within the 'count' samples, or 'count'. The
+// samples are compared chunk by chunk, only a chunk with a trigger is
+// searched sample by sample.
+static size_t find_trigger(
+    const struct adc_detector *detector,
+    const uint32_t *raw,
+    size_t count,
+    int32_t prev,
+    bool has_prev
+) {
+    const unsigned int shift = detector->layout.shift;
+    const int32_t baseline = (int32_t)lrint(detector->baseline);
+    // Crossings and slopes need a previous sample
+    size_t start = (has_prev || detector->mode == ADC_DETECT_DEVIATION) ? 0 : 1;
+    size_t n;
+    int32_t p;
+    for (size_t base = start; base < count; base += ADC_DETECT_CHUNK) {
+        n = (count - base < ADC_DETECT_CHUNK) ? count - base : ADC_DETECT_CHUNK;
+        p = (base > 0) ? code(raw[base - 1], shift) : prev;
+        if (!chunk_hit(detector, &raw[base], n, p, baseline))
+            continue;
+        for (size_t i = base; i < base + n; i++) {
+            if (sample_hit(detector, code(raw[i], shift), p, baseline))
+                return i;
+            p = code(raw[i], shift);
+        }
+    }
+    return count;
+}
+
+static double block_mean(
+    const uint32_t *raw, size_t count, unsigned int shift
+) {
+    int64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += code(raw[i], shift);
+    }
+    return (count > 0) ? (double)sum / (double)count : 0.0;
+}
+
+// Keep the last 'pre' of the 'count' words
+static void history_push(
+    struct adc_detector *detector, const uint32_t *raw, size_t count
+) {
+    const size_t pre = detector->pre;
+    size_t n;
+    if (pre == 0 || count == 0)
+        return;
+    if (count >= pre) {
+        memcpy(detector->history, &raw[count - pre], pre * sizeof(uint32_t));
+        detector->history_head = 0;
+        detector->history_fill = pre;
+        return;
+    }
+    n = (pre - detector->history_head < count) ? pre - detector->history_head
+                                               : count;
+    memcpy(
+        &detector->history[detector->history_head], raw, n * sizeof(uint32_t)
+    );
+    memcpy(detector->history, &raw[n], (count - n) * sizeof(uint32_t));
+    detector->history_head = (detector->history_head + count) % pre;
+    detector->history_fill = (detector->history_fill + count < pre)
+                                 ? detector->history_fill + count
+                                 : pre;
+}
+
+// Start the window of an event with the history, oldest word first. The
+// history is consumed, the next window starts after this one.
+static void start_window(
+    struct adc_detector *detector,
+    uint64_t block,
+    uint64_t timestamp_ns,
+    double period_ns
+) {
+    const size_t pre = detector->pre;
+    size_t fill = detector->history_fill, first, n;
+    if (fill > 0) {
+        first = (detector->history_head + pre - fill) % pre;
+        n = (pre - first < fill) ? pre - first : fill;
+        memcpy(
+            detector->window, &detector->history[first], n * sizeof(uint32_t)
+        );
+        memcpy(
+            &detector->window[n],
+            detector->history,
+            (fill - n) * sizeof(uint32_t)
+        );
+    }
+    detector->window_fill = fill;
+    detector->remaining = detector->post;
+    detector->history_fill = 0;
+    detector->header.magic = ADC_EVENT_MAGIC;
+    detector->header.pre = (uint32_t)fill;
+    detector->header.reserved = 0;
+    detector->header.sequence = detector->events++;
+    detector->header.block = block;
+    detector->header.timestamp_ns = timestamp_ns;
+    detector->header.period_ns = period_ns;
+}
+
+static int write_window(struct adc_detector *detector) {
+    size_t written;
+    detector->header.samples = (uint32_t)detector->window_fill;
+    if (fwrite(&detector->header, sizeof(detector->header), 1, detector->out) !=
+        1)
+        return -EIO;
+    written = fwrite(
+        detector->window,
+        sizeof(uint32_t),
+        detector->window_fill,
+        detector->out
+    );
+    detector->samples_out += written;
+    detector->window_fill = 0;
+    return (written == detector->header.samples) ? 0 : -EIO;
+}
+
+// Process the next block of 'count' words. The first sample of the block was
+// taken at 'timestamp_ns' (CLOCK_REALTIME), one every 'period_ns'. Returns
+// -EIO if a window could not be written.
+int adc_detector_process(
+    struct adc_detector *detector,
+    const uint32_t *raw,
+    size_t count,
+    uint64_t block,
+    uint64_t timestamp_ns,
+    double period_ns
+) {
+    const unsigned int shift = detector->layout.shift;
+    size_t i = 0, n, hit;
+    double mean = 0.0;
+    int32_t prev;
+    int rc;
+
+    detector->samples_in += count;
+    if (detector->mode == ADC_DETECT_DEVIATION) {
+        // The first block is its own baseline
+        mean = block_mean(raw, count, shift);
+        if (!detector->has_baseline) {
+            detector->baseline = mean;
+            detector->has_baseline = true;
+        }
+    }
+    while (i < count) {
+        if (detector->remaining > 0) {
+            n = (detector->remaining < count - i) ? detector->remaining
+                                                  : count - i;
+            memcpy(
+                &detector->window[detector->window_fill],
+                &raw[i],
+                n * sizeof(uint32_t)
+            );
+            detector->window_fill += n;
+            detector->remaining -= n;
+            i += n;
+            if (detector->remaining == 0) {
+                rc = write_window(detector);
+                if (rc < 0)
+                    return rc;
+            }
+            continue;
+        }
+        prev = (i > 0) ? code(raw[i - 1], shift) : detector->last;
+        hit = find_trigger(
+            detector, &raw[i], count - i, prev, i > 0 || detector->has_last
+        );
+        history_push(detector, &raw[i], hit);
+        if (hit == count - i)
+            break;
+        i += hit;
+        start_window(
+            detector,
+            block,
+            timestamp_ns + (uint64_t)llround((double)i * period_ns),
+            period_ns
+        );
+    }
+    if (count > 0) {
+        detector->last = code(raw[count - 1], shift);
+        detector->has_last = true;
+    }
+    if (detector->mode == ADC_DETECT_DEVIATION) {
+        detector->baseline +=
+            (mean - detector->baseline) / ADC_DETECT_BASELINE_BLOCKS;
+    }
+    return 0;
+}
+
+// Write the window of an event that is still in progress at the end of the
+// capture, it is shorter than requested.
+int adc_detector_flush(struct adc_detector *detector) {
+    if (detector->remaining == 0)
+        return 0;
+    detector->remaining = 0;
+    return write_window(detector);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "decode.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define ADC_EVENT_MAGIC 0x45434441
+// Weight of a new block in the running baseline of 'ADC_DETECT_DEVIATION' is
+// 1 / ADC_DETECT_BASELINE_BLOCKS
+#define ADC_DETECT_BASELINE_BLOCKS 16
+// Samples compared at once before the first trigger within them is searched
+#define ADC_DETECT_CHUNK 256
+
+enum adc_detect_mode {
+    // Signal crosses the threshold in either direction
+    ADC_DETECT_LEVEL,
+    // Difference between two consecutive samples of at least the threshold
+    ADC_DETECT_SLOPE,
+    // Distance from the running baseline of at least the threshold
+    ADC_DETECT_DEVIATION,
+};
+
+// Written ahead of the raw data words of every window. 'pre' samples precede
+// the trigger sample, windows at the start of a capture or after a previous
+// window have less than requested.
+struct adc_event_header {
+    uint32_t magic;
+    uint32_t pre;
+    uint32_t samples;
+    uint32_t reserved;
+    uint64_t sequence;
+    // Sequence number of the block of the trigger sample
+    uint64_t block;
+    // CLOCK_REALTIME time of the trigger sample and sample period in ns
+    uint64_t timestamp_ns;
+    double period_ns;
+};
+
+struct adc_detector {
+    enum adc_detect_mode mode;
+    struct adc_word_layout layout;
+    // Threshold in codes, signed for 'ADC_DETECT_LEVEL'
+    int32_t threshold;
+    size_t pre;
+    size_t post;
+    // The last 'pre' words, ring buffer starting at 'history_head'
+    uint32_t *history;
+    size_t history_head;
+    size_t history_fill;
+    // Window of the event in progress, 'remaining' words still missing
+    uint32_t *window;
+    size_t window_fill;
+    size_t remaining;
+    struct adc_event_header header;
+    // Previous sample, for crossings and slopes across blocks
+    int32_t last;
+    bool has_last;
+    double baseline;
+    bool has_baseline;
+    FILE *out;
+    uint64_t events;
+    uint64_t samples_in;
+    uint64_t samples_out;
+};
+
+int adc_detect_mode_parse(const char *name, enum adc_detect_mode *mode);
+int adc_detector_init(
+    struct adc_detector *detector,
+    enum adc_detect_mode mode,
+    const struct adc_word_layout *layout,
+    double threshold_volts,
+    size_t pre,
+    size_t post,
+    FILE *out
+);
+void adc_detector_free(struct adc_detector *detector);
+int adc_detector_process(
+    struct adc_detector *detector,
+    const uint32_t *raw,
+    size_t count,
+    uint64_t block,
+    uint64_t timestamp_ns,
+    double period_ns
+);
+int adc_detector_flush(struct adc_detector *detector);
@@ -1,5 +1,6 @@
 #include "dmaclient.h"
 #include "dmadc.h"
+#include "trace.h"
 
 #include <errno.h>
 #include <fcntl.h>
@@ -11,17 +12,49 @@
 #include <unistd.h>
 
 int open_dma_channel(struct dmadc_channel *channel) {
-    channel->fd = open("/dev/dmadc", O_RDWR);
+    return open_dma_channel_path(channel, DMADC_DEVICE);
+}
+
+// Open the DMA channel of the character device 'path', e.g.
+// 'DMADC_RAW_DEVICE'
+int open_dma_channel_path(struct dmadc_channel *channel, const char *path) {
+    uint64_t t = trace_begin();
+    channel->fd = open(path, O_RDWR);
     if (channel->fd == -1) {
-        fprintf(stderr, "Unable to open '/dev/dmadc'. Is the driver loaded?\n");
+        fprintf(stderr, "Unable to open '%s'. Is the driver loaded?\n", path);
         return -errno;
     }
     channel->buffer = NULL;
     channel->mapped_size = 0;
+    channel->sim = NULL;
+    trace_end("open_dma_channel", t);
+    return 0;
+}
 
+int open_dma_channel_sim(struct dmadc_channel *channel, double sample_rate) {
+    channel->sim = malloc(sizeof(struct dmasim));
+    if (channel->sim == NULL)
+        return -ENOMEM;
+    int fd = dmasim_open(channel->sim, sample_rate);
+    if (fd < 0) {
+        free(channel->sim);
+        channel->sim = NULL;
+        return fd;
+    }
+    channel->fd = fd;
+    channel->buffer = NULL;
+    channel->mapped_size = 0;
     return 0;
 }
 
+static int dmadc_ioctl(
+    struct dmadc_channel *channel, unsigned long request, void *arg
+) {
+    if (channel->sim != NULL)
+        return dmasim_ioctl(channel->sim, request, arg);
+    return ioctl(channel->fd, request, arg);
+}
+
 int dmadc_mmap(struct dmadc_channel *channel, size_t size) {
     if (size > DMADC_BUFFER_SIZE) {
         fprintf(
@@ -33,6 +66,7 @@ int dmadc_mmap(struct dmadc_channel *channel, size_t size) {
         return -EINVAL;
     }
 
+    uint64_t t = trace_begin();
     void *buffer =
         mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, channel->fd, 0);
     if (buffer == MAP_FAILED) {
@@ -40,6 +74,7 @@ int dmadc_mmap(struct dmadc_channel *channel, size_t size) {
     }
     channel->buffer = (uint32_t *)buffer;
     channel->mapped_size = size;
+    trace_end("dmadc_mmap", t);
     return 0;
 }
 
@@ -47,21 +82,37 @@ int dmadc_mmap_buffer(struct dmadc_channel *channel, size_t size) {
     return dmadc_mmap(channel, size);
 }
 
-int close_dma_channel(struct dmadc_channel *channel) {
+int dmadc_munmap(struct dmadc_channel *channel) {
+    uint64_t t = trace_begin();
     if (channel->buffer != NULL && channel->mapped_size > 0) {
         munmap(channel->buffer, channel->mapped_size);
         channel->buffer = NULL;
         channel->mapped_size = 0;
     }
-    // Close file descriptor for "/dev/dmadc". Any errors returned from this
+    trace_end("dmadc_munmap", t);
+    return 0;
+}
+
+int close_dma_channel(struct dmadc_channel *channel) {
+    uint64_t t = trace_begin();
+    dmadc_munmap(channel);
+    // Close file descriptor of the device. Any errors returned from this
     // are ignored for now. If the file is no longer open, we don't care.
     close(channel->fd);
+    if (channel->sim != NULL) {
+        dmasim_close(channel->sim);
+        free(channel->sim);
+        channel->sim = NULL;
+    }
+    trace_end("close_dma_channel", t);
     return 0;
 }
 
 long start_transfer(struct dmadc_channel *channel, unsigned int size) {
     unsigned int size_and_rc = size;
-    long rc = ioctl(channel->fd, START_TRANSFER, &size_and_rc);
+    uint64_t t = trace_begin();
+    long rc = dmadc_ioctl(channel, START_TRANSFER, &size_and_rc);
+    trace_end("start_transfer", t);
     if (rc != 0)
         return -errno;
     return size_and_rc;
@@ -69,7 +120,7 @@ long start_transfer(struct dmadc_channel *channel, unsigned int size) {
 
 long set_timeout_ms(struct dmadc_channel *channel, unsigned int timeout_ms) {
     unsigned int _timeout = timeout_ms;
-    long rc = ioctl(channel->fd, SET_TIMEOUT_MS, &_timeout);
+    long rc = dmadc_ioctl(channel, SET_TIMEOUT_MS, &_timeout);
     if (rc != 0)
         return -errno;
     return 0;
@@ -77,16 +128,27 @@ long set_timeout_ms(struct dmadc_channel *channel, unsigned int timeout_ms) {
 
 enum dmadc_status wait_for_transfer(struct dmadc_channel *channel) {
     enum dmadc_status status = DMADC_ERROR;
-    int rc = ioctl(channel->fd, WAIT_FOR_TRANSFER, &status);
+    uint64_t t = trace_begin();
+    int rc = dmadc_ioctl(channel, WAIT_FOR_TRANSFER, &status);
+    trace_end("wait_for_transfer", t);
     if (rc) {
         return DMADC_ERROR;
     }
     return status;
 }
 
+// Monotonic time at which the last transfer completed, zero if it has not
+// completed (yet).
+uint64_t get_completion_ns(struct dmadc_channel *channel) {
+    uint64_t completion_ns = 0;
+    if (dmadc_ioctl(channel, COMPLETION_TIME, &completion_ns))
+        return 0;
+    return completion_ns;
+}
+
 enum dmadc_status get_status(struct dmadc_channel *channel) {
     enum dmadc_status status = DMADC_ERROR;
-    int rc = ioctl(channel->fd, STATUS, &status);
+    int rc = dmadc_ioctl(channel, STATUS, &status);
     if (rc) {
         return DMADC_ERROR;
     }
@@ -1,19 +1,31 @@
 #pragma once
 
 #include "dmadc.h"
+#include "dmasim.h"
 #include <stddef.h>
 
+// Character devices of the DMA channels. The dual-stream variant of the block
+// design has a second channel for the raw conversion results.
+#define DMADC_DEVICE     "/dev/dmadc"
+#define DMADC_RAW_DEVICE "/dev/dmadc1"
+
 struct dmadc_channel {
     uint32_t *buffer;
     size_t mapped_size;
     int fd;
+    // Stand-in backend, NULL if the channel talks to a '/dev/dmadc' device
+    struct dmasim *sim;
 };
 
 int open_dma_channel(struct dmadc_channel *channel);
+int open_dma_channel_path(struct dmadc_channel *channel, const char *path);
+int open_dma_channel_sim(struct dmadc_channel *channel, double sample_rate);
 int close_dma_channel(struct dmadc_channel *channel);
 int dmadc_mmap(struct dmadc_channel *channel, size_t size);
 int dmadc_mmap_buffer(struct dmadc_channel *channel, size_t size);
+int dmadc_munmap(struct dmadc_channel *channel);
 long start_transfer(struct dmadc_channel *channel, unsigned int size);
 long set_timeout_ms(struct dmadc_channel *channel, unsigned int timeout_ms);
 enum dmadc_status wait_for_transfer(struct dmadc_channel *channel);
 enum dmadc_status get_status(struct dmadc_channel *channel);
+uint64_t get_completion_ns(struct dmadc_channel *channel);
@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+#include "dmasim.h"
+#include "dmadc.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DMASIM_DEFAULT_TIMEOUT_MS 10000
+// Period of the simulated sine wave in samples. A prime number avoids that
+// the signal repeats within common power-of-two transfer sizes.
+#define DMASIM_SINE_PERIOD 1021
+
+static uint64_t dmasim_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void dmasim_sleep_until(uint64_t t_ns) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(t_ns / 1000000000ull),
+        .tv_nsec = (long)(t_ns % 1000000000ull),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+// Fill the buffer with a half-scale sine wave and a few codes of noise in the
+// 'ADC_REG_MODE_32BIT_COM' layout: 24-bit differential data in the upper bits
+// followed by the 8-bit common mode.
+static void dmasim_fill(struct dmasim *sim) {
+    int32_t table[DMASIM_SINE_PERIOD];
+    size_t n = DMADC_BUFFER_SIZE / sizeof(uint32_t);
+    uint32_t lcg = 1;
+    int32_t code;
+    for (size_t i = 0; i < DMASIM_SINE_PERIOD; i++) {
+        double phase = 2.0 * M_PI * (double)i / DMASIM_SINE_PERIOD;
+        table[i] = (int32_t)lrint((double)(1 << 22) * sin(phase));
+    }
+    for (size_t i = 0; i < n; i++) {
+        lcg = lcg * 1664525u + 1013904223u;
+        code = table[i % DMASIM_SINE_PERIOD] + (int32_t)(lcg >> 28) - 8;
+        sim->buffer[i] = ((uint32_t)code << 8) | 0x80;
+    }
+}
+
+static uint64_t dmasim_done_ns(struct dmasim *sim) {
+    if (sim->sample_rate <= 0.0)
+        return sim->start_ns;
+    double samples = (double)(sim->transfer_size / sizeof(uint32_t));
+    return sim->start_ns + (uint64_t)(samples / sim->sample_rate * 1e9);
+}
+
+static enum dmadc_status dmasim_status(struct dmasim *sim) {
+    if (!sim->submitted)
+        return DMADC_NO_TRANSFER;
+    if (dmasim_now_ns() < dmasim_done_ns(sim))
+        return DMADC_IN_PROGRESS;
+    return DMADC_COMPLETE;
+}
+
+int dmasim_open(struct dmasim *sim, double sample_rate) {
+    sim->fd = memfd_create("dmadc-sim", 0);
+    if (sim->fd == -1) {
+        fprintf(stderr, "Unable to create buffer for DMA stand-in\n");
+        return -errno;
+    }
+    if (ftruncate(sim->fd, DMADC_BUFFER_SIZE) != 0) {
+        int rc = -errno;
+        close(sim->fd);
+        return rc;
+    }
+    void *buffer = mmap(
+        NULL,
+        DMADC_BUFFER_SIZE,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        sim->fd,
+        0
+    );
+    if (buffer == MAP_FAILED) {
+        int rc = -errno;
+        close(sim->fd);
+        return rc;
+    }
+    sim->buffer = (uint32_t *)buffer;
+    sim->sample_rate = sample_rate;
+    sim->timeout_ms = DMASIM_DEFAULT_TIMEOUT_MS;
+    sim->transfer_size = 0;
+    sim->start_ns = 0;
+    sim->submitted = false;
+    dmasim_fill(sim);
+    return sim->fd;
+}
+
+void dmasim_close(struct dmasim *sim) {
+    munmap(sim->buffer, DMADC_BUFFER_SIZE);
+    sim->buffer = NULL;
+    // The file descriptor is shared with the channel and closed there.
+}
+
+// Mirrors the ioctl interface of the driver in 'linux/dma/dmadc.c'.
+int dmasim_ioctl(struct dmasim *sim, unsigned long request, void *arg) {
+    uint64_t done_ns, now_ns;
+    uint64_t timeout_ns = (uint64_t)sim->timeout_ms * 1000000ull;
+    unsigned int size;
+    switch (request) {
+        case START_TRANSFER:
+            size = *(unsigned int *)arg;
+            if (dmasim_status(sim) == DMADC_IN_PROGRESS) {
+                *(unsigned int *)arg = EBUSY;
+            } else if (size == 0 || size > DMADC_BUFFER_SIZE ||
+                       size % sizeof(uint32_t) != 0) {
+                *(unsigned int *)arg = EINVAL;
+            } else {
+                sim->transfer_size = size;
+                sim->start_ns = dmasim_now_ns();
+                sim->submitted = true;
+                *(unsigned int *)arg = 0;
+            }
+            return 0;
+        case WAIT_FOR_TRANSFER:
+            if (dmasim_status(sim) == DMADC_IN_PROGRESS) {
+                done_ns = dmasim_done_ns(sim);
+                now_ns = dmasim_now_ns();
+                if (done_ns - now_ns > timeout_ns) {
+                    dmasim_sleep_until(now_ns + timeout_ns);
+                    *(enum dmadc_status *)arg = DMADC_TIMEOUT;
+                    return 0;
+                }
+                dmasim_sleep_until(done_ns);
+            }
+            *(enum dmadc_status *)arg = dmasim_status(sim);
+            return 0;
+        case STATUS:
+            *(enum dmadc_status *)arg = dmasim_status(sim);
+            return 0;
+        case SET_TIMEOUT_MS:
+            sim->timeout_ms = *(unsigned int *)arg;
+            return 0;
+        case COMPLETION_TIME:
+            done_ns = dmasim_done_ns(sim);
+            *(uint64_t *)arg =
+                (dmasim_status(sim) == DMADC_COMPLETE) ? done_ns : 0;
+            return 0;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "dmadc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stand-in for the dmadc driver, used to run the userspace tools without the
+// FPGA. The buffer is backed by a memfd so that 'dmadc_mmap()' works exactly
+// like it does on '/dev/dmadc'. Transfers complete after the time the ADC
+// would need to acquire the requested number of samples at 'sample_rate'.
+struct dmasim {
+    int fd;
+    uint32_t *buffer;
+    double sample_rate;
+    unsigned int timeout_ms;
+    unsigned int transfer_size;
+    uint64_t start_ns;
+    bool submitted;
+};
+
+int dmasim_open(struct dmasim *sim, double sample_rate);
+void dmasim_close(struct dmasim *sim);
+int dmasim_ioctl(struct dmasim *sim, unsigned long request, void *arg);
@@ -0,0 +1,133 @@
+#include "fft.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+int fft_plan_init(struct fft_plan *plan, size_t n) {
+    size_t m = n / 2;
+    if (n < 4 || (n & (n - 1)) != 0)
+        return -EINVAL;
+    plan->n = n;
+    plan->tw_re = malloc(m / 2 * sizeof(double));
+    plan->tw_im = malloc(m / 2 * sizeof(double));
+    plan->rt_re = malloc((m + 1) * sizeof(double));
+    plan->rt_im = malloc((m + 1) * sizeof(double));
+    if (plan->tw_re == NULL || plan->tw_im == NULL || plan->rt_re == NULL ||
+        plan->rt_im == NULL) {
+        fft_plan_free(plan);
+        return -ENOMEM;
+    }
+    // Every factor is computed directly instead of by recurrence, such that
+    // the rounding errors do not accumulate over large transforms.
+    for (size_t k = 0; k < m / 2; k++) {
+        plan->tw_re[k] = cos(2.0 * M_PI * (double)k / (double)m);
+        plan->tw_im[k] = -sin(2.0 * M_PI * (double)k / (double)m);
+    }
+    for (size_t k = 0; k <= m; k++) {
+        plan->rt_re[k] = cos(2.0 * M_PI * (double)k / (double)n);
+        plan->rt_im[k] = -sin(2.0 * M_PI * (double)k / (double)n);
+    }
+    return 0;
+}
+
+void fft_plan_free(struct fft_plan *plan) {
+    free(plan->tw_re);
+    free(plan->tw_im);
+    free(plan->rt_re);
+    free(plan->rt_im);
+    plan->tw_re = NULL;
+    plan->tw_im = NULL;
+    plan->rt_re = NULL;
+    plan->rt_im = NULL;
+}
+
+size_t fft_work_size(const struct fft_plan *plan) {
+    return 2 * plan->n;
+}
+
+// One radix-2 stage of sub-transforms of length 'len' with stride 's'. The
+// loop with more iterations is the inner one: the first stages run over 'p'
+// (contiguous input), the last stages over 'q' (contiguous input and output).
+static void fft_stage(
+    const struct fft_plan *plan,
+    size_t len,
+    size_t s,
+    const double *restrict xr,
+    const double *restrict xi,
+    double *restrict yr,
+    double *restrict yi
+) {
+    const size_t half = len / 2;
+    if (s >= half) {
+        for (size_t p = 0; p < half; p++) {
+            const double wr = plan->tw_re[p * s];
+            const double wi = plan->tw_im[p * s];
+            const double *ar = xr + s * p, *ai = xi + s * p;
+            const double *br = xr + s * (p + half), *bi = xi + s * (p + half);
+            double *evr = yr + s * 2 * p, *evi = yi + s * 2 * p;
+            double *odr = yr + s * (2 * p + 1), *odi = yi + s * (2 * p + 1);
+            for (size_t q = 0; q < s; q++) {
+                const double dr = ar[q] - br[q];
+                const double di = ai[q] - bi[q];
+                evr[q] = ar[q] + br[q];
+                evi[q] = ai[q] + bi[q];
+                odr[q] = dr * wr - di * wi;
+                odi[q] = dr * wi + di * wr;
+            }
+        }
+    } else {
+        for (size_t q = 0; q < s; q++) {
+            for (size_t p = 0; p < half; p++) {
+                const double wr = plan->tw_re[p * s];
+                const double wi = plan->tw_im[p * s];
+                const size_t a = q + s * p, b = q + s * (p + half);
+                const double dr = xr[a] - xr[b];
+                const double di = xi[a] - xi[b];
+                yr[q + s * 2 * p] = xr[a] + xr[b];
+                yi[q + s * 2 * p] = xi[a] + xi[b];
+                yr[q + s * (2 * p + 1)] = dr * wr - di * wi;
+                yi[q + s * (2 * p + 1)] = dr * wi + di * wr;
+            }
+        }
+    }
+}
+
+// Power spectrum |X[k]|^2 for k <= n / 2 of the real sequence 'in' of length
+// 'plan->n', written to 'out' (n / 2 + 1 values). The result is not scaled.
+void fft_power(
+    const struct fft_plan *plan, const double *in, double *out, double *work
+) {
+    const size_t n = plan->n, m = n / 2;
+    double *xr = work, *xi = work + m, *yr = work + 2 * m, *yi = work + 3 * m;
+    double *t;
+
+    // Even samples are the real, odd samples the imaginary part
+    for (size_t k = 0; k < m; k++) {
+        xr[k] = in[2 * k];
+        xi[k] = in[2 * k + 1];
+    }
+    for (size_t len = m, s = 1; len > 1; len /= 2, s *= 2) {
+        fft_stage(plan, len, s, xr, xi, yr, yi);
+        t = xr;
+        xr = yr;
+        yr = t;
+        t = xi;
+        xi = yi;
+        yi = t;
+    }
+
+    // Split Z into the spectra of the even (E) and odd (O) samples and
+    // combine them: X[k] = E[k] + exp(-2 pi i k / n) O[k]
+    for (size_t k = 0; k <= m; k++) {
+        const size_t a = (k == m) ? 0 : k, b = (k == 0) ? 0 : m - k;
+        const double evr = 0.5 * (xr[a] + xr[b]);
+        const double evi = 0.5 * (xi[a] - xi[b]);
+        const double odr = 0.5 * (xi[a] + xi[b]);
+        const double odi = -0.5 * (xr[a] - xr[b]);
+        const double re = evr + odr * plan->rt_re[k] - odi * plan->rt_im[k];
+        const double im = evi + odr * plan->rt_im[k] + odi * plan->rt_re[k];
+        out[k] = re * re + im * im;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+// Real-input FFT of a power-of-two length 'n'. The input is transformed as a
+// complex sequence of 'n / 2' points that is split into the spectrum of the
+// real sequence afterwards. The complex FFT is a radix-2 Stockham FFT on
+// separate real and imaginary arrays, the inner loops run over contiguous
+// memory and are vectorized by the compiler.
+//
+// A plan only holds the twiddle factors and can be shared between threads,
+// every thread passes its own work buffer of 'fft_work_size()' doubles.
+struct fft_plan {
+    size_t n;
+    // exp(-2 pi i k / (n / 2)) for k < n / 4
+    double *tw_re;
+    double *tw_im;
+    // exp(-2 pi i k / n) for k <= n / 2
+    double *rt_re;
+    double *rt_im;
+};
+
+int fft_plan_init(struct fft_plan *plan, size_t n);
+void fft_plan_free(struct fft_plan *plan);
+size_t fft_work_size(const struct fft_plan *plan);
+void fft_power(
+    const struct fft_plan *plan, const double *in, double *out, double *work
+);
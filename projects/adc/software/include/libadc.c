@@ -0,0 +1,309 @@
+#include "libadc.h"
+#include "adcctl.h"
+#include "capture.h"
+#include "dmaclient.h"
+#include "dmadc.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define LIBADC_DEFAULT_DIVIDER    20
+#define LIBADC_DEFAULT_TIMEOUT_MS 10000
+#define LIBADC_MAX_NUM_AVG        0x10
+
+struct libadc_request {
+    size_t samples;
+    libadc_callback callback;
+    void *user;
+    struct libadc_request *next;
+};
+
+struct libadc {
+    // Protects all members below and is never held during a transfer
+    pthread_mutex_t lock;
+    // Signalled when the lease is returned or a request is queued/completed
+    pthread_cond_t cond;
+
+    struct adc adc;
+    struct dmadc_channel channel;
+    struct libadc_config config;
+    // Set while a capture is running or a completed buffer is in use
+    bool leased;
+    uint64_t sequence;
+
+    // Asynchronous captures, processed in order by a single worker thread
+    // that is started with the first request.
+    pthread_t worker;
+    bool worker_running;
+    bool stopping;
+    struct libadc_request *head;
+    struct libadc_request *tail;
+    size_t pending;
+};
+
+static int check_config(const struct libadc_config *config) {
+    if (config->zone != 1 && config->zone != 2)
+        return -EINVAL;
+    if (config->avg > LIBADC_MAX_NUM_AVG)
+        return -EINVAL;
+    if (config->divider == 0)
+        return -EINVAL;
+    return 0;
+}
+
+static void acquire_lease(struct libadc *handle) {
+    pthread_mutex_lock(&handle->lock);
+    while (handle->leased)
+        pthread_cond_wait(&handle->cond, &handle->lock);
+    handle->leased = true;
+    pthread_mutex_unlock(&handle->lock);
+}
+
+static void return_lease(struct libadc *handle) {
+    pthread_mutex_lock(&handle->lock);
+    handle->leased = false;
+    pthread_cond_broadcast(&handle->cond);
+    pthread_mutex_unlock(&handle->lock);
+}
+
+// Apply the configuration to the hardware. The caller holds the lease.
+static void apply_config(
+    struct libadc *handle, const struct libadc_config *config, bool power_up
+) {
+    uint8_t mode = adc_default_mode(config->test, config->avg);
+    if (config->ddr)
+        mode |= ADC_REG_MODE_DDR;
+    if (!handle->config.sim && power_up) {
+        configure_adc(&handle->adc, mode, config->avg);
+    }
+    configure_adc_trigger(&handle->adc.trigger, config->zone);
+    reset_adc_datapath(&handle->adc);
+    set_timeout_ms(&handle->channel, config->timeout_ms);
+}
+
+void libadc_default_config(struct libadc_config *config) {
+    config->divider = LIBADC_DEFAULT_DIVIDER;
+    config->zone = 2;
+    config->avg = 0;
+    config->test = false;
+    config->ddr = false;
+    config->timeout_ms = LIBADC_DEFAULT_TIMEOUT_MS;
+    config->sim = false;
+    config->sim_rate = 0.0;
+}
+
+size_t libadc_max_samples(void) {
+    return DMADC_BUFFER_SIZE / sizeof(uint32_t);
+}
+
+int libadc_open(struct libadc **handle, const struct libadc_config *config) {
+    struct libadc *h;
+    double rate;
+    int rc;
+
+    rc = check_config(config);
+    if (rc < 0)
+        return rc;
+    h = calloc(1, sizeof(struct libadc));
+    if (h == NULL)
+        return -ENOMEM;
+    h->config = *config;
+
+    rc = config->sim ? open_adc_sim(&h->adc) : open_adc(&h->adc);
+    if (rc < 0) {
+        free(h);
+        return rc;
+    }
+    if (config->sim) {
+        rate = (config->sim_rate > 0.0) ? config->sim_rate
+                                        : adc_sample_rate(config->divider);
+        rc = open_dma_channel_sim(&h->channel, rate);
+    } else {
+        rc = open_dma_channel(&h->channel);
+    }
+    if (rc < 0) {
+        close_adc(&h->adc);
+        free(h);
+        return rc;
+    }
+    // The whole buffer is mapped once and stays mapped for all captures
+    rc = dmadc_mmap(&h->channel, DMADC_BUFFER_SIZE);
+    if (rc < 0) {
+        close_dma_channel(&h->channel);
+        close_adc(&h->adc);
+        free(h);
+        return rc;
+    }
+
+    pthread_mutex_init(&h->lock, NULL);
+    pthread_cond_init(&h->cond, NULL);
+    apply_config(h, config, true);
+    *handle = h;
+    return 0;
+}
+
+void libadc_close(struct libadc *handle) {
+    pthread_mutex_lock(&handle->lock);
+    handle->stopping = true;
+    pthread_cond_broadcast(&handle->cond);
+    pthread_mutex_unlock(&handle->lock);
+    if (handle->worker_running) {
+        pthread_join(handle->worker, NULL);
+    }
+    close_dma_channel(&handle->channel);
+    close_adc(&handle->adc);
+    pthread_cond_destroy(&handle->cond);
+    pthread_mutex_destroy(&handle->lock);
+    free(handle);
+}
+
+int libadc_configure(
+    struct libadc *handle, const struct libadc_config *config
+) {
+    int rc = check_config(config);
+    bool power_up;
+    if (rc < 0)
+        return rc;
+    if (config->sim != handle->config.sim)
+        return -EINVAL;
+    acquire_lease(handle);
+    // Only go through the (slow) ADC register configuration if any of the
+    // settings of the ADC itself changed.
+    power_up = config->avg != handle->config.avg ||
+               config->test != handle->config.test ||
+               config->ddr != handle->config.ddr;
+    apply_config(handle, config, power_up);
+    pthread_mutex_lock(&handle->lock);
+    handle->config = *config;
+    pthread_mutex_unlock(&handle->lock);
+    return_lease(handle);
+    return 0;
+}
+
+int libadc_capture(
+    struct libadc *handle, size_t samples, struct libadc_buffer *buffer
+) {
+    enum dmadc_status status;
+    uint32_t divider;
+
+    if (samples == 0 || samples > libadc_max_samples())
+        return -EINVAL;
+    acquire_lease(handle);
+    pthread_mutex_lock(&handle->lock);
+    divider = handle->config.divider;
+    pthread_mutex_unlock(&handle->lock);
+
+    status = capture_block(&handle->adc, &handle->channel, samples, divider);
+    if (status != DMADC_COMPLETE) {
+        return_lease(handle);
+        return (status == DMADC_TIMEOUT) ? -ETIMEDOUT : -EIO;
+    }
+
+    pthread_mutex_lock(&handle->lock);
+    buffer->data = handle->channel.buffer;
+    buffer->samples = samples;
+    buffer->sequence = handle->sequence++;
+    pthread_mutex_unlock(&handle->lock);
+    return 0;
+}
+
+void libadc_release(struct libadc *handle, struct libadc_buffer *buffer) {
+    buffer->data = NULL;
+    buffer->samples = 0;
+    return_lease(handle);
+}
+
+static void *libadc_worker(void *arg) {
+    struct libadc *handle = arg;
+    struct libadc_request *request;
+    struct libadc_buffer buffer;
+    bool retain, cancel;
+    int rc;
+
+    pthread_mutex_lock(&handle->lock);
+    for (;;) {
+        while (handle->head == NULL && !handle->stopping)
+            pthread_cond_wait(&handle->cond, &handle->lock);
+        request = handle->head;
+        if (request == NULL)
+            break;
+        handle->head = request->next;
+        if (handle->head == NULL)
+            handle->tail = NULL;
+        cancel = handle->stopping;
+        pthread_mutex_unlock(&handle->lock);
+
+        if (cancel) {
+            // Requests still queued on close are cancelled
+            request->callback(handle, NULL, -ECANCELED, request->user);
+        } else {
+            rc = libadc_capture(handle, request->samples, &buffer);
+            retain = request->callback(
+                handle, (rc == 0) ? &buffer : NULL, rc, request->user
+            );
+            if (rc == 0 && !retain)
+                libadc_release(handle, &buffer);
+        }
+        free(request);
+
+        pthread_mutex_lock(&handle->lock);
+        handle->pending--;
+        pthread_cond_broadcast(&handle->cond);
+    }
+    pthread_mutex_unlock(&handle->lock);
+    return NULL;
+}
+
+int libadc_capture_async(
+    struct libadc *handle, size_t samples, libadc_callback callback, void *user
+) {
+    struct libadc_request *request;
+    int rc;
+
+    if (samples == 0 || samples > libadc_max_samples() || callback == NULL)
+        return -EINVAL;
+    request = malloc(sizeof(struct libadc_request));
+    if (request == NULL)
+        return -ENOMEM;
+    request->samples = samples;
+    request->callback = callback;
+    request->user = user;
+    request->next = NULL;
+
+    pthread_mutex_lock(&handle->lock);
+    if (handle->stopping) {
+        pthread_mutex_unlock(&handle->lock);
+        free(request);
+        return -ESHUTDOWN;
+    }
+    if (!handle->worker_running) {
+        rc = pthread_create(&handle->worker, NULL, libadc_worker, handle);
+        if (rc != 0) {
+            pthread_mutex_unlock(&handle->lock);
+            free(request);
+            return -rc;
+        }
+        handle->worker_running = true;
+    }
+    if (handle->tail != NULL)
+        handle->tail->next = request;
+    else
+        handle->head = request;
+    handle->tail = request;
+    handle->pending++;
+    pthread_cond_broadcast(&handle->cond);
+    pthread_mutex_unlock(&handle->lock);
+    return 0;
+}
+
+int libadc_wait_idle(struct libadc *handle) {
+    pthread_mutex_lock(&handle->lock);
+    while (handle->pending > 0)
+        pthread_cond_wait(&handle->cond, &handle->lock);
+    pthread_mutex_unlock(&handle->lock);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Embeddable C API for the ADC, built as 'libadc.so'. See 'libadc.hpp' for
+// the C++ wrappers.
+//
+// A handle is configured once on 'libadc_open()' and can then be used for any
+// number of captures. Captured data is not copied: 'struct libadc_buffer'
+// points directly into the DMA buffer. As there is a single DMA buffer, a
+// completed capture holds a lease on it until 'libadc_release()' is called,
+// and further captures wait for the lease. All functions are thread-safe.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct libadc;
+
+struct libadc_config {
+    // Number of 'adc_clk' cycles per conversion minus one
+    uint32_t divider;
+    // Acquisition zone, either 1 or 2
+    unsigned int zone;
+    // Number of averages, max. 16
+    uint8_t avg;
+    // Test pattern mode
+    bool test;
+    // Read the conversion results at double data rate, see 'adc --ddr'
+    bool ddr;
+    unsigned int timeout_ms;
+    // Use the stand-in backend instead of the hardware
+    bool sim;
+    // Sample rate of the stand-in, zero to derive it from 'divider'
+    double sim_rate;
+};
+
+struct libadc_buffer {
+    // Raw words as transferred by the DMA, valid until released
+    const uint32_t *data;
+    size_t samples;
+    // Number of completed captures on this handle before this one
+    uint64_t sequence;
+};
+
+// Called from the worker thread of the handle once an asynchronous capture
+// completed. 'status' is zero on success or a negative error number, in which
+// case 'buffer' is NULL. If the callback returns true, the lease on the buffer
+// is retained and has to be returned with 'libadc_release()' later. Otherwise
+// the buffer is released as soon as the callback returns.
+typedef bool (*libadc_callback)(
+    struct libadc *handle,
+    struct libadc_buffer *buffer,
+    int status,
+    void *user
+);
+
+void libadc_default_config(struct libadc_config *config);
+int libadc_open(struct libadc **handle, const struct libadc_config *config);
+void libadc_close(struct libadc *handle);
+int libadc_configure(struct libadc *handle, const struct libadc_config *config);
+int libadc_capture(
+    struct libadc *handle, size_t samples, struct libadc_buffer *buffer
+);
+void libadc_release(struct libadc *handle, struct libadc_buffer *buffer);
+int libadc_capture_async(
+    struct libadc *handle, size_t samples, libadc_callback callback, void *user
+);
+int libadc_wait_idle(struct libadc *handle);
+size_t libadc_max_samples(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,190 @@
+#pragma once
+
+// Header-only C++ wrappers for 'libadc.h'.
+//
+//     adc::Device device(adc::Device::default_config());
+//     adc::Buffer buffer = device.capture(4096);
+//     process(buffer.begin(), buffer.end());
+//
+//     std::future<adc::Buffer> next = device.capture_async(4096);
+//
+// 'adc::Buffer' points into the DMA buffer and holds its lease. It has to be
+// destroyed (or released) before the next capture can complete and before
+// the 'adc::Device' it came from.
+
+#include "libadc.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+namespace adc {
+
+class Buffer {
+  public:
+    Buffer() = default;
+    Buffer(struct libadc *handle, const struct libadc_buffer &buffer)
+        : handle_(handle), buffer_(buffer) {}
+    Buffer(const Buffer &) = delete;
+    Buffer &operator=(const Buffer &) = delete;
+    Buffer(Buffer &&other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)),
+          buffer_(other.buffer_) {}
+    Buffer &operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            release();
+            handle_ = std::exchange(other.handle_, nullptr);
+            buffer_ = other.buffer_;
+        }
+        return *this;
+    }
+    ~Buffer() { release(); }
+
+    // Return the lease early, the data must not be accessed afterwards
+    void release() {
+        if (handle_ != nullptr) {
+            libadc_release(handle_, &buffer_);
+            handle_ = nullptr;
+        }
+    }
+
+    const std::uint32_t *data() const { return buffer_.data; }
+    std::size_t size() const { return buffer_.samples; }
+    std::uint64_t sequence() const { return buffer_.sequence; }
+    const std::uint32_t *begin() const { return buffer_.data; }
+    const std::uint32_t *end() const { return buffer_.data + buffer_.samples; }
+    std::uint32_t operator[](std::size_t index) const {
+        return buffer_.data[index];
+    }
+    explicit operator bool() const { return handle_ != nullptr; }
+
+  private:
+    struct libadc *handle_ = nullptr;
+    struct libadc_buffer buffer_ = {nullptr, 0, 0};
+};
+
+class Device {
+  public:
+    // Invoked on the worker thread of the device and must not throw. The
+    // buffer is released when the callback returns, unless it is moved out.
+    using Callback = std::function<void(Buffer &buffer, std::error_code)>;
+
+    static struct libadc_config default_config() {
+        struct libadc_config config;
+        libadc_default_config(&config);
+        return config;
+    }
+
+    explicit Device(const struct libadc_config &config = default_config()) {
+        check(libadc_open(&handle_, &config), "libadc_open");
+    }
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
+    Device(Device &&other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)) {}
+    Device &operator=(Device &&other) noexcept {
+        if (this != &other) {
+            close();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Device() { close(); }
+
+    void configure(const struct libadc_config &config) {
+        check(libadc_configure(handle_, &config), "libadc_configure");
+    }
+
+    Buffer capture(std::size_t samples) {
+        struct libadc_buffer buffer;
+        check(libadc_capture(handle_, samples, &buffer), "libadc_capture");
+        return Buffer(handle_, buffer);
+    }
+
+    void capture_async(std::size_t samples, Callback callback) {
+        auto context = std::make_unique<Callback>(std::move(callback));
+        check(
+            libadc_capture_async(
+                handle_, samples, &Device::on_callback, context.get()
+            ),
+            "libadc_capture_async"
+        );
+        context.release();
+    }
+
+    std::future<Buffer> capture_async(std::size_t samples) {
+        auto promise = std::make_unique<std::promise<Buffer>>();
+        std::future<Buffer> future = promise->get_future();
+        check(
+            libadc_capture_async(
+                handle_, samples, &Device::on_promise, promise.get()
+            ),
+            "libadc_capture_async"
+        );
+        promise.release();
+        return future;
+    }
+
+    void wait_idle() { libadc_wait_idle(handle_); }
+
+    static std::size_t max_samples() { return libadc_max_samples(); }
+
+    struct libadc *native_handle() const { return handle_; }
+
+  private:
+    static void check(int rc, const char *what) {
+        if (rc < 0)
+            throw std::system_error(-rc, std::generic_category(), what);
+    }
+
+    void close() {
+        if (handle_ != nullptr) {
+            libadc_close(handle_);
+            handle_ = nullptr;
+        }
+    }
+
+    static bool on_callback(
+        struct libadc *handle,
+        struct libadc_buffer *buffer,
+        int status,
+        void *user
+    ) {
+        std::unique_ptr<Callback> callback(static_cast<Callback *>(user));
+        Buffer wrapped;
+        if (status == 0)
+            wrapped = Buffer(handle, *buffer);
+        (*callback)(wrapped, std::error_code(-status, std::generic_category()));
+        // 'wrapped' releases the lease when it goes out of scope, unless the
+        // callback moved it elsewhere. Either way, libadc must not release it.
+        return status == 0;
+    }
+
+    static bool on_promise(
+        struct libadc *handle,
+        struct libadc_buffer *buffer,
+        int status,
+        void *user
+    ) {
+        std::unique_ptr<std::promise<Buffer>> promise(
+            static_cast<std::promise<Buffer> *>(user)
+        );
+        if (status < 0) {
+            promise->set_exception(std::make_exception_ptr(std::system_error(
+                -status, std::generic_category(), "libadc_capture_async"
+            )));
+            return false;
+        }
+        // The lease is retained and handed over to the future
+        promise->set_value(Buffer(handle, *buffer));
+        return true;
+    }
+
+    struct libadc *handle_ = nullptr;
+};
+
+} // namespace adc
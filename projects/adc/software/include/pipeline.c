@@ -0,0 +1,239 @@
+#include "pipeline.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void sem_wait_retry(sem_t *sem) {
+    while (sem_wait(sem) != 0 && errno == EINTR)
+        ;
+}
+
+int pipeline_init(
+    struct pipeline *pipeline, size_t num_blocks, size_t block_samples
+) {
+    memset(pipeline, 0, sizeof(struct pipeline));
+    pipeline->blocks = calloc(num_blocks, sizeof(struct pipeline_block));
+    if (pipeline->blocks == NULL)
+        return -ENOMEM;
+    pipeline->num_blocks = num_blocks;
+    pipeline->block_samples = block_samples;
+    // Before the blocks, 'pipeline_free()' destroys it on failure
+    sem_init(&pipeline->free_blocks, 0, (unsigned int)num_blocks);
+    for (size_t i = 0; i < num_blocks; i++) {
+        pipeline->blocks[i].data = malloc(block_samples * sizeof(uint32_t));
+        if (pipeline->blocks[i].data == NULL) {
+            pipeline_free(pipeline);
+            return -ENOMEM;
+        }
+        atomic_init(&pipeline->blocks[i].refs, 0);
+    }
+    return 0;
+}
+
+void pipeline_free(struct pipeline *pipeline) {
+    struct pipeline_consumer *c;
+    for (size_t i = 0; i < pipeline->num_consumers; i++) {
+        c = &pipeline->consumers[i];
+        sem_destroy(&c->items);
+        sem_destroy(&c->space);
+        free(c->ring.slots);
+    }
+    pipeline->num_consumers = 0;
+    if (pipeline->blocks != NULL) {
+        for (size_t i = 0; i < pipeline->num_blocks; i++)
+            free(pipeline->blocks[i].data);
+        free(pipeline->blocks);
+        pipeline->blocks = NULL;
+        sem_destroy(&pipeline->free_blocks);
+    }
+}
+
+// Add a consumer before the pipeline is started. 'depth' is the number of
+// blocks the consumer can fall behind before its policy applies, it is
+// rounded up to a power of two.
+int pipeline_add_consumer(
+    struct pipeline *pipeline,
+    const char *name,
+    enum pipeline_policy policy,
+    size_t depth,
+    pipeline_consume consume,
+    void *user
+) {
+    struct pipeline_consumer *c;
+    size_t size = 1;
+    if (pipeline->running || pipeline->num_consumers == PIPELINE_MAX_CONSUMERS)
+        return -EINVAL;
+    // One more slot for the sentinel that stops the consumer
+    while (size < depth + 1)
+        size *= 2;
+    c = &pipeline->consumers[pipeline->num_consumers];
+    memset(c, 0, sizeof(struct pipeline_consumer));
+    c->ring.slots = calloc(size, sizeof(struct pipeline_block *));
+    if (c->ring.slots == NULL)
+        return -ENOMEM;
+    c->ring.mask = size - 1;
+    atomic_init(&c->ring.head, 0);
+    atomic_init(&c->ring.tail, 0);
+    c->name = name;
+    c->policy = policy;
+    c->consume = consume;
+    c->user = user;
+    c->pipeline = pipeline;
+    sem_init(&c->items, 0, 0);
+    sem_init(&c->space, 0, (unsigned int)depth);
+    pipeline->num_consumers++;
+    return 0;
+}
+
+static void ring_push(
+    struct pipeline_consumer *c, struct pipeline_block *block
+) {
+    size_t head = atomic_load_explicit(&c->ring.head, memory_order_relaxed);
+    size_t depth;
+    c->ring.slots[head & c->ring.mask] = block;
+    atomic_store_explicit(&c->ring.head, head + 1, memory_order_release);
+    sem_post(&c->items);
+    depth =
+        head + 1 - atomic_load_explicit(&c->ring.tail, memory_order_acquire);
+    if (block != NULL && depth > c->max_depth)
+        c->max_depth = depth;
+}
+
+static struct pipeline_block *ring_pop(struct pipeline_consumer *c) {
+    size_t tail = atomic_load_explicit(&c->ring.tail, memory_order_relaxed);
+    struct pipeline_block *block;
+    sem_wait_retry(&c->items);
+    // Pairs with the release store in 'ring_push()', such that the slot (and
+    // the data of the block) are visible.
+    atomic_load_explicit(&c->ring.head, memory_order_acquire);
+    block = c->ring.slots[tail & c->ring.mask];
+    atomic_store_explicit(&c->ring.tail, tail + 1, memory_order_release);
+    return block;
+}
+
+static void *pipeline_consumer_thread(void *arg) {
+    struct pipeline_consumer *c = arg;
+    struct pipeline_block *block;
+    uint64_t t;
+    int rc;
+
+    trace_thread_name(c->name);
+    for (;;) {
+        block = ring_pop(c);
+        if (block == NULL)
+            break;
+        t = trace_begin();
+        rc = c->consume(block, c->user);
+        trace_end(c->name, t);
+        if (rc < 0) {
+            // Errors do not stop the consumer, the blocks are still released
+            // such that the other consumers are not affected.
+            c->errors++;
+            if (c->rc == 0)
+                c->rc = rc;
+        }
+        pipeline_release(c->pipeline, block);
+        sem_post(&c->space);
+    }
+    return NULL;
+}
+
+// Push the sentinel to the first 'count' consumers and join their threads
+static int stop_consumers(struct pipeline *pipeline, size_t count) {
+    struct pipeline_consumer *c;
+    int rc = 0;
+    for (size_t i = 0; i < count; i++) {
+        // The ring has a spare slot for the sentinel
+        ring_push(&pipeline->consumers[i], NULL);
+    }
+    for (size_t i = 0; i < count; i++) {
+        c = &pipeline->consumers[i];
+        pthread_join(c->thread, NULL);
+        if (rc == 0)
+            rc = c->rc;
+    }
+    return rc;
+}
+
+int pipeline_start(struct pipeline *pipeline) {
+    struct pipeline_consumer *c;
+    int rc;
+    for (size_t i = 0; i < pipeline->num_consumers; i++) {
+        c = &pipeline->consumers[i];
+        rc = pthread_create(&c->thread, NULL, pipeline_consumer_thread, c);
+        if (rc != 0) {
+            stop_consumers(pipeline, i);
+            return -rc;
+        }
+    }
+    pipeline->running = true;
+    return 0;
+}
+
+// Get a block with no references from the pool, waits until one of the
+// consumers releases a block if all of them are in use. The caller holds the
+// only reference until the block is published or released.
+struct pipeline_block *pipeline_acquire(struct pipeline *pipeline) {
+    struct pipeline_block *block;
+    if (sem_trywait(&pipeline->free_blocks) != 0) {
+        pipeline->pool_waits++;
+        sem_wait_retry(&pipeline->free_blocks);
+    }
+    for (size_t i = 0; i < pipeline->num_blocks; i++) {
+        block = &pipeline->blocks[i];
+        if (atomic_load_explicit(&block->refs, memory_order_acquire) == 0) {
+            atomic_store_explicit(&block->refs, 1, memory_order_relaxed);
+            return block;
+        }
+    }
+    // Not reached, the semaphore never counts more than the free blocks
+    return NULL;
+}
+
+// Hand the block to every consumer and drop the reference of the caller.
+// Consumers with a full ring either make the caller wait or skip the block,
+// depending on their policy.
+void pipeline_publish(
+    struct pipeline *pipeline, struct pipeline_block *block
+) {
+    struct pipeline_consumer *c;
+    block->sequence = pipeline->sequence++;
+    for (size_t i = 0; i < pipeline->num_consumers; i++) {
+        c = &pipeline->consumers[i];
+        if (sem_trywait(&c->space) != 0) {
+            if (c->policy == PIPELINE_DROP) {
+                c->dropped++;
+                continue;
+            }
+            c->waits++;
+            sem_wait_retry(&c->space);
+        }
+        atomic_fetch_add_explicit(&block->refs, 1, memory_order_relaxed);
+        ring_push(c, block);
+        c->delivered++;
+    }
+    pipeline_release(pipeline, block);
+}
+
+void pipeline_release(
+    struct pipeline *pipeline, struct pipeline_block *block
+) {
+    if (atomic_fetch_sub_explicit(&block->refs, 1, memory_order_acq_rel) == 1)
+        sem_post(&pipeline->free_blocks);
+}
+
+// Let the consumers process all published blocks and join their threads.
+// Returns the first error of any consumer.
+int pipeline_stop(struct pipeline *pipeline) {
+    if (!pipeline->running)
+        return 0;
+    pipeline->running = false;
+    return stop_consumers(pipeline, pipeline->num_consumers);
+}
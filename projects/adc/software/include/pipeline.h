@@ -0,0 +1,103 @@
+#pragma once
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PIPELINE_MAX_CONSUMERS 8
+#define PIPELINE_CACHE_LINE    64
+
+// Block of samples copied out of the DMA buffer. Blocks are handed to the
+// consumers by reference and return to the pool once the last consumer
+// released them.
+struct pipeline_block {
+    uint32_t *data;
+    size_t samples;
+    uint64_t sequence;
+    // CLOCK_REALTIME time of the first sample and the sample period in ns
+    uint64_t timestamp_ns;
+    double period_ns;
+    atomic_uint refs;
+};
+
+// What happens if the ring of a consumer is full when a block is published
+enum pipeline_policy {
+    // Wait for the consumer (lossless, e.g. writing to disk)
+    PIPELINE_WAIT,
+    // Skip the block for this consumer (lossy, e.g. a live preview)
+    PIPELINE_DROP,
+};
+
+// Called on the thread of the consumer for every block, in order. The block
+// must not be accessed after the callback returns.
+typedef int (*pipeline_consume)(const struct pipeline_block *block, void *user);
+
+// Lock-free single-producer/single-consumer ring of block pointers. 'head' is
+// only written by the producer, 'tail' only by the consumer.
+struct spsc_ring {
+    _Alignas(PIPELINE_CACHE_LINE) atomic_size_t head;
+    _Alignas(PIPELINE_CACHE_LINE) atomic_size_t tail;
+    size_t mask;
+    struct pipeline_block **slots;
+};
+
+struct pipeline_consumer {
+    const char *name;
+    enum pipeline_policy policy;
+    pipeline_consume consume;
+    void *user;
+    struct spsc_ring ring;
+    // Filled and free slots of the ring, only used to sleep and wake up,
+    // the ring itself is accessed without locks.
+    sem_t items;
+    sem_t space;
+    pthread_t thread;
+    struct pipeline *pipeline;
+    // Updated by the producer
+    uint64_t delivered;
+    uint64_t dropped;
+    uint64_t waits;
+    size_t max_depth;
+    // Updated by the consumer
+    uint64_t errors;
+    int rc;
+};
+
+struct pipeline {
+    struct pipeline_block *blocks;
+    size_t num_blocks;
+    size_t block_samples;
+    // Number of blocks with no references
+    sem_t free_blocks;
+    uint64_t sequence;
+    // Number of times no block was free when one was acquired
+    uint64_t pool_waits;
+    struct pipeline_consumer consumers[PIPELINE_MAX_CONSUMERS];
+    size_t num_consumers;
+    bool running;
+};
+
+int pipeline_init(
+    struct pipeline *pipeline, size_t num_blocks, size_t block_samples
+);
+void pipeline_free(struct pipeline *pipeline);
+int pipeline_add_consumer(
+    struct pipeline *pipeline,
+    const char *name,
+    enum pipeline_policy policy,
+    size_t depth,
+    pipeline_consume consume,
+    void *user
+);
+int pipeline_start(struct pipeline *pipeline);
+struct pipeline_block *pipeline_acquire(struct pipeline *pipeline);
+void pipeline_publish(
+    struct pipeline *pipeline, struct pipeline_block *block
+);
+void pipeline_release(
+    struct pipeline *pipeline, struct pipeline_block *block
+);
+int pipeline_stop(struct pipeline *pipeline);
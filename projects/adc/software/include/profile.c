@@ -0,0 +1,74 @@
+#include "profile.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The profile is a text file of 'key=value' lines. Unknown keys are ignored,
+// such that older versions of the tools can read newer profiles.
+int adc_profile_load(const char *path, struct adc_profile *profile) {
+    char line[128], *value;
+    int found = 0;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return -errno;
+    memset(profile, 0, sizeof(struct adc_profile));
+    while (fgets(line, sizeof(line), file) != NULL) {
+        value = strchr(line, '=');
+        if (line[0] == '#' || value == NULL)
+            continue;
+        *value++ = '\0';
+        if (strcmp(line, "divider") == 0) {
+            profile->divider = (uint32_t)strtoul(value, NULL, 10);
+            found |= 1;
+        } else if (strcmp(line, "zone") == 0) {
+            profile->zone = (unsigned int)strtoul(value, NULL, 10);
+            found |= 2;
+        } else if (strcmp(line, "sample_rate") == 0) {
+            profile->sample_rate = strtod(value, NULL);
+        } else if (strcmp(line, "pattern") == 0) {
+            profile->pattern = (uint32_t)strtoul(value, NULL, 16);
+        } else if (strcmp(line, "calibrated") == 0) {
+            profile->calibrated = strtoll(value, NULL, 10);
+        }
+    }
+    fclose(file);
+    if (found != 3 || profile->divider == 0 ||
+        (profile->zone != 1 && profile->zone != 2)) {
+        fprintf(stderr, "Invalid profile %s\n", path);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// Write to a temporary file first and rename it, such that a profile is never
+// left half-written.
+int adc_profile_save(const char *path, const struct adc_profile *profile) {
+    char tmp[256];
+    FILE *file;
+    int rc = 0;
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return -ENAMETOOLONG;
+    file = fopen(tmp, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", tmp);
+        return -errno;
+    }
+    fprintf(file, "# Written by 'adc --calibrate'\n");
+    fprintf(file, "divider=%" PRIu32 "\n", profile->divider);
+    fprintf(file, "zone=%u\n", profile->zone);
+    fprintf(file, "sample_rate=%.1f\n", profile->sample_rate);
+    fprintf(file, "pattern=%08" PRIX32 "\n", profile->pattern);
+    fprintf(file, "calibrated=%" PRId64 "\n", profile->calibrated);
+    if (fclose(file) != 0)
+        rc = -EIO;
+    if (rc == 0 && rename(tmp, path) != 0)
+        rc = -errno;
+    if (rc < 0) {
+        fprintf(stderr, "Unable to write profile %s\n", path);
+        remove(tmp);
+    }
+    return rc;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+// Board profile written by 'adc --calibrate'. It stays with the SD card of
+// the board that was calibrated.
+#define ADC_PROFILE_PATH "/etc/adc-profile"
+
+struct adc_profile {
+    // Lowest divider (highest sample rate) without errors in the test
+    // pattern, and the zone it was found with
+    uint32_t divider;
+    unsigned int zone;
+    double sample_rate;
+    uint32_t pattern;
+    // Seconds since the epoch
+    int64_t calibrated;
+};
+
+int adc_profile_load(const char *path, struct adc_profile *profile);
+int adc_profile_save(const char *path, const struct adc_profile *profile);
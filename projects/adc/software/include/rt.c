@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+#include "rt.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+// CLOCK_MONOTONIC in ns, the same clock as used for 'get_completion_ns()'
+uint64_t rt_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Lock all current and future pages of the process into memory
+int rt_lock_memory(void) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "Unable to lock memory: %s\n", strerror(errno));
+        return -errno;
+    }
+    return 0;
+}
+
+// Write to every page of 'buffer', such that no page faults occur later on.
+void rt_prefault(void *buffer, size_t size) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    volatile uint8_t *bytes = buffer;
+    for (size_t i = 0; i < size; i += (size_t)page_size) {
+        bytes[i] = bytes[i];
+    }
+}
+
+// Pin 'thread' to 'cpu' (unless negative) and run it with SCHED_FIFO at
+// 'priority' (unless zero).
+int rt_setup_thread(pthread_t thread, int cpu, int priority) {
+    struct sched_param param = {.sched_priority = priority};
+    cpu_set_t cpus;
+    int rc;
+
+    if (cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        rc = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus);
+        if (rc != 0) {
+            fprintf(stderr, "Unable to pin thread to CPU %d\n", cpu);
+            return -rc;
+        }
+    }
+    if (priority > 0) {
+        rc = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (rc != 0) {
+            fprintf(
+                stderr,
+                "Unable to set SCHED_FIFO priority %d: %s\n",
+                priority,
+                strerror(rc)
+            );
+            return -rc;
+        }
+    }
+    return 0;
+}
+
+void rt_latency_init(struct rt_latency *latency) {
+    memset(latency, 0, sizeof(struct rt_latency));
+    latency->min_ns = UINT64_MAX;
+}
+
+void rt_latency_add(struct rt_latency *latency, uint64_t ns) {
+    uint64_t bin = ns / RT_LATENCY_BIN_NS;
+    if (bin < RT_LATENCY_BINS)
+        latency->bins[bin]++;
+    else
+        latency->overflow++;
+    latency->count++;
+    latency->sum_ns += ns;
+    latency->min_ns = (ns < latency->min_ns) ? ns : latency->min_ns;
+    latency->max_ns = (ns > latency->max_ns) ? ns : latency->max_ns;
+}
+
+// Upper bound of the bin that contains the percentile 'p' (0 to 100), at
+// most the maximum latency.
+uint64_t rt_latency_percentile(const struct rt_latency *latency, double p) {
+    uint64_t target = (uint64_t)((double)latency->count * p / 100.0 + 0.5);
+    uint64_t seen = 0, bound;
+    for (size_t i = 0; i < RT_LATENCY_BINS; i++) {
+        seen += latency->bins[i];
+        if (seen >= target && seen > 0) {
+            bound = (i + 1) * RT_LATENCY_BIN_NS;
+            return (bound < latency->max_ns) ? bound : latency->max_ns;
+        }
+    }
+    return latency->max_ns;
+}
+
+// Write all non-empty bins as 'latency_us,count' lines, the value is the lower
+// bound of the bin.
+int rt_latency_write(const struct rt_latency *latency, FILE *file) {
+    if (fprintf(file, "latency_us,count\n") < 0)
+        return -EIO;
+    for (size_t i = 0; i < RT_LATENCY_BINS; i++) {
+        if (latency->bins[i] == 0)
+            continue;
+        if (fprintf(
+                file,
+                "%zu,%llu\n",
+                i * RT_LATENCY_BIN_NS / 1000,
+                (unsigned long long)latency->bins[i]
+            ) < 0)
+            return -EIO;
+    }
+    // The overflow bin is the last line, it includes all larger latencies
+    if (latency->overflow > 0 &&
+        fprintf(
+            file,
+            "%d,%llu\n",
+            RT_LATENCY_BINS * RT_LATENCY_BIN_NS / 1000,
+            (unsigned long long)latency->overflow
+        ) < 0)
+        return -EIO;
+    return 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Resolution and range of the wake-up latency histogram
+#define RT_LATENCY_BIN_NS 1000
+#define RT_LATENCY_BINS   10000
+
+// Histogram of latencies in nanoseconds. Latencies beyond the last bin are
+// only counted in 'overflow', 'max_ns' is exact.
+struct rt_latency {
+    uint64_t bins[RT_LATENCY_BINS];
+    uint64_t overflow;
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+};
+
+uint64_t rt_now_ns(void);
+int rt_lock_memory(void);
+void rt_prefault(void *buffer, size_t size);
+int rt_setup_thread(pthread_t thread, int cpu, int priority);
+void rt_latency_init(struct rt_latency *latency);
+void rt_latency_add(struct rt_latency *latency, uint64_t ns);
+uint64_t rt_latency_percentile(const struct rt_latency *latency, double p);
+int rt_latency_write(const struct rt_latency *latency, FILE *file);
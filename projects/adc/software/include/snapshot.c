@@ -0,0 +1,227 @@
+#include "snapshot.h"
+#include "decode.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Attempts of a reader before giving up, e.g. if the writer died while
+// updating the window
+#define SNAPSHOT_READ_RETRIES 1000
+
+static size_t snapshot_size(uint32_t capacity) {
+    return sizeof(struct adc_snapshot_shm) + capacity * sizeof(float);
+}
+
+// Mark a segment left over from an earlier writer as replaced and remove
+// it. Readers keep their mapping of it, which is never resized, and get
+// -ESTALE from 'adc_snapshot_read()'.
+static void retire_segment(const char *name) {
+    struct adc_snapshot_shm *shm;
+    struct stat st;
+    unsigned int seq;
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd == -1)
+        return;
+    if (fstat(fd, &st) == 0 &&
+        (size_t)st.st_size >= sizeof(struct adc_snapshot_shm)) {
+        shm = mmap(
+            NULL,
+            sizeof(struct adc_snapshot_shm),
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED,
+            fd,
+            0
+        );
+        if (shm != MAP_FAILED) {
+            // Odd while the capacity is changed, even again afterwards
+            seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+            seq = (seq + 1) | 1;
+            atomic_store_explicit(&shm->seq, seq, memory_order_relaxed);
+            atomic_thread_fence(memory_order_release);
+            shm->capacity = 0;
+            atomic_store_explicit(&shm->seq, seq + 1, memory_order_release);
+            munmap(shm, sizeof(struct adc_snapshot_shm));
+        }
+    }
+    close(fd);
+    shm_unlink(name);
+}
+
+// Create (or replace) the segment 'name' for a window of 'capacity' samples.
+// There must only be a single writer per segment. A replaced segment is
+// removed rather than resized, such that readers never lose their mapping.
+int adc_snapshot_create(
+    struct adc_snapshot *snapshot,
+    const char *name,
+    uint32_t capacity,
+    double sample_rate
+) {
+    size_t size = snapshot_size(capacity);
+    int fd, rc;
+    retire_segment(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to create shared memory %s\n", name);
+        return -errno;
+    }
+    if (ftruncate(fd, (off_t)size) == -1) {
+        rc = -errno;
+        close(fd);
+        return rc;
+    }
+    snapshot->shm =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (snapshot->shm == MAP_FAILED) {
+        fprintf(stderr, "Unable to map shared memory %s\n", name);
+        snapshot->shm = NULL;
+        return -errno;
+    }
+    snapshot->size = size;
+    snapshot->capacity = capacity;
+    snapshot->name = name;
+    snapshot->writer = true;
+
+    // Readers that open the segment right away must not see the header
+    // before the window is valid, mark it as being written first.
+    atomic_store_explicit(&snapshot->shm->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    snapshot->shm->magic = ADC_SNAPSHOT_MAGIC;
+    snapshot->shm->version = ADC_SNAPSHOT_VERSION;
+    snapshot->shm->capacity = capacity;
+    snapshot->shm->samples = 0;
+    snapshot->shm->block = 0;
+    snapshot->shm->timestamp_ns = 0;
+    snapshot->shm->sample_rate = sample_rate;
+    atomic_store_explicit(&snapshot->shm->seq, 2, memory_order_release);
+    return 0;
+}
+
+// Map an existing segment read-only
+int adc_snapshot_open(struct adc_snapshot *snapshot, const char *name) {
+    struct stat st;
+    int fd;
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        fprintf(stderr, "Unable to open shared memory %s\n", name);
+        return -errno;
+    }
+    if (fstat(fd, &st) == -1 ||
+        (size_t)st.st_size < sizeof(struct adc_snapshot_shm)) {
+        close(fd);
+        return -EINVAL;
+    }
+    snapshot->shm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (snapshot->shm == MAP_FAILED) {
+        fprintf(stderr, "Unable to map shared memory %s\n", name);
+        snapshot->shm = NULL;
+        return -errno;
+    }
+    snapshot->size = (size_t)st.st_size;
+    snapshot->name = name;
+    snapshot->writer = false;
+    if (snapshot->shm->magic != ADC_SNAPSHOT_MAGIC ||
+        snapshot->shm->version != ADC_SNAPSHOT_VERSION ||
+        snapshot_size(snapshot->shm->capacity) > snapshot->size) {
+        fprintf(stderr, "Invalid snapshot in shared memory %s\n", name);
+        munmap(snapshot->shm, snapshot->size);
+        return -EINVAL;
+    }
+    snapshot->capacity = snapshot->shm->capacity;
+    return 0;
+}
+
+// Unmap the segment, the writer also removes it
+void adc_snapshot_close(struct adc_snapshot *snapshot) {
+    munmap(snapshot->shm, snapshot->size);
+    if (snapshot->writer)
+        shm_unlink(snapshot->name);
+}
+
+// Append the conversion results of 'raw' to the window. Older samples are
+// shifted out, only the last 'capacity' samples of large blocks are kept.
+void adc_snapshot_publish(
+    struct adc_snapshot *snapshot,
+    const uint32_t *raw,
+    size_t count,
+    const struct adc_word_layout *layout,
+    uint64_t block
+) {
+    struct adc_snapshot_shm *shm = snapshot->shm;
+    const size_t capacity = shm->capacity;
+    unsigned int seq = atomic_load_explicit(&shm->seq, memory_order_relaxed);
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    atomic_store_explicit(&shm->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (count >= capacity) {
+        adc_decode_f32(
+            &raw[count - capacity], shm->data, capacity, layout, ADC_VREF
+        );
+        shm->samples = (uint32_t)capacity;
+    } else {
+        memmove(
+            shm->data,
+            &shm->data[count],
+            (capacity - count) * sizeof(float)
+        );
+        adc_decode_f32(
+            raw, &shm->data[capacity - count], count, layout, ADC_VREF
+        );
+        shm->samples = (uint32_t)((shm->samples + count < capacity)
+                                      ? shm->samples + count
+                                      : capacity);
+    }
+    shm->block = block;
+    shm->timestamp_ns =
+        (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    atomic_store_explicit(&shm->seq, seq + 2, memory_order_release);
+}
+
+// Copy a consistent snapshot of the window ('snapshot->capacity' samples) to
+// 'out'. The valid samples are at the end of 'out', 'info->samples' of them.
+// The writer is never blocked, the copy is retried if it was updated
+// meanwhile. Returns -ESTALE if the segment was replaced, open it again.
+int adc_snapshot_read(
+    const struct adc_snapshot *snapshot,
+    float *out,
+    struct adc_snapshot_info *info
+) {
+    const struct adc_snapshot_shm *shm = snapshot->shm;
+    unsigned int before, after;
+    for (unsigned int i = 0; i < SNAPSHOT_READ_RETRIES; i++) {
+        before = atomic_load_explicit(
+            (atomic_uint *)&shm->seq, memory_order_acquire
+        );
+        if (before & 1) {
+            sched_yield();
+            continue;
+        }
+        if (shm->capacity != snapshot->capacity)
+            return -ESTALE;
+        memcpy(out, shm->data, snapshot->capacity * sizeof(float));
+        info->samples = shm->samples;
+        info->block = shm->block;
+        info->timestamp_ns = shm->timestamp_ns;
+        info->sample_rate = shm->sample_rate;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(
+            (atomic_uint *)&shm->seq, memory_order_relaxed
+        );
+        if (before == after)
+            return 0;
+    }
+    return -EAGAIN;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "decode.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADC_SNAPSHOT_MAGIC           0x50534441
+#define ADC_SNAPSHOT_VERSION         1
+#define ADC_SNAPSHOT_DEFAULT_NAME    "/adc-snapshot"
+#define ADC_SNAPSHOT_DEFAULT_SAMPLES 4096
+#define ADC_SNAPSHOT_MAX_SAMPLES     (1 << 20)
+
+// Layout of the shared-memory segment. The window holds the most recent
+// 'samples' conversion results in volts, oldest first. It is protected by a
+// seqlock: the single writer increments 'seq' before (odd) and after (even)
+// every update, readers retry if 'seq' was odd or changed while copying.
+struct adc_snapshot_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    _Alignas(64) atomic_uint seq;
+    uint32_t samples;
+    // Sequence number of the newest block and CLOCK_MONOTONIC time of the
+    // update
+    uint64_t block;
+    uint64_t timestamp_ns;
+    double sample_rate;
+    _Alignas(64) float data[];
+};
+
+struct adc_snapshot {
+    struct adc_snapshot_shm *shm;
+    size_t size;
+    // Capacity of the window when the segment was mapped
+    uint32_t capacity;
+    const char *name;
+    bool writer;
+};
+
+// Consistent copy of the metadata, written by 'adc_snapshot_read()'
+struct adc_snapshot_info {
+    uint32_t samples;
+    uint64_t block;
+    uint64_t timestamp_ns;
+    double sample_rate;
+};
+
+int adc_snapshot_create(
+    struct adc_snapshot *snapshot,
+    const char *name,
+    uint32_t capacity,
+    double sample_rate
+);
+int adc_snapshot_open(struct adc_snapshot *snapshot, const char *name);
+void adc_snapshot_close(struct adc_snapshot *snapshot);
+void adc_snapshot_publish(
+    struct adc_snapshot *snapshot,
+    const uint32_t *raw,
+    size_t count,
+    const struct adc_word_layout *layout,
+    uint64_t block
+);
+int adc_snapshot_read(
+    const struct adc_snapshot *snapshot,
+    float *out,
+    struct adc_snapshot_info *info
+);
@@ -0,0 +1,307 @@
+#include "stats.h"
+#include "decode.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+// Moments of a single chunk relative to 'pivot'. With at most 24-bit codes,
+// the sums are exact in 64-bit integers for 'ADC_STATS_CHUNK' samples.
+struct chunk_moments {
+    int64_t sum;
+    int64_t sum_sq;
+    int32_t min;
+    int32_t max;
+};
+
+int adc_stats_init(struct adc_stats *stats, uint8_t mode) {
+    memset(stats, 0, sizeof(struct adc_stats));
+    if (adc_word_layout(mode, &stats->layout) < 0)
+        return -EINVAL;
+    stats->hist_bits = stats->layout.bits;
+    if (stats->hist_bits > ADC_STATS_HIST_BITS)
+        stats->hist_bits = ADC_STATS_HIST_BITS;
+    stats->hist_shift = stats->layout.bits - stats->hist_bits;
+    stats->num_pages = ((size_t)1 << stats->hist_bits) / ADC_STATS_PAGE_SIZE;
+    stats->min = INT32_MAX;
+    stats->max = INT32_MIN;
+    return 0;
+}
+
+void adc_stats_free(struct adc_stats *stats) {
+    for (size_t i = 0; i < stats->num_pages; i++) {
+        free(stats->pages[i]);
+        stats->pages[i] = NULL;
+    }
+}
+
+static void moments_int(
+    const int32_t *codes, size_t n, int32_t pivot, struct chunk_moments *m
+) {
+    size_t i = 0;
+#ifdef __ARM_NEON
+    int32x4_t vpivot = vdupq_n_s32(pivot);
+    int32x4_t vmin = vdupq_n_s32(INT32_MAX);
+    int32x4_t vmax = vdupq_n_s32(INT32_MIN);
+    int64x2_t vsum = vdupq_n_s64(0);
+    int64x2_t vsum_sq = vdupq_n_s64(0);
+    for (; i + 4 <= n; i += 4) {
+        int32x4_t c = vld1q_s32(codes + i);
+        int32x4_t d = vsubq_s32(c, vpivot);
+        vmin = vminq_s32(vmin, c);
+        vmax = vmaxq_s32(vmax, c);
+        vsum = vpadalq_s32(vsum, d);
+        vsum_sq = vmlal_s32(vsum_sq, vget_low_s32(d), vget_low_s32(d));
+        vsum_sq = vmlal_s32(vsum_sq, vget_high_s32(d), vget_high_s32(d));
+    }
+    int32x2_t min2 = vpmin_s32(vget_low_s32(vmin), vget_high_s32(vmin));
+    int32x2_t max2 = vpmax_s32(vget_low_s32(vmax), vget_high_s32(vmax));
+    m->min = vget_lane_s32(vpmin_s32(min2, min2), 0);
+    m->max = vget_lane_s32(vpmax_s32(max2, max2), 0);
+    m->sum = vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+    m->sum_sq = vgetq_lane_s64(vsum_sq, 0) + vgetq_lane_s64(vsum_sq, 1);
+#else
+    m->min = INT32_MAX;
+    m->max = INT32_MIN;
+    m->sum = 0;
+    m->sum_sq = 0;
+#endif
+    for (; i < n; i++) {
+        int64_t d = (int64_t)codes[i] - pivot;
+        m->min = (codes[i] < m->min) ? codes[i] : m->min;
+        m->max = (codes[i] > m->max) ? codes[i] : m->max;
+        m->sum += d;
+        m->sum_sq += d * d;
+    }
+}
+
+// Combine the mean and sum of squared differences of two sets of samples
+// (Chan et al.), used for chunks and for merging.
+static void combine(
+    struct adc_stats *stats, uint64_t count, double mean, double m2
+) {
+    uint64_t total;
+    double delta;
+    if (count == 0)
+        return;
+    total = stats->count + count;
+    delta = mean - stats->mean;
+    stats->mean += delta * (double)count / (double)total;
+    stats->m2 += m2 + delta * delta * (double)stats->count * (double)count /
+                          (double)total;
+    stats->count = total;
+}
+
+static int histogram_add(
+    struct adc_stats *stats, const int32_t *codes, size_t n
+) {
+    const unsigned int shift = stats->hist_shift;
+    const int32_t offset = 1 << (stats->hist_bits - 1);
+    uint32_t index;
+    uint64_t *page;
+    for (size_t i = 0; i < n; i++) {
+        index = (uint32_t)((codes[i] >> shift) + offset);
+        page = stats->pages[index >> ADC_STATS_PAGE_BITS];
+        if (page == NULL) {
+            page = calloc(ADC_STATS_PAGE_SIZE, sizeof(uint64_t));
+            if (page == NULL)
+                return -ENOMEM;
+            stats->pages[index >> ADC_STATS_PAGE_BITS] = page;
+        }
+        page[index & (ADC_STATS_PAGE_SIZE - 1)]++;
+    }
+    return 0;
+}
+
+static int update_chunk(
+    struct adc_stats *stats, const uint32_t *raw, size_t n, int32_t *codes
+) {
+    const unsigned int shift = stats->layout.shift;
+    struct chunk_moments m;
+    double mean, m2, d;
+
+    // Auto-vectorized
+    for (size_t i = 0; i < n; i++) {
+        codes[i] = (int32_t)raw[i] >> shift;
+    }
+    if (stats->layout.bits <= 24) {
+        moments_int(codes, n, codes[0], &m);
+        mean = (double)codes[0] + (double)m.sum / (double)n;
+        m2 = (double)m.sum_sq - (double)m.sum * (double)m.sum / (double)n;
+    } else {
+        // Squares of 30-bit codes do not fit, use two passes in double
+        m.min = INT32_MAX;
+        m.max = INT32_MIN;
+        mean = 0.0;
+        m2 = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            m.min = (codes[i] < m.min) ? codes[i] : m.min;
+            m.max = (codes[i] > m.max) ? codes[i] : m.max;
+            mean += (double)codes[i];
+        }
+        mean /= (double)n;
+        for (size_t i = 0; i < n; i++) {
+            d = (double)codes[i] - mean;
+            m2 += d * d;
+        }
+    }
+    stats->min = (m.min < stats->min) ? m.min : stats->min;
+    stats->max = (m.max > stats->max) ? m.max : stats->max;
+    combine(stats, n, mean, m2);
+    return histogram_add(stats, codes, n);
+}
+
+// Add 'count' raw words as written by the DMA.
+int adc_stats_update(
+    struct adc_stats *stats, const uint32_t *raw, size_t count
+) {
+    int32_t codes[ADC_STATS_CHUNK];
+    size_t n;
+    int rc;
+    for (size_t i = 0; i < count; i += n) {
+        n = (count - i < ADC_STATS_CHUNK) ? count - i : ADC_STATS_CHUNK;
+        rc = update_chunk(stats, raw + i, n, codes);
+        if (rc < 0)
+            return rc;
+    }
+    return 0;
+}
+
+struct update_job {
+    pthread_t thread;
+    bool started;
+    struct adc_stats *stats;
+    const uint32_t *raw;
+    size_t count;
+    int rc;
+};
+
+static void *update_thread(void *arg) {
+    struct update_job *job = arg;
+    job->rc = adc_stats_update(job->stats, job->raw, job->count);
+    return NULL;
+}
+
+// Split 'raw' into 'num_parts' slices and update 'parts[i]' with slice 'i',
+// each in its own thread. The parts are combined with 'adc_stats_merge()'.
+int adc_stats_update_parallel(
+    struct adc_stats *parts,
+    unsigned int num_parts,
+    const uint32_t *raw,
+    size_t count
+) {
+    struct update_job jobs[num_parts];
+    size_t slice, offset = 0;
+    int rc = 0;
+
+    if (num_parts <= 1)
+        return adc_stats_update(parts, raw, count);
+    // Slices are multiples of the chunk size
+    slice = (count / num_parts + ADC_STATS_CHUNK - 1) / ADC_STATS_CHUNK *
+            ADC_STATS_CHUNK;
+    for (unsigned int i = 0; i < num_parts; i++) {
+        jobs[i].stats = &parts[i];
+        jobs[i].raw = raw + offset;
+        jobs[i].count = (count - offset < slice) ? count - offset : slice;
+        jobs[i].rc = 0;
+        jobs[i].started = false;
+        offset += jobs[i].count;
+    }
+    for (unsigned int i = 1; i < num_parts; i++) {
+        jobs[i].started =
+            pthread_create(&jobs[i].thread, NULL, update_thread, &jobs[i]) == 0;
+        if (!jobs[i].started) {
+            // Fall back to the calling thread
+            update_thread(&jobs[i]);
+        }
+    }
+    update_thread(&jobs[0]);
+    for (unsigned int i = 0; i < num_parts; i++) {
+        if (jobs[i].started)
+            pthread_join(jobs[i].thread, NULL);
+        if (jobs[i].rc < 0)
+            rc = jobs[i].rc;
+    }
+    return rc;
+}
+
+// Add the samples of 'src' to 'dst'. Both have to use the same mode.
+int adc_stats_merge(struct adc_stats *dst, const struct adc_stats *src) {
+    uint64_t *page;
+    if (dst->layout.bits != src->layout.bits ||
+        dst->layout.shift != src->layout.shift)
+        return -EINVAL;
+    dst->min = (src->min < dst->min) ? src->min : dst->min;
+    dst->max = (src->max > dst->max) ? src->max : dst->max;
+    combine(dst, src->count, src->mean, src->m2);
+    for (size_t p = 0; p < src->num_pages; p++) {
+        if (src->pages[p] == NULL)
+            continue;
+        page = dst->pages[p];
+        if (page == NULL) {
+            page = calloc(ADC_STATS_PAGE_SIZE, sizeof(uint64_t));
+            if (page == NULL)
+                return -ENOMEM;
+            dst->pages[p] = page;
+        }
+        for (size_t i = 0; i < ADC_STATS_PAGE_SIZE; i++) {
+            page[i] += src->pages[p][i];
+        }
+    }
+    return 0;
+}
+
+// Sample variance in codes squared
+double adc_stats_variance(const struct adc_stats *stats) {
+    if (stats->count < 2)
+        return 0.0;
+    return stats->m2 / (double)(stats->count - 1);
+}
+
+// Number of histogram bins with at least one sample
+uint64_t adc_stats_bins(const struct adc_stats *stats) {
+    uint64_t bins = 0;
+    for (size_t p = 0; p < stats->num_pages; p++) {
+        if (stats->pages[p] == NULL)
+            continue;
+        for (size_t i = 0; i < ADC_STATS_PAGE_SIZE; i++) {
+            bins += stats->pages[p][i] != 0;
+        }
+    }
+    return bins;
+}
+
+// Write all non-empty bins as 'code,count' lines. Codes are signed and in
+// units of the histogram resolution ('hist_bits').
+int adc_stats_write_histogram(const struct adc_stats *stats, FILE *file) {
+    const int32_t offset = 1 << (stats->hist_bits - 1);
+    int32_t code;
+    if (fprintf(file, "code,count\n") < 0)
+        return -EIO;
+    for (size_t p = 0; p < stats->num_pages; p++) {
+        if (stats->pages[p] == NULL)
+            continue;
+        for (size_t i = 0; i < ADC_STATS_PAGE_SIZE; i++) {
+            if (stats->pages[p][i] == 0)
+                continue;
+            code = (int32_t)(p * ADC_STATS_PAGE_SIZE + i) - offset;
+            if (fprintf(
+                    file,
+                    "%ld,%llu\n",
+                    (long)code,
+                    (unsigned long long)stats->pages[p][i]
+                ) < 0)
+                return -EIO;
+        }
+    }
+    return 0;
+}
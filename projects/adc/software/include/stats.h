@@ -0,0 +1,51 @@
+#pragma once
+
+#include "decode.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Samples processed at once. The codes of a chunk are kept on the stack, such
+// that the DMA buffer is only read once.
+#define ADC_STATS_CHUNK 4096
+// The histogram covers at most 24 bits of the conversion result. It is split
+// into pages of 'ADC_STATS_PAGE_SIZE' codes that are allocated on first use.
+#define ADC_STATS_HIST_BITS 24
+#define ADC_STATS_PAGE_BITS 12
+#define ADC_STATS_PAGE_SIZE (1 << ADC_STATS_PAGE_BITS)
+#define ADC_STATS_MAX_PAGES (1 << (ADC_STATS_HIST_BITS - ADC_STATS_PAGE_BITS))
+
+// Streaming statistics of the conversion results (in codes). Mean and variance
+// are updated block by block using Welford's algorithm, instances that were
+// updated independently (e.g. by multiple threads) can be merged.
+struct adc_stats {
+    struct adc_word_layout layout;
+    uint64_t count;
+    double mean;
+    // Sum of squared differences from the mean
+    double m2;
+    int32_t min;
+    int32_t max;
+    // Histogram codes are the conversion results shifted right by
+    // 'hist_shift', only for formats with more than 24 bits.
+    unsigned int hist_shift;
+    unsigned int hist_bits;
+    size_t num_pages;
+    uint64_t *pages[ADC_STATS_MAX_PAGES];
+};
+
+int adc_stats_init(struct adc_stats *stats, uint8_t mode);
+void adc_stats_free(struct adc_stats *stats);
+int adc_stats_update(
+    struct adc_stats *stats, const uint32_t *raw, size_t count
+);
+int adc_stats_update_parallel(
+    struct adc_stats *parts,
+    unsigned int num_parts,
+    const uint32_t *raw,
+    size_t count
+);
+int adc_stats_merge(struct adc_stats *dst, const struct adc_stats *src);
+double adc_stats_variance(const struct adc_stats *stats);
+uint64_t adc_stats_bins(const struct adc_stats *stats);
+int adc_stats_write_histogram(const struct adc_stats *stats, FILE *file);
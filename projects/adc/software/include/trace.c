@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+struct trace_event {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+// Ring buffer of a single thread. Only the owning thread writes to it, the
+// events are read once all threads are done (see 'trace_close()').
+struct trace_ring {
+    struct trace_ring *next;
+    pid_t tid;
+    const char *thread_name;
+    atomic_uint_fast64_t head;
+    struct trace_event events[TRACE_RING_SIZE];
+};
+
+atomic_bool trace_active = false;
+
+static char *trace_path = NULL;
+// List of the rings of all threads, new rings are pushed to the front
+static _Atomic(struct trace_ring *) trace_rings = NULL;
+static _Thread_local struct trace_ring *trace_ring = NULL;
+
+uint64_t trace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static struct trace_ring *trace_thread_ring(void) {
+    struct trace_ring *ring = trace_ring;
+    if (ring != NULL)
+        return ring;
+    ring = calloc(1, sizeof(struct trace_ring));
+    if (ring == NULL)
+        return NULL;
+    ring->tid = (pid_t)syscall(SYS_gettid);
+    ring->next = atomic_load(&trace_rings);
+    while (!atomic_compare_exchange_weak(&trace_rings, &ring->next, ring))
+        ;
+    trace_ring = ring;
+    return ring;
+}
+
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+    struct trace_ring *ring = trace_thread_ring();
+    uint64_t head;
+    if (ring == NULL)
+        return;
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->events[head % TRACE_RING_SIZE] = (struct trace_event){
+        .name = name,
+        .start_ns = start_ns,
+        .end_ns = end_ns,
+    };
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Name of the calling thread in the trace, 'name' has to outlive the trace.
+void trace_thread_name(const char *name) {
+    struct trace_ring *ring;
+    if (!atomic_load_explicit(&trace_active, memory_order_relaxed))
+        return;
+    ring = trace_thread_ring();
+    if (ring != NULL)
+        ring->thread_name = name;
+}
+
+// Enable tracing, the events are written to 'path' by 'trace_close()'.
+int trace_open(const char *path) {
+    trace_path = strdup(path);
+    if (trace_path == NULL)
+        return -ENOMEM;
+    atomic_store(&trace_active, true);
+    return 0;
+}
+
+static void write_ring(FILE *file, struct trace_ring *ring, bool *first) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t start = (head > TRACE_RING_SIZE) ? head - TRACE_RING_SIZE : 0;
+    pid_t pid = getpid();
+    struct trace_event *event;
+
+    if (ring->thread_name != NULL) {
+        fprintf(
+            file,
+            "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, "
+            "\"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+            *first ? "" : ",",
+            (int)pid,
+            (int)ring->tid,
+            ring->thread_name
+        );
+        *first = false;
+    }
+    for (uint64_t i = start; i < head; i++) {
+        event = &ring->events[i % TRACE_RING_SIZE];
+        fprintf(
+            file,
+            "%s\n{\"name\": \"%s\", \"cat\": \"adc\", \"ph\": \"X\", "
+            "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d}",
+            *first ? "" : ",",
+            event->name,
+            (double)event->start_ns / 1e3,
+            (double)(event->end_ns - event->start_ns) / 1e3,
+            (int)pid,
+            (int)ring->tid
+        );
+        *first = false;
+    }
+    if (start > 0) {
+        fprintf(
+            stderr,
+            "Trace: %llu events of thread %d were overwritten\n",
+            (unsigned long long)start,
+            (int)ring->tid
+        );
+    }
+}
+
+// Disable tracing and write all events. All other threads that recorded
+// events must have been joined.
+int trace_close(void) {
+    struct trace_ring *ring, *next;
+    bool first = true;
+    FILE *file;
+    int rc = 0;
+
+    if (!atomic_exchange(&trace_active, false))
+        return 0;
+    file = fopen(trace_path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open file %s\n", trace_path);
+        rc = -errno;
+    } else {
+        fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+        for (ring = atomic_load(&trace_rings); ring != NULL; ring = ring->next)
+            write_ring(file, ring, &first);
+        fprintf(file, "\n]}\n");
+        if (fclose(file) != 0)
+            rc = -EIO;
+    }
+    ring = atomic_exchange(&trace_rings, NULL);
+    for (; ring != NULL; ring = next) {
+        next = ring->next;
+        free(ring);
+    }
+    trace_ring = NULL;
+    free(trace_path);
+    trace_path = NULL;
+    return rc;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// Span tracing, written as Chrome trace JSON (chrome://tracing, Perfetto).
+//
+//     uint64_t t = trace_begin();
+//     do_work();
+//     trace_end("do_work", t);
+//
+// Events are recorded into a ring buffer per thread without any locking and
+// written to the file by 'trace_close()'. Tracing is disabled unless
+// 'trace_open()' was called, in which case 'trace_begin()' and 'trace_end()'
+// are reduced to a single load and branch.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of events per thread, older events are overwritten
+#define TRACE_RING_SIZE 16384
+
+extern atomic_bool trace_active;
+
+uint64_t trace_now_ns(void);
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns);
+int trace_open(const char *path);
+int trace_close(void);
+void trace_thread_name(const char *name);
+
+// Start a span, returns zero if tracing is disabled
+static inline uint64_t trace_begin(void) {
+    if (__builtin_expect(
+            atomic_load_explicit(&trace_active, memory_order_relaxed), 0
+        ))
+        return trace_now_ns();
+    return 0;
+}
+
+// End the span started at 'start_ns'. 'name' must be a string literal or
+// otherwise outlive the trace.
+static inline void trace_end(const char *name, uint64_t start_ns) {
+    if (__builtin_expect(start_ns != 0, 0))
+        trace_record(name, start_ns, trace_now_ns());
+}
@@ -0,0 +1,625 @@
+// Python extension for the ADC, see 'adc/__init__.py' for the Python API.
+//
+// 'Device' maps the whole DMA buffer once and exports the samples of the last
+// completed capture through the buffer protocol, such that NumPy arrays
+// created with 'numpy.frombuffer()' point directly into the DMA buffer. All
+// calls that talk to the hardware release the GIL.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "adcctl.h"
+#include "capture.h"
+#include "decode.h"
+#include "dmaclient.h"
+#include "dmadc.h"
+
+#define MAX_NUM_SAMPLES (DMADC_BUFFER_SIZE / sizeof(uint32_t))
+#define MAX_NUM_AVG     0x10
+
+typedef struct {
+    PyObject_HEAD
+    struct adc adc;
+    struct dmadc_channel channel;
+    bool opened;
+    bool sim;
+    uint32_t divider;
+    unsigned int zone;
+    uint8_t mode;
+    // Samples of the running capture and of the last completed capture
+    size_t pending;
+    size_t samples;
+    // A capture was started and 'wait()' has not returned yet
+    bool running;
+    // A thread is blocked in 'wait()'
+    bool waiting;
+    // Number of exported buffers, the DMA buffer must not be unmapped while
+    // any of them exist.
+    Py_ssize_t exports;
+} DeviceObject;
+
+static const char *status_name(enum dmadc_status status) {
+    switch (status) {
+        case DMADC_COMPLETE:
+            return "complete";
+        case DMADC_IN_PROGRESS:
+            return "in_progress";
+        case DMADC_PAUSED:
+            return "paused";
+        case DMADC_TIMEOUT:
+            return "timeout";
+        case DMADC_NO_TRANSFER:
+            return "no_transfer";
+        case DMADC_SUBMIT_ERROR:
+            return "submit_error";
+        default:
+            return "error";
+    }
+}
+
+static PyObject *set_errno(int rc) {
+    errno = -rc;
+    return PyErr_SetFromErrno(PyExc_OSError);
+}
+
+static int check_open(DeviceObject *self) {
+    if (!self->opened) {
+        PyErr_SetString(PyExc_ValueError, "Device is closed");
+        return -1;
+    }
+    return 0;
+}
+
+static int Device_init(DeviceObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {
+        "divider",
+        "zone",
+        "avg",
+        "test",
+        "ddr",
+        "timeout_ms",
+        "sim",
+        "sim_rate",
+        NULL
+    };
+    unsigned int divider = 20, zone = 2, avg = 0, timeout_ms = 10000;
+    int test = 0, ddr = 0, sim = 0;
+    double sim_rate = 0.0, rate;
+    int rc;
+
+    if (self->opened) {
+        PyErr_SetString(PyExc_RuntimeError, "Device is already open");
+        return -1;
+    }
+    if (!PyArg_ParseTupleAndKeywords(
+            args,
+            kwds,
+            "|$IIIppIpd",
+            kwlist,
+            &divider,
+            &zone,
+            &avg,
+            &test,
+            &ddr,
+            &timeout_ms,
+            &sim,
+            &sim_rate
+        ))
+        return -1;
+    if (divider == 0) {
+        PyErr_SetString(PyExc_ValueError, "Divider must be larger than zero");
+        return -1;
+    }
+    if (zone != 1 && zone != 2) {
+        PyErr_SetString(PyExc_ValueError, "Zone must be either 1 or 2");
+        return -1;
+    }
+    if (avg > MAX_NUM_AVG) {
+        PyErr_SetString(PyExc_ValueError, "Number of averages exceeds 16");
+        return -1;
+    }
+
+    rc = sim ? open_adc_sim(&self->adc) : open_adc(&self->adc);
+    if (rc < 0) {
+        set_errno(rc);
+        return -1;
+    }
+    rate = (sim && sim_rate > 0.0) ? sim_rate : adc_sample_rate(divider);
+    rc = sim ? open_dma_channel_sim(&self->channel, rate)
+             : open_dma_channel(&self->channel);
+    if (rc < 0) {
+        close_adc(&self->adc);
+        set_errno(rc);
+        return -1;
+    }
+    // The whole buffer is mapped once, exported buffers stay valid across
+    // captures.
+    rc = dmadc_mmap(&self->channel, DMADC_BUFFER_SIZE);
+    if (rc < 0) {
+        close_dma_channel(&self->channel);
+        close_adc(&self->adc);
+        set_errno(rc);
+        return -1;
+    }
+
+    self->opened = true;
+    self->sim = sim;
+    self->divider = divider;
+    self->zone = zone;
+    self->mode = adc_default_mode(test, (uint8_t)avg);
+    if (ddr)
+        self->mode |= ADC_REG_MODE_DDR;
+    self->pending = 0;
+    self->samples = 0;
+    self->running = false;
+    self->waiting = false;
+
+    // Powering up the ADC takes a while
+    Py_BEGIN_ALLOW_THREADS;
+    if (!sim)
+        configure_adc(&self->adc, self->mode, (uint8_t)avg);
+    configure_adc_trigger(&self->adc.trigger, zone);
+    reset_adc_datapath(&self->adc);
+    set_timeout_ms(&self->channel, timeout_ms);
+    Py_END_ALLOW_THREADS;
+    return 0;
+}
+
+static PyObject *Device_close(
+    DeviceObject *self, PyObject *Py_UNUSED(ignored)
+) {
+    enum dmadc_status status;
+
+    if (!self->opened)
+        Py_RETURN_NONE;
+    if (self->waiting) {
+        PyErr_SetString(PyExc_RuntimeError, "Device is waiting for a capture");
+        return NULL;
+    }
+    if (self->exports > 0) {
+        PyErr_SetString(
+            PyExc_BufferError, "Cannot close Device with exported buffers"
+        );
+        return NULL;
+    }
+    self->opened = false;
+    Py_BEGIN_ALLOW_THREADS;
+    if (self->running) {
+        status = wait_for_transfer(&self->channel);
+        capture_finish(&self->adc, status);
+    }
+    close_dma_channel(&self->channel);
+    close_adc(&self->adc);
+    Py_END_ALLOW_THREADS;
+    self->running = false;
+    Py_RETURN_NONE;
+}
+
+static void Device_dealloc(DeviceObject *self) {
+    // Exported buffers hold a reference, 'exports' is zero at this point
+    if (self->opened && !self->waiting) {
+        if (self->running)
+            capture_finish(&self->adc, wait_for_transfer(&self->channel));
+        close_dma_channel(&self->channel);
+        close_adc(&self->adc);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Device_start(DeviceObject *self, PyObject *arg) {
+    enum dmadc_status status;
+    size_t samples;
+
+    if (check_open(self) < 0)
+        return NULL;
+    samples = PyLong_AsSize_t(arg);
+    if (samples == (size_t)-1 && PyErr_Occurred())
+        return NULL;
+    if (samples == 0 || samples > MAX_NUM_SAMPLES) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "Invalid number of samples %zu. Max: %zu",
+            samples,
+            (size_t)MAX_NUM_SAMPLES
+        );
+        return NULL;
+    }
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "A capture is already running");
+        return NULL;
+    }
+    // Claim the device before the GIL is released
+    self->running = true;
+    Py_BEGIN_ALLOW_THREADS;
+    status = capture_start(&self->adc, &self->channel, samples, self->divider);
+    Py_END_ALLOW_THREADS;
+    if (status != DMADC_IN_PROGRESS) {
+        self->running = false;
+        PyErr_Format(
+            PyExc_OSError, "Unable to start capture: %s", status_name(status)
+        );
+        return NULL;
+    }
+    self->pending = samples;
+    Py_RETURN_NONE;
+}
+
+static PyObject *Device_wait(DeviceObject *self, PyObject *Py_UNUSED(ignored)) {
+    enum dmadc_status status;
+
+    if (check_open(self) < 0)
+        return NULL;
+    if (!self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "No capture is running");
+        return NULL;
+    }
+    if (self->waiting) {
+        PyErr_SetString(PyExc_RuntimeError, "Device is waiting for a capture");
+        return NULL;
+    }
+    self->waiting = true;
+    Py_BEGIN_ALLOW_THREADS;
+    status = wait_for_transfer(&self->channel);
+    capture_finish(&self->adc, status);
+    Py_END_ALLOW_THREADS;
+    self->waiting = false;
+    self->running = false;
+
+    switch (status) {
+        case DMADC_COMPLETE:
+            self->samples = self->pending;
+            return PyLong_FromSize_t(self->samples);
+        case DMADC_TIMEOUT:
+            PyErr_SetString(PyExc_TimeoutError, "DMA transfer timed out");
+            return NULL;
+        default:
+            PyErr_Format(
+                PyExc_OSError,
+                "DMA transfer exited with status %s",
+                status_name(status)
+            );
+            return NULL;
+    }
+}
+
+static PyObject *Device_progress(
+    DeviceObject *self, PyObject *Py_UNUSED(ignored)
+) {
+    enum dmadc_status status;
+    size_t done;
+
+    if (check_open(self) < 0)
+        return NULL;
+    if (!self->running)
+        return PyLong_FromSize_t(self->samples);
+    Py_BEGIN_ALLOW_THREADS;
+    status = get_status(&self->channel);
+    done = (status == DMADC_COMPLETE) ? self->pending
+                                      : capture_progress(&self->adc);
+    Py_END_ALLOW_THREADS;
+    return PyLong_FromSize_t(done);
+}
+
+static PyObject *Device_status(
+    DeviceObject *self, PyObject *Py_UNUSED(ignored)
+) {
+    enum dmadc_status status;
+
+    if (check_open(self) < 0)
+        return NULL;
+    Py_BEGIN_ALLOW_THREADS;
+    status = get_status(&self->channel);
+    Py_END_ALLOW_THREADS;
+    return PyUnicode_FromString(status_name(status));
+}
+
+static PyObject *Device_enter(
+    DeviceObject *self, PyObject *Py_UNUSED(ignored)
+) {
+    if (check_open(self) < 0)
+        return NULL;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *Device_exit(DeviceObject *self, PyObject *Py_UNUSED(args)) {
+    return Device_close(self, NULL);
+}
+
+static int Device_getbuffer(DeviceObject *self, Py_buffer *view, int flags) {
+    Py_ssize_t *shape;
+
+    if (!self->opened) {
+        PyErr_SetString(PyExc_BufferError, "Device is closed");
+        return -1;
+    }
+    if (PyBuffer_FillInfo(
+            view,
+            (PyObject *)self,
+            self->channel.buffer,
+            (Py_ssize_t)(self->samples * sizeof(uint32_t)),
+            1,
+            flags
+        ) < 0)
+        return -1;
+    // Without a shape, the consumer sees plain bytes as filled in above.
+    // 'Device_releasebuffer()' is not called if this fails, 'exports' is
+    // only incremented on success.
+    if (flags & PyBUF_ND) {
+        shape = PyMem_Malloc(sizeof(Py_ssize_t));
+        if (shape == NULL) {
+            Py_CLEAR(view->obj);
+            PyErr_NoMemory();
+            return -1;
+        }
+        *shape = (Py_ssize_t)self->samples;
+        view->shape = shape;
+        view->internal = shape;
+        view->itemsize = sizeof(uint32_t);
+        if (flags & PyBUF_FORMAT)
+            view->format = "I";
+    }
+    self->exports++;
+    return 0;
+}
+
+static void Device_releasebuffer(DeviceObject *self, Py_buffer *view) {
+    PyMem_Free(view->internal);
+    self->exports--;
+}
+
+static PyObject *Device_get_samples(DeviceObject *self, void *closure) {
+    return PyLong_FromSize_t(self->samples);
+}
+
+static PyObject *Device_get_divider(DeviceObject *self, void *closure) {
+    return PyLong_FromUnsignedLong(self->divider);
+}
+
+static int Device_set_divider(
+    DeviceObject *self, PyObject *value, void *closure
+) {
+    unsigned long divider;
+
+    if (value == NULL) {
+        PyErr_SetString(PyExc_AttributeError, "Cannot delete divider");
+        return -1;
+    }
+    divider = PyLong_AsUnsignedLong(value);
+    if (divider == (unsigned long)-1 && PyErr_Occurred())
+        return -1;
+    if (divider == 0 || divider > UINT32_MAX) {
+        PyErr_SetString(PyExc_ValueError, "Invalid divider");
+        return -1;
+    }
+    // Applied with the next call to 'start()'
+    self->divider = (uint32_t)divider;
+    return 0;
+}
+
+static PyObject *Device_get_mode(DeviceObject *self, void *closure) {
+    return PyLong_FromLong(self->mode);
+}
+
+static PyObject *Device_get_zone(DeviceObject *self, void *closure) {
+    return PyLong_FromUnsignedLong(self->zone);
+}
+
+static PyObject *Device_get_sample_rate(DeviceObject *self, void *closure) {
+    return PyFloat_FromDouble(adc_sample_rate(self->divider));
+}
+
+static PyObject *Device_get_sim(DeviceObject *self, void *closure) {
+    return PyBool_FromLong(self->sim);
+}
+
+static PyObject *Device_get_closed(DeviceObject *self, void *closure) {
+    return PyBool_FromLong(!self->opened);
+}
+
+static PyMethodDef Device_methods[] = {
+    {"start",
+     (PyCFunction)Device_start,
+     METH_O,
+     "start(samples)\n--\n\nStart a capture of 'samples' samples without "
+     "waiting for it."},
+    {"wait",
+     (PyCFunction)Device_wait,
+     METH_NOARGS,
+     "wait()\n--\n\nWait for the running capture and return the number of "
+     "samples. Raises TimeoutError if the DMA transfer timed out."},
+    {"progress",
+     (PyCFunction)Device_progress,
+     METH_NOARGS,
+     "progress()\n--\n\nNumber of samples of the running capture that have "
+     "been transferred so far."},
+    {"status",
+     (PyCFunction)Device_status,
+     METH_NOARGS,
+     "status()\n--\n\nStatus of the DMA transfer as reported by the driver."},
+    {"close",
+     (PyCFunction)Device_close,
+     METH_NOARGS,
+     "close()\n--\n\nClose the device. Fails if buffers are still exported."},
+    {"__enter__", (PyCFunction)Device_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)Device_exit, METH_VARARGS, NULL},
+    {NULL}
+};
+
+static PyGetSetDef Device_getset[] = {
+    {"samples",
+     (getter)Device_get_samples,
+     NULL,
+     "Number of samples of the last completed capture",
+     NULL},
+    {"divider",
+     (getter)Device_get_divider,
+     (setter)Device_set_divider,
+     "Number of 'adc_clk' cycles per conversion minus one",
+     NULL},
+    {"mode",
+     (getter)Device_get_mode,
+     NULL,
+     "Value of the ADC mode register (output data format)",
+     NULL},
+    {"zone", (getter)Device_get_zone, NULL, "Acquisition zone", NULL},
+    {"sample_rate",
+     (getter)Device_get_sample_rate,
+     NULL,
+     "Sample rate in Hz for the current divider",
+     NULL},
+    {"sim", (getter)Device_get_sim, NULL, "Uses the stand-in backend", NULL},
+    {"closed", (getter)Device_get_closed, NULL, NULL, NULL},
+    {NULL}
+};
+
+static PyBufferProcs Device_as_buffer = {
+    .bf_getbuffer = (getbufferproc)Device_getbuffer,
+    .bf_releasebuffer = (releasebufferproc)Device_releasebuffer,
+};
+
+static PyTypeObject DeviceType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "adc._adc.Device",
+    .tp_doc = PyDoc_STR(
+        "Device(*, divider=20, zone=2, avg=0, test=False, ddr=False, "
+        "timeout_ms=10000, sim=False, sim_rate=0.0)\n--\n\n"
+        "ADC and DMA buffer. Exports the samples of the last completed "
+        "capture as raw 32-bit words through the buffer protocol."
+    ),
+    .tp_basicsize = sizeof(DeviceObject),
+    .tp_itemsize = 0,
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)Device_init,
+    .tp_dealloc = (destructor)Device_dealloc,
+    .tp_methods = Device_methods,
+    .tp_getset = Device_getset,
+    .tp_as_buffer = &Device_as_buffer,
+};
+
+static bool is_integer_format(const char *format) {
+    size_t n;
+    if (format == NULL)
+        return true;
+    n = strlen(format);
+    return n > 0 && strchr("iIlL", format[n - 1]) != NULL;
+}
+
+static bool is_float_format(const char *format, char type) {
+    size_t n;
+    if (format == NULL)
+        return false;
+    n = strlen(format);
+    return n > 0 && format[n - 1] == type;
+}
+
+static PyObject *adc_decode(PyObject *module, PyObject *args) {
+    PyObject *raw_obj, *out_obj;
+    Py_buffer raw, out;
+    struct adc_word_layout layout;
+    unsigned char mode;
+    double vref = ADC_VREF;
+    size_t count;
+    bool f32;
+    PyObject *result = NULL;
+
+    if (!PyArg_ParseTuple(
+            args, "OOb|d:decode", &raw_obj, &out_obj, &mode, &vref
+        ))
+        return NULL;
+    if (adc_word_layout(mode, &layout) < 0) {
+        PyErr_SetString(PyExc_ValueError, "Mode has no conversion results");
+        return NULL;
+    }
+    if (PyObject_GetBuffer(raw_obj, &raw, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) <
+        0)
+        return NULL;
+    if (PyObject_GetBuffer(
+            out_obj, &out, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | PyBUF_WRITABLE
+        ) < 0) {
+        PyBuffer_Release(&raw);
+        return NULL;
+    }
+    if (raw.itemsize != sizeof(uint32_t) || !is_integer_format(raw.format)) {
+        PyErr_SetString(PyExc_TypeError, "Expected 32-bit words");
+        goto exit;
+    }
+    if (out.itemsize == sizeof(float) && is_float_format(out.format, 'f')) {
+        f32 = true;
+    } else if (out.itemsize == sizeof(double) &&
+               is_float_format(out.format, 'd')) {
+        f32 = false;
+    } else {
+        PyErr_SetString(PyExc_TypeError, "Expected float32 or float64 output");
+        goto exit;
+    }
+    count = (size_t)(raw.len / raw.itemsize);
+    if ((size_t)(out.len / out.itemsize) != count) {
+        PyErr_SetString(PyExc_ValueError, "Size of input and output differ");
+        goto exit;
+    }
+
+    Py_BEGIN_ALLOW_THREADS;
+    if (f32)
+        adc_decode_f32(raw.buf, out.buf, count, &layout, vref);
+    else
+        adc_decode_f64(raw.buf, out.buf, count, &layout, vref);
+    Py_END_ALLOW_THREADS;
+    result = Py_NewRef(Py_None);
+
+exit:
+    PyBuffer_Release(&raw);
+    PyBuffer_Release(&out);
+    return result;
+}
+
+static PyMethodDef adc_methods[] = {
+    {"decode",
+     adc_decode,
+     METH_VARARGS,
+     "decode(raw, out, mode, vref=VREF)\n--\n\nConvert the raw words in 'raw' "
+     "to volts in 'out' (float32 or float64) for the output data format in "
+     "'mode'."},
+    {NULL}
+};
+
+static struct PyModuleDef adc_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "adc._adc",
+    .m_doc = "Zero-copy access to the ADC DMA buffer",
+    .m_size = -1,
+    .m_methods = adc_methods,
+};
+
+PyMODINIT_FUNC PyInit__adc(void) {
+    PyObject *module;
+
+    if (PyType_Ready(&DeviceType) < 0)
+        return NULL;
+    module = PyModule_Create(&adc_module);
+    if (module == NULL)
+        return NULL;
+    if (PyModule_AddObjectRef(module, "Device", (PyObject *)&DeviceType) < 0 ||
+        PyModule_AddIntConstant(module, "MODE_24BIT", ADC_REG_MODE_24BIT) < 0 ||
+        PyModule_AddIntConstant(
+            module, "MODE_24BIT_COM", ADC_REG_MODE_24BIT_COM
+        ) < 0 ||
+        PyModule_AddIntConstant(
+            module, "MODE_32BIT_COM", ADC_REG_MODE_32BIT_COM
+        ) < 0 ||
+        PyModule_AddIntConstant(
+            module, "MODE_32BIT_AVG", ADC_REG_MODE_32BIT_AVG
+        ) < 0 ||
+        PyModule_AddIntConstant(module, "MODE_TEST", ADC_REG_MODE_TEST) < 0 ||
+        PyModule_AddIntConstant(module, "MAX_SAMPLES", MAX_NUM_SAMPLES) < 0 ||
+        PyModule_AddObject(module, "VREF", PyFloat_FromDouble(ADC_VREF)) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
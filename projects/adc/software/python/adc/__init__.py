@@ -0,0 +1,82 @@
+"""Zero-copy access to the ADC DMA buffer.
+
+>>> import adc
+>>> with adc.Device(divider=20) as device:
+...     raw = device.capture(4096)
+...     volts = adc.to_volts(raw, device.mode)
+
+Arrays returned by :meth:`Device.capture` and :meth:`Device.array` point
+directly into the DMA buffer. They are overwritten by the next capture and
+have to be deleted before the device can be closed. Use ``raw.copy()`` to keep
+the data of a capture.
+"""
+
+import numpy as np
+
+from ._adc import (
+    MAX_SAMPLES,
+    MODE_24BIT,
+    MODE_24BIT_COM,
+    MODE_32BIT_AVG,
+    MODE_32BIT_COM,
+    MODE_TEST,
+    VREF,
+    decode,
+)
+from ._adc import Device as _Device
+
+__all__ = [
+    "MAX_SAMPLES",
+    "MODE_24BIT",
+    "MODE_24BIT_COM",
+    "MODE_32BIT_AVG",
+    "MODE_32BIT_COM",
+    "MODE_TEST",
+    "VREF",
+    "Device",
+    "decode",
+    "to_volts",
+    "common_mode",
+]
+
+
+def to_volts(raw, mode=MODE_32BIT_COM, vref=VREF, dtype=np.float64, out=None):
+    """Convert raw words as written by the DMA to the differential voltage.
+
+    ``mode`` is the output data format of the ADC (see :attr:`Device.mode`),
+    the result is written to ``out`` if given.
+    """
+    raw = np.ascontiguousarray(raw, dtype=np.uint32)
+    if out is None:
+        out = np.empty(raw.shape, dtype=dtype)
+    decode(raw, out, mode, vref)
+    return out
+
+
+def common_mode(raw, vref=VREF):
+    """Common mode voltage of words in the ``MODE_*_COM`` formats."""
+    codes = np.asarray(raw, dtype=np.uint32) & 0xFF
+    return codes * (vref / 256.0)
+
+
+class Device(_Device):
+    """ADC and DMA buffer.
+
+    Keyword arguments: ``divider``, ``zone``, ``avg``, ``test``, ``ddr``,
+    ``timeout_ms``, ``sim``, and ``sim_rate``, see ``adc --help``. With
+    ``sim=True``, the stand-in backend is used instead of the hardware.
+    """
+
+    def array(self):
+        """Raw words of the last completed capture, without copying."""
+        return np.frombuffer(self, dtype=np.uint32)
+
+    def capture(self, samples):
+        """Capture ``samples`` samples and return the raw words."""
+        self.start(samples)
+        self.wait()
+        return self.array()
+
+    def volts(self, dtype=np.float64, out=None):
+        """Last completed capture converted to volts."""
+        return to_volts(self.array(), self.mode, dtype=dtype, out=out)
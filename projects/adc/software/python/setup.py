@@ -0,0 +1,33 @@
+# Build the Python extension for the ADC, e.g. on the Red Pitaya:
+#
+#     pip install ./projects/adc/software/python
+#
+# The extension is compiled from the shared sources in '../include'.
+from setuptools import Extension, setup
+
+SHARED_SOURCES = [
+    "adcctl.c",
+    "capture.c",
+    "decode.c",
+    "dmaclient.c",
+    "dmasim.c",
+    "trace.c",
+]
+
+setup(
+    name="adc",
+    version="0.1.0",
+    description="Zero-copy access to the ADC DMA buffer",
+    packages=["adc"],
+    python_requires=">=3.10",
+    install_requires=["numpy"],
+    ext_modules=[
+        Extension(
+            "adc._adc",
+            sources=["_adc.c"] + [f"../include/{f}" for f in SHARED_SOURCES],
+            include_dirs=["../include", "../../../../linux/dma"],
+            extra_compile_args=["-std=gnu11"],
+            libraries=["m"],
+        )
+    ],
+)
@@ -2,11 +2,21 @@ add_files -norecurse library/adc/adc_manager.v
 add_files -norecurse library/adc/adc_config.v
 add_files -norecurse library/adc/adc_trigger.v
 add_files -norecurse library/adc/packetizer.v
+add_files -norecurse library/adc/decimator.v
+add_files -norecurse library/adc/axis_fifo.v
+add_files -norecurse library/adc/axis_stats.v
+add_files -norecurse library/adc/event_trigger.v
+add_files -norecurse library/adc/axis_broadcast.v
 add_files -norecurse library/misc/delay.v
 add_files -norecurse library/include/axi4lite_helpers.vh
 add_files -fileset sim_1 -norecurse library/adc/adc_manager_tb.sv
 add_files -fileset sim_1 -norecurse library/adc/adc_trigger_tb.sv
 add_files -fileset sim_1 -norecurse library/adc/packetizer_tb.sv
+add_files -fileset sim_1 -norecurse library/adc/decimator_tb.sv
+add_files -fileset sim_1 -norecurse library/adc/axis_fifo_tb.sv
+add_files -fileset sim_1 -norecurse library/adc/axis_stats_tb.sv
+add_files -fileset sim_1 -norecurse library/adc/event_trigger_tb.sv
+add_files -fileset sim_1 -norecurse library/adc/axis_broadcast_tb.sv
 add_files -fileset sim_1 -norecurse library/misc/delay_tb.sv
 
 # Ignore truncation of AXI Stream register to 24 bits
@@ -14,6 +24,18 @@ create_waiver -type LINT -id ASSIGN-10 -rtl_name {s_axis_tdata} -rtl_hierarchy {
 
 set_property top adc_manager [current_fileset]
 update_compile_order -fileset sources_1
+
+# Dual-stream variant with a second DMA channel for the raw conversion
+# results, see 'bd_adc.tcl'. Selected with 'make DUAL_STREAM=yes'.
+set dual_stream [expr {[info exists ::env(DUAL_STREAM)] && $::env(DUAL_STREAM) eq "yes"}]
+# Echo clock variant with SCKOUT on the debug pin, which needs a change of
+# the board, see 'bd_adc.tcl'. Selected with 'make ECHO_CLK=yes'.
+set echo_clk [expr {[info exists ::env(ECHO_CLK)] && $::env(ECHO_CLK) eq "yes"}]
+if {$echo_clk} {
+    add_files -fileset constrs_1 -norecurse constraints/echo_clk.xdc
+    # After 'clocks.xdc', which defines 'adc_clk'
+    set_property PROCESSING_ORDER LATE [get_files constraints/echo_clk.xdc]
+}
 source projects/adc/bd_adc.tcl
 
 assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs adc_config/s_axi_lite/reg0] -force
@@ -30,8 +52,44 @@ assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs packetizer/s_
 set_property range 256 [get_bd_addr_segs {ps/Data/SEG_packetizer_reg0}]
 set_property offset 0x40000200 [get_bd_addr_segs {ps/Data/SEG_packetizer_reg0}]
 
+include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_decimator_reg0]
+assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs decimator/s_axi_lite/reg0] -force
+set_property range 256 [get_bd_addr_segs {ps/Data/SEG_decimator_reg0}]
+set_property offset 0x40000300 [get_bd_addr_segs {ps/Data/SEG_decimator_reg0}]
+
+include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_axis_fifo_reg0]
+assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs axis_fifo/s_axi_lite/reg0] -force
+set_property range 256 [get_bd_addr_segs {ps/Data/SEG_axis_fifo_reg0}]
+set_property offset 0x40000400 [get_bd_addr_segs {ps/Data/SEG_axis_fifo_reg0}]
+
+include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_axis_stats_reg0]
+assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs axis_stats/s_axi_lite/reg0] -force
+set_property range 256 [get_bd_addr_segs {ps/Data/SEG_axis_stats_reg0}]
+set_property offset 0x40000500 [get_bd_addr_segs {ps/Data/SEG_axis_stats_reg0}]
+
+include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_event_trigger_reg0]
+assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs event_trigger/s_axi_lite/reg0] -force
+set_property range 256 [get_bd_addr_segs {ps/Data/SEG_event_trigger_reg0}]
+set_property offset 0x40000600 [get_bd_addr_segs {ps/Data/SEG_event_trigger_reg0}]
+
 include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_axi_dma_Reg]
 assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs axi_dma/S_AXI_LITE/Reg] -force
 set_property range 64K [get_bd_addr_segs {ps/Data/SEG_axi_dma_Reg}]
 set_property offset 0x40400000 [get_bd_addr_segs {ps/Data/SEG_axi_dma_Reg}]
 
+if {$dual_stream} {
+    include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_axis_fifo_raw_reg0]
+    assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs axis_fifo_raw/s_axi_lite/reg0] -force
+    set_property range 256 [get_bd_addr_segs {ps/Data/SEG_axis_fifo_raw_reg0}]
+    set_property offset 0x40000700 [get_bd_addr_segs {ps/Data/SEG_axis_fifo_raw_reg0}]
+
+    include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_packetizer_raw_reg0]
+    assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs packetizer_raw/s_axi_lite/reg0] -force
+    set_property range 256 [get_bd_addr_segs {ps/Data/SEG_packetizer_raw_reg0}]
+    set_property offset 0x40000800 [get_bd_addr_segs {ps/Data/SEG_packetizer_raw_reg0}]
+
+    include_bd_addr_seg [get_bd_addr_segs -excluded ps/Data/SEG_axi_dma_raw_Reg]
+    assign_bd_address -target_address_space /ps/Data [get_bd_addr_segs axi_dma_raw/S_AXI_LITE/Reg] -force
+    set_property range 64K [get_bd_addr_segs {ps/Data/SEG_axi_dma_raw_Reg}]
+    set_property offset 0x40410000 [get_bd_addr_segs {ps/Data/SEG_axi_dma_raw_Reg}]
+}
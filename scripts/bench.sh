@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Builds the co-simulation of the ADC datapath in 'sim' and runs it, all
+# arguments are passed on, see 'build/bench/adc_chain --help'.
+BUILD_DIR="./build/bench"
+mkdir -p -- "$BUILD_DIR"
+declare -a otherfiles
+
+case "$(uname -s)" in
+    Darwin)
+        YOSYS_SIM="/opt/homebrew/share/yosys/xilinx/cells_sim.v"
+        ;;
+    Linux)
+        YOSYS_SIM="/usr/share/yosys/xilinx/cells_sim.v"
+        ;;
+    *)
+        echo "Unsupported platform" >&2
+        exit 1
+        ;;
+esac
+
+# The yosys simulation sources provide the BUFHCE of 'adc_manager'
+otherfiles=( library/adc/*.v library/misc/delay.v )
+if [[ -f "$YOSYS_SIM" ]]; then
+    otherfiles+=( "$YOSYS_SIM" )
+fi
+
+echo "Compile 'adc_chain'..." >&2
+# Only the build log on stdout is discarded, lint and width warnings go to
+# stderr and stay visible
+verilator --cc --exe --build -j 0 \
+    --no-timing -O3 \
+    config.vlt \
+    -Mdir "$BUILD_DIR" \
+    -o adc_chain \
+    -Ilibrary/include \
+    -CFLAGS "-O2 -I$(pwd)/projects/adc/software/include" \
+    "${otherfiles[@]}" \
+    sim/adc_model.sv \
+    sim/adc_chain.sv \
+    sim/adc_chain.cpp \
+    --top adc_chain > /dev/null
+
+"$BUILD_DIR/adc_chain" "$@"
@@ -43,7 +43,8 @@ while [[ "$#" -gt 0 ]]; do
             shift
             ;;
         *)
-            # Add argument to list of files copied to /usr/bin
+            # Add argument to list of files copied to /usr/bin (or /usr/lib
+            # and /usr/include for libraries and headers)
             files+=("$1")
             shift
             ;;
@@ -251,8 +252,13 @@ setup_software() {
     files=("$@")
     files+=("./linux/resize-sd" "$BUILD_DIR/fpgautil")
     for file in "${files[@]}"; do
-        echo "Copy '$(basename "$file")' to /usr/bin"
-        sudo cp -- "$file" "$ROOT_DIR/usr/bin"
+        case "$file" in
+            *.so) dest="/usr/lib" ;;
+            *.h|*.hpp) dest="/usr/include" ;;
+            *) dest="/usr/bin" ;;
+        esac
+        echo "Copy '$(basename "$file")' to $dest"
+        sudo cp -- "$file" "$ROOT_DIR$dest"
     done
 }
 
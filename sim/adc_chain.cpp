@@ -0,0 +1,664 @@
+// Co-simulation of the datapath of the 'adc' project, see 'adc_chain.sv',
+// with the model of the AD4030-24 in 'adc_model.sv' and a model of the S2MM
+// channel of the DMA.
+//
+// For every divider of the sweep, a fresh instance of the chain is set up
+// through AXI4-Lite like 'adc' does it: the ADC is put into four-lane mode,
+// the packetizer, FIFO and trigger are configured, and the trigger runs in
+// continuous mode until '--samples' conversions were made. The chain is then
+// drained and the words that reached the DMA are checked against the
+// conversions of the model.
+//
+// Built and run by 'scripts/bench.sh', see 'README.md'.
+
+#include "Vadc_chain.h"
+#include "verilated.h"
+
+#include "adcctl.h"
+
+#include <getopt.h>
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Addresses as seen by 'adc_chain', relative to the first block
+constexpr std::uint32_t block(std::uint32_t addr) {
+    return addr - ADC_CONFIG_ADDR;
+}
+constexpr std::uint32_t config_reg = block(ADC_CONFIG_ADDR) + 0x00;
+constexpr std::uint32_t config_adc_reg = block(ADC_CONFIG_ADDR) + 0x08;
+constexpr std::uint32_t trigger_config = block(ADC_TRIGGER_ADDR) + 0x00;
+constexpr std::uint32_t trigger_divider = block(ADC_TRIGGER_ADDR) + 0x04;
+constexpr std::uint32_t packetizer_config = block(PACKETIZER_ADDR) + 0x00;
+constexpr std::uint32_t packetizer_packing = block(PACKETIZER_ADDR) + 0x0C;
+constexpr std::uint32_t fifo_control = block(ADC_FIFO_ADDR) + 0x00;
+constexpr std::uint32_t fifo_high_water = block(ADC_FIFO_ADDR) + 0x08;
+constexpr std::uint32_t fifo_dropped = block(ADC_FIFO_ADDR) + 0x0C;
+
+// Header words of a packet, see 'packetizer_s2mm'
+constexpr std::uint32_t header_words = 8;
+constexpr std::uint32_t header_magic = 0x48434441;
+
+// Conversion results are numbered, the number is in the 24-bit result
+constexpr std::uint32_t index_mask = 0xFFFFFF;
+
+struct Options {
+    std::uint32_t min_div = 16;
+    std::uint32_t max_div = 40;
+    // 0 for both zones
+    unsigned int zone = 0;
+    bool ddr = false;
+    bool echo = false;
+    bool pack = false;
+    bool header = false;
+    std::uint32_t length = 4096;
+    std::uint64_t samples = 16384;
+    unsigned int latency = 64;
+    unsigned int stall = 0;
+    double conv_time_ns = 282.0;
+    unsigned int seed = 1;
+    // 0 if every divider only has to work
+    std::uint32_t sustain = 0;
+};
+
+struct Result {
+    std::uint32_t divider = 0;
+    unsigned int zone = 0;
+    double achieved_hz = 0.0;
+    std::uint64_t skipped = 0;
+    std::uint64_t stalls = 0;
+    std::uint64_t lost = 0;
+    std::uint32_t dropped = 0;
+    std::uint64_t corrupted = 0;
+    std::uint32_t high_water = 0;
+
+    bool sustained() const {
+        return skipped == 0 && lost == 0 && corrupted == 0;
+    }
+};
+
+// Result of conversion 'n' of 'adc_model', {n, check(n)}
+std::uint32_t check(std::uint32_t index) {
+    return (index ^ index >> 8 ^ index >> 16 ^ 0xA5) & 0xFF;
+}
+
+// Watches CNV before every rising edge of 'aclk'. A conversion is expected
+// every 'divider + 1' cycles from the first CNV to the last one, those that
+// 'adc_model' did not start were either held back by 'adc_trigger' or
+// ignored by the ADC.
+class CnvProbe {
+  public:
+    void sample(const Vadc_chain &top, std::uint64_t cycle) {
+        if (top.cnv && !cnv_) {
+            if (pulses_ == 0)
+                first_ = cycle;
+            last_ = cycle;
+            pulses_++;
+        }
+        cnv_ = top.cnv;
+    }
+
+    std::uint64_t skipped(const Vadc_chain &top, std::uint32_t divider) const {
+        if (pulses_ == 0)
+            return 0;
+        return (last_ - first_) / (divider + 1) + 1 - top.adc_started;
+    }
+
+  private:
+    bool cnv_ = false;
+    std::uint64_t pulses_ = 0;
+    std::uint64_t first_ = 0;
+    std::uint64_t last_ = 0;
+};
+
+// S2MM channel of the AXI DMA. It takes a word every cycle while a transfer
+// is set up, the next transfer starts 'latency' cycles after the last word
+// of a packet (completion, next descriptor). Within a transfer, a word is
+// held back with a probability of 'stall' percent, e.g. by the arbitration
+// of the HP port.
+class DmaSink {
+  public:
+    DmaSink(unsigned int latency, unsigned int stall, unsigned int seed)
+        : latency_(latency), stall_(stall), wait_(latency), random_(seed) {}
+
+    // Before the rising edge of 'aclk', true if a word is transferred
+    bool sample(const Vadc_chain &top, std::uint32_t &data, bool &last) {
+        if (!top.m_axis_s2mm_tvalid)
+            return false;
+        if (!top.m_axis_s2mm_tready) {
+            stalls_++;
+            return false;
+        }
+        data = top.m_axis_s2mm_tdata;
+        last = top.m_axis_s2mm_tlast;
+        if (last)
+            wait_ = latency_;
+        return true;
+    }
+
+    // After the rising edge of 'aclk'
+    void drive(Vadc_chain &top) {
+        if (wait_ > 0) {
+            wait_--;
+            top.m_axis_s2mm_tready = 0;
+        } else {
+            top.m_axis_s2mm_tready = !(stall_ > 0 && percent_(random_) < stall_);
+        }
+    }
+
+    // Cycles in which a word was held back
+    std::uint64_t stalls() const { return stalls_; }
+
+  private:
+    unsigned int latency_;
+    unsigned int stall_;
+    unsigned int wait_;
+    std::uint64_t stalls_ = 0;
+    std::mt19937 random_;
+    std::uniform_int_distribution<unsigned int> percent_{0, 99};
+};
+
+// Checks the words of the S2MM stream against the numbered conversions.
+// Every sample is expected to follow the previous one, a jump forward counts
+// the conversions in between as lost, anything else (including an invalid
+// check byte, a broken header or a packet of the wrong length) as corrupted.
+// The check byte is not part of packed samples.
+class StreamChecker {
+  public:
+    StreamChecker(bool pack, bool header, std::uint32_t length)
+        : pack_(pack), header_(header),
+          length_(pack ? length / 4 * 4 : length) {}
+
+    void word(std::uint32_t data, bool last, std::uint64_t cycle) {
+        cycle_ = cycle;
+        if (header_ && header_index_ < header_words) {
+            if ((header_index_ == 0 && data != header_magic) ||
+                (header_index_ == 1 && data != (packets_ & 0xFFFFFFFF)) ||
+                (header_index_ == 4 && data != length_))
+                corrupted_++;
+            header_index_++;
+        } else if (pack_) {
+            rest_ |= static_cast<std::uint64_t>(data) << rest_bits_;
+            rest_bits_ += 32;
+            while (rest_bits_ >= 24) {
+                sample(rest_ & index_mask, true);
+                rest_ >>= 24;
+                rest_bits_ -= 24;
+            }
+        } else {
+            sample(data >> 8, (data & 0xFF) == check(data >> 8));
+        }
+        if (last) {
+            if (in_packet_ != length_ || rest_bits_ != 0)
+                corrupted_++;
+            in_packet_ = 0;
+            header_index_ = 0;
+            rest_ = 0;
+            rest_bits_ = 0;
+            packets_++;
+        }
+    }
+
+    std::uint64_t received() const { return received_; }
+    std::uint64_t lost() const { return lost_; }
+    std::uint64_t corrupted() const { return corrupted_; }
+
+    // Samples per cycle between the first and the last sample
+    double rate() const {
+        if (received_ < 2 || last_cycle_ == first_cycle_)
+            return 0.0;
+        return static_cast<double>(received_ - 1) /
+               static_cast<double>(last_cycle_ - first_cycle_);
+    }
+
+  private:
+    void sample(std::uint32_t index, bool valid) {
+        std::uint32_t gap = (index - expected_) & index_mask;
+        if (received_ == 0)
+            first_cycle_ = cycle_;
+        last_cycle_ = cycle_;
+        received_++;
+        in_packet_++;
+        if (!valid || gap > index_mask / 2) {
+            corrupted_++;
+            return;
+        }
+        lost_ += gap;
+        expected_ = (index + 1) & index_mask;
+    }
+
+    bool pack_;
+    bool header_;
+    std::uint32_t length_;
+    std::uint32_t header_index_ = 0;
+    std::uint32_t in_packet_ = 0;
+    std::uint64_t rest_ = 0;
+    unsigned int rest_bits_ = 0;
+    std::uint32_t expected_ = 0;
+    std::uint64_t packets_ = 0;
+    std::uint64_t received_ = 0;
+    std::uint64_t lost_ = 0;
+    std::uint64_t corrupted_ = 0;
+    std::uint64_t cycle_ = 0;
+    std::uint64_t first_cycle_ = 0;
+    std::uint64_t last_cycle_ = 0;
+};
+
+class Bench {
+  public:
+    Bench(VerilatedContext &context, const Options &options)
+        : top_(new Vadc_chain(&context)),
+          sink_(options.latency, options.stall, options.seed),
+          checker_(options.pack, options.header, options.length),
+          options_(options) {
+        top_->conv_cycles = static_cast<std::uint8_t>(std::ceil(
+            options.conv_time_ns * ADC_CLK_FREQ_HZ / 1e9
+        ));
+    }
+
+    ~Bench() { top_->final(); }
+
+    Result run(std::uint32_t divider, unsigned int zone) {
+        Result result;
+        std::uint8_t mode = ADC_REG_MODE_4_LANE | ADC_REG_MODE_SPI_CLK;
+        std::uint32_t flags = 0;
+        std::uint32_t trigger = ADC_TRIGGER_CONTINUOUS;
+        std::uint64_t limit;
+        unsigned int idle = 0;
+
+        reset();
+        write(config_reg, ADC_PWR_EN | ADC_IO_EN | ADC_REF_EN);
+        if (options_.echo)
+            mode = ADC_REG_MODE_4_LANE | ADC_REG_MODE_ECHO_CLK;
+        else if (options_.ddr)
+            mode |= ADC_REG_MODE_DDR;
+        // Packing needs the plain 24-bit samples, the model always sends 32
+        mode |= options_.pack ? ADC_REG_MODE_24BIT : ADC_REG_MODE_32BIT_COM;
+        write_adc_reg(ADC_REG_ENTER);
+        write_adc_reg(ADC_REG(0, ADC_REG_MODE_ADDR, mode));
+        write_adc_reg(ADC_REG_EXIT);
+        if (top_->adc_reg_access || top_->adc_mode != mode)
+            throw std::runtime_error("ADC not in the requested mode");
+
+        if (options_.pack)
+            flags |= PACKETIZER_PACK;
+        if (options_.header)
+            flags |= PACKETIZER_HEADER;
+        write(packetizer_packing, flags);
+        write(packetizer_config, options_.length);
+        write(fifo_control, ADC_FIFO_CLEAR);
+        if (zone == 1)
+            trigger |= ADC_TRIGGER_ZONE_1;
+        write(trigger_config, trigger);
+
+        // Every conversion has to be made within four times its period
+        limit = cycle_ + options_.samples * (divider + 1) * 4 + 100000;
+        write(trigger_divider, divider);
+        while (top_->adc_conversions < options_.samples) {
+            if (cycle_ >= limit)
+                throw std::runtime_error(
+                    "Only " + std::to_string(top_->adc_conversions) +
+                    " conversions with divider " + std::to_string(divider)
+                );
+            cycle();
+        }
+        write(trigger_divider, 0);
+        // Drain until the DMA saw nothing for a while
+        while (idle < options_.latency + 1000) {
+            idle = top_->m_axis_s2mm_tvalid ? 0 : idle + 1;
+            if (cycle_ >= limit)
+                throw std::runtime_error("Chain not drained in time");
+            cycle();
+        }
+
+        result.divider = divider;
+        result.zone = zone;
+        result.achieved_hz = checker_.rate() * ADC_CLK_FREQ_HZ;
+        result.skipped = cnv_.skipped(*top_, divider);
+        result.stalls = sink_.stalls();
+        result.lost = checker_.lost();
+        result.dropped = read(fifo_dropped);
+        result.corrupted = checker_.corrupted();
+        result.high_water = read(fifo_high_water);
+        return result;
+    }
+
+  private:
+    void half_cycle(bool rising) {
+        top_->aclk = rising;
+        top_->eval();
+        if (rising)
+            sink_.drive(*top_);
+        top_->eval();
+    }
+
+    void cycle() {
+        std::uint32_t data;
+        bool last;
+        // Handshakes complete with the values before the rising edge
+        if (sink_.sample(*top_, data, last))
+            checker_.word(data, last, cycle_);
+        cnv_.sample(*top_, cycle_);
+        half_cycle(true);
+        half_cycle(false);
+        cycle_++;
+    }
+
+    void wait_for(const std::function<bool()> &done, const char *what) {
+        for (unsigned int i = 0; !done(); i++) {
+            if (i > 10000)
+                throw std::runtime_error(std::string("Timeout on ") + what);
+            cycle();
+        }
+    }
+
+    void reset() {
+        top_->aresetn = 0;
+        for (int i = 0; i < 8; i++)
+            cycle();
+        top_->aresetn = 1;
+        for (int i = 0; i < 8; i++)
+            cycle();
+    }
+
+    // The valid signals are only raised once the block is ready, such that
+    // 'adc_config' sees a single write while a register access is pending
+    void write(std::uint32_t addr, std::uint32_t data) {
+        std::uint8_t resp;
+        top_->s_axi_lite_awaddr = addr;
+        top_->s_axi_lite_wdata = data;
+        top_->s_axi_lite_wstrb = 0xF;
+        top_->s_axi_lite_bready = 1;
+        top_->eval();
+        wait_for(
+            [this] {
+                return top_->s_axi_lite_awready && top_->s_axi_lite_wready;
+            },
+            "write address"
+        );
+        top_->s_axi_lite_awvalid = 1;
+        top_->s_axi_lite_wvalid = 1;
+        cycle();
+        top_->s_axi_lite_awvalid = 0;
+        top_->s_axi_lite_wvalid = 0;
+        wait_for([this] { return top_->s_axi_lite_bvalid; }, "write response");
+        resp = top_->s_axi_lite_bresp;
+        cycle();
+        top_->s_axi_lite_bready = 0;
+        if (resp != 0)
+            throw std::runtime_error(
+                "Write to 0x" + to_hex(addr) + " failed"
+            );
+    }
+
+    std::uint32_t read(std::uint32_t addr) {
+        std::uint32_t data;
+        std::uint8_t resp;
+        top_->s_axi_lite_araddr = addr;
+        top_->s_axi_lite_rready = 1;
+        top_->eval();
+        wait_for([this] { return top_->s_axi_lite_arready; }, "read address");
+        top_->s_axi_lite_arvalid = 1;
+        cycle();
+        top_->s_axi_lite_arvalid = 0;
+        wait_for([this] { return top_->s_axi_lite_rvalid; }, "read data");
+        data = top_->s_axi_lite_rdata;
+        resp = top_->s_axi_lite_rresp;
+        cycle();
+        top_->s_axi_lite_rready = 0;
+        if (resp != 0)
+            throw std::runtime_error(
+                "Read from 0x" + to_hex(addr) + " failed"
+            );
+        return data;
+    }
+
+    // Like 'write_adc_reg()', waits until the ADC saw the transaction
+    void write_adc_reg(std::uint32_t command) {
+        std::uint32_t before = top_->adc_transactions;
+        write(config_adc_reg, command);
+        wait_for(
+            [this, before] { return top_->adc_transactions != before; },
+            "register access"
+        );
+    }
+
+    static std::string to_hex(std::uint32_t value) {
+        char text[9];
+        std::snprintf(text, sizeof(text), "%03" PRIX32, value);
+        return text;
+    }
+
+    std::unique_ptr<Vadc_chain> top_;
+    CnvProbe cnv_;
+    DmaSink sink_;
+    StreamChecker checker_;
+    const Options &options_;
+    std::uint64_t cycle_ = 0;
+};
+
+// Like 'adc_sample_rate()', a conversion every 'divider + 1' cycles
+double sample_rate(std::uint32_t divider) {
+    return ADC_CLK_FREQ_HZ / static_cast<double>(divider + 1);
+}
+
+void usage(const char *name) {
+    std::printf(
+        "Usage: %s [OPTION...]\n"
+        "Throughput of the ADC datapath over a sweep of dividers\n"
+        "\n"
+        "  --min-div N     Lowest divider (default 16)\n"
+        "  --max-div N     Highest divider (default 40)\n"
+        "  --zone N        Only read out in zone 1 or 2 (default both)\n"
+        "  --ddr           Read out at double data rate\n"
+        "  --echo          Read out with the echo clock, at single data rate\n"
+        "  --pack          Pack four 24-bit samples into three words\n"
+        "  --header        Start every packet with a block header\n"
+        "  --length N      Samples per packet (default 4096)\n"
+        "  --samples N     Conversions per divider (default 16384)\n"
+        "  --latency N     Cycles until the DMA takes the next packet\n"
+        "                  (default 64)\n"
+        "  --stall P       Percent of cycles in which the DMA holds back a\n"
+        "                  word (default 0)\n"
+        "  --conv-time NS  Conversion time of the ADC (default 282)\n"
+        "  --seed N        Seed of the DMA stalls (default 1)\n"
+        "  --sustain DIV   Fail unless every divider from DIV up sustains\n"
+        "                  its sample rate\n"
+        "  --help          Show this help\n",
+        name
+    );
+}
+
+unsigned long parse(const char *arg, const char *option) {
+    char *end;
+    unsigned long value = std::strtoul(arg, &end, 0);
+    if (*arg == '\0' || *end != '\0')
+        throw std::runtime_error(
+            std::string("Invalid value for --") + option + ": '" + arg + "'"
+        );
+    return value;
+}
+
+Options parse_options(int argc, char **argv) {
+    static const struct option long_options[] = {
+        {"min-div", required_argument, nullptr, 'm'},
+        {"max-div", required_argument, nullptr, 'M'},
+        {"zone", required_argument, nullptr, 'z'},
+        {"ddr", no_argument, nullptr, 'd'},
+        {"echo", no_argument, nullptr, 'e'},
+        {"pack", no_argument, nullptr, 'p'},
+        {"header", no_argument, nullptr, 'H'},
+        {"length", required_argument, nullptr, 'l'},
+        {"samples", required_argument, nullptr, 'n'},
+        {"latency", required_argument, nullptr, 'L'},
+        {"stall", required_argument, nullptr, 'S'},
+        {"conv-time", required_argument, nullptr, 'c'},
+        {"seed", required_argument, nullptr, 'r'},
+        {"sustain", required_argument, nullptr, 'u'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    Options options;
+    int key;
+
+    while ((key = getopt_long(argc, argv, "", long_options, nullptr)) != -1) {
+        const char *name = long_options[0].name;
+        for (const struct option *o = long_options; o->name != nullptr; o++)
+            if (o->val == key)
+                name = o->name;
+        switch (key) {
+        case 'm':
+            options.min_div = parse(optarg, name);
+            break;
+        case 'M':
+            options.max_div = parse(optarg, name);
+            break;
+        case 'z':
+            options.zone = parse(optarg, name);
+            if (options.zone != 1 && options.zone != 2)
+                throw std::runtime_error("Zone has to be 1 or 2");
+            break;
+        case 'd':
+            options.ddr = true;
+            break;
+        case 'e':
+            options.echo = true;
+            options.ddr = false;
+            break;
+        case 'p':
+            options.pack = true;
+            break;
+        case 'H':
+            options.header = true;
+            break;
+        case 'l':
+            options.length = parse(optarg, name);
+            break;
+        case 'n':
+            options.samples = parse(optarg, name);
+            break;
+        case 'L':
+            options.latency = parse(optarg, name);
+            break;
+        case 'S':
+            options.stall = parse(optarg, name);
+            if (options.stall > 99)
+                throw std::runtime_error("Stall has to be below 100 percent");
+            break;
+        case 'c':
+            options.conv_time_ns = parse(optarg, name);
+            break;
+        case 'r':
+            options.seed = parse(optarg, name);
+            break;
+        case 'u':
+            options.sustain = parse(optarg, name);
+            break;
+        case 'h':
+            usage(argv[0]);
+            std::exit(0);
+        default:
+            usage(argv[0]);
+            std::exit(1);
+        }
+    }
+    if (options.min_div == 0 || options.min_div > options.max_div)
+        throw std::runtime_error("Invalid range of dividers");
+    if (options.length < 8)
+        throw std::runtime_error("Packets need at least 8 samples");
+    if (options.conv_time_ns <= 0.0 ||
+        std::ceil(options.conv_time_ns * ADC_CLK_FREQ_HZ / 1e9) > 255)
+        throw std::runtime_error("Invalid conversion time");
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    VerilatedContext context;
+    std::vector<Result> failed;
+    Options options;
+
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &error) {
+        std::fprintf(stderr, "Error: %s\n", error.what());
+        return 1;
+    }
+    context.commandArgs(argc, argv);
+
+    std::printf(
+        "%s, %s%s, %" PRIu32 " samples per packet, DMA latency %u cycles, "
+        "%u%% stalls\n",
+        options.echo ? "SDR with echo clock" : options.ddr ? "DDR" : "SDR",
+        options.pack ? "packed" : "32-bit words",
+        options.header ? ", block headers" : "",
+        options.length,
+        options.latency,
+        options.stall
+    );
+    std::printf(
+        "%7s %5s %15s %15s %8s %9s %8s %8s %10s %9s\n",
+        "divider",
+        "zone",
+        "sample_rate_hz",
+        "achieved_hz",
+        "skipped",
+        "stalls",
+        "lost",
+        "dropped",
+        "corrupted",
+        "fifo_max"
+    );
+    for (std::uint32_t div = options.max_div; div >= options.min_div; div--) {
+        for (unsigned int zone = 1; zone <= 2; zone++) {
+            Result result;
+            if (options.zone != 0 && zone != options.zone)
+                continue;
+            try {
+                Bench bench(context, options);
+                result = bench.run(div, zone);
+            } catch (const std::exception &error) {
+                std::fprintf(stderr, "Error: %s\n", error.what());
+                return 1;
+            }
+            std::printf(
+                "%7" PRIu32 " %5u %15.1f %15.1f %8" PRIu64 " %9" PRIu64
+                " %8" PRIu64 " %8" PRIu32 " %10" PRIu64 " %9" PRIu32 "\n",
+                result.divider,
+                result.zone,
+                sample_rate(result.divider),
+                result.achieved_hz,
+                result.skipped,
+                result.stalls,
+                result.lost,
+                result.dropped,
+                result.corrupted,
+                result.high_water
+            );
+            std::fflush(stdout);
+            if (options.sustain != 0 && div >= options.sustain &&
+                !result.sustained())
+                failed.push_back(result);
+        }
+    }
+    for (const Result &result : failed)
+        std::fprintf(
+            stderr,
+            "Error: Divider %" PRIu32 " in zone %u not sustained\n",
+            result.divider,
+            result.zone
+        );
+    return failed.empty() ? 0 : 1;
+}
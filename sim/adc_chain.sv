@@ -0,0 +1,394 @@
+`timescale 1ns / 1ps
+
+module adc_chain (
+    input  wire        aclk,
+    input  wire        aresetn,
+    // ADC model, see 'adc_model.sv'
+    input  wire [ 7:0] conv_cycles,
+    output wire        cnv,
+    output wire [31:0] adc_started,
+    output wire [31:0] adc_ignored,
+    output wire [31:0] adc_conversions,
+    output wire [31:0] adc_transactions,
+    output wire [ 7:0] adc_mode,
+    output wire        adc_reg_access,
+    // AXI-Stream (S2MM) data manager, in place of the DMA
+    output wire [31:0] m_axis_s2mm_tdata,
+    output wire        m_axis_s2mm_tvalid,
+    input  wire        m_axis_s2mm_tready,
+    output wire        m_axis_s2mm_tlast,
+    // AXI4-Lite subordinate of all blocks, in place of the PS
+    input  wire [31:0] s_axi_lite_awaddr,
+    input  wire        s_axi_lite_awvalid,
+    output wire        s_axi_lite_awready,
+
+    input  wire [31:0] s_axi_lite_wdata,
+    input  wire [ 3:0] s_axi_lite_wstrb,
+    input  wire        s_axi_lite_wvalid,
+    output wire        s_axi_lite_wready,
+
+    output wire [1:0] s_axi_lite_bresp,
+    output wire       s_axi_lite_bvalid,
+    input  wire       s_axi_lite_bready,
+
+    input  wire [31:0] s_axi_lite_araddr,
+    input  wire        s_axi_lite_arvalid,
+    output wire        s_axi_lite_arready,
+
+    output wire [31:0] s_axi_lite_rdata,
+    output wire [ 1:0] s_axi_lite_rresp,
+    output wire        s_axi_lite_rvalid,
+    input  wire        s_axi_lite_rready
+);
+    // The datapath of the single-stream 'adc' block design for the
+    // co-simulation in 'sim/adc_chain.cpp': the blocks are connected as in
+    // 'projects/adc/bd_adc.tcl', the ADC is modelled by 'adc_model' and the
+    // DMA by the harness.
+    //
+    // The AXI4-Lite interconnect is reduced to a decoder of bits 10:8 of the
+    // address, which selects the block in the order of the address map
+    // (0x000 'adc_config' to 0x600 'event_trigger'). The address has to be
+    // held until the response arrived. Nothing answers at 0x700.
+    localparam integer Blocks = 8;
+
+    wire [2:0] write_block = s_axi_lite_awaddr[10:8];
+    wire [2:0] read_block = s_axi_lite_araddr[10:8];
+    wire [Blocks-1:0] write_select = Blocks'(1) << write_block;
+    wire [Blocks-1:0] read_select = Blocks'(1) << read_block;
+
+    wire [Blocks-1:0] awready;
+    wire [Blocks-1:0] wready;
+    wire [Blocks-1:0] bvalid;
+    wire [Blocks-1:0] arready;
+    wire [Blocks-1:0] rvalid;
+    wire [1:0] bresp[Blocks];
+    wire [31:0] rdata[Blocks];
+    wire [1:0] rresp[Blocks];
+
+    assign awready[7] = 1'b0;
+    assign wready[7] = 1'b0;
+    assign bvalid[7] = 1'b0;
+    assign bresp[7] = 2'b10;
+    assign arready[7] = 1'b0;
+    assign rvalid[7] = 1'b0;
+    assign rdata[7] = 32'b0;
+    assign rresp[7] = 2'b10;
+
+    assign s_axi_lite_awready = awready[write_block];
+    assign s_axi_lite_wready = wready[write_block];
+    assign s_axi_lite_bvalid = bvalid[write_block];
+    assign s_axi_lite_bresp = bresp[write_block];
+    assign s_axi_lite_arready = arready[read_block];
+    assign s_axi_lite_rvalid = rvalid[read_block];
+    assign s_axi_lite_rdata = rdata[read_block];
+    assign s_axi_lite_rresp = rresp[read_block];
+
+    // Streams between the blocks
+    wire [31:0] reg_tdata;
+    wire        reg_tvalid;
+    wire        reg_tready;
+    wire [31:0] manager_tdata;
+    wire        manager_tvalid;
+    wire        manager_tready;
+    wire [31:0] stats_tdata;
+    wire        stats_tvalid;
+    wire        stats_tready;
+    wire [31:0] fifo_tdata;
+    wire        fifo_tvalid;
+    wire        fifo_tready;
+    wire [31:0] event_tdata;
+    wire        event_tvalid;
+    wire        event_tready;
+    wire [31:0] decimator_tdata;
+    wire        decimator_tvalid;
+    wire        decimator_tready;
+
+    wire [31:0] manager_status;
+    wire        manager_ready;
+    wire        fifo_ready;
+    wire        trigger;
+    wire        trigger_delayed;
+    wire        last;
+    wire [31:0] trigger_divider;
+    wire [31:0] trigger_config;
+
+    wire        busy;
+    wire [ 3:0] spi_sdi;
+    wire        spi_echo_clk;
+    wire        spi_sdo;
+    wire        spi_csn;
+    wire        spi_clk;
+
+    adc_model adc_model (
+        .aclk(aclk),
+        .conv_cycles(conv_cycles),
+        .cnv(cnv),
+        .busy(busy),
+        .sck(spi_clk),
+        .csn(spi_csn),
+        .sdi(spi_sdo),
+        .sdo(spi_sdi),
+        .sckout(spi_echo_clk),
+        .started(adc_started),
+        .ignored(adc_ignored),
+        .conversions(adc_conversions),
+        .transactions(adc_transactions),
+        .mode(adc_mode),
+        .reg_access(adc_reg_access)
+    );
+
+    adc_config adc_config (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .cfg(),
+        .status(manager_status),
+        .adc_resetn(),
+        .dma_resetn(),
+        .packetizer_resetn(),
+        .pwr_en(),
+        .ref_en(),
+        .io_en(),
+        .diffamp_en(),
+        .opamp_en(),
+        .m_axis_tdata(reg_tdata),
+        .m_axis_tvalid(reg_tvalid),
+        .m_axis_tready(reg_tready),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[0]),
+        .s_axi_lite_awready(awready[0]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[0]),
+        .s_axi_lite_wready(wready[0]),
+        .s_axi_lite_bresp(bresp[0]),
+        .s_axi_lite_bvalid(bvalid[0]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[0]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[0]),
+        .s_axi_lite_arready(arready[0]),
+        .s_axi_lite_rdata(rdata[0]),
+        .s_axi_lite_rresp(rresp[0]),
+        .s_axi_lite_rvalid(rvalid[0]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[0])
+    );
+
+    adc_manager adc_manager (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .trigger(trigger_delayed),
+        .spi_sdi(spi_sdi),
+        .spi_echo_clk(spi_echo_clk),
+        .spi_sdo(spi_sdo),
+        .spi_csn(spi_csn),
+        .spi_clk(spi_clk),
+        .spi_resetn(),
+        .s_axis_tdata(reg_tdata),
+        .s_axis_tvalid(reg_tvalid),
+        .s_axis_tready(reg_tready),
+        .m_axis_tdata(manager_tdata),
+        .m_axis_tvalid(manager_tvalid),
+        .m_axis_tready(manager_tready),
+        .status(manager_status),
+        .ready(manager_ready)
+    );
+
+    adc_trigger adc_trigger (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .trigger(trigger),
+        .cnv(cnv),
+        .busy(busy),
+        .last(last),
+        .ready(fifo_ready & manager_ready),
+        .divider(trigger_divider),
+        .cfg(trigger_config),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[1]),
+        .s_axi_lite_awready(awready[1]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[1]),
+        .s_axi_lite_wready(wready[1]),
+        .s_axi_lite_bresp(bresp[1]),
+        .s_axi_lite_bvalid(bvalid[1]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[1]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[1]),
+        .s_axi_lite_arready(arready[1]),
+        .s_axi_lite_rdata(rdata[1]),
+        .s_axi_lite_rresp(rresp[1]),
+        .s_axi_lite_rvalid(rvalid[1]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[1])
+    );
+
+    delay #(
+        .DELAY_CYCLES(1)
+    ) trigger_delay (
+        .clk(aclk),
+        .resetn(aresetn),
+        .signal_in(trigger),
+        .signal_out(trigger_delayed)
+    );
+
+    axis_stats axis_stats (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(manager_tdata),
+        .s_axis_data_tvalid(manager_tvalid),
+        .s_axis_data_tready(manager_tready),
+        .m_axis_data_tdata(stats_tdata),
+        .m_axis_data_tvalid(stats_tvalid),
+        .m_axis_data_tready(stats_tready),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[5]),
+        .s_axi_lite_awready(awready[5]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[5]),
+        .s_axi_lite_wready(wready[5]),
+        .s_axi_lite_bresp(bresp[5]),
+        .s_axi_lite_bvalid(bvalid[5]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[5]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[5]),
+        .s_axi_lite_arready(arready[5]),
+        .s_axi_lite_rdata(rdata[5]),
+        .s_axi_lite_rresp(rresp[5]),
+        .s_axi_lite_rvalid(rvalid[5]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[5])
+    );
+
+    axis_fifo axis_fifo (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(stats_tdata),
+        .s_axis_data_tvalid(stats_tvalid),
+        .s_axis_data_tready(stats_tready),
+        .m_axis_data_tdata(fifo_tdata),
+        .m_axis_data_tvalid(fifo_tvalid),
+        .m_axis_data_tready(fifo_tready),
+        .ready(fifo_ready),
+        .last(last),
+        .trigger_config(trigger_config),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[4]),
+        .s_axi_lite_awready(awready[4]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[4]),
+        .s_axi_lite_wready(wready[4]),
+        .s_axi_lite_bresp(bresp[4]),
+        .s_axi_lite_bvalid(bvalid[4]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[4]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[4]),
+        .s_axi_lite_arready(arready[4]),
+        .s_axi_lite_rdata(rdata[4]),
+        .s_axi_lite_rresp(rresp[4]),
+        .s_axi_lite_rvalid(rvalid[4]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[4])
+    );
+
+    event_trigger event_trigger (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(fifo_tdata),
+        .s_axis_data_tvalid(fifo_tvalid),
+        .s_axis_data_tready(fifo_tready),
+        .m_axis_data_tdata(event_tdata),
+        .m_axis_data_tvalid(event_tvalid),
+        .m_axis_data_tready(event_tready),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[6]),
+        .s_axi_lite_awready(awready[6]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[6]),
+        .s_axi_lite_wready(wready[6]),
+        .s_axi_lite_bresp(bresp[6]),
+        .s_axi_lite_bvalid(bvalid[6]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[6]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[6]),
+        .s_axi_lite_arready(arready[6]),
+        .s_axi_lite_rdata(rdata[6]),
+        .s_axi_lite_rresp(rresp[6]),
+        .s_axi_lite_rvalid(rvalid[6]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[6])
+    );
+
+    decimator decimator (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(event_tdata),
+        .s_axis_data_tvalid(event_tvalid),
+        .s_axis_data_tready(event_tready),
+        .m_axis_data_tdata(decimator_tdata),
+        .m_axis_data_tvalid(decimator_tvalid),
+        .m_axis_data_tready(decimator_tready),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[3]),
+        .s_axi_lite_awready(awready[3]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[3]),
+        .s_axi_lite_wready(wready[3]),
+        .s_axi_lite_bresp(bresp[3]),
+        .s_axi_lite_bvalid(bvalid[3]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[3]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[3]),
+        .s_axi_lite_arready(arready[3]),
+        .s_axi_lite_rdata(rdata[3]),
+        .s_axi_lite_rresp(rresp[3]),
+        .s_axi_lite_rvalid(rvalid[3]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[3])
+    );
+
+    packetizer packetizer (
+        .aclk(aclk),
+        .aresetn(aresetn),
+        .s_axis_data_tdata(decimator_tdata),
+        .s_axis_data_tvalid(decimator_tvalid),
+        .s_axis_data_tready(decimator_tready),
+        .m_axis_s2mm_tdata(m_axis_s2mm_tdata),
+        .m_axis_s2mm_tvalid(m_axis_s2mm_tvalid),
+        .m_axis_s2mm_tready(m_axis_s2mm_tready),
+        .m_axis_s2mm_tlast(m_axis_s2mm_tlast),
+        .last(last),
+        .ready(),
+        .trigger_divider(trigger_divider),
+        .trigger_config(trigger_config),
+        .s_axi_lite_awaddr(s_axi_lite_awaddr),
+        .s_axi_lite_awprot(3'b0),
+        .s_axi_lite_awvalid(s_axi_lite_awvalid & write_select[2]),
+        .s_axi_lite_awready(awready[2]),
+        .s_axi_lite_wdata(s_axi_lite_wdata),
+        .s_axi_lite_wstrb(s_axi_lite_wstrb),
+        .s_axi_lite_wvalid(s_axi_lite_wvalid & write_select[2]),
+        .s_axi_lite_wready(wready[2]),
+        .s_axi_lite_bresp(bresp[2]),
+        .s_axi_lite_bvalid(bvalid[2]),
+        .s_axi_lite_bready(s_axi_lite_bready & write_select[2]),
+        .s_axi_lite_araddr(s_axi_lite_araddr),
+        .s_axi_lite_arprot(3'b0),
+        .s_axi_lite_arvalid(s_axi_lite_arvalid & read_select[2]),
+        .s_axi_lite_arready(arready[2]),
+        .s_axi_lite_rdata(rdata[2]),
+        .s_axi_lite_rresp(rresp[2]),
+        .s_axi_lite_rvalid(rvalid[2]),
+        .s_axi_lite_rready(s_axi_lite_rready & read_select[2])
+    );
+endmodule
@@ -0,0 +1,107 @@
+`timescale 1ns / 1ps
+
+module adc_model (
+    input  wire        aclk,
+    // Conversion time in 'aclk' cycles, at least 1
+    input  wire [ 7:0] conv_cycles,
+    input  wire        cnv,
+    output reg         busy = 1'b0,
+
+    input  wire        sck,
+    input  wire        csn,
+    input  wire        sdi,
+    output wire [ 3:0] sdo,
+    output wire        sckout,
+
+    // Conversions started, ignored (CNV during a conversion) and done
+    output reg  [31:0] started = 32'b0,
+    output reg  [31:0] ignored = 32'b0,
+    output reg  [31:0] conversions = 32'b0,
+    // SPI transactions, the mode register and the register access mode
+    output reg  [31:0] transactions = 32'b0,
+    output reg  [ 7:0] mode = 8'b0,
+    output reg         reg_access = 1'b0
+);
+    // Behavioural model of the AD4030-24 for the co-simulation of the
+    // datapath, without delays. Unlike 'adc_impl' of 'adc_manager_tb.sv',
+    // every conversion has a distinct result: conversion 'n' returns
+    // {n[23:0], check(n)}, which replaces the output register at the end of
+    // the conversion. The output register is shifted out on the four lanes
+    // while CSn is low, the first group right after the falling edge of CSn,
+    // the next one after every rising edge of SCK (and every falling edge in
+    // DDR mode). A conversion that ends during a read-out changes the groups
+    // that are still to come, like on the ADC. Only the four-lane mode is
+    // modelled, register accesses are decoded like in 'adc_impl'.
+    localparam reg [14:0] ExitReg = 15'h0014;
+    localparam reg [14:0] ModeReg = 15'h0020;
+    localparam reg [1:0] ClkModeEcho = 2'b01;
+    localparam reg [3:0] Groups = 4'd8;
+
+    function automatic [7:0] check(input [23:0] index);
+        check = index[7:0] ^ index[15:8] ^ index[23:16] ^ 8'hA5;
+    endfunction
+
+    reg         cnv_last = 1'b0;
+    reg  [ 7:0] remaining = 8'b0;
+    reg  [31:0] result = 32'b0;
+    reg  [23:0] reg_command = 24'b0;
+    reg  [ 3:0] group = 4'b0;
+    wire        ddr = mode[3];
+    wire        sck_fall = ddr & ~sck;
+    wire [ 3:0] lanes = result[31-4*group-:4];
+
+    // Group 0 is the most significant one, the lanes are in reverse order
+    assign sdo = (csn || reg_access || group >= Groups) ? 4'b0 : {<<{lanes}};
+    assign sckout = sck & (mode[5:4] == ClkModeEcho);
+
+    always @(posedge aclk) begin
+        cnv_last <= cnv;
+        if (busy) begin
+            if (remaining == 1) begin
+                busy <= 0;
+                result <= {conversions[23:0], check(conversions[23:0])};
+                conversions <= conversions + 1;
+            end else begin
+                remaining <= remaining - 1;
+            end
+        end
+        if (cnv && !cnv_last) begin
+            if (busy && remaining != 1) begin
+                ignored <= ignored + 1;
+            end else begin
+                busy <= 1;
+                remaining <= conv_cycles;
+                started <= started + 1;
+            end
+        end
+    end
+
+    always @(posedge sck or posedge sck_fall or posedge csn) begin
+        if (csn) begin
+            group <= 0;
+        end else if (group != Groups) begin
+            group <= group + 1;
+        end
+    end
+
+    always @(posedge sck or negedge csn) begin
+        if (!csn && !sck) begin
+            reg_command <= 0;
+        end else if (!csn) begin
+            reg_command <= {reg_command[22:0], sdi};
+        end
+    end
+
+    always @(posedge csn) begin
+        transactions <= transactions + 1;
+        if (reg_command[23:21] == 3'b101) begin
+            reg_access <= 1;
+        end else if (reg_access) begin
+            if (reg_command[23:8] == {1'b0, ModeReg}) begin
+                mode <= reg_command[7:0];
+            end else if (reg_command[23:8] == {1'b0, ExitReg} && reg_command[0]) begin
+                reg_access <= 0;
+            end
+        end
+    end
+endmodule